@@ -85,12 +85,21 @@ LexRec, *LexPtr;
          a = NULL;   \
     }
 
+/* comments must be freed with xconfigFreeComment(); see xconfigAddComment() */
+
+#define FREE_COMMENT(a)          \
+    if (a) {                     \
+        xconfigFreeComment (a);  \
+        a = NULL;                \
+    }
+
 
 #define PARSE_PROLOGUE(typeptr,typerec)                         \
     typeptr ptr;                                                \
     if ((ptr = (typeptr) calloc(1, sizeof(typerec))) == NULL) { \
         return NULL;                                            \
     }                                                           \
+    xconfigCountAlloc(sizeof(typerec));                         \
     memset(ptr, 0, sizeof(typerec));
 
 
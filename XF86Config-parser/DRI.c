@@ -134,7 +134,7 @@ xconfigFreeDRI (XConfigDRIPtr *ptr)
         return;
     
     xconfigFreeBuffersList (&((*ptr)->buffers));
-    TEST_FREE ((*ptr)->comment);
+    FREE_COMMENT ((*ptr)->comment);
     free (*ptr);
     *ptr = NULL;
 }
@@ -149,7 +149,7 @@ xconfigFreeBuffersList (XConfigBuffersPtr *ptr)
 
     while (*ptr) {
         TEST_FREE ((*ptr)->flags);
-        TEST_FREE ((*ptr)->comment);
+        FREE_COMMENT ((*ptr)->comment);
         prev = *ptr;
         *ptr  = (*ptr)->next;
         free (prev);
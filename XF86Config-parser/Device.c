@@ -232,6 +232,8 @@ xconfigParseDeviceSection (void)
             if (xconfigGetSubToken (&(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "BusID");
             ptr->busid = val.str;
+            if (!xconfigParsePciAddress(ptr->busid, &ptr->pciaddr))
+                ptr->pciaddr = 0;
             break;
         case IRQ:
             if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
@@ -264,6 +266,7 @@ void
 xconfigPrintDeviceSection (FILE * cf, XConfigDevicePtr ptr)
 {
     int i;
+    char num[32];
 
     while (ptr)
     {
@@ -288,7 +291,9 @@ xconfigPrintDeviceSection (FILE * cf, XConfigDevicePtr ptr)
             fprintf (cf, "    DacSpeed    ");
             for (i = 0; i < CONF_MAXDACSPEEDS
                     && ptr->dacSpeeds[i] > 0; i++ )
-                fprintf (cf, "%g ", (double) (ptr->dacSpeeds[i])/ 1000.0 );
+                fprintf (cf, "%s ",
+                         xconfigFormatRealShort (num, sizeof(num),
+                                 (double) (ptr->dacSpeeds[i]) / 1000.0, 6));
             fprintf (cf, "\n");
         }
         if (ptr->videoram)
@@ -310,12 +315,15 @@ xconfigPrintDeviceSection (FILE * cf, XConfigDevicePtr ptr)
         if (ptr->clocks > 0 ) {
             fprintf (cf, "    Clocks      ");
             for (i = 0; i < ptr->clocks; i++ )
-                fprintf (cf, "%.1f ", (double)ptr->clock[i] / 1000.0 );
+                fprintf (cf, "%s ",
+                         xconfigFormatReal (num, sizeof(num),
+                                 (double) ptr->clock[i] / 1000.0, 1));
             fprintf (cf, "\n");
         }
         if (ptr->textclockfreq) {
-            fprintf (cf, "    TextClockFreq %.1f\n",
-                     (double)ptr->textclockfreq / 1000.0);
+            fprintf (cf, "    TextClockFreq %s\n",
+                     xconfigFormatReal (num, sizeof(num),
+                             (double) ptr->textclockfreq / 1000.0, 1));
         }
         if (ptr->busid)
             fprintf (cf, "    BusID          \"%s\"\n", ptr->busid);
@@ -346,7 +354,7 @@ xconfigFreeDeviceList (XConfigDevicePtr *ptr)
         TEST_FREE ((*ptr)->driver);
         TEST_FREE ((*ptr)->ramdac);
         TEST_FREE ((*ptr)->clockchip);
-        TEST_FREE ((*ptr)->comment);
+        FREE_COMMENT ((*ptr)->comment);
         xconfigFreeOptionList (&((*ptr)->options));
 
         prev = *ptr;
@@ -398,8 +406,8 @@ xconfigFindDevice (const char *ident, XConfigDevicePtr p)
 
 static int isPci(const char* busID, const char **retID)
 {
-    char *p, *s;
-    int ret = FALSE;
+    char prefix[16];
+    size_t len;
 
     /* If no type field, Default to PCI */
     if (isdigit(busID[0])) {
@@ -408,98 +416,177 @@ static int isPci(const char* busID, const char **retID)
 	return TRUE;
     }
     
-    s = strdup(busID);
-    p = strtok(s, ":");
-    if (p == NULL || *p == 0) {
-	free(s);
+    /* the type field is everything up to the first ':' */
+    len = strcspn(busID, ":");
+    if (len == 0 || len >= sizeof(prefix))
 	return FALSE;
-    }
-    if (!xconfigNameCompare(p, "pci") || !xconfigNameCompare(p, "agp")) {
+
+    memcpy(prefix, busID, len);
+    prefix[len] = '\0';
+
+    if (!xconfigNameCompare(prefix, "pci") ||
+        !xconfigNameCompare(prefix, "agp")) {
         if (retID)
-	    *retID = busID + strlen(p) + 1;
-        ret = TRUE;
+	    *retID = busID + len + (busID[len] ? 1 : 0);
+        return TRUE;
     }
-    free(s);
-    return ret;
+    return FALSE;
 }
 
 
 /*
- * Parse a BUS ID string, and return the PCI bus parameters if it was
- * in the correct format for a PCI bus id.
+ * parseDecimal() - parse a run of decimal digits starting at *s, which
+ * must extend to the end of the token (the next ':' or the end of the
+ * string); on success, the value is stored in val and *s is advanced
+ * past the digits.  An empty run is parsed as 0.
  */
 
-int xconfigParsePciBusString(const char *busID,
-                             int *bus, int *device, int *func)
+static int parseDecimal(const char **s, int *val)
 {
-    /*
-     * The format is assumed to be "bus[@domain]:device[:func]", where domain,
-     * bus, device and func are decimal integers. func may be omitted and
-     * assumed to be zero.
-     */
-    
-    char *p, *s, *d;
-    const char *id;
-    int i;
-    
-    if (!isPci(busID, &id))
+    const char *p = *s;
+    int v = 0;
+
+    while (isdigit(*p))
+	v = v * 10 + (*p++ - '0');
+
+    if (*p != ':' && *p != '\0')
 	return FALSE;
-    
-    s = strdup(id);
-    p = strtok(s, ":");
-    if (p == NULL || *p == 0) {
-	free(s);
+
+    *val = v;
+    *s = p;
+    return TRUE;
+}
+
+
+/*
+ * skipSeparators() - skip a run of ':' separators; returns FALSE if
+ * there is no further token.
+ */
+
+static int skipSeparators(const char **s)
+{
+    while (**s == ':')
+	(*s)++;
+
+    return (**s != '\0');
+}
+
+
+/*
+ * parsePciBusString() - parse a BUS ID string of the form
+ * "[PCI:]bus[@domain]:device[:func]", where domain, bus, device and
+ * func are decimal integers; func may be omitted and is then assumed
+ * to be zero.  As with strtok(3), runs of ':' separate tokens.  This
+ * does not allocate any memory.
+ */
+
+static int parsePciBusString(const char *busID, int *domain, int *bus,
+                             int *device, int *func)
+{
+    const char *p;
+    int b = 0;
+
+    if (!busID || !isPci(busID, &p) || !skipSeparators(&p))
 	return FALSE;
-    }
-    d = strpbrk(p, "@");
-    if (d != NULL) {
-	*(d++) = 0;
-	for (i = 0; d[i] != 0; i++) {
-	    if (!isdigit(d[i])) {
-		free(s);
-		return FALSE;
-	    }
-	}
-    }
-    for (i = 0; p[i] != 0; i++) {
-	if (!isdigit(p[i])) {
-	    free(s);
+
+    while (isdigit(*p))
+	b = b * 10 + (*p++ - '0');
+
+    *domain = 0;
+    if (*p == '@') {
+	p++;
+	if (!parseDecimal(&p, domain))
 	    return FALSE;
-	}
-    }
-    *bus = atoi(p);
-    if (d != NULL && *d != 0)
-	*bus += atoi(d) << 8;
-    p = strtok(NULL, ":");
-    if (p == NULL || *p == 0) {
-	free(s);
+    } else if (*p != ':' && *p != '\0') {
 	return FALSE;
     }
-    for (i = 0; p[i] != 0; i++) {
-	if (!isdigit(p[i])) {
-	    free(s);
-	    return FALSE;
-	}
-    }
-    *device = atoi(p);
+    *bus = b;
+
+    if (!skipSeparators(&p) || !isdigit(*p) || !parseDecimal(&p, device))
+	return FALSE;
+
     *func = 0;
-    p = strtok(NULL, ":");
-    if (p == NULL || *p == 0) {
-	free(s);
+    if (!skipSeparators(&p))
 	return TRUE;
-    }
-    for (i = 0; p[i] != 0; i++) {
-	if (!isdigit(p[i])) {
-	    free(s);
-	    return FALSE;
-	}
-    }
-    *func = atoi(p);
-    free(s);
+
+    /* anything after the function is ignored */
+    return (isdigit(*p) && parseDecimal(&p, func));
+}
+
+
+/*
+ * Parse a BUS ID string, and return the PCI bus parameters if it was
+ * in the correct format for a PCI bus id.  The domain, if any, is
+ * folded into the upper bits of bus.
+ */
+
+int xconfigParsePciBusString(const char *busID,
+                             int *bus, int *device, int *func)
+{
+    int domain, b, d, f;
+
+    if (!parsePciBusString(busID, &domain, &b, &d, &f))
+	return FALSE;
+
+    *bus = b + (domain << 8);
+    *device = d;
+    *func = f;
+    return TRUE;
+}
+
+
+/*
+ * xconfigParsePciAddress() - parse a BUS ID string into a packed PCI
+ * address; returns FALSE if it is not a valid PCI bus id.
+ */
+
+int xconfigParsePciAddress(const char *busID, XConfigPciAddress *addr)
+{
+    int domain, bus, device, func;
+
+    if (!parsePciBusString(busID, &domain, &bus, &device, &func))
+	return FALSE;
+
+    *addr = XCONFIG_PCI_ADDRESS(domain, bus, device, func);
     return TRUE;
 }
 
 
+/*
+ * xconfigGetDevicePciAddress() - return the packed PCI address of the
+ * device's BusID, or 0 if it has none.  The address is normally
+ * recorded when the BusID is parsed or assigned; otherwise, it is
+ * parsed from the BusID here and recorded.
+ */
+
+XConfigPciAddress xconfigGetDevicePciAddress(XConfigDevicePtr device)
+{
+    if (!device || !device->busid)
+	return 0;
+
+    if (!device->pciaddr &&
+        !xconfigParsePciAddress(device->busid, &device->pciaddr))
+	device->pciaddr = 0;
+
+    return device->pciaddr;
+}
+
+
+/*
+ * xconfigFormatPciAddress() - format a packed PCI address as a BusID
+ * string; see xconfigFormatPciBusString().
+ */
+
+void xconfigFormatPciAddress(char *str, int len, XConfigPciAddress addr)
+{
+    xconfigFormatPciBusString(str, len,
+                              XCONFIG_PCI_DOMAIN(addr),
+                              XCONFIG_PCI_BUS(addr),
+                              XCONFIG_PCI_DEVICE(addr),
+                              XCONFIG_PCI_FUNC(addr));
+}
+
+
 /*
  * xconfigFormatPciBusString : The function checks for the availability
  * of PCI domain & accordingly formats the busid string.
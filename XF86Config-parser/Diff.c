@@ -0,0 +1,1956 @@
+/*
+ * nvidia-xconfig: A tool for manipulating X config files,
+ * specifically for use by the NVIDIA Linux graphics driver.
+ *
+ * Copyright (C) 2005 NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>.
+ *
+ *
+ * Diff.c - compute the structural difference between two X configs as
+ * a patch, and apply such a patch to an X config.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "xf86Parser.h"
+#include "xf86tokens.h"
+#include "Configint.h"
+
+extern LexRec val;
+
+
+/*
+ * A patch is read with the X config scanner, so it uses the lexical
+ * syntax of an X config file: keywords, quoted strings, numbers, and
+ * '#' comments.  It is a sequence of records of the form
+ *
+ *     Section "Device"
+ *         Identifier     "Device0"
+ *         BoardName      "Quadro"
+ *         Option         "Coolbits" "4"
+ *         RemoveOption   "NoLogo"
+ *     EndSection
+ *
+ *     RemoveSection "Monitor" "Monitor1"
+ *
+ * Sections are matched by Identifier; a Section record creates the
+ * section if the config does not have it, and otherwise changes only
+ * the fields it lists.  The fields covered are:
+ *
+ *     all sections    Option "name" ["value"], RemoveOption "name"
+ *     Monitor         VendorName, ModelName, HorizSync, VertRefresh
+ *     Device          Driver, VendorName, BoardName, BusID, Screen
+ *     Screen          Device, Monitor, DefaultDepth,
+ *                     Modes <depth> "mode" ..., RemoveDisplay <depth>
+ *     InputDevice     Driver
+ *     ServerLayout    Screen lines, as in an X config file; if a record
+ *                     has any, they replace the layout's screen list
+ *
+ * ServerFlags and Extensions records have no Identifier, and only
+ * change options.  An empty string unsets a string field, and a
+ * HorizSync or VertRefresh line replaces the whole list of ranges.
+ * Other sections (Files, Module, Modes, DRI, ...) and the other fields
+ * of the sections above (e.g., the modelines of Monitor sections, or
+ * the Virtual size of Display subsections) cannot be patched;
+ * xconfigDiffConfigs() refuses to diff configs that differ in them.
+ */
+
+enum {
+    PATCH_FLAGS = 0,
+    PATCH_EXTENSIONS,
+    PATCH_MONITOR,
+    PATCH_DEVICE,
+    PATCH_SCREEN,
+    PATCH_INPUT,
+    PATCH_LAYOUT,
+    PATCH_NUM_SECTIONS
+};
+
+/* sections from PATCH_MONITOR on are matched by Identifier */
+
+#define PATCH_HAS_IDENTIFIER(type) ((type) >= PATCH_MONITOR)
+
+static const char *PatchSectionNames[PATCH_NUM_SECTIONS] = {
+    "ServerFlags",
+    "Extensions",
+    "Monitor",
+    "Device",
+    "Screen",
+    "InputDevice",
+    "ServerLayout",
+};
+
+static XConfigSymTabRec PatchTab[] =
+{
+    {SECTION, "section"},
+    {ENDSECTION, "endsection"},
+    {REMOVESECTION, "removesection"},
+    {IDENTIFIER, "identifier"},
+    {OPTION, "option"},
+    {REMOVEOPTION, "removeoption"},
+    {VENDOR, "vendorname"},
+    {MODEL, "modelname"},
+    {HORIZSYNC, "horizsync"},
+    {VERTREFRESH, "vertrefresh"},
+    {DRIVER, "driver"},
+    {BOARD, "boardname"},
+    {BUSID, "busid"},
+    {SCREEN, "screen"},
+    {MDEVICE, "device"},
+    {MONITOR, "monitor"},
+    {DEFAULTDEPTH, "defaultdepth"},
+    {MODES, "modes"},
+    {REMOVEDISPLAY, "removedisplay"},
+    {RIGHTOF, "rightof"},
+    {LEFTOF, "leftof"},
+    {ABOVE, "above"},
+    {BELOW, "below"},
+    {RELATIVE, "relative"},
+    {ABSOLUTE, "absolute"},
+    {-1, ""},
+};
+
+
+
+/*
+ * Diff
+ */
+
+typedef struct {
+    FILE *fp;
+    const char *type;       /* section name of the current record */
+    const char *identifier; /* identifier of the current record, if any */
+    int open;               /* the current record's header is written */
+    int count;              /* number of records written */
+    const char *uncovered;  /* section differing in an uncovered field */
+    int error;              /* out of memory */
+} DiffStateRec, *DiffStatePtr;
+
+
+
+/*
+ * diff_begin() - start the record for the named section; nothing is
+ * written until the record has something to say.
+ */
+
+static void diff_begin(DiffStatePtr state, int type, const char *identifier)
+{
+    state->type = PatchSectionNames[type];
+    state->identifier = identifier;
+    state->open = FALSE;
+
+} /* diff_begin() */
+
+
+
+/*
+ * diff_open() - write the header of the current record, if it has not
+ * been written yet.
+ */
+
+static void diff_open(DiffStatePtr state)
+{
+    if (state->open) return;
+
+    fprintf(state->fp, "Section \"%s\"\n", state->type);
+    if (state->identifier) {
+        fprintf(state->fp, "    Identifier     \"%s\"\n", state->identifier);
+    }
+    state->open = TRUE;
+
+} /* diff_open() */
+
+
+
+/*
+ * diff_end() - close the current record, if anything was written.
+ */
+
+static void diff_end(DiffStatePtr state)
+{
+    if (!state->open) return;
+
+    fprintf(state->fp, "EndSection\n\n");
+    state->open = FALSE;
+    state->count++;
+
+} /* diff_end() */
+
+
+
+/*
+ * diff_remove() - write a record removing the named section.
+ */
+
+static void diff_remove(DiffStatePtr state, int type, const char *identifier)
+{
+    fprintf(state->fp, "RemoveSection \"%s\" \"%s\"\n\n",
+            PatchSectionNames[type], identifier);
+    state->count++;
+
+} /* diff_remove() */
+
+
+
+static int strings_differ(const char *s0, const char *s1)
+{
+    if (!s0 || !s1) return (s0 != s1);
+    return (strcmp(s0, s1) != 0);
+}
+
+
+
+static void diff_string(DiffStatePtr state, const char *keyword,
+                        const char *from, const char *to)
+{
+    if (!strings_differ(from, to)) return;
+
+    diff_open(state);
+    fprintf(state->fp, "    %-14s \"%s\"\n", keyword, to ? to : "");
+}
+
+
+
+static void diff_int(DiffStatePtr state, const char *keyword,
+                     int from, int to)
+{
+    if (from == to) return;
+
+    diff_open(state);
+    fprintf(state->fp, "    %-14s %d\n", keyword, to);
+}
+
+
+
+/*
+ * diff_ranges() - write the list of ranges 'to' on one line if it
+ * differs from 'from'.  The values are written with enough digits to
+ * read back as the same floats.
+ */
+
+static void diff_ranges(DiffStatePtr state, const char *keyword,
+                        int n_from, const parser_range *from,
+                        int n_to, const parser_range *to)
+{
+    char lo[32], hi[32];
+    int i;
+
+    if (n_from == n_to) {
+        for (i = 0; i < n_to; i++) {
+            if (from[i].lo != to[i].lo || from[i].hi != to[i].hi) break;
+        }
+        if (i == n_to) return;
+    }
+
+    diff_open(state);
+    fprintf(state->fp, "    %-14s", keyword);
+
+    for (i = 0; i < n_to; i++) {
+        xconfigFormatRealShort(lo, sizeof(lo), to[i].lo, 9);
+        if (to[i].lo == to[i].hi) {
+            fprintf(state->fp, " %s", lo);
+        } else {
+            xconfigFormatRealShort(hi, sizeof(hi), to[i].hi, 9);
+            fprintf(state->fp, " %s - %s", lo, hi);
+        }
+        if (i + 1 < n_to) fputc(',', state->fp);
+    }
+    fputc('\n', state->fp);
+
+} /* diff_ranges() */
+
+
+
+/*
+ * diff_options() - write the options of 'to' that are not in 'from' or
+ * have a different value there, and remove the options of 'from' that
+ * are not in 'to'.  Options are matched by normalized name.
+ */
+
+static void diff_options(DiffStatePtr state,
+                         XConfigOptionPtr from, XConfigOptionPtr to)
+{
+    XConfigOptionPtr opt, old;
+
+    for (opt = to; opt; opt = opt->next) {
+        old = xconfigFindOption(from, opt->name);
+        if (old && !strings_differ(old->val, opt->val)) continue;
+
+        diff_open(state);
+        if (opt->val) {
+            fprintf(state->fp, "    Option         \"%s\" \"%s\"\n",
+                    opt->name, opt->val);
+        } else {
+            fprintf(state->fp, "    Option         \"%s\"\n", opt->name);
+        }
+    }
+
+    for (opt = from; opt; opt = opt->next) {
+        if (xconfigFindOption(to, opt->name)) continue;
+
+        diff_open(state);
+        fprintf(state->fp, "    RemoveOption   \"%s\"\n", opt->name);
+    }
+
+} /* diff_options() */
+
+
+
+static void diff_monitor(DiffStatePtr state, XConfigMonitorPtr from,
+                         XConfigMonitorPtr to)
+{
+    diff_string(state, "VendorName", from->vendor, to->vendor);
+    diff_string(state, "ModelName", from->modelname, to->modelname);
+    diff_ranges(state, "HorizSync", from->n_hsync, from->hsync,
+                to->n_hsync, to->hsync);
+    diff_ranges(state, "VertRefresh", from->n_vrefresh, from->vrefresh,
+                to->n_vrefresh, to->vrefresh);
+    diff_options(state, from->options, to->options);
+}
+
+
+
+static void diff_device(DiffStatePtr state, XConfigDevicePtr from,
+                        XConfigDevicePtr to)
+{
+    diff_string(state, "Driver", from->driver, to->driver);
+    diff_string(state, "VendorName", from->vendor, to->vendor);
+    diff_string(state, "BoardName", from->board, to->board);
+    diff_string(state, "BusID", from->busid, to->busid);
+    diff_int(state, "Screen", from->screen, to->screen);
+    diff_options(state, from->options, to->options);
+}
+
+
+
+static XConfigDisplayPtr find_display(XConfigDisplayPtr display, int depth)
+{
+    for (; display; display = display->next) {
+        if (display->depth == depth) return display;
+    }
+    return NULL;
+}
+
+
+
+static int modes_differ(XConfigModePtr m0, XConfigModePtr m1)
+{
+    while (m0 && m1) {
+        if (strings_differ(m0->mode_name, m1->mode_name)) return TRUE;
+        m0 = m0->next;
+        m1 = m1->next;
+    }
+    return (m0 != m1);
+}
+
+
+
+/*
+ * diff_displays() - write the mode list of each display subsection of
+ * 'to' whose modes differ from those of 'from' for the same depth, and
+ * remove the display subsections of 'from' for depths 'to' does not
+ * have.
+ */
+
+static void diff_displays(DiffStatePtr state, XConfigDisplayPtr from,
+                          XConfigDisplayPtr to)
+{
+    XConfigDisplayPtr display, old;
+    XConfigModePtr mode;
+
+    for (display = to; display; display = display->next) {
+        old = find_display(from, display->depth);
+        if (old && !modes_differ(old->modes, display->modes)) continue;
+
+        diff_open(state);
+        fprintf(state->fp, "    Modes          %d", display->depth);
+        for (mode = display->modes; mode; mode = mode->next) {
+            fprintf(state->fp, " \"%s\"", mode->mode_name);
+        }
+        fputc('\n', state->fp);
+    }
+
+    for (display = from; display; display = display->next) {
+        if (find_display(to, display->depth)) continue;
+
+        diff_open(state);
+        fprintf(state->fp, "    RemoveDisplay  %d\n", display->depth);
+    }
+
+} /* diff_displays() */
+
+
+
+static void diff_screen(DiffStatePtr state, XConfigScreenPtr from,
+                        XConfigScreenPtr to)
+{
+    diff_string(state, "Device", from->device_name, to->device_name);
+    diff_string(state, "Monitor", from->monitor_name, to->monitor_name);
+    diff_int(state, "DefaultDepth", from->defaultdepth, to->defaultdepth);
+    diff_displays(state, from->displays, to->displays);
+    diff_options(state, from->options, to->options);
+}
+
+
+
+static void diff_input(DiffStatePtr state, XConfigInputPtr from,
+                       XConfigInputPtr to)
+{
+    diff_string(state, "Driver", from->driver, to->driver);
+    diff_options(state, from->options, to->options);
+}
+
+
+
+static int adjacencies_differ(XConfigAdjacencyPtr a0, XConfigAdjacencyPtr a1)
+{
+    while (a0 && a1) {
+        if (a0->scrnum != a1->scrnum ||
+            a0->where != a1->where ||
+            a0->x != a1->x ||
+            a0->y != a1->y ||
+            strings_differ(a0->screen_name, a1->screen_name) ||
+            strings_differ(a0->refscreen, a1->refscreen) ||
+            strings_differ(a0->top_name, a1->top_name) ||
+            strings_differ(a0->bottom_name, a1->bottom_name) ||
+            strings_differ(a0->left_name, a1->left_name) ||
+            strings_differ(a0->right_name, a1->right_name)) {
+            return TRUE;
+        }
+        a0 = a0->next;
+        a1 = a1->next;
+    }
+    return (a0 != a1);
+}
+
+
+
+/*
+ * diff_adjacencies() - write the whole screen list of 'to' if it
+ * differs from that of 'from'.
+ */
+
+static void diff_adjacencies(DiffStatePtr state, XConfigAdjacencyPtr from,
+                             XConfigAdjacencyPtr to)
+{
+    XConfigAdjacencyPtr adj;
+    FILE *fp = state->fp;
+
+    if (!adjacencies_differ(from, to)) return;
+
+    diff_open(state);
+
+    for (adj = to; adj; adj = adj->next) {
+        fprintf(fp, "    Screen        ");
+        if (adj->scrnum >= 0) {
+            fprintf(fp, " %d", adj->scrnum);
+        }
+        fprintf(fp, " \"%s\"", adj->screen_name);
+
+        switch (adj->where) {
+        case CONF_ADJ_OBSOLETE:
+            fprintf(fp, " \"%s\" \"%s\" \"%s\" \"%s\"",
+                    adj->top_name, adj->bottom_name,
+                    adj->left_name, adj->right_name);
+            break;
+        case CONF_ADJ_ABSOLUTE:
+            fprintf(fp, " Absolute %d %d", adj->x, adj->y);
+            break;
+        case CONF_ADJ_RIGHTOF:
+            fprintf(fp, " RightOf \"%s\"", adj->refscreen);
+            break;
+        case CONF_ADJ_LEFTOF:
+            fprintf(fp, " LeftOf \"%s\"", adj->refscreen);
+            break;
+        case CONF_ADJ_ABOVE:
+            fprintf(fp, " Above \"%s\"", adj->refscreen);
+            break;
+        case CONF_ADJ_BELOW:
+            fprintf(fp, " Below \"%s\"", adj->refscreen);
+            break;
+        case CONF_ADJ_RELATIVE:
+            fprintf(fp, " Relative \"%s\" %d %d",
+                    adj->refscreen, adj->x, adj->y);
+            break;
+        }
+        fputc('\n', fp);
+    }
+
+} /* diff_adjacencies() */
+
+
+
+static void diff_layout(DiffStatePtr state, XConfigLayoutPtr from,
+                        XConfigLayoutPtr to)
+{
+    diff_adjacencies(state, from->adjacencies, to->adjacencies);
+    diff_options(state, from->options, to->options);
+}
+
+
+
+/*
+ * Differences that patches do not cover
+ */
+
+/*
+ * PRINTED_DIFFER() - set 'differ' to whether the sections 'from' and
+ * 'to' print differently with the given print function; if either
+ * cannot be printed, they are taken to differ.
+ */
+
+#define PRINTED_DIFFER(print, from, to, differ)                         \
+{                                                                       \
+    char *buf0 = NULL, *buf1 = NULL;                                    \
+    size_t len0 = 0, len1 = 0;                                          \
+    FILE *cf;                                                           \
+                                                                        \
+    if ((cf = open_memstream(&buf0, &len0)) != NULL) {                  \
+        print(cf, (from));                                              \
+        fclose(cf);                                                     \
+    }                                                                   \
+    if ((cf = open_memstream(&buf1, &len1)) != NULL) {                  \
+        print(cf, (to));                                                \
+        fclose(cf);                                                     \
+    }                                                                   \
+                                                                        \
+    (differ) = (!buf0 || !buf1 || (len0 != len1) ||                     \
+                (memcmp(buf0, buf1, len0) != 0));                       \
+                                                                        \
+    free(buf0);                                                         \
+    free(buf1);                                                         \
+}
+
+
+
+/*
+ * dri_differ() - whether the DRI sections differ; the DRI section is
+ * not written out, so it is compared field by field.
+ */
+
+static int dri_differ(XConfigDRIPtr d0, XConfigDRIPtr d1)
+{
+    XConfigBuffersPtr b0, b1;
+
+    if (!d0 || !d1) return (d0 != d1);
+
+    if (strings_differ(d0->group_name, d1->group_name) ||
+        d0->group != d1->group ||
+        d0->mode != d1->mode) {
+        return TRUE;
+    }
+
+    for (b0 = d0->buffers, b1 = d1->buffers; b0 && b1;
+         b0 = b0->next, b1 = b1->next) {
+        if (b0->count != b1->count ||
+            b0->size != b1->size ||
+            strings_differ(b0->flags, b1->flags)) {
+            return TRUE;
+        }
+    }
+    return (b0 != b1);
+
+} /* dri_differ() */
+
+
+
+/*
+ * modelines_differ() - whether the modeline lists differ in names or
+ * timings; comments are not compared.
+ */
+
+static int modelines_differ(XConfigModeLinePtr m0, XConfigModeLinePtr m1)
+{
+    for (; m0 && m1; m0 = m0->next, m1 = m1->next) {
+        if (m0 == m1) return FALSE;
+        if (strings_differ(m0->identifier, m1->identifier) ||
+            strings_differ(m0->clock, m1->clock) ||
+            m0->hdisplay != m1->hdisplay ||
+            m0->hsyncstart != m1->hsyncstart ||
+            m0->hsyncend != m1->hsyncend ||
+            m0->htotal != m1->htotal ||
+            m0->vdisplay != m1->vdisplay ||
+            m0->vsyncstart != m1->vsyncstart ||
+            m0->vsyncend != m1->vsyncend ||
+            m0->vtotal != m1->vtotal ||
+            m0->vscan != m1->vscan ||
+            m0->flags != m1->flags ||
+            m0->hskew != m1->hskew) {
+            return TRUE;
+        }
+    }
+    return (m0 != m1);
+
+} /* modelines_differ() */
+
+
+
+static int modes_links_differ(XConfigModesLinkPtr l0, XConfigModesLinkPtr l1)
+{
+    for (; l0 && l1; l0 = l0->next, l1 = l1->next) {
+        if (strings_differ(l0->modes_name, l1->modes_name)) return TRUE;
+    }
+    return (l0 != l1);
+}
+
+
+
+/*
+ * options_differ() - whether the option lists differ in the options
+ * they set, as diff_options() compares them.
+ */
+
+static int options_differ(XConfigOptionPtr o0, XConfigOptionPtr o1)
+{
+    XConfigOptionPtr opt, other;
+
+    for (opt = o1; opt; opt = opt->next) {
+        other = xconfigFindOption(o0, opt->name);
+        if (!other || strings_differ(other->val, opt->val)) return TRUE;
+    }
+    for (opt = o0; opt; opt = opt->next) {
+        if (!xconfigFindOption(o1, opt->name)) return TRUE;
+    }
+    return FALSE;
+
+} /* options_differ() */
+
+
+
+/*
+ * The *_uncovered_differ() functions return whether two sections with
+ * the same Identifier differ in a field that patches do not cover; the
+ * covered fields are left to the diff_*() functions above.  A section
+ * that only 'to' has is compared with the section a patch would create.
+ */
+
+static int monitor_uncovered_differ(XConfigMonitorPtr m0,
+                                    XConfigMonitorPtr m1)
+{
+    return (m0->width != m1->width ||
+            m0->height != m1->height ||
+            m0->gamma_red != m1->gamma_red ||
+            m0->gamma_green != m1->gamma_green ||
+            m0->gamma_blue != m1->gamma_blue ||
+            modelines_differ(m0->modelines, m1->modelines) ||
+            modes_links_differ(m0->modes_sections, m1->modes_sections));
+}
+
+
+
+static int device_uncovered_differ(XConfigDevicePtr d0, XConfigDevicePtr d1)
+{
+    int i;
+
+    if (strings_differ(d0->chipset, d1->chipset) ||
+        strings_differ(d0->card, d1->card) ||
+        strings_differ(d0->ramdac, d1->ramdac) ||
+        strings_differ(d0->clockchip, d1->clockchip) ||
+        d0->videoram != d1->videoram ||
+        d0->textclockfreq != d1->textclockfreq ||
+        d0->bios_base != d1->bios_base ||
+        d0->mem_base != d1->mem_base ||
+        d0->io_base != d1->io_base ||
+        d0->chipid != d1->chipid ||
+        d0->chiprev != d1->chiprev ||
+        d0->irq != d1->irq ||
+        d0->clocks != d1->clocks) {
+        return TRUE;
+    }
+
+    for (i = 0; i < CONF_MAXDACSPEEDS; i++) {
+        if (d0->dacSpeeds[i] != d1->dacSpeeds[i]) return TRUE;
+    }
+    for (i = 0; i < d1->clocks; i++) {
+        if (d0->clock[i] != d1->clock[i]) return TRUE;
+    }
+    return FALSE;
+
+} /* device_uncovered_differ() */
+
+
+
+static int rgb_differ(parser_rgb c0, parser_rgb c1)
+{
+    return (c0.red != c1.red || c0.green != c1.green || c0.blue != c1.blue);
+}
+
+
+
+/*
+ * display_uncovered_differ() - whether the display subsections differ
+ * in anything but their mode list; Black and White are only written if
+ * their red value is set.
+ */
+
+static int display_uncovered_differ(XConfigDisplayPtr d0,
+                                    XConfigDisplayPtr d1)
+{
+    if (d0->frameX0 != d1->frameX0 ||
+        d0->frameY0 != d1->frameY0 ||
+        d0->virtualX != d1->virtualX ||
+        d0->virtualY != d1->virtualY ||
+        d0->bpp != d1->bpp ||
+        strings_differ(d0->visual, d1->visual) ||
+        rgb_differ(d0->weight, d1->weight) ||
+        options_differ(d0->options, d1->options)) {
+        return TRUE;
+    }
+
+    if ((d0->black.red != -1 || d1->black.red != -1) &&
+        rgb_differ(d0->black, d1->black)) {
+        return TRUE;
+    }
+    if ((d0->white.red != -1 || d1->white.red != -1) &&
+        rgb_differ(d0->white, d1->white)) {
+        return TRUE;
+    }
+    return FALSE;
+
+} /* display_uncovered_differ() */
+
+
+
+/*
+ * displays_uncovered_differ() - whether any display subsection of 'to'
+ * differs from the one of 'from' for the same depth (or from the one a
+ * Modes line would add) in anything but its mode list.  Patches match
+ * display subsections by depth, so several for one depth are also
+ * taken to differ.
+ */
+
+static int displays_uncovered_differ(XConfigDisplayPtr from,
+                                     XConfigDisplayPtr to)
+{
+    XConfigDisplayPtr display, old, blank = NULL;
+    int differ = FALSE;
+
+    for (display = from; display && !differ; display = display->next) {
+        differ = (find_display(from, display->depth) != display);
+    }
+
+    for (display = to; display && !differ; display = display->next) {
+        if (find_display(to, display->depth) != display) {
+            differ = TRUE;
+            break;
+        }
+        old = find_display(from, display->depth);
+        if (!old) {
+            if (!blank) xconfigAddDisplay(&blank, 0);
+            old = blank;
+        }
+        differ = display_uncovered_differ(old, display);
+    }
+
+    xconfigFreeDisplayList(&blank);
+
+    return differ;
+
+} /* displays_uncovered_differ() */
+
+
+
+static int adaptor_links_differ(XConfigAdaptorLinkPtr l0,
+                                XConfigAdaptorLinkPtr l1)
+{
+    for (; l0 && l1; l0 = l0->next, l1 = l1->next) {
+        if (strings_differ(l0->adaptor_name, l1->adaptor_name)) return TRUE;
+    }
+    return (l0 != l1);
+}
+
+
+
+static int screen_uncovered_differ(XConfigScreenPtr s0, XConfigScreenPtr s1)
+{
+    return (strings_differ(s0->obsolete_driver, s1->obsolete_driver) ||
+            s0->defaultbpp != s1->defaultbpp ||
+            s0->defaultfbbpp != s1->defaultfbbpp ||
+            adaptor_links_differ(s0->adaptors, s1->adaptors) ||
+            displays_uncovered_differ(s0->displays, s1->displays));
+}
+
+
+
+static int input_uncovered_differ(XConfigInputPtr i0, XConfigInputPtr i1)
+{
+    /* the Driver and options of an InputDevice section are covered */
+
+    return FALSE;
+}
+
+
+
+static int layout_uncovered_differ(XConfigLayoutPtr l0, XConfigLayoutPtr l1)
+{
+    XConfigInputrefPtr r0, r1;
+    XConfigInactivePtr i0, i1;
+
+    for (r0 = l0->inputs, r1 = l1->inputs; r0 && r1;
+         r0 = r0->next, r1 = r1->next) {
+        if (strings_differ(r0->input_name, r1->input_name) ||
+            options_differ(r0->options, r1->options)) {
+            return TRUE;
+        }
+    }
+    if (r0 != r1) return TRUE;
+
+    for (i0 = l0->inactives, i1 = l1->inactives; i0 && i1;
+         i0 = i0->next, i1 = i1->next) {
+        if (strings_differ(i0->device_name, i1->device_name)) return TRUE;
+    }
+    return (i0 != i1);
+
+} /* layout_uncovered_differ() */
+
+
+
+/*
+ * DiffBlanksRec - the sections that a patch creates for an Identifier
+ * the config does not have; the sections of 'to' that 'from' does not
+ * have are diffed against these.
+ */
+
+typedef struct {
+    XConfigMonitorRec monitor;
+    XConfigDeviceRec device;
+    XConfigScreenRec screen;
+    XConfigInputRec input;
+    XConfigLayoutRec layout;
+} DiffBlanksRec, *DiffBlanksPtr;
+
+
+
+/*
+ * DiffIndexRec - the sections of one list, sorted by the
+ * xconfigNameHash() of their Identifier and then by Identifier, so that
+ * the section with a given Identifier is found with a binary search
+ * rather than by walking the list, and sections with the same
+ * Identifier end up next to each other.
+ */
+
+typedef struct {
+    unsigned int key;
+    const char *name;
+    void *item;
+} DiffIndexEntry;
+
+typedef struct {
+    DiffIndexEntry *entries;
+    int count;
+    int repeat;     /* two sections have the same Identifier */
+} DiffIndexRec, *DiffIndexPtr;
+
+static int compare_index_entries(const void *p0, const void *p1)
+{
+    const DiffIndexEntry *e0 = p0, *e1 = p1;
+
+    if (e0->key != e1->key) return (e0->key < e1->key) ? -1 : 1;
+    return xconfigNameCompare(e0->name, e1->name);
+}
+
+
+
+/*
+ * diff_index_build() - index the sections of the list, whose
+ * Identifier is found 'offset' bytes into each section.  Returns FALSE
+ * if out of memory.
+ */
+
+static int diff_index_build(DiffIndexPtr index, GenericListPtr list,
+                            size_t offset)
+{
+    GenericListPtr item;
+    int i;
+
+    memset(index, 0, sizeof(DiffIndexRec));
+
+    for (item = list; item; item = item->next) index->count++;
+    if (!index->count) return TRUE;
+
+    index->entries = malloc(index->count * sizeof(DiffIndexEntry));
+    if (!index->entries) return FALSE;
+
+    for (i = 0, item = list; item; i++, item = item->next) {
+        index->entries[i].name = *(const char **) ((char *) item + offset);
+        index->entries[i].key = xconfigNameHash(index->entries[i].name);
+        index->entries[i].item = item;
+    }
+
+    qsort(index->entries, index->count, sizeof(DiffIndexEntry),
+          compare_index_entries);
+
+    for (i = 1; i < index->count && !index->repeat; i++) {
+        index->repeat = (compare_index_entries(&index->entries[i - 1],
+                                               &index->entries[i]) == 0);
+    }
+
+    return TRUE;
+
+} /* diff_index_build() */
+
+
+
+static void *diff_index_find(DiffIndexPtr index, const char *name)
+{
+    DiffIndexEntry key, *entry;
+
+    if (!index->count) return NULL;
+
+    key.key = xconfigNameHash(name);
+    key.name = name;
+
+    entry = bsearch(&key, index->entries, index->count,
+                    sizeof(DiffIndexEntry), compare_index_entries);
+
+    return entry ? entry->item : NULL;
+}
+
+
+
+/*
+ * uncovered_difference() - return the name of the first section in
+ * which the configs differ in a way that a patch cannot express, or
+ * NULL if there is none.  Whole sections that patches do not cover
+ * are compared as they are written out.  The other fields of the
+ * sections that patches do cover, and whether any of them have the
+ * same Identifier, are checked by DIFF_SECTIONS(), as the sections are
+ * diffed.  Comments and the order of the sections are
+ * not compared.
+ */
+
+static const char *uncovered_difference(XConfigPtr from, XConfigPtr to)
+{
+    int differ;
+
+    PRINTED_DIFFER(xconfigPrintFileSection, from->files, to->files, differ);
+    if (differ) return "Files";
+
+    PRINTED_DIFFER(xconfigPrintModuleSection, from->modules, to->modules,
+                   differ);
+    if (differ) return "Module";
+
+    PRINTED_DIFFER(xconfigPrintVendorSection, from->vendors, to->vendors,
+                   differ);
+    if (differ) return "Vendor";
+
+    PRINTED_DIFFER(xconfigPrintInputClassSection, from->inputclasses,
+                   to->inputclasses, differ);
+    if (differ) return "InputClass";
+
+    PRINTED_DIFFER(xconfigPrintVideoAdaptorSection, from->videoadaptors,
+                   to->videoadaptors, differ);
+    if (differ) return "VideoAdaptor";
+
+    PRINTED_DIFFER(xconfigPrintModesSection, from->modes, to->modes, differ);
+    if (differ) return "Modes";
+
+    if (dri_differ(from->dri, to->dri)) return "DRI";
+
+    return NULL;
+
+} /* uncovered_difference() */
+
+
+
+/*
+ * DIFF_SECTIONS() - diff the lists of identified sections 'from' and
+ * 'to' with the given diff function: sections of 'from' that 'to' does
+ * not have are removed, and the sections of 'to' are compared with the
+ * matching section of 'from', or with 'blank' if there is none.
+ *
+ * If the 'differ' function finds that two sections differ in a field
+ * that patches do not cover, or two sections of either list have the
+ * same Identifier (patches could not tell them apart), the section type
+ * is recorded in the state and diffing stops.
+ */
+
+#define DIFF_SECTIONS(state, type, rectype, from, to, blank, diff, differ) \
+{                                                                       \
+    DiffIndexRec fromIndex, toIndex;                                    \
+    rectype *pFrom, *pTo;                                               \
+    const size_t offset = offsetof(rectype, identifier);                \
+                                                                        \
+    if (!diff_index_build(&fromIndex, (GenericListPtr) (from), offset) || \
+        !diff_index_build(&toIndex, (GenericListPtr) (to), offset)) {   \
+        (state)->error = TRUE;                                          \
+    } else if (fromIndex.repeat || toIndex.repeat) {                    \
+        (state)->uncovered = PatchSectionNames[(type)];                 \
+    }                                                                   \
+                                                                        \
+    for (pFrom = (from); pFrom && !DIFF_STOPPED(state);                 \
+         pFrom = pFrom->next) {                                         \
+        if (!diff_index_find(&toIndex, pFrom->identifier)) {            \
+            diff_remove((state), (type), pFrom->identifier);            \
+        }                                                               \
+    }                                                                   \
+                                                                        \
+    for (pTo = (to); pTo && !DIFF_STOPPED(state); pTo = pTo->next) {    \
+        pFrom = diff_index_find(&fromIndex, pTo->identifier);           \
+        if (differ(pFrom ? pFrom : (blank), pTo)) {                     \
+            (state)->uncovered = PatchSectionNames[(type)];             \
+            break;                                                      \
+        }                                                               \
+        diff_begin((state), (type), pTo->identifier);                   \
+        if (!pFrom) {                                                   \
+            pFrom = (blank);                                            \
+            diff_open(state);                                           \
+        }                                                               \
+        diff((state), pFrom, pTo);                                      \
+        diff_end(state);                                                \
+    }                                                                   \
+                                                                        \
+    free(fromIndex.entries);                                            \
+    free(toIndex.entries);                                              \
+}
+
+#define DIFF_STOPPED(state) ((state)->uncovered || (state)->error)
+
+
+
+/*
+ * xconfigDiffConfigs() - write to 'fp' a patch that, applied with
+ * xconfigApplyPatch() to the config 'from', makes the fields covered by
+ * patches (see above) equal to those of the config 'to'.  Returns the
+ * number of records written; 0 if the configs do not differ in any
+ * covered field.
+ *
+ * If the configs also differ in a way that a patch cannot express
+ * (e.g., in a Files, Module or Modes section, in the modelines of a
+ * Monitor section, or in any other field not listed above), nothing is
+ * written, '*uncovered' is set to the name of the section, and -1 is
+ * returned; a partial patch would otherwise silently drop the
+ * difference.  If out of memory, -1 is returned with '*uncovered' set
+ * to NULL.
+ */
+
+int xconfigDiffConfigs(FILE *fp, XConfigPtr from, XConfigPtr to,
+                       const char **uncovered)
+{
+    DiffStateRec state;
+    DiffBlanksRec blanks;
+    char *buf = NULL;
+    size_t len = 0;
+
+    *uncovered = uncovered_difference(from, to);
+    if (*uncovered) return -1;
+
+    /* as patch_find_section() creates them */
+
+    memset(&blanks, 0, sizeof(blanks));
+    blanks.device.chipid = -1;
+    blanks.device.chiprev = -1;
+    blanks.device.irq = -1;
+    blanks.device.screen = -1;
+
+    /*
+     * the patch is only written to 'fp' once all sections are diffed,
+     * since diffing a later section may find an uncovered difference
+     */
+
+    memset(&state, 0, sizeof(state));
+    state.fp = open_memstream(&buf, &len);
+    if (!state.fp) return -1;
+
+    diff_begin(&state, PATCH_FLAGS, NULL);
+    diff_options(&state,
+                 from->flags ? from->flags->options : NULL,
+                 to->flags ? to->flags->options : NULL);
+    diff_end(&state);
+
+    diff_begin(&state, PATCH_EXTENSIONS, NULL);
+    diff_options(&state,
+                 from->extensions ? from->extensions->options : NULL,
+                 to->extensions ? to->extensions->options : NULL);
+    diff_end(&state);
+
+    DIFF_SECTIONS(&state, PATCH_MONITOR, XConfigMonitorRec,
+                  from->monitors, to->monitors,
+                  &blanks.monitor, diff_monitor,
+                  monitor_uncovered_differ);
+
+    DIFF_SECTIONS(&state, PATCH_DEVICE, XConfigDeviceRec,
+                  from->devices, to->devices,
+                  &blanks.device, diff_device,
+                  device_uncovered_differ);
+
+    DIFF_SECTIONS(&state, PATCH_SCREEN, XConfigScreenRec,
+                  from->screens, to->screens,
+                  &blanks.screen, diff_screen,
+                  screen_uncovered_differ);
+
+    DIFF_SECTIONS(&state, PATCH_INPUT, XConfigInputRec,
+                  from->inputs, to->inputs,
+                  &blanks.input, diff_input,
+                  input_uncovered_differ);
+
+    DIFF_SECTIONS(&state, PATCH_LAYOUT, XConfigLayoutRec,
+                  from->layouts, to->layouts,
+                  &blanks.layout, diff_layout,
+                  layout_uncovered_differ);
+
+    fclose(state.fp);
+
+    if (state.error) {
+        state.count = -1;
+    } else if (state.uncovered) {
+        *uncovered = state.uncovered;
+        state.count = -1;
+    } else {
+        fwrite(buf, 1, len, fp);
+    }
+
+    free(buf);
+
+    return state.count;
+
+} /* xconfigDiffConfigs() */
+
+
+
+/*
+ * Patch
+ */
+
+typedef struct {
+    int type;                   /* PATCH_* type of the section */
+    void *section;              /* the section being patched */
+    XConfigOptionPtr *options;  /* the section's option list */
+    int adjacencies;            /* the layout's screen list was replaced */
+} PatchSectionRec, *PatchSectionPtr;
+
+
+
+/*
+ * patch_token() - get the next token of the patch, skipping comments.
+ */
+
+static int patch_token(void)
+{
+    int token;
+
+    while ((token = xconfigGetToken(PatchTab)) == COMMENT);
+
+    return token;
+}
+
+
+
+/*
+ * patch_error() - report a parse error; any string token just read is
+ * freed.  Always returns FALSE.
+ */
+
+static int patch_error(int token, char *fmt, const char *arg)
+{
+    xconfigErrorMsg(ParseErrorMsg, fmt, arg);
+
+    if (token == STRING) {
+        free(val.str);
+        val.str = NULL;
+    }
+
+    return FALSE;
+}
+
+
+
+static int patch_section_type(const char *name)
+{
+    int type;
+
+    for (type = 0; type < PATCH_NUM_SECTIONS; type++) {
+        if (xconfigNameCompare(name, PatchSectionNames[type]) == 0) {
+            return type;
+        }
+    }
+    return -1;
+}
+
+
+
+/*
+ * patch_string() - read the quoted string following 'keyword' into
+ * 'field'; an empty string unsets the field.
+ */
+
+static int patch_string(char **field, const char *keyword)
+{
+    int token = patch_token();
+
+    if (token != STRING) {
+        return patch_error(token, QUOTE_MSG, keyword);
+    }
+
+    free(*field);
+
+    if (val.str[0] == '\0') {
+        free(val.str);
+        *field = NULL;
+    } else {
+        *field = val.str;
+    }
+    val.str = NULL;
+
+    return TRUE;
+}
+
+
+
+/*
+ * patch_int() - read the (possibly negative) integer following
+ * 'keyword'.
+ */
+
+static int patch_int(int *value, const char *keyword)
+{
+    int token, negative;
+
+    token = patch_token();
+    negative = (token == DASH);
+    if (negative) {
+        token = patch_token();
+    }
+
+    if (token != NUMBER) {
+        return patch_error(token, NUMBER_MSG, keyword);
+    }
+
+    *value = negative ? -val.num : val.num;
+
+    return TRUE;
+}
+
+
+
+/*
+ * patch_ranges() - read the comma separated list of numbers and ranges
+ * following 'keyword', replacing the list of ranges 'ranges'.
+ */
+
+static int patch_ranges(parser_range *ranges, int *n, int max,
+                        const char *keyword)
+{
+    int token, count = 0;
+    float lo, hi;
+
+    while ((token = patch_token()) == NUMBER) {
+        if (count >= max) {
+            return patch_error(token, "Too many %s ranges.", keyword);
+        }
+
+        lo = hi = val.realnum;
+
+        token = patch_token();
+        if (token == DASH) {
+            token = patch_token();
+            if (token != NUMBER || (float) val.realnum < lo) {
+                return patch_error(token, "The %s keyword must be followed "
+                                   "by a list of numbers or ranges.",
+                                   keyword);
+            }
+            hi = val.realnum;
+            token = patch_token();
+        }
+
+        ranges[count].lo = lo;
+        ranges[count].hi = hi;
+        count++;
+
+        if (token != COMMA) break;
+    }
+
+    xconfigUnGetToken(token);
+    *n = count;
+
+    return TRUE;
+
+} /* patch_ranges() */
+
+
+
+/*
+ * patch_option() - read the name and optional value of an Option line,
+ * and set the option in the section.
+ */
+
+static int patch_option(PatchSectionPtr s)
+{
+    char *name;
+    int token;
+
+    token = patch_token();
+    if (token != STRING) {
+        return patch_error(token, BAD_OPTION_MSG, NULL);
+    }
+    name = val.str;
+    val.str = NULL;
+
+    xconfigOptionListUnshare(s->options);
+
+    token = patch_token();
+    if (token == STRING) {
+        xconfigAddNewOption(s->options, name, val.str);
+        free(val.str);
+        val.str = NULL;
+    } else {
+        xconfigUnGetToken(token);
+        xconfigAddNewOption(s->options, name, NULL);
+    }
+
+    free(name);
+
+    return TRUE;
+
+} /* patch_option() */
+
+
+
+static int patch_remove_option(PatchSectionPtr s)
+{
+    int token = patch_token();
+
+    if (token != STRING) {
+        return patch_error(token, QUOTE_MSG, "RemoveOption");
+    }
+
+    xconfigOptionListUnshare(s->options);
+    xconfigRemoveNamedOption(s->options, val.str, NULL);
+
+    free(val.str);
+    val.str = NULL;
+
+    return TRUE;
+}
+
+
+
+/*
+ * patch_modes() - read the depth and mode list of a Modes line, and
+ * replace the mode list of the screen's display subsection for that
+ * depth, adding the subsection if the screen does not have one.
+ */
+
+static int patch_modes(XConfigScreenPtr screen)
+{
+    XConfigDisplayPtr display;
+    XConfigModePtr *pMode;
+    int depth, token;
+
+    if (!patch_int(&depth, "Modes")) {
+        return FALSE;
+    }
+
+    xconfigDisplayListUnshare(&screen->displays);
+
+    display = find_display(screen->displays, depth);
+    if (!display) {
+        xconfigAddDisplay(&display, depth);
+        xconfigAddListItem((GenericListPtr *)(&screen->displays),
+                           (GenericListPtr) display);
+    }
+
+    xconfigFreeModeList(&display->modes);
+
+    pMode = &display->modes;
+    while ((token = patch_token()) == STRING) {
+        xconfigAddMode(pMode, val.str);
+        pMode = &((*pMode)->next);
+        free(val.str);
+        val.str = NULL;
+    }
+    xconfigUnGetToken(token);
+
+    return TRUE;
+
+} /* patch_modes() */
+
+
+
+static int patch_remove_display(XConfigScreenPtr screen)
+{
+    XConfigDisplayPtr display;
+    int depth;
+
+    if (!patch_int(&depth, "RemoveDisplay")) {
+        return FALSE;
+    }
+
+    xconfigDisplayListUnshare(&screen->displays);
+
+    display = find_display(screen->displays, depth);
+    if (display) {
+        xconfigRemoveListItem((GenericListPtr *)(&screen->displays),
+                              (GenericListPtr) display);
+        display->next = NULL;
+        xconfigFreeDisplayList(&display);
+    }
+
+    return TRUE;
+}
+
+
+
+/*
+ * patch_adjacency() - read a ServerLayout Screen line.  The first one
+ * in a record replaces the layout's screen list.
+ */
+
+static int patch_adjacency(PatchSectionPtr s)
+{
+    XConfigLayoutPtr layout = s->section;
+    XConfigAdjacencyPtr adj;
+    int token, ok = FALSE;
+
+    if (!s->adjacencies) {
+        xconfigFreeAdjacencyList(&layout->adjacencies);
+        s->adjacencies = TRUE;
+    }
+
+    adj = xconfigAlloc(sizeof(XConfigAdjacencyRec));
+    adj->scrnum = -1;
+    adj->where = CONF_ADJ_ABSOLUTE;
+
+    xconfigAddListItem((GenericListPtr *)(&layout->adjacencies),
+                       (GenericListPtr) adj);
+
+    token = patch_token();
+    if (token == NUMBER) {
+        adj->scrnum = val.num;
+        token = patch_token();
+    }
+    if (token != STRING) {
+        return patch_error(token, SCREEN_MSG, NULL);
+    }
+    adj->screen_name = val.str;
+    val.str = NULL;
+
+    switch (token = patch_token()) {
+    case RIGHTOF:
+        adj->where = CONF_ADJ_RIGHTOF;
+        ok = patch_string(&adj->refscreen, "RightOf");
+        break;
+    case LEFTOF:
+        adj->where = CONF_ADJ_LEFTOF;
+        ok = patch_string(&adj->refscreen, "LeftOf");
+        break;
+    case ABOVE:
+        adj->where = CONF_ADJ_ABOVE;
+        ok = patch_string(&adj->refscreen, "Above");
+        break;
+    case BELOW:
+        adj->where = CONF_ADJ_BELOW;
+        ok = patch_string(&adj->refscreen, "Below");
+        break;
+    case RELATIVE:
+        adj->where = CONF_ADJ_RELATIVE;
+        ok = patch_string(&adj->refscreen, "Relative") &&
+             patch_int(&adj->x, "Relative") &&
+             patch_int(&adj->y, "Relative");
+        break;
+    case ABSOLUTE:
+        ok = patch_int(&adj->x, "Absolute") &&
+             patch_int(&adj->y, "Absolute");
+        break;
+    case NUMBER:
+        adj->x = val.num;
+        ok = patch_int(&adj->y, "Screen");
+        break;
+    case STRING:
+        adj->where = CONF_ADJ_OBSOLETE;
+        adj->top_name = val.str;
+        val.str = NULL;
+        ok = patch_string(&adj->bottom_name, "Screen") &&
+             patch_string(&adj->left_name, "Screen") &&
+             patch_string(&adj->right_name, "Screen");
+        break;
+    default:
+        xconfigUnGetToken(token);
+        ok = TRUE;
+        break;
+    }
+
+    return ok;
+
+} /* patch_adjacency() */
+
+
+
+/*
+ * patch_field() - read the field line starting with 'token' into the
+ * section.
+ */
+
+static int patch_field(PatchSectionPtr s, int token)
+{
+    XConfigMonitorPtr monitor = s->section;
+    XConfigDevicePtr device = s->section;
+    XConfigScreenPtr screen = s->section;
+    XConfigInputPtr input = s->section;
+
+    switch (s->type) {
+
+    case PATCH_MONITOR:
+        switch (token) {
+        case VENDOR:
+            return patch_string(&monitor->vendor, "VendorName");
+        case MODEL:
+            return patch_string(&monitor->modelname, "ModelName");
+        case HORIZSYNC:
+            return patch_ranges(monitor->hsync, &monitor->n_hsync,
+                                CONF_MAX_HSYNC, "HorizSync");
+        case VERTREFRESH:
+            return patch_ranges(monitor->vrefresh, &monitor->n_vrefresh,
+                                CONF_MAX_VREFRESH, "VertRefresh");
+        }
+        break;
+
+    case PATCH_DEVICE:
+        switch (token) {
+        case DRIVER:
+            return patch_string(&device->driver, "Driver");
+        case VENDOR:
+            return patch_string(&device->vendor, "VendorName");
+        case BOARD:
+            return patch_string(&device->board, "BoardName");
+        case BUSID:
+            if (!patch_string(&device->busid, "BusID")) {
+                return FALSE;
+            }
+            if (!xconfigParsePciAddress(device->busid, &device->pciaddr)) {
+                device->pciaddr = 0;
+            }
+            return TRUE;
+        case SCREEN:
+            return patch_int(&device->screen, "Screen");
+        }
+        break;
+
+    case PATCH_SCREEN:
+        switch (token) {
+        case MDEVICE:
+            return patch_string(&screen->device_name, "Device");
+        case MONITOR:
+            return patch_string(&screen->monitor_name, "Monitor");
+        case DEFAULTDEPTH:
+            return patch_int(&screen->defaultdepth, "DefaultDepth");
+        case MODES:
+            return patch_modes(screen);
+        case REMOVEDISPLAY:
+            return patch_remove_display(screen);
+        }
+        break;
+
+    case PATCH_INPUT:
+        switch (token) {
+        case DRIVER:
+            return patch_string(&input->driver, "Driver");
+        }
+        break;
+
+    case PATCH_LAYOUT:
+        switch (token) {
+        case SCREEN:
+            return patch_adjacency(s);
+        }
+        break;
+    }
+
+    return patch_error(token, INVALID_KEYWORD_MSG, xconfigTokenString());
+
+} /* patch_field() */
+
+
+
+/*
+ * patch_find_section() - find the named section of the given type in
+ * the config, adding an empty one if there is none.
+ */
+
+static void patch_find_section(XConfigPtr config, PatchSectionPtr s,
+                               const char *identifier)
+{
+    XConfigMonitorPtr monitor;
+    XConfigDevicePtr device;
+    XConfigScreenPtr screen;
+    XConfigInputPtr input;
+    XConfigLayoutPtr layout;
+
+    switch (s->type) {
+
+    case PATCH_FLAGS:
+        if (!config->flags) {
+            config->flags = xconfigAlloc(sizeof(XConfigFlagsRec));
+        }
+        s->section = config->flags;
+        s->options = &config->flags->options;
+        break;
+
+    case PATCH_EXTENSIONS:
+        if (!config->extensions) {
+            config->extensions = xconfigAlloc(sizeof(XConfigExtensionsRec));
+        }
+        s->section = config->extensions;
+        s->options = &config->extensions->options;
+        break;
+
+    case PATCH_MONITOR:
+        monitor = xconfigFindMonitor(identifier, config->monitors);
+        if (!monitor) {
+            monitor = xconfigAlloc(sizeof(XConfigMonitorRec));
+            monitor->identifier = xconfigStrdup(identifier);
+            xconfigAddListItem((GenericListPtr *)(&config->monitors),
+                               (GenericListPtr) monitor);
+        }
+        s->section = monitor;
+        s->options = &monitor->options;
+        break;
+
+    case PATCH_DEVICE:
+        device = xconfigFindDevice(identifier, config->devices);
+        if (!device) {
+            device = xconfigAlloc(sizeof(XConfigDeviceRec));
+            device->identifier = xconfigStrdup(identifier);
+            device->chipid = -1;
+            device->chiprev = -1;
+            device->irq = -1;
+            device->screen = -1;
+            xconfigAddListItem((GenericListPtr *)(&config->devices),
+                               (GenericListPtr) device);
+        }
+        s->section = device;
+        s->options = &device->options;
+        break;
+
+    case PATCH_SCREEN:
+        screen = xconfigFindScreen(identifier, config->screens);
+        if (!screen) {
+            screen = xconfigAlloc(sizeof(XConfigScreenRec));
+            screen->identifier = xconfigStrdup(identifier);
+            xconfigAddListItem((GenericListPtr *)(&config->screens),
+                               (GenericListPtr) screen);
+        }
+        s->section = screen;
+        s->options = &screen->options;
+        break;
+
+    case PATCH_INPUT:
+        input = xconfigFindInput(identifier, config->inputs);
+        if (!input) {
+            input = xconfigAlloc(sizeof(XConfigInputRec));
+            input->identifier = xconfigStrdup(identifier);
+            xconfigAddListItem((GenericListPtr *)(&config->inputs),
+                               (GenericListPtr) input);
+        }
+        s->section = input;
+        s->options = &input->options;
+        break;
+
+    case PATCH_LAYOUT:
+        layout = xconfigFindLayout(identifier, config->layouts);
+        if (!layout) {
+            layout = xconfigAlloc(sizeof(XConfigLayoutRec));
+            layout->identifier = xconfigStrdup(identifier);
+            xconfigAddListItem((GenericListPtr *)(&config->layouts),
+                               (GenericListPtr) layout);
+        }
+        s->section = layout;
+        s->options = &layout->options;
+        break;
+    }
+
+} /* patch_find_section() */
+
+
+
+/*
+ * patch_section() - read a Section record and apply it to the config.
+ */
+
+static int patch_section(XConfigPtr config)
+{
+    PatchSectionRec s;
+    char *identifier = NULL;
+    int token, ok;
+
+    token = patch_token();
+    if (token != STRING) {
+        return patch_error(token, QUOTE_MSG, "Section");
+    }
+
+    xconfigSetSection(val.str);
+
+    memset(&s, 0, sizeof(s));
+    s.type = patch_section_type(val.str);
+    if (s.type < 0) {
+        return patch_error(token, INVALID_SECTION_MSG, val.str);
+    }
+    free(val.str);
+    val.str = NULL;
+
+    if (PATCH_HAS_IDENTIFIER(s.type)) {
+        token = patch_token();
+        if (token != IDENTIFIER) {
+            return patch_error(token, NO_IDENT_MSG, NULL);
+        }
+        token = patch_token();
+        if (token != STRING) {
+            return patch_error(token, QUOTE_MSG, "Identifier");
+        }
+        identifier = val.str;
+        val.str = NULL;
+    }
+
+    patch_find_section(config, &s, identifier);
+    free(identifier);
+
+    ok = TRUE;
+
+    while (ok && (token = patch_token()) != ENDSECTION) {
+        switch (token) {
+        case OPTION:
+            ok = patch_option(&s);
+            break;
+        case REMOVEOPTION:
+            ok = patch_remove_option(&s);
+            break;
+        case EOF_TOKEN:
+            ok = patch_error(token, UNEXPECTED_EOF_MSG, NULL);
+            break;
+        default:
+            ok = patch_field(&s, token);
+            break;
+        }
+    }
+
+    return ok;
+
+} /* patch_section() */
+
+
+
+/*
+ * patch_remove_section() - read a RemoveSection record, and remove the
+ * named section from the config, if it has one.
+ */
+
+static int patch_remove_section(XConfigPtr config)
+{
+    GenericListPtr *pHead, item;
+    char *identifier;
+    int token, type;
+
+    token = patch_token();
+    if (token != STRING) {
+        return patch_error(token, QUOTE_MSG, "RemoveSection");
+    }
+
+    xconfigSetSection(val.str);
+
+    type = patch_section_type(val.str);
+    if (!PATCH_HAS_IDENTIFIER(type)) {
+        return patch_error(token, INVALID_SECTION_MSG, val.str);
+    }
+    free(val.str);
+    val.str = NULL;
+
+    token = patch_token();
+    if (token != STRING) {
+        return patch_error(token, QUOTE_MSG, "RemoveSection");
+    }
+    identifier = val.str;
+    val.str = NULL;
+
+    switch (type) {
+    case PATCH_MONITOR:
+        pHead = (GenericListPtr *)(&config->monitors);
+        item = (GenericListPtr) xconfigFindMonitor(identifier,
+                                                   config->monitors);
+        break;
+    case PATCH_DEVICE:
+        pHead = (GenericListPtr *)(&config->devices);
+        item = (GenericListPtr) xconfigFindDevice(identifier,
+                                                  config->devices);
+        break;
+    case PATCH_SCREEN:
+        pHead = (GenericListPtr *)(&config->screens);
+        item = (GenericListPtr) xconfigFindScreen(identifier,
+                                                  config->screens);
+        break;
+    case PATCH_INPUT:
+        pHead = (GenericListPtr *)(&config->inputs);
+        item = (GenericListPtr) xconfigFindInput(identifier,
+                                                 config->inputs);
+        break;
+    default:
+        pHead = (GenericListPtr *)(&config->layouts);
+        item = (GenericListPtr) xconfigFindLayout(identifier,
+                                                  config->layouts);
+        break;
+    }
+
+    free(identifier);
+
+    if (!item) {
+        return TRUE;
+    }
+
+    xconfigRemoveListItem(pHead, item);
+    item->next = NULL;
+
+    switch (type) {
+    case PATCH_MONITOR:
+        xconfigFreeMonitorList((XConfigMonitorPtr *)(&item));
+        break;
+    case PATCH_DEVICE:
+        xconfigFreeDeviceList((XConfigDevicePtr *)(&item));
+        break;
+    case PATCH_SCREEN:
+        xconfigFreeScreenList((XConfigScreenPtr *)(&item));
+        break;
+    case PATCH_INPUT:
+        xconfigFreeInputList((XConfigInputPtr *)(&item));
+        break;
+    default:
+        xconfigFreeLayoutList((XConfigLayoutPtr *)(&item));
+        break;
+    }
+
+    return TRUE;
+
+} /* patch_remove_section() */
+
+
+
+/*
+ * patch_resolve_references() - resolve the name references of the
+ * patched config again: a patch may add, remove or rename the sections
+ * that screens and layouts refer to.
+ */
+
+static int patch_resolve_references(XConfigPtr config)
+{
+    XConfigScreenPtr screen;
+    XConfigLayoutPtr layout;
+    XConfigAdjacencyPtr adj;
+    XConfigInactivePtr inactive;
+    XConfigInputrefPtr inputref;
+
+    for (screen = config->screens; screen; screen = screen->next) {
+        screen->device = xconfigFindDevice(screen->device_name,
+                                           config->devices);
+        if (!screen->device) {
+            xconfigErrorMsg(ValidationErrorMsg, UNDEFINED_DEVICE_MSG,
+                            screen->device_name, screen->identifier);
+            return FALSE;
+        }
+
+        screen->monitor = NULL;
+        if (screen->monitor_name) {
+            screen->monitor = xconfigFindMonitor(screen->monitor_name,
+                                                 config->monitors);
+            if (!screen->monitor) {
+                xconfigErrorMsg(ValidationErrorMsg, UNDEFINED_MONITOR_MSG,
+                                screen->monitor_name, screen->identifier);
+                return FALSE;
+            }
+        }
+    }
+
+    for (layout = config->layouts; layout; layout = layout->next) {
+        for (adj = layout->adjacencies; adj; adj = adj->next) {
+            adj->screen = xconfigFindScreen(adj->screen_name,
+                                            config->screens);
+            if (!adj->screen) {
+                xconfigErrorMsg(ValidationErrorMsg, UNDEFINED_SCREEN_MSG,
+                                adj->screen_name, layout->identifier);
+                return FALSE;
+            }
+            adj->top = xconfigFindScreen(adj->top_name, config->screens);
+            adj->bottom = xconfigFindScreen(adj->bottom_name,
+                                            config->screens);
+            adj->left = xconfigFindScreen(adj->left_name, config->screens);
+            adj->right = xconfigFindScreen(adj->right_name,
+                                           config->screens);
+        }
+
+        for (inactive = layout->inactives; inactive;
+             inactive = inactive->next) {
+            inactive->device = xconfigFindDevice(inactive->device_name,
+                                                 config->devices);
+            if (!inactive->device) {
+                xconfigErrorMsg(ValidationErrorMsg, UNDEFINED_DEVICE_LAY_MSG,
+                                inactive->device_name, layout->identifier);
+                return FALSE;
+            }
+        }
+
+        for (inputref = layout->inputs; inputref; inputref = inputref->next) {
+            inputref->input = xconfigFindInput(inputref->input_name,
+                                               config->inputs);
+            if (!inputref->input) {
+                xconfigErrorMsg(ValidationErrorMsg, UNDEFINED_INPUT_MSG,
+                                inputref->input_name, layout->identifier);
+                return FALSE;
+            }
+        }
+    }
+
+    return TRUE;
+
+} /* patch_resolve_references() */
+
+
+
+/*
+ * xconfigApplyPatch() - read the open patch file, as written by
+ * xconfigDiffConfigs(), and apply it to the config.  The records are
+ * applied as they are read, so if an error is returned the config may
+ * have been partially patched, and should be discarded.
+ */
+
+XConfigError xconfigApplyPatch(XConfigPtr config)
+{
+    int token;
+
+    while ((token = patch_token()) != EOF_TOKEN) {
+
+        switch (token) {
+
+        case SECTION:
+            if (!patch_section(config)) {
+                return XCONFIG_RETURN_PARSE_ERROR;
+            }
+            break;
+
+        case REMOVESECTION:
+            if (!patch_remove_section(config)) {
+                return XCONFIG_RETURN_PARSE_ERROR;
+            }
+            break;
+
+        default:
+            patch_error(token, INVALID_KEYWORD_MSG, xconfigTokenString());
+            return XCONFIG_RETURN_PARSE_ERROR;
+        }
+    }
+
+    if (!patch_resolve_references(config)) {
+        return XCONFIG_RETURN_VALIDATION_ERROR;
+    }
+
+    return XCONFIG_RETURN_SUCCESS;
+
+} /* xconfigApplyPatch() */
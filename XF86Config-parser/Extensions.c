@@ -97,7 +97,7 @@ xconfigFreeExtensions (XConfigExtensionsPtr *ptr)
         return;
 
     xconfigFreeOptionList (&((*ptr)->options));
-    TEST_FREE ((*ptr)->comment);
+    FREE_COMMENT ((*ptr)->comment);
     free (*ptr);
     *ptr = NULL;
 }
@@ -275,7 +275,7 @@ xconfigFreeFiles (XConfigFilesPtr *p)
     TEST_FREE ((*p)->modulepath);
     TEST_FREE ((*p)->inputdevs);
     TEST_FREE ((*p)->fontpath);
-    TEST_FREE ((*p)->comment);
+    FREE_COMMENT ((*p)->comment);
 
     free (*p);
     *p = NULL;
@@ -192,14 +192,14 @@ xconfigAddNewOption (XConfigOptionPtr *pHead, const char *name,
     /* Don't allow duplicates */
     if (*pHead != NULL &&
         ((old = xconfigFindOption(*pHead, name)) != NULL)) {
-        TEST_FREE(old->name);
+        xconfigReleaseString(old->name);
         TEST_FREE(old->val);
         new = old;
     } else {
         new = calloc(1, sizeof (XConfigOptionRec));
         new->next = NULL;
     }
-    new->name = xconfigStrdup(name);
+    new->name = xconfigInternString(name);
     new->val = xconfigStrdup(val);
     
     if (old == NULL) {
@@ -214,7 +214,7 @@ xconfigFreeFlags (XConfigFlagsPtr *flags)
         return;
 
     xconfigFreeOptionList (&((*flags)->options));
-    TEST_FREE((*flags)->comment);
+    FREE_COMMENT((*flags)->comment);
     free (*flags);
     *flags = NULL;
 }
@@ -234,6 +234,35 @@ xconfigOptionListDup (XConfigOptionPtr opt)
     return newopt;
 }
 
+/*
+ * xconfigOptionListRef() - share the option list with another owner,
+ * rather than duplicating it.  A shared list is immutable: owners
+ * must call xconfigOptionListUnshare() before modifying it.
+ */
+
+XConfigOptionPtr
+xconfigOptionListRef (XConfigOptionPtr opt)
+{
+    if (opt)
+        opt->refcount++;
+    return opt;
+}
+
+/*
+ * xconfigOptionListUnshare() - give the caller a private copy of the
+ * option list, if the list is currently shared (copy-on-write).
+ */
+
+void
+xconfigOptionListUnshare (XConfigOptionPtr *opt)
+{
+    if (opt == NULL || *opt == NULL || (*opt)->refcount == 0)
+        return;
+
+    (*opt)->refcount--;
+    *opt = xconfigOptionListDup (*opt);
+}
+
 void
 xconfigFreeOptionList (XConfigOptionPtr *opt)
 {
@@ -242,11 +271,19 @@ xconfigFreeOptionList (XConfigOptionPtr *opt)
     if (opt == NULL || *opt == NULL)
         return;
 
+    /* a shared list is only released by its last owner */
+
+    if ((*opt)->refcount > 0) {
+        (*opt)->refcount--;
+        *opt = NULL;
+        return;
+    }
+
     while (*opt)
     {
-        TEST_FREE ((*opt)->name);
+        xconfigReleaseString ((*opt)->name);
         TEST_FREE ((*opt)->val);
-        TEST_FREE ((*opt)->comment);
+        FREE_COMMENT ((*opt)->comment);
         prev = *opt;
         *opt = (*opt)->next;
         free (prev);
@@ -278,7 +315,7 @@ xconfigNewOption(const char *name, const char *value)
     if (!opt)
         return NULL;
 
-    opt->name = xconfigStrdup(name);
+    opt->name = xconfigInternString(name);
     opt->val = xconfigStrdup(value);
     opt->next = NULL;
 
@@ -290,9 +327,9 @@ xconfigRemoveOption(XConfigOptionPtr *pHead, XConfigOptionPtr opt)
 {
     xconfigRemoveListItem((GenericListPtr *)pHead, (GenericListPtr)opt);
 
-    TEST_FREE(opt->name);
+    xconfigReleaseString(opt->name);
     TEST_FREE(opt->val);
-    TEST_FREE(opt->comment);
+    FREE_COMMENT(opt->comment);
     free(opt);
 }
 
@@ -313,9 +350,18 @@ xconfigNextOption(XConfigOptionPtr list)
 XConfigOptionPtr
 xconfigFindOption (XConfigOptionPtr list, const char *name)
 {
+    unsigned int key;
+
+    if (!list)
+        return (NULL);
+
+    /* option names are interned, so their keys are precomputed */
+    key = xconfigNameHash (name);
+
     while (list)
     {
-        if (xconfigNameCompare (list->name, name) == 0)
+        if (xconfigNameKeyCompare (list->name, xconfigInternKey (list->name),
+                                   name, key) == 0)
             return (list);
         list = list->next;
     }
@@ -381,7 +427,8 @@ xconfigOptionListMerge (XConfigOptionPtr head, XConfigOptionPtr tail)
     a = tail;
     b = head;
     while (tail && b) {
-        if (xconfigNameCompare (a->name, b->name) == 0) {
+        if (xconfigNameKeyCompare (a->name, xconfigInternKey (a->name),
+                                   b->name, xconfigInternKey (b->name)) == 0) {
             if (b == head)
                 head = a;
             else
@@ -441,8 +488,7 @@ xconfigParseOption(XConfigOptionPtr head)
 
     if ((token = xconfigGetSubToken(&comment)) != STRING) {
         xconfigErrorMsg(ParseErrorMsg, BAD_OPTION_MSG);
-        if (comment)
-            free(comment);
+        xconfigFreeComment(comment);
         return (head);
     }
 
@@ -469,9 +515,9 @@ xconfigParseOption(XConfigOptionPtr head)
     /* Don't allow duplicates */
     if (head != NULL && (old = xconfigFindOption(head, name)) != NULL) {
         cnew = old;
-        free(option->name);
+        xconfigReleaseString(option->name);
         TEST_FREE(option->val);
-        TEST_FREE(option->comment);
+        FREE_COMMENT(option->comment);
         free(option);
     }
     else
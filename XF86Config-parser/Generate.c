@@ -28,10 +28,14 @@
 #include <sys/stat.h>
 #include <sys/mman.h>
 #include <fcntl.h>
+#include <dirent.h>
+#include <limits.h>
+#include <ctype.h>
 
 
 #include "xf86Parser.h"
 #include "Configint.h"
+#include "common-utils.h"
 
 #define MOUSE_IDENTIFER "Mouse0"
 #define KEYBOARD_IDENTIFER "Keyboard0"
@@ -41,7 +45,6 @@
 #define MONITOR_IDENTIFIER "Monitor%d"
 
 
-static int is_file(const char *filename);
 
 static void add_font_path(GenerateOptions *gop, XConfigPtr config);
 static void add_modules(GenerateOptions *gop, XConfigPtr config);
@@ -177,14 +180,91 @@ void xconfigGenerateAssignScreenAdjacencies(XConfigLayoutPtr layout)
 
 
 /*
- * is_file()
+ * font_server_running() - determine whether a font server (xfs) is
+ * running.  On Linux, this scans the /proc process table in-process,
+ * stopping at the first match; elsewhere, or if /proc is not
+ * available, ps(1) is used.
  */
 
-static int is_file(const char *filename)
+static int font_server_running(void)
 {
-    return (access(filename, F_OK) == 0);
+    int ret;
+
+#if !defined(NV_SUNOS) && !defined(NV_BSD)
+    DIR *dir;
+    struct dirent *ent;
+    char path[NAME_MAX + sizeof("/comm")], comm[32];
+    int fd, found = FALSE;
+    ssize_t len;
+
+    dir = opendir("/proc");
+
+    if (dir) {
+        while (!found && (ent = readdir(dir)) != NULL) {
+
+            /* only consider process directories */
+
+            if ((ent->d_name[0] < '0') || (ent->d_name[0] > '9')) continue;
+
+            snprintf(path, sizeof(path), "%s/comm", ent->d_name);
+
+            fd = openat(dirfd(dir), path, O_RDONLY);
+            if (fd == -1) continue;
+
+            len = read(fd, comm, sizeof(comm) - 1);
+            close(fd);
+
+            if (len <= 0) continue;
+
+            comm[len] = '\0';
+            if (comm[len - 1] == '\n') comm[len - 1] = '\0';
+
+            found = (strcmp(comm, "xfs") == 0);
+        }
+
+        closedir(dir);
+
+        return found;
+    }
+#endif
+
+#if defined(NV_SUNOS)
+    ret = system("ps -e -o fname | grep -v grep | egrep \"^xfs$\" > /dev/null");
+#elif defined(NV_BSD)
+    ret = system("ps -e -o comm | grep -v grep | egrep \"^xfs$\" > /dev/null");
+#else
+    ret = system("ps -C xfs 2>&1 > /dev/null");
+#endif
+
+    return (WEXITSTATUS(ret) == 0);
+
+} /* font_server_running() */
+
+
+
+/*
+ * has_fonts_dir() - check for the file "fonts.dir" in the directory
+ * 'path', relative to the directory file descriptor 'fd' (or AT_FDCWD);
+ * any ":unscaled" appendage on 'path' is ignored.
+ */
+
+static int has_fonts_dir(int fd, const char *path)
+{
+    char buf[PATH_MAX];
+    struct stat stat_buf;
+    size_t len;
+
+    len = strcspn(path, ":");
+
+    if ((len + sizeof("/fonts.dir")) > sizeof(buf)) return FALSE;
+
+    memcpy(buf, path, len);
+    strcpy(buf + len, "/fonts.dir");
+
+    return (fstatat(fd, buf, &stat_buf, 0) == 0);
+
+} /* has_fonts_dir() */
 
-} /* is_file() */
 
 
 /*
@@ -257,8 +337,8 @@ static char *find_libdir(GenerateOptions *gop)
 
 static void add_font_path(GenerateOptions *gop, XConfigPtr config)
 {
-    int i, ret;
-    char *path, *p, *orig, *fonts_dir, *libdir;
+    int i, libdir_fd;
+    char *path, *orig, *libdir;
 
     /*
      * The below font path has been constructed from various examples
@@ -293,71 +373,58 @@ static void add_font_path(GenerateOptions *gop, XConfigPtr config)
      *
      * XXX should we check the port the font server is using?
      */
-#if defined(NV_SUNOS)
-    ret = system("ps -e -o fname | grep -v grep | egrep \"^xfs$\" > /dev/null");
-#elif defined(NV_BSD)
-    ret = system("ps -e -o comm | grep -v grep | egrep \"^xfs$\" > /dev/null");
-#else
-    ret = system("ps -C xfs 2>&1 > /dev/null");
-#endif
-    if (WEXITSTATUS(ret) == 0) {
+
+    if (font_server_running()) {
         config->files->fontpath = xconfigStrdup("unix/:7100");
-    } else {
+        return;
+    }
 
-        /* get the X server libdir */
+    /*
+     * get the X server libdir, and open it once, so that all the
+     * LIBDIR-relative font directories are probed relative to it
+     */
 
-        libdir = find_libdir(gop);
+    libdir = find_libdir(gop);
+    libdir_fd = open(libdir, O_RDONLY | O_DIRECTORY);
 
-        for (i = 0; __font_paths[i]; i++) {
-            path = xconfigStrdup(__font_paths[i]);
+    for (i = 0; __font_paths[i]; i++) {
 
-            /* replace LIBDIR with libdir */
+        /* skip this entry if the fonts.dir does not exist */
 
-            if (strncmp(path, "LIBDIR", 6) == 0) {
-                p = xconfigStrcat(libdir, path + 6, NULL);
-                free(path);
-                path = p;
+        if (strncmp(__font_paths[i], "LIBDIR/", 7) == 0) {
+            if ((libdir_fd == -1) ||
+                !has_fonts_dir(libdir_fd, __font_paths[i] + 7)) {
+                continue;
             }
-
-            /* temporarily chop off any ":unscaled" appendage */
-
-            p = strchr(path, ':');
-            if (p) *p = '\0';
-
-            /* skip this entry if the fonts.dir does not exist */
-
-            fonts_dir = xconfigStrcat(path, "/fonts.dir", NULL);
-            if (!is_file(fonts_dir)) {
-                /* does not exist */
-                free(path);
-                free(fonts_dir);
+            path = xconfigStrcat(libdir, __font_paths[i] + 6, NULL);
+        } else {
+            if (!has_fonts_dir(AT_FDCWD, __font_paths[i])) {
                 continue;
             }
-            free(fonts_dir);
+            path = xconfigStrdup(__font_paths[i]);
+        }
 
-            /* add the ":unscaled" back */
+        /*
+         * either use this path as the fontpath, or append to the
+         * existing fontpath
+         */
 
-            if (p) *p = ':';
+        if (config->files->fontpath) {
+            orig = config->files->fontpath;
+            config->files->fontpath = xconfigStrcat(orig, ",", path, NULL);
+            free(orig);
+            free(path);
+        } else {
+            config->files->fontpath = path;
+        }
+    }
 
-            /*
-             * either use this path as the fontpath, or append to the
-             * existing fontpath
-             */
+    if (libdir_fd != -1) close(libdir_fd);
 
-            if (config->files->fontpath) {
-                orig = config->files->fontpath;
-                config->files->fontpath = xconfigStrcat(orig, ",", path, NULL);
-                free(orig);
-                free(path);
-            } else {
-                config->files->fontpath = path;
-            }
-        }
+    /* free the libdir string */
 
-        /* free the libdir string */
+    free(libdir);
 
-        free(libdir);
-    }
 } /* add_font_path() */
 
 
@@ -471,8 +538,9 @@ static XConfigDevicePtr add_device(XConfigPtr config, int bus, int domain,
     device->vendor = xconfigStrdup("NVIDIA Corporation");
 
     if (bus != -1 && domain != -1 && slot != -1) {
+        device->pciaddr = XCONFIG_PCI_ADDRESS(domain, bus, slot, 0);
         device->busid = xconfigAlloc(32);
-        xconfigFormatPciBusString(device->busid, 32, domain, bus, slot, 0);
+        xconfigFormatPciAddress(device->busid, 32, device->pciaddr);
     }
 
     if (boardname) device->board = xconfigStrdup(boardname);
@@ -576,6 +644,109 @@ static void add_inputref(XConfigPtr config, XConfigLayoutPtr layout,
 
 
 
+/*********************************************************************/
+
+/*
+ * Table indexing
+ *
+ * The mouse, gpm protocol and keyboard tables below are searched
+ * through sorted indexes, built the first time a table is consulted.
+ * Each index entry pairs a key with the position of its row in the
+ * table; rows with equal keys stay in table order, so a lookup finds
+ * the same row that a linear scan of the table would.
+ */
+
+typedef struct {
+    const char *key;
+    int row;
+} TableIndexRec;
+
+
+static int compare_index_case(const void *a, const void *b)
+{
+    const TableIndexRec *x = a, *y = b;
+    int ret = strcmp(x->key, y->key);
+
+    return ret ? ret : (x->row - y->row);
+}
+
+static int compare_index_nocase(const void *a, const void *b)
+{
+    const TableIndexRec *x = a, *y = b;
+    int ret = strcasecmp(x->key, y->key);
+
+    return ret ? ret : (x->row - y->row);
+}
+
+
+
+/*
+ * sort_table_index() - sort the n entries of the index by key, case
+ * sensitive or not.
+ */
+
+static void sort_table_index(TableIndexRec *index, int n, int nocase)
+{
+    qsort(index, n, sizeof(TableIndexRec),
+          nocase ? compare_index_nocase : compare_index_case);
+
+} /* sort_table_index() */
+
+
+
+/*
+ * count_index_run() - return the number of leading entries of the
+ * index (of length n) that have the same key as the first.
+ */
+
+static int count_index_run(const TableIndexRec *index, int n, int nocase)
+{
+    int i;
+
+    for (i = 1; i < n; i++) {
+        if ((nocase ? strcasecmp(index[i].key, index[0].key) :
+                      strcmp(index[i].key, index[0].key)) != 0) break;
+    }
+
+    return i;
+
+} /* count_index_run() */
+
+
+
+/*
+ * lookup_table_index() - binary search the index for the first entry
+ * with the given key; return its position in the index, or -1 if
+ * there is no such entry.
+ */
+
+static int lookup_table_index(const TableIndexRec *index, int n,
+                              const char *key, int nocase)
+{
+    int lo = 0, hi = n, mid;
+
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if ((nocase ? strcasecmp(index[mid].key, key) :
+                      strcmp(index[mid].key, key)) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    if ((lo < n) &&
+        ((nocase ? strcasecmp(index[lo].key, key) :
+                   strcmp(index[lo].key, key)) == 0)) {
+        return lo;
+    }
+
+    return -1;
+
+} /* lookup_table_index() */
+
+
+
 /*********************************************************************/
 
 /*
@@ -680,6 +851,55 @@ static const ProtocolEntry __protocols[] = {
 };
 
 
+#define NUM_MICE      ((int) ARRAY_LEN(__mice) - 1)
+#define NUM_PROTOCOLS ((int) ARRAY_LEN(__protocols) - 1)
+
+static struct {
+    int built;
+    TableIndexRec byShortname[NUM_MICE];
+    TableIndexRec byDevice[NUM_MICE];
+    TableIndexRec byXproto[NUM_MICE];    /* case insensitive */
+    TableIndexRec byGpmproto[NUM_PROTOCOLS];
+} mouse_index;
+
+
+
+/*
+ * build_mouse_index() - index the __mice[] table by shortname, device
+ * and X protocol, and the __protocols[] table by gpm protocol.
+ */
+
+static void build_mouse_index(void)
+{
+    int i;
+
+    if (mouse_index.built) return;
+
+    for (i = 0; i < NUM_MICE; i++) {
+        mouse_index.byShortname[i].key = __mice[i].shortname;
+        mouse_index.byShortname[i].row = i;
+        mouse_index.byDevice[i].key = __mice[i].device;
+        mouse_index.byDevice[i].row = i;
+        mouse_index.byXproto[i].key = __mice[i].Xproto;
+        mouse_index.byXproto[i].row = i;
+    }
+
+    for (i = 0; i < NUM_PROTOCOLS; i++) {
+        mouse_index.byGpmproto[i].key = __protocols[i].gpmproto;
+        mouse_index.byGpmproto[i].row = i;
+    }
+
+    sort_table_index(mouse_index.byShortname, NUM_MICE, FALSE);
+    sort_table_index(mouse_index.byDevice, NUM_MICE, FALSE);
+    sort_table_index(mouse_index.byXproto, NUM_MICE, TRUE);
+    sort_table_index(mouse_index.byGpmproto, NUM_PROTOCOLS, FALSE);
+
+    mouse_index.built = TRUE;
+
+} /* build_mouse_index() */
+
+
+
 /*
  * gpm_proto_to_X_proto() - map from gpm mouse protocol to X mouse
  * protocol
@@ -689,21 +909,21 @@ static char* gpm_proto_to_X_proto(const char *gpm)
 {
     int i;
 
-    for (i = 0; __protocols[i].gpmproto; i++) {
-        if (strcmp(gpm, __protocols[i].gpmproto) == 0) {
-            return __protocols[i].Xproto;
-        }
-    }
-    return NULL;
+    build_mouse_index();
+
+    i = lookup_table_index(mouse_index.byGpmproto, NUM_PROTOCOLS, gpm, FALSE);
+    if (i < 0) return NULL;
+
+    return __protocols[mouse_index.byGpmproto[i].row].Xproto;
 
 } /* gpm_proto_to_X_proto() */
 
 
 
 /*
- * find_mouse_entry() - scan the __mice[] table for the entry that
- * corresponds to the specified value; return a pointer to the
- * matching entry in the table, if any.
+ * find_mouse_entry() - look up the __mice[] table entry whose
+ * shortname is the specified value; return a pointer to the matching
+ * entry in the table, if any.
  */
 
 static const MouseEntry *find_mouse_entry(char *value)
@@ -712,30 +932,36 @@ static const MouseEntry *find_mouse_entry(char *value)
 
     if (!value) return NULL;
 
-    for (i = 0; __mice[i].name; i++) {
-        if (strcmp(value, __mice[i].shortname) == 0) {
-            return &__mice[i];
-        }
-    }
-    return NULL;
+    build_mouse_index();
+
+    i = lookup_table_index(mouse_index.byShortname, NUM_MICE, value, FALSE);
+    if (i < 0) return NULL;
+
+    return &__mice[mouse_index.byShortname[i].row];
 
 } /* find_mouse_entry() */
 
 
 
 /*
- * find_closest_mouse_entry() - scan the __mice[] table for the entry that
+ * find_closest_mouse_entry() - find the first __mice[] table entry that
  * matches all of the specified values; any of the values can be NULL,
  * in which case we do not use them as part of the comparison.  Note
  * that device is compared case sensitive, proto is compared case
  * insensitive, and emulate3 is just a boolean.
+ *
+ * The candidates are taken from the device or the protocol index,
+ * whichever run of matching keys is shorter, and are checked in table
+ * order against the remaining values.
  */
 
 static const MouseEntry *find_closest_mouse_entry(const char *device,
                                                   const char *proto,
                                                   const char *emulate3_str)
 {
-    int i;
+    const TableIndexRec *candidates = NULL;
+    const MouseEntry *e;
+    int i, ncandidates = NUM_MICE;
     int emulate3 = FALSE;
 
     /*
@@ -758,11 +984,35 @@ static const MouseEntry *find_closest_mouse_entry(const char *device,
         device += 5; /* strlen("/dev/") */
     }
 
-    for (i = 0; __mice[i].name; i++) {
-        if ((device) && (strcmp(device, __mice[i].device) != 0)) continue;
-        if ((proto) && (strcasecmp(proto, __mice[i].Xproto)) != 0) continue;
-        if ((emulate3_str) && (emulate3 != __mice[i].emulate3)) continue;
-        return &__mice[i];
+    build_mouse_index();
+
+    if (device) {
+        i = lookup_table_index(mouse_index.byDevice, NUM_MICE, device, FALSE);
+        if (i < 0) return NULL;
+        candidates = &mouse_index.byDevice[i];
+        ncandidates = count_index_run(candidates, NUM_MICE - i, FALSE);
+    }
+
+    if (proto) {
+        const TableIndexRec *c;
+        int n;
+
+        i = lookup_table_index(mouse_index.byXproto, NUM_MICE, proto, TRUE);
+        if (i < 0) return NULL;
+        c = &mouse_index.byXproto[i];
+        n = count_index_run(c, NUM_MICE - i, TRUE);
+        if (n < ncandidates) {
+            candidates = c;
+            ncandidates = n;
+        }
+    }
+
+    for (i = 0; i < ncandidates; i++) {
+        e = candidates ? &__mice[candidates[i].row] : &__mice[i];
+        if ((device) && (strcmp(device, e->device) != 0)) continue;
+        if ((proto) && (strcasecmp(proto, e->Xproto)) != 0) continue;
+        if ((emulate3_str) && (emulate3 != e->emulate3)) continue;
+        return e;
     }
 
     return NULL;
@@ -772,96 +1022,162 @@ static const MouseEntry *find_closest_mouse_entry(const char *device,
 
 
 /*
- * find_config_entry() - scan the specified filename for the specified
- * keyword; return the value that the keyword is assigned to, or NULL
- * if any error occurs.
+ * Shell-style "KEY=value" files (/etc/sysconfig/mouse, etc) are
+ * mapped and indexed once, the first time they are consulted; each
+ * entry points into the mapping, so that lookups do not need to copy
+ * or rescan the file.
  */
 
-static char *find_config_entry(const char *filename, const char *keyword)
+typedef struct {
+    const char *key;
+    size_t keylen;
+    const char *value;
+    size_t valuelen;
+} ConfigEntryRec;
+
+typedef struct _ConfigFileRec {
+    struct _ConfigFileRec *next;
+    char *filename;
+    char *data;
+    size_t size;
+    int nentries;
+    ConfigEntryRec *entries;
+} ConfigFileRec;
+
+static ConfigFileRec *config_files = NULL;
+
+
+
+/*
+ * index_config_file() - record the first uncommented assignment to
+ * each key in the mapped file.  Only complete (newline terminated)
+ * lines are considered; an optional leading "export" is skipped.
+ */
+
+static void index_config_file(ConfigFileRec *file)
 {
-    int fd = -1;
-    char *data = NULL;
-    char *value = NULL;
-    char *buf = NULL;
-    char *tmp, *start, *c, *end;
-    struct stat stat_buf;
-    size_t len;
+    const char *p = file->data, *end = file->data + file->size;
+    const char *eol, *key;
+    int i, n = 0;
 
-    if ((fd = open(filename, O_RDONLY)) == -1) goto done;
+    for (eol = p; (eol = memchr(eol, '\n', end - eol)); eol++) n++;
 
-    if (fstat(fd, &stat_buf) == -1) goto done;
+    if (n == 0) return;
 
-    if ((data = mmap(0, stat_buf.st_size, PROT_READ, MAP_SHARED,
-                     fd, 0)) == (void *) -1) goto done;
+    file->entries = xconfigAlloc(n * sizeof(ConfigEntryRec));
 
-    /*
-     * create a sysmem copy of the buffer, so that we can explicitly
-     * NULL terminate it
-     */
+    for (; (eol = memchr(p, '\n', end - p)); p = eol + 1) {
 
-    buf = malloc(stat_buf.st_size + 1);
+        while ((p < eol) && ((*p == ' ') || (*p == '\t'))) p++;
 
-    if (!buf) goto done;
+        if (((eol - p) > 7) && !strncmp(p, "export", 6) &&
+            ((p[6] == ' ') || (p[6] == '\t'))) {
+            p += 7;
+            while ((p < eol) && ((*p == ' ') || (*p == '\t'))) p++;
+        }
 
-    memcpy(buf, data, stat_buf.st_size);
-    buf[stat_buf.st_size] = '\0';
+        key = p;
+        while ((p < eol) && (isalnum((unsigned char) *p) || (*p == '_'))) p++;
 
-    /* search for the keyword */
+        if ((p == key) || (p == eol) || (*p != '=')) continue;
 
-    start = buf;
+        /* the first assignment to a key wins */
 
-    while (TRUE) {
-        tmp = strstr(start, keyword);
-        if (!tmp) goto done;
+        for (i = 0; i < file->nentries; i++) {
+            if ((file->entries[i].keylen == (size_t) (p - key)) &&
+                !strncmp(file->entries[i].key, key, p - key)) break;
+        }
+        if (i < file->nentries) continue;
 
-        /*
-         * make sure this line is not commented out: search back from
-         * tmp: if we hit a "#" before a newline, then this line is
-         * commented out and we should search again
-         */
+        file->entries[i].key = key;
+        file->entries[i].keylen = p - key;
+        file->entries[i].value = p + 1;
+        file->entries[i].valuelen = eol - (p + 1);
+        file->nentries++;
+    }
 
-        c = tmp;
-        while ((c >= start) && (*c != '\n') && (*c != '#')) c--;
+} /* index_config_file() */
 
-        if (*c == '#') {
-            /* keyword was commented out... search again */
-            start = tmp+1;
-        } else {
-            /* keyword is not commented out */
-            break;
+
+
+/*
+ * get_config_file() - return the index for the specified file, reading
+ * it on first use.  A missing or unreadable file is cached as an empty
+ * index.
+ */
+
+static ConfigFileRec *get_config_file(const char *filename)
+{
+    ConfigFileRec *file;
+    struct stat stat_buf;
+    void *data;
+    int fd;
+
+    for (file = config_files; file; file = file->next) {
+        if (!strcmp(file->filename, filename)) return file;
+    }
+
+    file = xconfigAlloc(sizeof(ConfigFileRec));
+    file->filename = xconfigStrdup(filename);
+    file->next = config_files;
+    config_files = file;
+
+    if ((fd = open(filename, O_RDONLY)) == -1) return file;
+
+    if ((fstat(fd, &stat_buf) != -1) && (stat_buf.st_size > 0)) {
+        data = mmap(0, stat_buf.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (data != MAP_FAILED) {
+            file->data = data;
+            file->size = stat_buf.st_size;
+            index_config_file(file);
         }
     }
 
-    start = tmp + strlen(keyword);
-    end = strchr(start, '\n');
-    if (!end) goto done;
+    close(fd);
 
-    /* there must be something between the start and the end */
+    return file;
 
-    if (start == end) goto done;
+} /* get_config_file() */
 
-    /* take what is between as the value */
 
-    len = end - start;
-    value = xconfigAlloc(len + 1);
-    strncpy(value, start, len);
-    value[len] = '\0';
 
-    /* if the first and last characters are quotation marks, remove them */
+/*
+ * find_config_entry() - look up the value assigned to the specified
+ * key in the specified file; return a newly allocated copy of the
+ * value, with any surrounding quotation marks removed, or NULL if the
+ * key is not assigned a non-empty value.
+ */
 
-    if ((value[0] == '\"') && (value[len-1] == '\"')) {
-        tmp = xconfigAlloc(len - 1);
-        strncpy(tmp, value + 1, len - 2);
-        tmp[len-2] = '\0';
-        free(value);
-        value = tmp;
+static char *find_config_entry(const char *filename, const char *keyword)
+{
+    ConfigFileRec *file = get_config_file(filename);
+    const char *start;
+    char *value;
+    size_t keylen = strlen(keyword), len;
+    int i;
+
+    for (i = 0; i < file->nentries; i++) {
+        if ((file->entries[i].keylen == keylen) &&
+            !strncmp(file->entries[i].key, keyword, keylen)) break;
     }
 
- done:
+    if ((i == file->nentries) || (file->entries[i].valuelen == 0)) {
+        return NULL;
+    }
 
-    if (buf) free(buf);
-    if (data) munmap(data, stat_buf.st_size);
-    if (fd != -1) close(fd);
+    start = file->entries[i].value;
+    len = file->entries[i].valuelen;
+
+    /* if the first and last characters are quotation marks, remove them */
+
+    if ((len >= 2) && (start[0] == '\"') && (start[len-1] == '\"')) {
+        start++;
+        len -= 2;
+    }
+
+    value = xconfigAlloc(len + 1);
+    memcpy(value, start, len);
+    value[len] = '\0';
 
     return value;
 
@@ -889,12 +1205,60 @@ void xconfigGeneratePrintPossibleMice(void)
 
 
 
+/*
+ * find_probed_input() - return the input device of the given kind
+ * (keyboard or pointer) that the kernel lists, if the X server has
+ * the "evdev" driver to use it with; otherwise, return NULL.
+ */
+
+static XConfigProbedInputPtr find_probed_input(GenerateOptions *gop,
+                                               int pointer)
+{
+#if defined(NV_SUNOS) || defined(NV_BSD)
+    return NULL;
+#else
+    if (gop->xserver != X_IS_XORG) return NULL;
+
+    return xconfigFindProbedInput(gop->input_root, pointer);
+#endif
+
+} /* find_probed_input() */
+
+
+
+/*
+ * add_evdev_mouse() - add a mouse input section using the "evdev"
+ * driver on the event node of the probed pointer
+ */
+
+static void add_evdev_mouse(XConfigPtr config, XConfigProbedInputPtr probed)
+{
+    XConfigInputPtr input = xconfigAlloc(sizeof(XConfigInputRec));
+
+    input->comment = xconfigStrcat("    # generated from kernel input "
+                                   "device \"", probed->name, "\"\n", NULL);
+    input->identifier = xconfigStrdup("Mouse0");
+    input->driver = xconfigStrdup("evdev");
+
+    input->options = NULL;
+    xconfigAddNewOption(&input->options, "Device", probed->device);
+
+    input->next = config->inputs;
+    config->inputs = input;
+
+} /* add_evdev_mouse() */
+
+
+
 /*
  * xconfigAddMouse() - determine the mouse type, and then add an
  * XConfigInputRec with the appropriate options.
  *
  * - if the user specified on the commandline, use that
  *
+ * - if the kernel lists a pointing device among its input devices,
+ *   use the "evdev" driver on its event node
+ *
  * - if /etc/sysconfig/mouse exists and contains valid data, use
  *   that
  *
@@ -908,6 +1272,7 @@ void xconfigGeneratePrintPossibleMice(void)
 int xconfigAddMouse(GenerateOptions *gop, XConfigPtr config)
 {
     const MouseEntry *entry = NULL;
+    XConfigProbedInputPtr probed;
     XConfigInputPtr input;
     char *device_path, *comment = "default";
 
@@ -923,6 +1288,16 @@ int xconfigAddMouse(GenerateOptions *gop, XConfigPtr config)
         }
     }
 
+    /*
+     * if the kernel lists a pointing device, use the evdev driver on
+     * its event node
+     */
+
+    if (!entry && (probed = find_probed_input(gop, TRUE))) {
+        add_evdev_mouse(config, probed);
+        return TRUE;
+    }
+
     /*
      * if /etc/sysconfig/mouse exists, and contains valid data, use
      * that
@@ -931,9 +1306,9 @@ int xconfigAddMouse(GenerateOptions *gop, XConfigPtr config)
     if (!entry) {
         char *protocol, *device, *emulate3;
 
-        device = find_config_entry("/etc/sysconfig/mouse", "DEVICE=");
-        protocol = find_config_entry("/etc/sysconfig/mouse", "XMOUSETYPE=");
-        emulate3 = find_config_entry("/etc/sysconfig/mouse", "XEMU3=");
+        device = find_config_entry("/etc/sysconfig/mouse", "DEVICE");
+        protocol = find_config_entry("/etc/sysconfig/mouse", "XMOUSETYPE");
+        emulate3 = find_config_entry("/etc/sysconfig/mouse", "XEMU3");
 
         if (device || protocol || emulate3) {
             entry = find_closest_mouse_entry(device, protocol, emulate3);
@@ -948,8 +1323,8 @@ int xconfigAddMouse(GenerateOptions *gop, XConfigPtr config)
     if (!entry) {
         char *protocol, *device;
 
-        protocol = find_config_entry("/etc/conf.d/gpm", "MOUSE=");
-        device = find_config_entry("/etc/conf.d/gpm", "MOUSEDEV=");
+        protocol = find_config_entry("/etc/conf.d/gpm", "MOUSE");
+        device = find_config_entry("/etc/conf.d/gpm", "MOUSEDEV");
 
         if (protocol && device) {
             MouseEntry *e = xconfigAlloc(sizeof(MouseEntry));
@@ -1126,10 +1501,19 @@ static const KeyboardEntry __keyboards[] = {
 
 
 
+#define NUM_KEYBOARDS ((int) ARRAY_LEN(__keyboards) - 1)
+
+static struct {
+    int built;
+    TableIndexRec byKeytable[NUM_KEYBOARDS];
+} keyboard_index;
+
+
+
 /*
- * find_keyboard_entry() - scan the __keyboards[] table for the entry that
- * corresponds to the specified value; return a pointer to the
- * matching entry in the table, if any.
+ * find_keyboard_entry() - look up the __keyboards[] table entry whose
+ * keytable is the specified value; return a pointer to the matching
+ * entry in the table, if any.
  */
 
 static const KeyboardEntry *find_keyboard_entry(char *value)
@@ -1138,12 +1522,20 @@ static const KeyboardEntry *find_keyboard_entry(char *value)
 
     if (!value) return NULL;
 
-    for (i = 0; __keyboards[i].name; i++) {
-        if (strcmp(value, __keyboards[i].keytable) == 0) {
-            return &__keyboards[i];
+    if (!keyboard_index.built) {
+        for (i = 0; i < NUM_KEYBOARDS; i++) {
+            keyboard_index.byKeytable[i].key = __keyboards[i].keytable;
+            keyboard_index.byKeytable[i].row = i;
         }
+        sort_table_index(keyboard_index.byKeytable, NUM_KEYBOARDS, FALSE);
+        keyboard_index.built = TRUE;
     }
-    return NULL;
+
+    i = lookup_table_index(keyboard_index.byKeytable, NUM_KEYBOARDS,
+                           value, FALSE);
+    if (i < 0) return NULL;
+
+    return &__keyboards[keyboard_index.byKeytable[i].row];
 
 } /* find_keyboard_entry() */
 
@@ -1179,15 +1571,29 @@ void xconfigGeneratePrintPossibleKeyboards(void)
  *
  * - if /etc/sysconfig/keyboard exists, and contains a valid
  *   KEYTABLE entry, use that
+ *
+ * Unless the user specified a keyboard driver, a keyboard that the
+ * kernel lists among its input devices is used with the "evdev"
+ * driver on its event node.
  */
 
 int xconfigAddKeyboard(GenerateOptions *gop, XConfigPtr config)
 {
     char *value, *comment = "default";
     const KeyboardEntry *entry = NULL;
+    XConfigProbedInputPtr probed = NULL;
 
     XConfigInputPtr input;
 
+    /*
+     * the capability bits identify the keyboard device, but not its
+     * layout; the layout is looked for as before
+     */
+
+    if (!gop->keyboard_driver) {
+        probed = find_probed_input(gop, FALSE);
+    }
+
     /*
      * if the user specified on the command line, use that
      */
@@ -1208,7 +1614,7 @@ int xconfigAddKeyboard(GenerateOptions *gop, XConfigPtr config)
      */
 
     if (!entry) {
-        value = find_config_entry("/etc/sysconfig/keyboard", "KEYTABLE=");
+        value = find_config_entry("/etc/sysconfig/keyboard", "KEYTABLE");
         entry = find_keyboard_entry(value);
         if (value) {
             free(value);
@@ -1222,13 +1628,20 @@ int xconfigAddKeyboard(GenerateOptions *gop, XConfigPtr config)
 
     input = xconfigAlloc(sizeof(XConfigInputRec));
 
-    input->comment = xconfigStrcat("    # generated from ",
-                                   comment, "\n", NULL);
+    if (probed) {
+        input->comment = xconfigStrcat("    # generated from ", comment,
+                                       " and kernel input device \"",
+                                       probed->name, "\"\n", NULL);
+    } else {
+        input->comment = xconfigStrcat("    # generated from ",
+                                       comment, "\n", NULL);
+    }
     input->identifier = xconfigStrdup("Keyboard0");
 
     /*
-     * determine which keyboard driver should be used (either "kbd" or
+     * determine which keyboard driver should be used ("evdev", "kbd" or
      * "keyboard"); if the user specified a keyboard driver use that;
+     * if the kernel lists a keyboard, use "evdev" on its event node;
      * if 'ROOT/lib/modules/input/kbd_drv.(o|so)' exists, use "kbd";
      * otherwise, use "keyboard".
      * On Solaris, use the default "keyboard"
@@ -1236,6 +1649,8 @@ int xconfigAddKeyboard(GenerateOptions *gop, XConfigPtr config)
 
     if (gop->keyboard_driver) {
         input->driver = gop->keyboard_driver;
+    } else if (probed) {
+        input->driver = xconfigStrdup("evdev");
     } else {
 #if defined(NV_SUNOS) || defined(NV_BSD)
         input->driver = xconfigStrdup("keyboard");
@@ -1255,6 +1670,10 @@ int xconfigAddKeyboard(GenerateOptions *gop, XConfigPtr config)
 
     input->options = NULL;
 
+    if (probed) {
+        xconfigAddNewOption(&input->options, "Device", probed->device);
+    }
+
     if (entry) {
         if (entry->layout)
             xconfigAddNewOption(&input->options, "XkbLayout", entry->layout);
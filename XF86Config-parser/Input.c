@@ -336,7 +336,7 @@ xconfigFreeInputList (XConfigInputPtr *ptr)
     {
         TEST_FREE ((*ptr)->identifier);
         TEST_FREE ((*ptr)->driver);
-        TEST_FREE ((*ptr)->comment);
+        FREE_COMMENT ((*ptr)->comment);
         xconfigFreeOptionList (&((*ptr)->options));
 
         prev = *ptr;
@@ -357,7 +357,7 @@ xconfigFreeInputClassList (XConfigInputClassPtr *ptr)
     {
         TEST_FREE ((*ptr)->identifier);
         TEST_FREE ((*ptr)->driver);
-        TEST_FREE ((*ptr)->comment);
+        FREE_COMMENT ((*ptr)->comment);
         TEST_FREE ((*ptr)->match_product);
         TEST_FREE ((*ptr)->match_vendor);
         TEST_FREE ((*ptr)->match_driver);
@@ -431,6 +431,36 @@ xconfigFindInputByDriver (const char *driver, XConfigInputPtr p)
 
 
 
+/*
+ * findProbedEvdevInput() - return the first input section using the
+ * "evdev" driver on the event node of a device that the kernel lists
+ * as a pointer (or, if mouse is FALSE, a keyboard); see InputProbe.c
+ */
+
+static XConfigInputPtr findProbedEvdevInput(GenerateOptions *gop,
+                                            XConfigInputPtr p,
+                                            const int mouse)
+{
+    XConfigProbedInputPtr probed;
+    XConfigOptionPtr opt;
+
+    for (; p; p = p->next) {
+        if (xconfigNameCompare("evdev", p->driver) != 0) continue;
+
+        opt = xconfigFindOption(p->options, "Device");
+        if (!opt) continue;
+
+        probed = xconfigFindProbedInputByDevice(gop->input_root, opt->val);
+        if (probed && (mouse ? probed->pointer : probed->keyboard)) {
+            return p;
+        }
+    }
+
+    return NULL;
+}
+
+
+
 static int getCoreInputDevice(GenerateOptions *gop,
                               XConfigPtr config,
                               XConfigLayoutPtr layout,
@@ -501,7 +531,8 @@ static int getCoreInputDevice(GenerateOptions *gop,
     
     /*
      * if we didn't find a core input device above, then select the
-     * first input with the correct driver
+     * first input with the correct driver, or else the first evdev
+     * input on a device of the correct kind
      */
     
     firstTry = TRUE;
@@ -516,6 +547,9 @@ static int getCoreInputDevice(GenerateOptions *gop,
         if (!input && defaultDriver1) {
             input = xconfigFindInputByDriver(defaultDriver1, config->inputs);
         }
+        if (!input) {
+            input = findProbedEvdevInput(gop, config->inputs, mouse);
+        }
         if (input) {
             core = input;
             found_msg = foundMsg1;
@@ -0,0 +1,536 @@
+/*
+ * nvidia-xconfig: A tool for manipulating X config files,
+ * specifically for use by the NVIDIA Linux graphics driver.
+ *
+ * Copyright (C) 2005 NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>.
+ *
+ *
+ * InputProbe.c - enumerate the kernel's input devices, and classify
+ * them as keyboards and pointers from their capability bits.
+ *
+ * fixtures/input-root and fixtures/input-root-sysfs are fake trees (a
+ * laptop with a USB mouse and a combined keyboard and touchpad) that
+ * can be probed with '--input-root', through /proc and /sys
+ * respectively.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <dirent.h>
+#include <limits.h>
+
+#include "xf86Parser.h"
+#include "Configint.h"
+
+
+#define PROC_INPUT_DEVICES "/proc/bus/input/devices"
+#define SYS_CLASS_INPUT    "/sys/class/input"
+
+/*
+ * event types and codes from <linux/input.h>; they are part of the
+ * kernel ABI, and are defined here so that this file builds on
+ * every platform
+ */
+
+#define INPUT_EV_KEY     0x01
+#define INPUT_EV_REL     0x02
+#define INPUT_EV_ABS     0x03
+
+#define INPUT_REL_X      0x00
+#define INPUT_REL_Y      0x01
+#define INPUT_ABS_X      0x00
+#define INPUT_ABS_Y      0x01
+
+#define INPUT_BTN_MOUSE  0x110
+#define INPUT_BTN_TOUCH  0x14a
+#define INPUT_BTN_STYLUS 0x14b
+
+#define INPUT_KEY_MAX    0x2ff
+
+#define BITS_PER_WORD    (sizeof(unsigned long) * CHAR_BIT)
+#define BITMASK_WORDS    ((INPUT_KEY_MAX / BITS_PER_WORD) + 1)
+
+typedef struct {
+    unsigned long ev[BITMASK_WORDS];
+    unsigned long key[BITMASK_WORDS];
+    unsigned long rel[BITMASK_WORDS];
+    unsigned long abs[BITMASK_WORDS];
+} InputCapabilities;
+
+
+/* the devices found by the last probe, and the root they were read from */
+
+static struct {
+    int valid;
+    char *root;
+    XConfigProbedInputPtr devices;
+} probe_cache;
+
+
+
+/*
+ * parse_bitmask() - parse a capability bitmask as printed by the
+ * kernel: hexadecimal words separated by spaces, most significant
+ * word first.  Bits beyond the size of the bitmask are dropped.
+ */
+
+static void parse_bitmask(const char *str, unsigned long *bits)
+{
+    const char *p, *end;
+    int word;
+
+    memset(bits, 0, BITMASK_WORDS * sizeof(unsigned long));
+
+    /* walk the words from the end of the string, least significant first */
+
+    end = str + strlen(str);
+
+    for (word = 0; word < (int) BITMASK_WORDS; word++) {
+        while ((end > str) && isspace((unsigned char) end[-1])) end--;
+        if (end == str) break;
+
+        p = end;
+        while ((p > str) && !isspace((unsigned char) p[-1])) p--;
+
+        bits[word] = strtoul(p, NULL, 16);
+        end = p;
+    }
+}
+
+
+static int test_bit(int bit, const unsigned long *bits)
+{
+    return (bits[bit / BITS_PER_WORD] >> (bit % BITS_PER_WORD)) & 1;
+}
+
+
+
+/*
+ * classify_device() - decide whether a device is a keyboard and/or a
+ * pointer: a keyboard reports the keys from KEY_ESC through KEY_S (the
+ * number row and the first two letter rows), a pointer reports relative or absolute X and Y axes with a
+ * button.
+ */
+
+static void classify_device(XConfigProbedInputPtr dev,
+                            const InputCapabilities *caps)
+{
+    int i;
+
+    if (test_bit(INPUT_EV_KEY, caps->ev)) {
+        dev->keyboard = TRUE;
+        for (i = 1; i < 32; i++) {
+            if (!test_bit(i, caps->key)) {
+                dev->keyboard = FALSE;
+                break;
+            }
+        }
+    }
+
+    if (test_bit(INPUT_EV_REL, caps->ev) &&
+        test_bit(INPUT_REL_X, caps->rel) &&
+        test_bit(INPUT_REL_Y, caps->rel) &&
+        test_bit(INPUT_BTN_MOUSE, caps->key)) {
+        dev->pointer = TRUE;
+    }
+
+    if (test_bit(INPUT_EV_ABS, caps->ev) &&
+        test_bit(INPUT_ABS_X, caps->abs) &&
+        test_bit(INPUT_ABS_Y, caps->abs) &&
+        (test_bit(INPUT_BTN_MOUSE, caps->key) ||
+         test_bit(INPUT_BTN_TOUCH, caps->key) ||
+         test_bit(INPUT_BTN_STYLUS, caps->key))) {
+        dev->pointer = TRUE;
+    }
+}
+
+
+
+/*
+ * event_node() - return the path of the device's event node, from the
+ * "eventN" handler in its list of handlers, or NULL if it has none
+ */
+
+static char *event_node(const char *handlers)
+{
+    const char *p = handlers;
+    size_t len;
+
+    while (*p) {
+        while (isspace((unsigned char) *p)) p++;
+        len = strcspn(p, " \t");
+
+        if ((len > 5) && !strncmp(p, "event", 5) &&
+            (strspn(p + 5, "0123456789") == len - 5)) {
+            char *device = xconfigAlloc(len + strlen("/dev/input/") + 1);
+            strcpy(device, "/dev/input/");
+            strncat(device, p, len);
+            return device;
+        }
+        p += len;
+    }
+
+    return NULL;
+}
+
+
+
+/*
+ * add_device() - classify the device and append it to the list; the
+ * name and handlers are taken over by the new list entry.
+ */
+
+static void add_device(XConfigProbedInputPtr *head,
+                       XConfigProbedInputPtr *tail,
+                       char *name, char *handlers,
+                       const InputCapabilities *caps)
+{
+    XConfigProbedInputPtr dev = xconfigAlloc(sizeof(XConfigProbedInputRec));
+
+    dev->name = name ? name : xconfigStrdup("");
+    dev->handlers = handlers ? handlers : xconfigStrdup("");
+    dev->device = event_node(dev->handlers);
+
+    classify_device(dev, caps);
+
+    if (*tail) {
+        (*tail)->next = dev;
+    } else {
+        *head = dev;
+    }
+    *tail = dev;
+}
+
+
+
+/*
+ * chomp() - strip trailing whitespace in place
+ */
+
+static void chomp(char *s)
+{
+    size_t len = strlen(s);
+
+    while ((len > 0) && isspace((unsigned char) s[len - 1])) s[--len] = '\0';
+}
+
+
+
+/*
+ * read_proc_devices() - read all input devices from the single
+ * /proc/bus/input/devices file; each device is a block of "X: ..."
+ * lines, terminated by a blank line.  Returns FALSE if the file
+ * cannot be opened.
+ */
+
+static int read_proc_devices(const char *root, XConfigProbedInputPtr *head)
+{
+    XConfigProbedInputPtr tail = NULL;
+    InputCapabilities caps;
+    char *path, *name = NULL, *handlers = NULL;
+    char line[1024];
+    int have_device = FALSE;
+    FILE *fp;
+
+    path = xconfigStrcat(root, PROC_INPUT_DEVICES, NULL);
+    fp = fopen(path, "r");
+    free(path);
+
+    if (!fp) return FALSE;
+
+    memset(&caps, 0, sizeof(caps));
+
+    while (TRUE) {
+        char *l = fgets(line, sizeof(line), fp);
+
+        if (l) chomp(line);
+
+        if (!l || (line[0] == '\0')) {
+            if (have_device) {
+                add_device(head, &tail, name, handlers, &caps);
+                name = handlers = NULL;
+                memset(&caps, 0, sizeof(caps));
+                have_device = FALSE;
+            }
+            if (!l) break;
+            continue;
+        }
+
+        have_device = TRUE;
+
+        if (!strncmp(line, "N: Name=", 8)) {
+            char *s = line + 8;
+            size_t len = strlen(s);
+
+            if ((len >= 2) && (s[0] == '"') && (s[len - 1] == '"')) {
+                s[len - 1] = '\0';
+                s++;
+            }
+            free(name);
+            name = xconfigStrdup(s);
+        } else if (!strncmp(line, "H: Handlers=", 12)) {
+            free(handlers);
+            handlers = xconfigStrdup(line + 12);
+        } else if (!strncmp(line, "B: EV=", 6)) {
+            parse_bitmask(line + 6, caps.ev);
+        } else if (!strncmp(line, "B: KEY=", 7)) {
+            parse_bitmask(line + 7, caps.key);
+        } else if (!strncmp(line, "B: REL=", 7)) {
+            parse_bitmask(line + 7, caps.rel);
+        } else if (!strncmp(line, "B: ABS=", 7)) {
+            parse_bitmask(line + 7, caps.abs);
+        }
+    }
+
+    fclose(fp);
+
+    return TRUE;
+}
+
+
+
+/*
+ * read_sysfs_attribute() - read the first line of a sysfs attribute
+ * file into a newly allocated string; returns NULL on failure.
+ */
+
+static char *read_sysfs_attribute(const char *dir, const char *attr)
+{
+    char *path, *value = NULL;
+    char line[1024];
+    FILE *fp;
+
+    path = xconfigStrcat(dir, "/", attr, NULL);
+    fp = fopen(path, "r");
+    free(path);
+
+    if (!fp) return NULL;
+
+    if (fgets(line, sizeof(line), fp)) {
+        chomp(line);
+        value = xconfigStrdup(line);
+    }
+
+    fclose(fp);
+
+    return value;
+}
+
+
+
+static int is_input_dir(const struct dirent *ent)
+{
+    return !strncmp(ent->d_name, "input", 5) &&
+        isdigit((unsigned char) ent->d_name[5]);
+}
+
+
+/*
+ * compare_input_dirs() - sort the inputN directories by number, i.e.,
+ * in the order /proc/bus/input/devices lists the devices
+ */
+
+static int compare_input_dirs(const struct dirent **a, const struct dirent **b)
+{
+    unsigned long na = strtoul((*a)->d_name + 5, NULL, 10);
+    unsigned long nb = strtoul((*b)->d_name + 5, NULL, 10);
+
+    return (na > nb) - (na < nb);
+}
+
+
+
+/*
+ * read_sysfs_devices() - read the input devices from the inputN
+ * directories under /sys/class/input, in numerical order; the handlers
+ * are the names of the event, mouse, etc nodes within each directory.
+ * Returns FALSE if the directory cannot be read.
+ */
+
+static int read_sysfs_devices(const char *root, XConfigProbedInputPtr *head)
+{
+    static const struct {
+        const char *attr;
+        size_t offset;
+    } bitmasks[] = {
+        { "capabilities/ev",  offsetof(InputCapabilities, ev)  },
+        { "capabilities/key", offsetof(InputCapabilities, key) },
+        { "capabilities/rel", offsetof(InputCapabilities, rel) },
+        { "capabilities/abs", offsetof(InputCapabilities, abs) },
+    };
+
+    XConfigProbedInputPtr tail = NULL;
+    InputCapabilities caps;
+    struct dirent **ents, *sub;
+    char *path, *dir, *value, *name, *handlers;
+    DIR *subdp;
+    int i, n, ent;
+
+    path = xconfigStrcat(root, SYS_CLASS_INPUT, NULL);
+    n = scandir(path, &ents, is_input_dir, compare_input_dirs);
+
+    if (n < 0) {
+        free(path);
+        return FALSE;
+    }
+
+    for (ent = 0; ent < n; ent++) {
+        dir = xconfigStrcat(path, "/", ents[ent]->d_name, NULL);
+        free(ents[ent]);
+
+        memset(&caps, 0, sizeof(caps));
+        for (i = 0; i < (int) (sizeof(bitmasks) / sizeof(bitmasks[0])); i++) {
+            value = read_sysfs_attribute(dir, bitmasks[i].attr);
+            if (value) {
+                parse_bitmask(value,
+                              (unsigned long *)
+                              ((char *) &caps + bitmasks[i].offset));
+                free(value);
+            }
+        }
+
+        name = read_sysfs_attribute(dir, "name");
+
+        handlers = NULL;
+        if ((subdp = opendir(dir))) {
+            while ((sub = readdir(subdp))) {
+                if (!strncmp(sub->d_name, "event", 5) ||
+                    !strncmp(sub->d_name, "mouse", 5) ||
+                    !strncmp(sub->d_name, "js", 2)) {
+                    char *tmp = handlers ?
+                        xconfigStrcat(handlers, " ", sub->d_name, NULL) :
+                        xconfigStrdup(sub->d_name);
+                    free(handlers);
+                    handlers = tmp;
+                }
+            }
+            closedir(subdp);
+        }
+
+        add_device(head, &tail, name, handlers, &caps);
+        free(dir);
+    }
+
+    free(ents);
+    free(path);
+
+    return TRUE;
+}
+
+
+
+/*
+ * free_probed_inputs() - free a list of probed input devices
+ */
+
+static void free_probed_inputs(XConfigProbedInputPtr dev)
+{
+    XConfigProbedInputPtr next;
+
+    while (dev) {
+        next = dev->next;
+        free(dev->name);
+        free(dev->handlers);
+        free(dev->device);
+        free(dev);
+        dev = next;
+    }
+}
+
+
+
+/*
+ * xconfigProbeInputDevices() - return the list of input devices known
+ * to the kernel, read from /proc/bus/input/devices or, if that is not
+ * available, from /sys/class/input.  Both paths are relative to root
+ * (NULL meaning "/"), so that a fake tree can be probed instead.
+ *
+ * The devices are enumerated once, on the first call for a given
+ * root; the returned list belongs to the parser and must not be freed.
+ */
+
+XConfigProbedInputPtr xconfigProbeInputDevices(const char *root)
+{
+    XConfigProbedInputPtr devices = NULL;
+
+    if (!root) root = "";
+
+    if (probe_cache.valid && !strcmp(probe_cache.root, root)) {
+        return probe_cache.devices;
+    }
+
+    if (!read_proc_devices(root, &devices)) {
+        read_sysfs_devices(root, &devices);
+    }
+
+    free_probed_inputs(probe_cache.devices);
+    free(probe_cache.root);
+
+    probe_cache.root = xconfigStrdup(root);
+    probe_cache.devices = devices;
+    probe_cache.valid = TRUE;
+
+    return devices;
+}
+
+
+
+/*
+ * xconfigFindProbedInput() - return the first probed input device
+ * with an event node that is a keyboard (or, if pointer is TRUE, a
+ * pointer), or NULL.  A device that is only of the requested kind
+ * (e.g., a mouse, rather than a keyboard with a built-in trackpoint)
+ * is preferred.
+ */
+
+XConfigProbedInputPtr xconfigFindProbedInput(const char *root, int pointer)
+{
+    XConfigProbedInputPtr dev, found = NULL;
+    int is, other;
+
+    for (dev = xconfigProbeInputDevices(root); dev; dev = dev->next) {
+        if (!dev->device) continue;
+
+        is = pointer ? dev->pointer : dev->keyboard;
+        other = pointer ? dev->keyboard : dev->pointer;
+
+        if (is && !other) return dev;
+        if (is && !found) found = dev;
+    }
+
+    return found;
+}
+
+
+
+/*
+ * xconfigFindProbedInputByDevice() - return the probed input device
+ * whose event node is the given device path, or NULL.
+ */
+
+XConfigProbedInputPtr xconfigFindProbedInputByDevice(const char *root,
+                                                     const char *device)
+{
+    XConfigProbedInputPtr dev;
+
+    if (!device) return NULL;
+
+    for (dev = xconfigProbeInputDevices(root); dev; dev = dev->next) {
+        if (dev->device && !strcmp(dev->device, device)) return dev;
+    }
+
+    return NULL;
+}
@@ -0,0 +1,1779 @@
+/*
+ * nvidia-xconfig: A tool for manipulating X config files,
+ * specifically for use by the NVIDIA Linux graphics driver.
+ *
+ * Copyright (C) 2005 NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>.
+ *
+ *
+ * Json.c - export an X config as JSON, and import an X config from
+ * JSON.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <limits.h>
+#include <errno.h>
+#include <math.h>
+
+#include "xf86Parser.h"
+#include "Configint.h"
+
+extern char *configPath;
+
+
+/*
+ * The JSON form of an X config mirrors XConfigRec:
+ *
+ *     { "version": 1, "config": { "monitors": [ { "identifier": ... } ] } }
+ *
+ * Each record is an object whose members are named after the fields of
+ * the C structure; lists of records (sections, options, modelines, ...)
+ * are arrays of objects.  Fields that still have the value the parser
+ * gives a new record (NULL, 0, or, e.g., -1 for XConfigDeviceRec.irq)
+ * are left out.  References between sections are given by name only
+ * (e.g., "monitor_name"); they are resolved when the config is
+ * imported, as when an X config file is read.
+ */
+
+#define JSON_VERSION 1
+
+enum {
+    JSON_STRING = 0,
+    JSON_INTERNED,      /* string kept with xconfigInternString() */
+    JSON_INT,
+    JSON_ULONG,
+    JSON_FLOAT,
+    JSON_RANGES,        /* parser_range[max], with an int count */
+    JSON_RGB,           /* parser_rgb, as [ red, green, blue ] */
+    JSON_INTS,          /* int[max], with an optional int count */
+    JSON_OBJECT,        /* pointer to one record */
+    JSON_LIST,          /* list of records */
+};
+
+enum {
+    J_CONFIG = 0,
+    J_FILES,
+    J_MODULE,
+    J_LOAD,
+    J_OPTION,
+    J_FLAGS,
+    J_VIDEOADAPTOR,
+    J_VIDEOPORT,
+    J_MODES,
+    J_MODELINE,
+    J_MODESLINK,
+    J_MONITOR,
+    J_DEVICE,
+    J_MODE,
+    J_DISPLAY,
+    J_ADAPTORLINK,
+    J_SCREEN,
+    J_INPUT,
+    J_INPUTCLASS,
+    J_INPUTREF,
+    J_ADJACENCY,
+    J_INACTIVE,
+    J_LAYOUT,
+    J_VENDSUB,
+    J_VENDOR,
+    J_BUFFERS,
+    J_DRI,
+    J_EXTENSIONS,
+    J_NUM_TYPES
+};
+
+#define JSON_NO_COUNT ((size_t) -1)
+
+typedef struct {
+    const char *name;
+    int kind;
+    size_t offset;
+    int type;           /* JSON_OBJECT, JSON_LIST: type of the records */
+    int max;            /* JSON_RANGES, JSON_INTS: length of the array */
+    size_t count;       /* JSON_RANGES, JSON_INTS: offset of the count */
+    int required;       /* the record is incomplete without this field */
+} JsonFieldRec;
+
+typedef struct {
+    size_t size;
+    const JsonFieldRec *fields;
+    int num_fields;
+    void (*init)(void *rec);    /* defaults, as set by the parser */
+    void (*finish)(void *rec);  /* called when a record is imported */
+} JsonTypeRec;
+
+#define J_FIELD(rec, f, kind, type, req) \
+    { #f, kind, offsetof(rec, f), type, 0, JSON_NO_COUNT, req }
+#define J_STR(rec, f)         J_FIELD(rec, f, JSON_STRING, 0, FALSE)
+#define J_REQ(rec, f)         J_FIELD(rec, f, JSON_STRING, 0, TRUE)
+#define J_INTERNED(rec, f)    J_FIELD(rec, f, JSON_INTERNED, 0, TRUE)
+#define J_INT(rec, f)         J_FIELD(rec, f, JSON_INT, 0, FALSE)
+#define J_ULONG(rec, f)       J_FIELD(rec, f, JSON_ULONG, 0, FALSE)
+#define J_FLOAT(rec, f)       J_FIELD(rec, f, JSON_FLOAT, 0, FALSE)
+#define J_RGB(rec, f)         J_FIELD(rec, f, JSON_RGB, 0, FALSE)
+#define J_OBJECT(rec, f, t)   J_FIELD(rec, f, JSON_OBJECT, t, FALSE)
+#define J_LIST(rec, f, t)     J_FIELD(rec, f, JSON_LIST, t, FALSE)
+#define J_RANGES(rec, f, n, max) \
+    { #f, JSON_RANGES, offsetof(rec, f), 0, max, offsetof(rec, n), FALSE }
+#define J_INTS(rec, f, n, max) \
+    { #f, JSON_INTS, offsetof(rec, f), 0, max, offsetof(rec, n), FALSE }
+#define J_INT_ARRAY(rec, f, max) \
+    { #f, JSON_INTS, offsetof(rec, f), 0, max, JSON_NO_COUNT, FALSE }
+
+static const JsonFieldRec ConfigFields[] = {
+    J_STR(XConfigRec, comment),
+    J_OBJECT(XConfigRec, files, J_FILES),
+    J_OBJECT(XConfigRec, modules, J_MODULE),
+    J_OBJECT(XConfigRec, flags, J_FLAGS),
+    J_LIST(XConfigRec, videoadaptors, J_VIDEOADAPTOR),
+    J_LIST(XConfigRec, modes, J_MODES),
+    J_LIST(XConfigRec, monitors, J_MONITOR),
+    J_LIST(XConfigRec, devices, J_DEVICE),
+    J_LIST(XConfigRec, screens, J_SCREEN),
+    J_LIST(XConfigRec, inputs, J_INPUT),
+    J_LIST(XConfigRec, inputclasses, J_INPUTCLASS),
+    J_LIST(XConfigRec, layouts, J_LAYOUT),
+    J_LIST(XConfigRec, vendors, J_VENDOR),
+    J_OBJECT(XConfigRec, dri, J_DRI),
+    J_OBJECT(XConfigRec, extensions, J_EXTENSIONS),
+};
+
+static const JsonFieldRec FilesFields[] = {
+    J_STR(XConfigFilesRec, logfile),
+    J_STR(XConfigFilesRec, rgbpath),
+    J_STR(XConfigFilesRec, modulepath),
+    J_STR(XConfigFilesRec, inputdevs),
+    J_STR(XConfigFilesRec, fontpath),
+    J_STR(XConfigFilesRec, comment),
+};
+
+static const JsonFieldRec ModuleFields[] = {
+    J_LIST(XConfigModuleRec, loads, J_LOAD),
+    J_LIST(XConfigModuleRec, disables, J_LOAD),
+    J_STR(XConfigModuleRec, comment),
+};
+
+static const JsonFieldRec LoadFields[] = {
+    J_REQ(XConfigLoadRec, name),
+    J_INT(XConfigLoadRec, type),
+    J_LIST(XConfigLoadRec, opt, J_OPTION),
+    J_STR(XConfigLoadRec, comment),
+};
+
+static const JsonFieldRec OptionFields[] = {
+    J_INTERNED(XConfigOptionRec, name),
+    J_STR(XConfigOptionRec, val),
+    J_STR(XConfigOptionRec, comment),
+};
+
+static const JsonFieldRec FlagsFields[] = {
+    J_LIST(XConfigFlagsRec, options, J_OPTION),
+    J_STR(XConfigFlagsRec, comment),
+};
+
+static const JsonFieldRec VideoAdaptorFields[] = {
+    J_REQ(XConfigVideoAdaptorRec, identifier),
+    J_STR(XConfigVideoAdaptorRec, vendor),
+    J_STR(XConfigVideoAdaptorRec, board),
+    J_STR(XConfigVideoAdaptorRec, busid),
+    J_STR(XConfigVideoAdaptorRec, driver),
+    J_LIST(XConfigVideoAdaptorRec, options, J_OPTION),
+    J_LIST(XConfigVideoAdaptorRec, ports, J_VIDEOPORT),
+    J_STR(XConfigVideoAdaptorRec, fwdref),
+    J_STR(XConfigVideoAdaptorRec, comment),
+};
+
+static const JsonFieldRec VideoPortFields[] = {
+    J_REQ(XConfigVideoPortRec, identifier),
+    J_LIST(XConfigVideoPortRec, options, J_OPTION),
+    J_STR(XConfigVideoPortRec, comment),
+};
+
+static const JsonFieldRec ModesFields[] = {
+    J_REQ(XConfigModesRec, identifier),
+    J_LIST(XConfigModesRec, modelines, J_MODELINE),
+    J_STR(XConfigModesRec, comment),
+};
+
+static const JsonFieldRec ModeLineFields[] = {
+    J_REQ(XConfigModeLineRec, identifier),
+    J_INTERNED(XConfigModeLineRec, clock),
+    J_INT(XConfigModeLineRec, hdisplay),
+    J_INT(XConfigModeLineRec, hsyncstart),
+    J_INT(XConfigModeLineRec, hsyncend),
+    J_INT(XConfigModeLineRec, htotal),
+    J_INT(XConfigModeLineRec, vdisplay),
+    J_INT(XConfigModeLineRec, vsyncstart),
+    J_INT(XConfigModeLineRec, vsyncend),
+    J_INT(XConfigModeLineRec, vtotal),
+    J_INT(XConfigModeLineRec, vscan),
+    J_INT(XConfigModeLineRec, flags),
+    J_INT(XConfigModeLineRec, hskew),
+    J_STR(XConfigModeLineRec, comment),
+};
+
+static const JsonFieldRec ModesLinkFields[] = {
+    J_REQ(XConfigModesLinkRec, modes_name),
+};
+
+static const JsonFieldRec MonitorFields[] = {
+    J_REQ(XConfigMonitorRec, identifier),
+    J_STR(XConfigMonitorRec, vendor),
+    J_STR(XConfigMonitorRec, modelname),
+    J_INT(XConfigMonitorRec, width),
+    J_INT(XConfigMonitorRec, height),
+    J_LIST(XConfigMonitorRec, modelines, J_MODELINE),
+    J_RANGES(XConfigMonitorRec, hsync, n_hsync, CONF_MAX_HSYNC),
+    J_RANGES(XConfigMonitorRec, vrefresh, n_vrefresh, CONF_MAX_VREFRESH),
+    J_FLOAT(XConfigMonitorRec, gamma_red),
+    J_FLOAT(XConfigMonitorRec, gamma_green),
+    J_FLOAT(XConfigMonitorRec, gamma_blue),
+    J_LIST(XConfigMonitorRec, options, J_OPTION),
+    J_LIST(XConfigMonitorRec, modes_sections, J_MODESLINK),
+    J_STR(XConfigMonitorRec, comment),
+};
+
+static const JsonFieldRec DeviceFields[] = {
+    J_REQ(XConfigDeviceRec, identifier),
+    J_STR(XConfigDeviceRec, vendor),
+    J_STR(XConfigDeviceRec, board),
+    J_STR(XConfigDeviceRec, chipset),
+    J_STR(XConfigDeviceRec, busid),
+    J_STR(XConfigDeviceRec, card),
+    J_STR(XConfigDeviceRec, driver),
+    J_STR(XConfigDeviceRec, ramdac),
+    J_INT_ARRAY(XConfigDeviceRec, dacSpeeds, CONF_MAXDACSPEEDS),
+    J_INT(XConfigDeviceRec, videoram),
+    J_INT(XConfigDeviceRec, textclockfreq),
+    J_ULONG(XConfigDeviceRec, bios_base),
+    J_ULONG(XConfigDeviceRec, mem_base),
+    J_ULONG(XConfigDeviceRec, io_base),
+    J_STR(XConfigDeviceRec, clockchip),
+    J_INTS(XConfigDeviceRec, clock, clocks, CONF_MAXCLOCKS),
+    J_INT(XConfigDeviceRec, chipid),
+    J_INT(XConfigDeviceRec, chiprev),
+    J_INT(XConfigDeviceRec, irq),
+    J_INT(XConfigDeviceRec, screen),
+    J_LIST(XConfigDeviceRec, options, J_OPTION),
+    J_STR(XConfigDeviceRec, comment),
+};
+
+static const JsonFieldRec ModeFields[] = {
+    J_REQ(XConfigModeRec, mode_name),
+};
+
+static const JsonFieldRec DisplayFields[] = {
+    J_INT(XConfigDisplayRec, frameX0),
+    J_INT(XConfigDisplayRec, frameY0),
+    J_INT(XConfigDisplayRec, virtualX),
+    J_INT(XConfigDisplayRec, virtualY),
+    J_INT(XConfigDisplayRec, depth),
+    J_INT(XConfigDisplayRec, bpp),
+    J_STR(XConfigDisplayRec, visual),
+    J_RGB(XConfigDisplayRec, weight),
+    J_RGB(XConfigDisplayRec, black),
+    J_RGB(XConfigDisplayRec, white),
+    J_LIST(XConfigDisplayRec, modes, J_MODE),
+    J_LIST(XConfigDisplayRec, options, J_OPTION),
+    J_STR(XConfigDisplayRec, comment),
+};
+
+static const JsonFieldRec AdaptorLinkFields[] = {
+    J_REQ(XConfigAdaptorLinkRec, adaptor_name),
+};
+
+static const JsonFieldRec ScreenFields[] = {
+    J_REQ(XConfigScreenRec, identifier),
+    J_STR(XConfigScreenRec, obsolete_driver),
+    J_INT(XConfigScreenRec, defaultdepth),
+    J_INT(XConfigScreenRec, defaultbpp),
+    J_INT(XConfigScreenRec, defaultfbbpp),
+    J_STR(XConfigScreenRec, monitor_name),
+    J_STR(XConfigScreenRec, device_name),
+    J_LIST(XConfigScreenRec, adaptors, J_ADAPTORLINK),
+    J_LIST(XConfigScreenRec, displays, J_DISPLAY),
+    J_LIST(XConfigScreenRec, options, J_OPTION),
+    J_STR(XConfigScreenRec, comment),
+};
+
+static const JsonFieldRec InputFields[] = {
+    J_REQ(XConfigInputRec, identifier),
+    J_STR(XConfigInputRec, driver),
+    J_LIST(XConfigInputRec, options, J_OPTION),
+    J_STR(XConfigInputRec, comment),
+};
+
+static const JsonFieldRec InputClassFields[] = {
+    J_REQ(XConfigInputClassRec, identifier),
+    J_STR(XConfigInputClassRec, driver),
+    J_STR(XConfigInputClassRec, match_is_pointer),
+    J_STR(XConfigInputClassRec, match_is_touchpad),
+    J_STR(XConfigInputClassRec, match_is_touchscreen),
+    J_STR(XConfigInputClassRec, match_is_keyboard),
+    J_STR(XConfigInputClassRec, match_is_joystick),
+    J_STR(XConfigInputClassRec, match_is_tablet),
+    J_STR(XConfigInputClassRec, match_tag),
+    J_STR(XConfigInputClassRec, match_device_path),
+    J_STR(XConfigInputClassRec, match_os),
+    J_STR(XConfigInputClassRec, match_usb_id),
+    J_STR(XConfigInputClassRec, match_pnp_id),
+    J_STR(XConfigInputClassRec, match_product),
+    J_STR(XConfigInputClassRec, match_driver),
+    J_STR(XConfigInputClassRec, match_vendor),
+    J_LIST(XConfigInputClassRec, options, J_OPTION),
+    J_STR(XConfigInputClassRec, comment),
+};
+
+static const JsonFieldRec InputrefFields[] = {
+    J_REQ(XConfigInputrefRec, input_name),
+    J_LIST(XConfigInputrefRec, options, J_OPTION),
+};
+
+static const JsonFieldRec AdjacencyFields[] = {
+    J_INT(XConfigAdjacencyRec, scrnum),
+    J_REQ(XConfigAdjacencyRec, screen_name),
+    J_STR(XConfigAdjacencyRec, top_name),
+    J_STR(XConfigAdjacencyRec, bottom_name),
+    J_STR(XConfigAdjacencyRec, left_name),
+    J_STR(XConfigAdjacencyRec, right_name),
+    J_INT(XConfigAdjacencyRec, where),
+    J_INT(XConfigAdjacencyRec, x),
+    J_INT(XConfigAdjacencyRec, y),
+    J_STR(XConfigAdjacencyRec, refscreen),
+};
+
+static const JsonFieldRec InactiveFields[] = {
+    J_REQ(XConfigInactiveRec, device_name),
+};
+
+static const JsonFieldRec LayoutFields[] = {
+    J_REQ(XConfigLayoutRec, identifier),
+    J_LIST(XConfigLayoutRec, adjacencies, J_ADJACENCY),
+    J_LIST(XConfigLayoutRec, inactives, J_INACTIVE),
+    J_LIST(XConfigLayoutRec, inputs, J_INPUTREF),
+    J_LIST(XConfigLayoutRec, options, J_OPTION),
+    J_STR(XConfigLayoutRec, comment),
+};
+
+static const JsonFieldRec VendSubFields[] = {
+    J_STR(XConfigVendSubRec, name),
+    J_STR(XConfigVendSubRec, identifier),
+    J_LIST(XConfigVendSubRec, options, J_OPTION),
+    J_STR(XConfigVendSubRec, comment),
+};
+
+static const JsonFieldRec VendorFields[] = {
+    J_REQ(XConfigVendorRec, identifier),
+    J_LIST(XConfigVendorRec, options, J_OPTION),
+    J_LIST(XConfigVendorRec, subs, J_VENDSUB),
+    J_STR(XConfigVendorRec, comment),
+};
+
+static const JsonFieldRec BuffersFields[] = {
+    J_INT(XConfigBuffersRec, count),
+    J_INT(XConfigBuffersRec, size),
+    J_STR(XConfigBuffersRec, flags),
+    J_STR(XConfigBuffersRec, comment),
+};
+
+static const JsonFieldRec DRIFields[] = {
+    J_STR(XConfigDRIRec, group_name),
+    J_INT(XConfigDRIRec, group),
+    J_INT(XConfigDRIRec, mode),
+    J_LIST(XConfigDRIRec, buffers, J_BUFFERS),
+    J_STR(XConfigDRIRec, comment),
+};
+
+static const JsonFieldRec ExtensionsFields[] = {
+    J_LIST(XConfigExtensionsRec, options, J_OPTION),
+    J_STR(XConfigExtensionsRec, comment),
+};
+
+
+/*
+ * the defaults the parser gives new records (see, e.g.,
+ * xconfigParseDeviceSection())
+ */
+
+static void device_init(void *rec)
+{
+    XConfigDevicePtr device = rec;
+
+    device->chipid = -1;
+    device->chiprev = -1;
+    device->irq = -1;
+    device->screen = -1;
+}
+
+static void display_init(void *rec)
+{
+    XConfigDisplayPtr display = rec;
+
+    display->black.red = display->black.green = display->black.blue = -1;
+    display->white.red = display->white.green = display->white.blue = -1;
+}
+
+static void dri_init(void *rec)
+{
+    XConfigDRIPtr dri = rec;
+
+    dri->group = -1;
+}
+
+/*
+ * the packed PCI address is derived from the BusID, as when the BusID
+ * is parsed, rather than exported
+ */
+
+static void device_finish(void *rec)
+{
+    XConfigDevicePtr device = rec;
+
+    if (!device->busid ||
+        !xconfigParsePciAddress(device->busid, &device->pciaddr)) {
+        device->pciaddr = 0;
+    }
+}
+
+static void modeline_finish(void *rec)
+{
+    XConfigModeLinePtr modeline = rec;
+
+    modeline->key = xconfigModelineKey(modeline);
+}
+
+#define J_TYPE(rec, fields, init, finish) \
+    { sizeof(rec), fields, sizeof(fields) / sizeof(fields[0]), init, finish }
+
+static const JsonTypeRec JsonTypes[J_NUM_TYPES] = {
+    J_TYPE(XConfigRec, ConfigFields, NULL, NULL),
+    J_TYPE(XConfigFilesRec, FilesFields, NULL, NULL),
+    J_TYPE(XConfigModuleRec, ModuleFields, NULL, NULL),
+    J_TYPE(XConfigLoadRec, LoadFields, NULL, NULL),
+    J_TYPE(XConfigOptionRec, OptionFields, NULL, NULL),
+    J_TYPE(XConfigFlagsRec, FlagsFields, NULL, NULL),
+    J_TYPE(XConfigVideoAdaptorRec, VideoAdaptorFields, NULL, NULL),
+    J_TYPE(XConfigVideoPortRec, VideoPortFields, NULL, NULL),
+    J_TYPE(XConfigModesRec, ModesFields, NULL, NULL),
+    J_TYPE(XConfigModeLineRec, ModeLineFields, NULL, modeline_finish),
+    J_TYPE(XConfigModesLinkRec, ModesLinkFields, NULL, NULL),
+    J_TYPE(XConfigMonitorRec, MonitorFields, NULL, NULL),
+    J_TYPE(XConfigDeviceRec, DeviceFields, device_init, device_finish),
+    J_TYPE(XConfigModeRec, ModeFields, NULL, NULL),
+    J_TYPE(XConfigDisplayRec, DisplayFields, display_init, NULL),
+    J_TYPE(XConfigAdaptorLinkRec, AdaptorLinkFields, NULL, NULL),
+    J_TYPE(XConfigScreenRec, ScreenFields, NULL, NULL),
+    J_TYPE(XConfigInputRec, InputFields, NULL, NULL),
+    J_TYPE(XConfigInputClassRec, InputClassFields, NULL, NULL),
+    J_TYPE(XConfigInputrefRec, InputrefFields, NULL, NULL),
+    J_TYPE(XConfigAdjacencyRec, AdjacencyFields, NULL, NULL),
+    J_TYPE(XConfigInactiveRec, InactiveFields, NULL, NULL),
+    J_TYPE(XConfigLayoutRec, LayoutFields, NULL, NULL),
+    J_TYPE(XConfigVendSubRec, VendSubFields, NULL, NULL),
+    J_TYPE(XConfigVendorRec, VendorFields, NULL, NULL),
+    J_TYPE(XConfigBuffersRec, BuffersFields, NULL, NULL),
+    J_TYPE(XConfigDRIRec, DRIFields, dri_init, NULL),
+    J_TYPE(XConfigExtensionsRec, ExtensionsFields, NULL, NULL),
+};
+
+
+
+/*
+ * json_new_record() - allocate a record of the given type, with the
+ * parser's defaults
+ */
+
+static void *json_new_record(int type)
+{
+    void *rec = xconfigAlloc(JsonTypes[type].size);
+
+    if (JsonTypes[type].init) {
+        JsonTypes[type].init(rec);
+    }
+
+    return rec;
+
+} /* json_new_record() */
+
+
+
+/*
+ * Export
+ */
+
+#define JSON_BUF_SIZE  8192
+#define JSON_MAX_DEPTH 32
+
+typedef struct {
+    FILE *fp;
+    int error;
+    char buf[JSON_BUF_SIZE];
+    size_t len;
+    int depth;
+    int count[JSON_MAX_DEPTH];          /* values written at each depth */
+    void *defaults[J_NUM_TYPES];        /* json_new_record() of each type */
+} JsonWriterRec, *JsonWriterPtr;
+
+
+
+/*
+ * json_flush() - write out the buffered output
+ */
+
+static void json_flush(JsonWriterPtr w)
+{
+    if (w->len && !w->error &&
+        (fwrite(w->buf, 1, w->len, w->fp) != w->len)) {
+        w->error = TRUE;
+    }
+
+    w->len = 0;
+
+} /* json_flush() */
+
+
+
+static void json_write(JsonWriterPtr w, const char *s, size_t len)
+{
+    if (w->len + len > sizeof(w->buf)) {
+        json_flush(w);
+        if (len > sizeof(w->buf)) {
+            if (!w->error && (fwrite(s, 1, len, w->fp) != len)) {
+                w->error = TRUE;
+            }
+            return;
+        }
+    }
+
+    memcpy(w->buf + w->len, s, len);
+    w->len += len;
+}
+
+
+
+static void json_putc(JsonWriterPtr w, char c)
+{
+    if (w->len == sizeof(w->buf)) {
+        json_flush(w);
+    }
+
+    w->buf[w->len++] = c;
+}
+
+
+
+static void json_indent(JsonWriterPtr w)
+{
+    int i;
+
+    json_putc(w, '\n');
+    for (i = 0; i < w->depth; i++) {
+        json_write(w, "  ", 2);
+    }
+}
+
+
+
+/*
+ * json_open(), json_close() - begin and end an object or array; the
+ * members of an object, and the elements of an array of objects, are
+ * written one per line, indented by depth.
+ */
+
+static void json_open(JsonWriterPtr w, char c)
+{
+    json_putc(w, c);
+    w->depth++;
+    w->count[w->depth] = 0;
+}
+
+static void json_close(JsonWriterPtr w, char c)
+{
+    int empty = (w->count[w->depth] == 0);
+
+    w->depth--;
+    if (!empty) json_indent(w);
+    json_putc(w, c);
+}
+
+
+
+/*
+ * json_string() - write a JSON string literal; the characters that need
+ * no escaping are copied in runs.
+ */
+
+static void json_string(JsonWriterPtr w, const char *s)
+{
+    static const char hex[] = "0123456789abcdef";
+    const char *run;
+    char esc[6];
+    unsigned char c;
+
+    json_putc(w, '"');
+
+    for (run = s; ; s++) {
+        c = *s;
+        if ((c >= 0x20) && (c != '"') && (c != '\\')) continue;
+
+        json_write(w, run, s - run);
+        run = s + 1;
+
+        if (c == '\0') break;
+
+        switch (c) {
+        case '"':  json_write(w, "\\\"", 2); break;
+        case '\\': json_write(w, "\\\\", 2); break;
+        case '\n': json_write(w, "\\n", 2); break;
+        case '\t': json_write(w, "\\t", 2); break;
+        case '\r': json_write(w, "\\r", 2); break;
+        default:
+            esc[0] = '\\';
+            esc[1] = 'u';
+            esc[2] = '0';
+            esc[3] = '0';
+            esc[4] = hex[c >> 4];
+            esc[5] = hex[c & 0xf];
+            json_write(w, esc, 6);
+            break;
+        }
+    }
+
+    json_putc(w, '"');
+
+} /* json_string() */
+
+
+
+/*
+ * json_member() - start the named member of the current object
+ */
+
+static void json_member(JsonWriterPtr w, const char *name)
+{
+    if (w->count[w->depth]++) json_putc(w, ',');
+    json_indent(w);
+    json_string(w, name);
+    json_write(w, ": ", 2);
+}
+
+
+
+/*
+ * json_element() - start the next element of an array of objects
+ */
+
+static void json_element(JsonWriterPtr w)
+{
+    if (w->count[w->depth]++) json_putc(w, ',');
+    json_indent(w);
+}
+
+
+
+static void json_uint(JsonWriterPtr w, unsigned long long v)
+{
+    char buf[24];
+    char *p = buf + sizeof(buf);
+
+    do {
+        *--p = '0' + (v % 10);
+        v /= 10;
+    } while (v);
+
+    json_write(w, p, buf + sizeof(buf) - p);
+}
+
+static void json_int(JsonWriterPtr w, long long v)
+{
+    if (v < 0) {
+        json_putc(w, '-');
+        json_uint(w, 0ULL - (unsigned long long) v);
+    } else {
+        json_uint(w, v);
+    }
+}
+
+static void json_float(JsonWriterPtr w, double v)
+{
+    char buf[64];
+
+    /* JSON has no infinities or NaNs */
+
+    if (!isfinite(v)) v = 0.0;
+
+    /* formatted as in X config files, with enough digits to read back
+     * as the same float, and independently of the locale */
+
+    xconfigFormatRealShort(buf, sizeof(buf), v, 9);
+    json_write(w, buf, strlen(buf));
+}
+
+
+
+/*
+ * json_write_field() - write the field of the record as a member of the
+ * current object, unless it has its default value
+ */
+
+static void json_write_record(JsonWriterPtr w, int type, const void *rec);
+
+static void json_write_field(JsonWriterPtr w, const JsonFieldRec *field,
+                             const char *rec, const char *def)
+{
+    const char *p = rec + field->offset;
+    const char *s;
+    const parser_range *range;
+    const parser_rgb *rgb;
+    const int *ints;
+    const GenericListRec *item;
+    const void *obj;
+    size_t size = 0;
+    int i, n;
+
+    switch (field->kind) {
+
+    case JSON_STRING:
+    case JSON_INTERNED:
+        memcpy(&s, p, sizeof(s));
+        if (!s) return;
+        json_member(w, field->name);
+        json_string(w, s);
+        return;
+
+    case JSON_OBJECT:
+        memcpy(&obj, p, sizeof(obj));
+        if (!obj) return;
+        json_member(w, field->name);
+        json_write_record(w, field->type, obj);
+        return;
+
+    case JSON_LIST:
+        memcpy(&item, p, sizeof(item));
+        if (!item) return;
+        json_member(w, field->name);
+        json_open(w, '[');
+        for (; item; item = item->next) {
+            json_element(w);
+            json_write_record(w, field->type, item);
+        }
+        json_close(w, ']');
+        return;
+
+    case JSON_INT:    size = sizeof(int); break;
+    case JSON_ULONG:  size = sizeof(unsigned long); break;
+    case JSON_FLOAT:  size = sizeof(float); break;
+    case JSON_RGB:    size = sizeof(parser_rgb); break;
+    case JSON_RANGES: size = field->max * sizeof(parser_range); break;
+    case JSON_INTS:   size = field->max * sizeof(int); break;
+    }
+
+    /* scalars and arrays are left out if they have the default value */
+
+    if ((memcmp(p, def + field->offset, size) == 0) &&
+        ((field->count == JSON_NO_COUNT) ||
+         (memcmp(rec + field->count, def + field->count, sizeof(int)) == 0))) {
+        return;
+    }
+
+    json_member(w, field->name);
+
+    switch (field->kind) {
+
+    case JSON_INT:
+        json_int(w, *(const int *) p);
+        break;
+
+    case JSON_ULONG:
+        json_uint(w, *(const unsigned long *) p);
+        break;
+
+    case JSON_FLOAT:
+        json_float(w, *(const float *) p);
+        break;
+
+    case JSON_RGB:
+        rgb = (const parser_rgb *) p;
+        json_putc(w, '[');
+        json_int(w, rgb->red);
+        json_write(w, ", ", 2);
+        json_int(w, rgb->green);
+        json_write(w, ", ", 2);
+        json_int(w, rgb->blue);
+        json_putc(w, ']');
+        break;
+
+    case JSON_RANGES:
+        range = (const parser_range *) p;
+        n = *(const int *) (rec + field->count);
+        if (n < 0) n = 0;
+        if (n > field->max) n = field->max;
+        json_putc(w, '[');
+        for (i = 0; i < n; i++) {
+            if (i) json_write(w, ", ", 2);
+            json_putc(w, '[');
+            json_float(w, range[i].lo);
+            json_write(w, ", ", 2);
+            json_float(w, range[i].hi);
+            json_putc(w, ']');
+        }
+        json_putc(w, ']');
+        break;
+
+    case JSON_INTS:
+        ints = (const int *) p;
+        if (field->count != JSON_NO_COUNT) {
+            n = *(const int *) (rec + field->count);
+            if (n < 0) n = 0;
+            if (n > field->max) n = field->max;
+        } else {
+            /* leave out the trailing defaults */
+            for (n = field->max; n > 0; n--) {
+                if (ints[n - 1] != ((const int *) (def + field->offset))[n - 1]) {
+                    break;
+                }
+            }
+        }
+        json_putc(w, '[');
+        for (i = 0; i < n; i++) {
+            if (i) json_write(w, ", ", 2);
+            json_int(w, ints[i]);
+        }
+        json_putc(w, ']');
+        break;
+    }
+
+} /* json_write_field() */
+
+
+
+/*
+ * json_write_record() - write the record as an object
+ */
+
+static void json_write_record(JsonWriterPtr w, int type, const void *rec)
+{
+    const JsonTypeRec *t = &JsonTypes[type];
+    int i;
+
+    if (w->depth + 1 >= JSON_MAX_DEPTH) {
+        w->error = TRUE;
+        return;
+    }
+
+    if (!w->defaults[type]) {
+        w->defaults[type] = json_new_record(type);
+    }
+
+    json_open(w, '{');
+    for (i = 0; i < t->num_fields; i++) {
+        json_write_field(w, &t->fields[i], rec, w->defaults[type]);
+    }
+    json_close(w, '}');
+
+} /* json_write_record() */
+
+
+
+/*
+ * xconfigWriteJson() - write the config to fp as JSON.  Returns TRUE on
+ * success.
+ */
+
+int xconfigWriteJson(FILE *fp, XConfigPtr config)
+{
+    JsonWriterPtr w;
+    int i, ret;
+
+    if (!config) return FALSE;
+
+    w = xconfigAlloc(sizeof(JsonWriterRec));
+    w->fp = fp;
+
+    json_open(w, '{');
+    json_member(w, "version");
+    json_int(w, JSON_VERSION);
+    json_member(w, "config");
+    json_write_record(w, J_CONFIG, config);
+    json_close(w, '}');
+    json_putc(w, '\n');
+
+    json_flush(w);
+
+    if ((fflush(fp) != 0) || ferror(fp)) {
+        w->error = TRUE;
+    }
+
+    ret = !w->error;
+
+    for (i = 0; i < J_NUM_TYPES; i++) {
+        free(w->defaults[i]);
+    }
+    free(w);
+
+    return ret;
+
+} /* xconfigWriteJson() */
+
+
+
+/*
+ * Import
+ */
+
+typedef struct {
+    const char *filename;
+    const char *p;
+    const char *end;
+    int line;
+    int depth;
+    int error;          /* an error has been reported */
+} JsonReaderRec, *JsonReaderPtr;
+
+
+
+/*
+ * json_error() - report the first error found in the JSON file
+ */
+
+static void json_error(JsonReaderPtr r, const char *fmt, ...)
+{
+    char msg[256];
+    va_list ap;
+
+    if (r->error) return;
+    r->error = TRUE;
+
+    va_start(ap, fmt);
+    vsnprintf(msg, sizeof(msg), fmt, ap);
+    va_end(ap);
+
+    xconfigErrorMsg(ErrorMsg, "Unable to import the X configuration from "
+                    "\"%s\": line %d: %s.\n", r->filename, r->line, msg);
+
+} /* json_error() */
+
+
+
+/*
+ * json_peek() - skip white space, and return the next character, or -1
+ * at the end of the input
+ */
+
+static int json_peek(JsonReaderPtr r)
+{
+    while (r->p < r->end) {
+        switch (*r->p) {
+        case '\n':
+            r->line++;
+            /* fall through */
+        case ' ':
+        case '\t':
+        case '\r':
+            r->p++;
+            break;
+        default:
+            return (unsigned char) *r->p;
+        }
+    }
+
+    return -1;
+
+} /* json_peek() */
+
+
+
+static int json_accept(JsonReaderPtr r, int c)
+{
+    if (json_peek(r) != c) return FALSE;
+
+    r->p++;
+
+    return TRUE;
+}
+
+static int json_expect(JsonReaderPtr r, int c)
+{
+    if (json_accept(r, c)) return TRUE;
+
+    if (r->p < r->end) {
+        json_error(r, "expected '%c', found '%c'", c, *r->p);
+    } else {
+        json_error(r, "expected '%c', found the end of the file", c);
+    }
+
+    return FALSE;
+}
+
+
+
+/*
+ * json_accept_null() - accept the literal null
+ */
+
+static int json_accept_null(JsonReaderPtr r)
+{
+    if ((json_peek(r) != 'n') || (r->end - r->p < 4) ||
+        (strncmp(r->p, "null", 4) != 0)) {
+        return FALSE;
+    }
+
+    r->p += 4;
+
+    return TRUE;
+}
+
+
+
+static int json_hex4(const char *p, unsigned int *v)
+{
+    int i;
+
+    *v = 0;
+
+    for (i = 0; i < 4; i++) {
+        *v <<= 4;
+        if ((p[i] >= '0') && (p[i] <= '9')) *v |= p[i] - '0';
+        else if ((p[i] >= 'a') && (p[i] <= 'f')) *v |= p[i] - 'a' + 10;
+        else if ((p[i] >= 'A') && (p[i] <= 'F')) *v |= p[i] - 'A' + 10;
+        else return FALSE;
+    }
+
+    return TRUE;
+}
+
+
+
+/*
+ * json_read_string() - read a string literal, returning it decoded in
+ * a new allocation, or NULL on error.  An escape sequence is never
+ * longer than its UTF-8 encoding, so the string is decoded into a
+ * buffer the size of the literal.
+ */
+
+static char *json_read_string(JsonReaderPtr r)
+{
+    const char *p, *start;
+    char *str, *out;
+    unsigned int c, c2;
+
+    if (json_peek(r) != '"') {
+        json_error(r, "expected a string");
+        return NULL;
+    }
+
+    start = ++r->p;
+
+    for (p = start; (p < r->end) && (*p != '"'); p++) {
+        if ((*p == '\\') && (p + 1 < r->end)) p++;
+    }
+
+    if (p >= r->end) {
+        json_error(r, "unterminated string");
+        return NULL;
+    }
+
+    str = out = xconfigAlloc(p - start + 1);
+
+    for (p = start; *p != '"'; p++) {
+
+        c = (unsigned char) *p;
+
+        if (c < 0x20) {
+            json_error(r, "control character in a string");
+            goto fail;
+        }
+
+        if (c != '\\') {
+            *out++ = c;
+            continue;
+        }
+
+        switch (*++p) {
+        case '"':  *out++ = '"'; break;
+        case '\\': *out++ = '\\'; break;
+        case '/':  *out++ = '/'; break;
+        case 'b':  *out++ = '\b'; break;
+        case 'f':  *out++ = '\f'; break;
+        case 'n':  *out++ = '\n'; break;
+        case 'r':  *out++ = '\r'; break;
+        case 't':  *out++ = '\t'; break;
+        case 'u':
+            if ((r->end - p < 5) || !json_hex4(p + 1, &c)) {
+                json_error(r, "invalid \\u escape");
+                goto fail;
+            }
+            p += 4;
+
+            /* a surrogate pair */
+
+            if ((c >= 0xd800) && (c < 0xdc00) && (r->end - p >= 7) &&
+                (p[1] == '\\') && (p[2] == 'u') && json_hex4(p + 3, &c2) &&
+                (c2 >= 0xdc00) && (c2 < 0xe000)) {
+                c = 0x10000 + ((c - 0xd800) << 10) + (c2 - 0xdc00);
+                p += 6;
+            }
+
+            if (c == 0) {
+                json_error(r, "NUL character in a string");
+                goto fail;
+            }
+
+            if (c < 0x80) {
+                *out++ = c;
+            } else if (c < 0x800) {
+                *out++ = 0xc0 | (c >> 6);
+                *out++ = 0x80 | (c & 0x3f);
+            } else if (c < 0x10000) {
+                *out++ = 0xe0 | (c >> 12);
+                *out++ = 0x80 | ((c >> 6) & 0x3f);
+                *out++ = 0x80 | (c & 0x3f);
+            } else {
+                *out++ = 0xf0 | (c >> 18);
+                *out++ = 0x80 | ((c >> 12) & 0x3f);
+                *out++ = 0x80 | ((c >> 6) & 0x3f);
+                *out++ = 0x80 | (c & 0x3f);
+            }
+            break;
+        default:
+            json_error(r, "invalid escape sequence in a string");
+            goto fail;
+        }
+    }
+
+    *out = '\0';
+    r->p = p + 1;
+
+    return str;
+
+ fail:
+    free(str);
+    return NULL;
+
+} /* json_read_string() */
+
+
+
+/*
+ * json_number() - copy the characters of the number at the current
+ * position to buf
+ */
+
+static int json_number(JsonReaderPtr r, char *buf, size_t size)
+{
+    const char *p;
+    size_t len;
+
+    json_peek(r);
+
+    for (p = r->p; (p < r->end) && *p && strchr("+-0123456789.eE", *p); p++);
+
+    len = p - r->p;
+
+    if ((len == 0) || (len >= size)) {
+        json_error(r, "expected a number");
+        return FALSE;
+    }
+
+    memcpy(buf, r->p, len);
+    buf[len] = '\0';
+
+    r->p = p;
+
+    return TRUE;
+
+} /* json_number() */
+
+
+
+/*
+ * json_real() - convert a JSON number with a fraction or exponent to a
+ * double, as xconfigStrToReal() converts numbers in X config files, so
+ * that the result does not depend on the locale.  Returns FALSE if buf
+ * is not a valid number.
+ */
+
+static int json_real(const char *buf, double *d)
+{
+    const char *p = buf, *mant;
+    int neg, eneg = FALSE, exp = 0;
+
+    neg = (*p == '-');
+    if (neg) p++;
+
+    mant = p;
+
+    if ((*p < '0') || (*p > '9')) return FALSE;
+    while ((*p >= '0') && (*p <= '9')) p++;
+
+    if (*p == '.') {
+        p++;
+        if ((*p < '0') || (*p > '9')) return FALSE;
+        while ((*p >= '0') && (*p <= '9')) p++;
+    }
+
+    *d = xconfigStrToReal(mant);
+
+    if ((*p == 'e') || (*p == 'E')) {
+        p++;
+        if ((*p == '+') || (*p == '-')) eneg = (*p++ == '-');
+        if ((*p < '0') || (*p > '9')) return FALSE;
+        for (; (*p >= '0') && (*p <= '9'); p++) {
+            if (exp < 1000) exp = exp * 10 + (*p - '0');
+        }
+        *d = eneg ? *d / pow(10.0, exp) : *d * pow(10.0, exp);
+    }
+
+    if (neg) *d = -*d;
+
+    return (*p == '\0');
+
+} /* json_real() */
+
+
+
+/*
+ * json_read_number() - read a number; 'integer' is set if it has no
+ * fraction or exponent
+ */
+
+static int json_read_number(JsonReaderPtr r, double *d, long long *ll,
+                            int *integer)
+{
+    char buf[64];
+    char *end;
+    int ok;
+
+    if (!json_number(r, buf, sizeof(buf))) return FALSE;
+
+    *integer = (strpbrk(buf, ".eE") == NULL);
+
+    if (*integer) {
+        errno = 0;
+        *ll = strtoll(buf, &end, 10);
+        *d = (double) *ll;
+        ok = ((*end == '\0') && (errno == 0));
+    } else {
+        ok = json_real(buf, d);
+    }
+
+    if (!ok) {
+        json_error(r, "invalid number \"%s\"", buf);
+        return FALSE;
+    }
+
+    return TRUE;
+
+} /* json_read_number() */
+
+
+
+static int json_read_uint(JsonReaderPtr r, unsigned long long max,
+                          unsigned long long *v)
+{
+    char buf[64];
+    char *end;
+
+    if (!json_number(r, buf, sizeof(buf))) return FALSE;
+
+    errno = 0;
+    *v = strtoull(buf, &end, 10);
+
+    if ((buf[0] == '-') || (*end != '\0') || (errno != 0) || (*v > max)) {
+        json_error(r, "expected an integer from 0 to %llu", max);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+
+
+static int json_read_int(JsonReaderPtr r, long long min, long long max,
+                         long long *v)
+{
+    double d;
+    int integer;
+
+    if (!json_read_number(r, &d, v, &integer)) return FALSE;
+
+    if (!integer || (*v < min) || (*v > max)) {
+        json_error(r, "expected an integer from %lld to %lld", min, max);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static int json_read_float(JsonReaderPtr r, float *f)
+{
+    long long ll;
+    double d;
+    int integer;
+
+    if (!json_read_number(r, &d, &ll, &integer)) return FALSE;
+
+    *f = d;
+
+    return TRUE;
+}
+
+
+
+/*
+ * json_skip_value() - skip a value of a member this version does not
+ * know about
+ */
+
+static int json_skip_value(JsonReaderPtr r)
+{
+    long long ll;
+    double d;
+    char *s;
+    int c, integer, ret = TRUE;
+
+    if (++r->depth > JSON_MAX_DEPTH) {
+        json_error(r, "too deeply nested");
+        return FALSE;
+    }
+
+    c = json_peek(r);
+
+    if (c == '"') {
+        s = json_read_string(r);
+        ret = (s != NULL);
+        free(s);
+    } else if ((c == '[') || (c == '{')) {
+        r->p++;
+        if (!json_accept(r, c == '[' ? ']' : '}')) {
+            do {
+                if (c == '{') {
+                    s = json_read_string(r);
+                    free(s);
+                    if (!s || !json_expect(r, ':')) {
+                        ret = FALSE;
+                        break;
+                    }
+                }
+                if (!json_skip_value(r)) {
+                    ret = FALSE;
+                    break;
+                }
+            } while (json_accept(r, ','));
+            ret = ret && json_expect(r, c == '[' ? ']' : '}');
+        }
+    } else if (json_accept_null(r)) {
+        ret = TRUE;
+    } else if ((r->end - r->p >= 4) && (strncmp(r->p, "true", 4) == 0)) {
+        r->p += 4;
+    } else if ((r->end - r->p >= 5) && (strncmp(r->p, "false", 5) == 0)) {
+        r->p += 5;
+    } else {
+        ret = json_read_number(r, &d, &ll, &integer);
+    }
+
+    r->depth--;
+
+    return ret;
+
+} /* json_skip_value() */
+
+
+
+static int json_read_record(JsonReaderPtr r, int type, void *rec);
+
+/*
+ * json_read_list() - read an array of records, appending them to the
+ * list whose head is at *head
+ */
+
+static int json_read_list(JsonReaderPtr r, int type, void *head)
+{
+    GenericListPtr *tail = head;
+    GenericListPtr item;
+    int ret;
+
+    while (*tail) tail = (GenericListPtr *) &(*tail)->next;
+
+    if (!json_expect(r, '[')) return FALSE;
+    if (json_accept(r, ']')) return TRUE;
+
+    do {
+        item = json_new_record(type);
+        *tail = item;
+        tail = (GenericListPtr *) &item->next;
+
+        ret = json_read_record(r, type, item);
+
+        if (JsonTypes[type].finish) {
+            JsonTypes[type].finish(item);
+        }
+
+        if (!ret) return FALSE;
+
+    } while (json_accept(r, ','));
+
+    return json_expect(r, ']');
+
+} /* json_read_list() */
+
+
+
+/*
+ * json_read_field() - read the value of a member into the field of the
+ * record
+ */
+
+static int json_read_field(JsonReaderPtr r, const JsonFieldRec *field,
+                           char *rec)
+{
+    char *p = rec + field->offset;
+    char *s, *old;
+    void *obj;
+    parser_range *range;
+    parser_rgb *rgb;
+    unsigned long long u;
+    long long v;
+    int n;
+
+    switch (field->kind) {
+
+    case JSON_STRING:
+    case JSON_INTERNED:
+        if (json_accept_null(r)) {
+            s = NULL;
+        } else if (!(s = json_read_string(r))) {
+            return FALSE;
+        }
+        if (s && (field->kind == JSON_INTERNED)) {
+            old = s;
+            s = xconfigInternString(old);
+            free(old);
+        }
+        memcpy(&old, p, sizeof(old));
+        if (field->kind == JSON_INTERNED) {
+            xconfigReleaseString(old);
+        } else {
+            free(old);
+        }
+        memcpy(p, &s, sizeof(s));
+        return TRUE;
+
+    case JSON_INT:
+        if (!json_read_int(r, INT_MIN, INT_MAX, &v)) return FALSE;
+        *(int *) p = v;
+        return TRUE;
+
+    case JSON_ULONG:
+        if (!json_read_uint(r, ULONG_MAX, &u)) return FALSE;
+        *(unsigned long *) p = u;
+        return TRUE;
+
+    case JSON_FLOAT:
+        return json_read_float(r, (float *) p);
+
+    case JSON_RGB:
+        rgb = (parser_rgb *) p;
+        if (!json_expect(r, '[') ||
+            !json_read_int(r, INT_MIN, INT_MAX, &v)) return FALSE;
+        rgb->red = v;
+        if (!json_expect(r, ',') ||
+            !json_read_int(r, INT_MIN, INT_MAX, &v)) return FALSE;
+        rgb->green = v;
+        if (!json_expect(r, ',') ||
+            !json_read_int(r, INT_MIN, INT_MAX, &v)) return FALSE;
+        rgb->blue = v;
+        return json_expect(r, ']');
+
+    case JSON_RANGES:
+        range = (parser_range *) p;
+        if (!json_expect(r, '[')) return FALSE;
+        n = 0;
+        if (!json_accept(r, ']')) {
+            do {
+                if (n == field->max) {
+                    json_error(r, "more than %d \"%s\" ranges", field->max,
+                               field->name);
+                    return FALSE;
+                }
+                if (!json_expect(r, '[') ||
+                    !json_read_float(r, &range[n].lo) ||
+                    !json_expect(r, ',') ||
+                    !json_read_float(r, &range[n].hi) ||
+                    !json_expect(r, ']')) {
+                    return FALSE;
+                }
+                n++;
+            } while (json_accept(r, ','));
+            if (!json_expect(r, ']')) return FALSE;
+        }
+        *(int *) (rec + field->count) = n;
+        return TRUE;
+
+    case JSON_INTS:
+        if (!json_expect(r, '[')) return FALSE;
+        n = 0;
+        if (!json_accept(r, ']')) {
+            do {
+                if (n == field->max) {
+                    json_error(r, "more than %d \"%s\" values", field->max,
+                               field->name);
+                    return FALSE;
+                }
+                if (!json_read_int(r, INT_MIN, INT_MAX, &v)) return FALSE;
+                ((int *) p)[n++] = v;
+            } while (json_accept(r, ','));
+            if (!json_expect(r, ']')) return FALSE;
+        }
+        if (field->count != JSON_NO_COUNT) {
+            *(int *) (rec + field->count) = n;
+        }
+        return TRUE;
+
+    case JSON_OBJECT:
+        if (json_accept_null(r)) return TRUE;
+        memcpy(&obj, p, sizeof(obj));
+        if (obj) {
+            json_error(r, "more than one \"%s\"", field->name);
+            return FALSE;
+        }
+        obj = json_new_record(field->type);
+        memcpy(p, &obj, sizeof(obj));
+        return json_read_record(r, field->type, obj);
+
+    case JSON_LIST:
+        if (json_accept_null(r)) return TRUE;
+        return json_read_list(r, field->type, p);
+    }
+
+    return FALSE;
+
+} /* json_read_field() */
+
+
+
+/*
+ * json_read_record() - read an object into the record; members this
+ * version does not know about are skipped
+ */
+
+static int json_read_record(JsonReaderPtr r, int type, void *rec)
+{
+    const JsonTypeRec *t = &JsonTypes[type];
+    const JsonFieldRec *field;
+    char *name, *s;
+    int i, ret = TRUE;
+
+    if (++r->depth > JSON_MAX_DEPTH) {
+        json_error(r, "too deeply nested");
+        return FALSE;
+    }
+
+    if (!json_expect(r, '{')) return FALSE;
+
+    if (!json_accept(r, '}')) {
+        do {
+            name = json_read_string(r);
+            if (!name || !json_expect(r, ':')) {
+                free(name);
+                return FALSE;
+            }
+
+            for (field = NULL, i = 0; i < t->num_fields; i++) {
+                if (strcmp(t->fields[i].name, name) == 0) {
+                    field = &t->fields[i];
+                    break;
+                }
+            }
+
+            free(name);
+
+            ret = field ? json_read_field(r, field, rec) : json_skip_value(r);
+            if (!ret) return FALSE;
+
+        } while (json_accept(r, ','));
+
+        if (!json_expect(r, '}')) return FALSE;
+    }
+
+    for (i = 0; i < t->num_fields; i++) {
+        if (!t->fields[i].required) continue;
+        memcpy(&s, (char *) rec + t->fields[i].offset, sizeof(s));
+        if (!s) {
+            json_error(r, "missing \"%s\"", t->fields[i].name);
+            return FALSE;
+        }
+    }
+
+    r->depth--;
+
+    return TRUE;
+
+} /* json_read_record() */
+
+
+
+/*
+ * json_read_file() - read the whole of the named file
+ */
+
+static char *json_read_file(const char *filename, size_t *len)
+{
+    FILE *fp;
+    char *buf = NULL, *tmp;
+    size_t n, size = 0;
+
+    *len = 0;
+
+    fp = fopen(filename, "r");
+    if (!fp) {
+        xconfigErrorMsg(ErrorMsg, "Unable to open \"%s\" for reading (%s).\n",
+                        filename, strerror(errno));
+        return NULL;
+    }
+
+    do {
+        if (*len == size) {
+            size = size ? size * 2 : 65536;
+            tmp = realloc(buf, size);
+            if (!tmp) {
+                xconfigErrorMsg(ErrorMsg, "Unable to read \"%s\" (%s).\n",
+                                filename, strerror(errno));
+                free(buf);
+                fclose(fp);
+                return NULL;
+            }
+            buf = tmp;
+        }
+        n = fread(buf + *len, 1, size - *len, fp);
+        *len += n;
+    } while (n > 0);
+
+    if (ferror(fp)) {
+        xconfigErrorMsg(ErrorMsg, "Unable to read \"%s\" (%s).\n",
+                        filename, strerror(errno));
+        free(buf);
+        buf = NULL;
+    }
+
+    fclose(fp);
+
+    return buf;
+
+} /* json_read_file() */
+
+
+
+/*
+ * xconfigReadJson() - import the config from the named JSON file, as
+ * written by xconfigWriteJson().  As with xconfigReadConfigFile(), the
+ * name references in the config are resolved and checked.  The
+ * filename of the config is left unset: the JSON file is not where the
+ * config would be written back to.
+ */
+
+XConfigError xconfigReadJson(const char *filename, XConfigPtr *configPtr)
+{
+    JsonReaderRec reader, *r = &reader;
+    XConfigPtr config = NULL;
+    char *buf, *name, *path;
+    long long version = 0;
+    size_t len;
+    int ret = TRUE;
+
+    *configPtr = NULL;
+
+    buf = json_read_file(filename, &len);
+    if (!buf) return XCONFIG_RETURN_PARSE_ERROR;
+
+    memset(r, 0, sizeof(reader));
+    r->filename = filename;
+    r->p = buf;
+    r->end = buf + len;
+    r->line = 1;
+
+    if (!json_expect(r, '{')) goto fail;
+
+    if (!json_accept(r, '}')) {
+        do {
+            name = json_read_string(r);
+            if (!name || !json_expect(r, ':')) {
+                free(name);
+                goto fail;
+            }
+
+            if (strcmp(name, "version") == 0) {
+                ret = json_read_int(r, 1, INT_MAX, &version);
+                if (ret && (version > JSON_VERSION)) {
+                    json_error(r, "version %lld is not supported", version);
+                    ret = FALSE;
+                }
+            } else if (strcmp(name, "config") == 0) {
+                if (config) {
+                    json_error(r, "more than one \"config\"");
+                    ret = FALSE;
+                } else {
+                    config = json_new_record(J_CONFIG);
+                    ret = json_read_record(r, J_CONFIG, config);
+                }
+            } else {
+                ret = json_skip_value(r);
+            }
+
+            free(name);
+
+            if (!ret) goto fail;
+
+        } while (json_accept(r, ','));
+
+        if (!json_expect(r, '}')) goto fail;
+    }
+
+    if (json_peek(r) != -1) {
+        json_error(r, "unexpected data after the end of the JSON object");
+        goto fail;
+    }
+
+    if (!config) {
+        json_error(r, "missing \"config\"");
+        goto fail;
+    }
+
+    free(buf);
+
+    /* validation errors are reported against the JSON file */
+
+    path = configPath;
+    configPath = (char *) filename;
+    ret = xconfigValidateConfig(config);
+    configPath = path;
+
+    if (!ret) {
+        xconfigFreeConfig(&config);
+        return XCONFIG_RETURN_VALIDATION_ERROR;
+    }
+
+    *configPtr = config;
+
+    return XCONFIG_RETURN_SUCCESS;
+
+ fail:
+    free(buf);
+    xconfigFreeConfig(&config);
+
+    return XCONFIG_RETURN_PARSE_ERROR;
+
+} /* xconfigReadJson() */
@@ -365,7 +365,7 @@ xconfigFreeLayoutList (XConfigLayoutPtr *ptr)
     while (*ptr)
     {
         TEST_FREE ((*ptr)->identifier);
-        TEST_FREE ((*ptr)->comment);
+        FREE_COMMENT ((*ptr)->comment);
         xconfigFreeAdjacencyList (&((*ptr)->adjacencies));
         xconfigFreeInputrefList (&((*ptr)->inputs));
         prev = *ptr;
@@ -389,6 +389,7 @@ xconfigFreeAdjacencyList (XConfigAdjacencyPtr *ptr)
         TEST_FREE ((*ptr)->bottom_name);
         TEST_FREE ((*ptr)->left_name);
         TEST_FREE ((*ptr)->right_name);
+        TEST_FREE ((*ptr)->refscreen);
 
         prev = *ptr;
         *ptr = (*ptr)->next;
@@ -31,6 +31,186 @@
 #include "Configint.h"
 
 
+/*
+ * Merge index: an open-addressed hash table of the named items (sections
+ * or options) of one list, keyed by the xconfigNameHash() of the item's
+ * name.  Merging looks up each item of one config in an index of the
+ * other config, rather than walking the other config's list, so merging
+ * is linear in the size of the two configs.
+ *
+ * Each entry records the address of the item's name rather than the
+ * name itself, because merging an option may replace the option's name
+ * with an equivalent spelling.  As with the xconfigFind*() functions,
+ * the first of several items with the same name is the one found.
+ */
+
+typedef struct {
+    void *item;
+    char **name;
+    unsigned int key;
+    int removed;
+} MergeIndexEntry;
+
+typedef struct {
+    MergeIndexEntry *entries;
+    unsigned int size;  /* number of entries; a power of two */
+    unsigned int count; /* number of entries in use */
+    GenericListPtr last; /* last item of the indexed list */
+} MergeIndexRec, *MergeIndexPtr;
+
+#define MERGE_INDEX_MIN_SIZE 16
+
+#define MERGE_INDEX_NAME(item, offset) \
+    ((char **) ((char *) (item) + (offset)))
+
+
+
+/*
+ * merge_index_slot() - return the entry for the named item, or the
+ * empty entry where it would be added.
+ */
+
+static MergeIndexEntry *merge_index_slot(MergeIndexPtr index,
+                                         const char *name, unsigned int key)
+{
+    MergeIndexEntry *entry;
+    unsigned int i;
+
+    for (i = key & (index->size - 1); ; i = (i + 1) & (index->size - 1)) {
+        entry = &index->entries[i];
+        if (!entry->item ||
+            xconfigNameKeyCompare(name, key, *entry->name, entry->key) == 0) {
+            return entry;
+        }
+    }
+
+} /* merge_index_slot() */
+
+
+
+/*
+ * merge_index_find() - return the index entry for the named item, or
+ * NULL if no item by that name is in the index.
+ */
+
+static MergeIndexEntry *merge_index_find(MergeIndexPtr index, const char *name)
+{
+    MergeIndexEntry *entry;
+
+    if (!index->count) return NULL;
+
+    entry = merge_index_slot(index, name, xconfigNameHash(name));
+
+    return entry->item ? entry : NULL;
+
+} /* merge_index_find() */
+
+
+
+/*
+ * merge_index_add() - add the item, whose name is at address 'name', to
+ * the index, unless an item by that name is already in the index.
+ * Returns 1 if successful and 0 if not.
+ */
+
+static int merge_index_add(MergeIndexPtr index, void *item, char **name)
+{
+    MergeIndexEntry *old, *entry;
+    unsigned int i, oldSize, key;
+
+    /* keep the table at most half full, rehashing into a larger table */
+
+    if ((index->count + 1) * 2 > index->size) {
+        old = index->entries;
+        oldSize = index->size;
+
+        index->size = oldSize ? oldSize * 2 : MERGE_INDEX_MIN_SIZE;
+        index->entries = calloc(index->size, sizeof(MergeIndexEntry));
+        if (!index->entries) {
+            index->entries = old;
+            index->size = oldSize;
+            return 0;
+        }
+
+        for (i = 0; i < oldSize; i++) {
+            if (old[i].item) {
+                *merge_index_slot(index, *old[i].name, old[i].key) = old[i];
+            }
+        }
+        free(old);
+    }
+
+    key = xconfigNameHash(*name);
+    entry = merge_index_slot(index, *name, key);
+
+    if (!entry->item) {
+        entry->item = item;
+        entry->name = name;
+        entry->key = key;
+        entry->removed = FALSE;
+        index->count++;
+    }
+
+    return 1;
+
+} /* merge_index_add() */
+
+
+
+/*
+ * merge_index_build() - add each item of the list to the index; the
+ * name of each item is found 'offset' bytes into the item.  The last
+ * item in the list is remembered, so that items can be appended to the
+ * list without walking it again.
+ */
+
+static void merge_index_build(MergeIndexPtr index,
+                              GenericListPtr list, size_t offset)
+{
+    for (; list; list = list->next) {
+        merge_index_add(index, list, MERGE_INDEX_NAME(list, offset));
+        index->last = list;
+    }
+
+} /* merge_index_build() */
+
+
+
+/*
+ * merge_index_free() - free the index's table and reset it to empty.
+ */
+
+static void merge_index_free(MergeIndexPtr index)
+{
+    free(index->entries);
+    index->entries = NULL;
+    index->size = index->count = 0;
+    index->last = NULL;
+
+} /* merge_index_free() */
+
+
+
+/*
+ * merge_list_append() - add the item to the end of the indexed list,
+ * and to its index.
+ */
+
+static void merge_list_append(GenericListPtr *pHead, MergeIndexPtr index,
+                              GenericListPtr item, size_t offset)
+{
+    if (index->last) {
+        index->last->next = item;
+    } else {
+        *pHead = item;
+    }
+    index->last = item;
+
+    merge_index_add(index, item, MERGE_INDEX_NAME(item, offset));
+
+} /* merge_list_append() */
+
+
 
 /*
  * xconfigAddRemovedOptionComment() - Makes a note in the comment
@@ -66,6 +246,7 @@ static void xconfigAddRemovedOptionComment(char **existing_comments,
     }
 
     *existing_comments = xconfigAddComment(*existing_comments, str);
+    free(str);
 
 } /* xconfigAddRemovedOptionComment() */
 
@@ -124,56 +305,152 @@ static int xconfigOptionValuesDiffer(XConfigOptionPtr option0,
 
 
 /*
- * xconfigMergeOption() - Merge option "name" from option source
- * list "srcHead" to option destination list "dstHead".
+ * xconfigMergeOptionList() - Merge each option from the option source
+ * list "srcHead" to the option destination list "dstHead".
  *
  * Merging here means:
  *
- * If the option is not in the source config, do nothing to the
+ * Options not in the source list are left as they are in the
  * destination.  Otherwise, either add or update the option in
  * the dest.  If the option is modified, and a comment is given,
  * then the old option will be commented out instead of being
  * simply removed/replaced.
+ *
+ * Both lists are indexed once, so merging is linear in the length of
+ * the lists.  Returns 1 if the merge was successful and 0 if not.
  */
-static void xconfigMergeOption(XConfigOptionPtr *dstHead,
-                               XConfigOptionPtr *srcHead,
-                               const char *name, char **comments)
+static int xconfigMergeOptionList(XConfigOptionPtr *dstHead,
+                                  XConfigOptionPtr srcHead, char **comments)
 {
-    XConfigOptionPtr srcOption = xconfigFindOption(*srcHead, name);
-    XConfigOptionPtr dstOption = xconfigFindOption(*dstHead, name);
+    MergeIndexRec dstIndex = { NULL, 0, 0, NULL };
+    MergeIndexRec srcIndex = { NULL, 0, 0, NULL };
+    MergeIndexEntry *entry;
+    XConfigOptionPtr option, srcOption, dstOption;
+    const size_t offset = offsetof(XConfigOptionRec, name);
+    char *name, *srcValue;
+    int ret = 1;
 
-    char *srcValue = NULL;
+    if (!srcHead) return 1;
 
-    if (!srcOption) {
-        /* Option does not exist in src, do nothing to dst. */
-        return;
-    }
+    xconfigOptionListUnshare(dstHead);
+
+    merge_index_build(&dstIndex, (GenericListPtr)*dstHead, offset);
+    merge_index_build(&srcIndex, (GenericListPtr)srcHead, offset);
 
-    srcValue = xconfigOptionValue(srcOption);
+    for (option = srcHead; option; option = option->next) {
 
-    if (srcOption && !dstOption) {
+        name = xconfigOptionName(option);
 
-        /* option exists in src but not in dst: add to dst */
-        xconfigAddNewOption(dstHead, name, srcValue);
+        entry = merge_index_find(&srcIndex, name);
+        srcOption = entry ? entry->item : option;
+        srcValue = xconfigOptionValue(srcOption);
 
-    } else if (srcOption && dstOption) {
+        entry = merge_index_find(&dstIndex, name);
+        dstOption = entry ? entry->item : NULL;
 
-        /*
-         * option exists in src and in dst; if the option values are
-         * different, replace the dst's option value with src's option
-         * value; note that xconfigAddNewOption() will remove the old
-         * option first, if necessary
-         */
+        if (!dstOption) {
+
+            /* option exists in src but not in dst: add to dst */
+
+            dstOption = xconfigNewOption(name, srcValue);
+            if (!dstOption) {
+                ret = 0;
+                break;
+            }
+            merge_list_append((GenericListPtr *)dstHead, &dstIndex,
+                              (GenericListPtr)dstOption, offset);
+
+        } else if (xconfigOptionValuesDiffer(srcOption, dstOption)) {
+
+            /*
+             * option exists in src and in dst, with different values:
+             * replace the dst's option name and value with the src's,
+             * in place, as xconfigAddNewOption() would
+             */
 
-        if (xconfigOptionValuesDiffer(srcOption, dstOption)) {
             if (comments) {
                 xconfigAddRemovedOptionComment(comments, dstOption);
             }
-            xconfigAddNewOption(dstHead, name, srcValue);
+            xconfigReleaseString(dstOption->name);
+            TEST_FREE(dstOption->val);
+            dstOption->name = xconfigInternString(name);
+            dstOption->val = xconfigStrdup(srcValue);
         }
     }
 
-} /* xconfigMergeOption() */
+    merge_index_free(&dstIndex);
+    merge_index_free(&srcIndex);
+
+    return ret;
+
+} /* xconfigMergeOptionList() */
+
+
+
+/*
+ * xconfigRemoveOptionList() - Removes each option named in the option
+ * list "srcHead" from the option list "pHead".  If a comments string
+ * is given, each removed option is noted in it, in the order of the
+ * source list; if "changed_only" is set, only options whose value
+ * differs from the source option's value are noted.
+ *
+ * The options to remove are found through an index and then unlinked
+ * in a single pass over the list.
+ */
+static void xconfigRemoveOptionList(XConfigOptionPtr *pHead,
+                                    XConfigOptionPtr srcHead,
+                                    char **comments, int changed_only)
+{
+    MergeIndexRec index = { NULL, 0, 0, NULL };
+    MergeIndexEntry *entry;
+    XConfigOptionPtr option, *pOption, garbage = NULL;
+    const size_t offset = offsetof(XConfigOptionRec, name);
+    int removed = FALSE;
+
+    if (!*pHead || !srcHead) return;
+
+    xconfigOptionListUnshare(pHead);
+
+    merge_index_build(&index, (GenericListPtr)*pHead, offset);
+
+    /* mark the options to remove, commenting them in source order */
+
+    for (option = srcHead; option; option = option->next) {
+        entry = merge_index_find(&index, xconfigOptionName(option));
+        if (!entry || entry->removed) continue;
+
+        if (comments &&
+            (!changed_only ||
+             xconfigOptionValuesDiffer(option, entry->item))) {
+            xconfigAddRemovedOptionComment(comments, entry->item);
+        }
+        entry->removed = removed = TRUE;
+    }
+
+    /*
+     * unlink the marked options onto a list of their own; they are only
+     * freed once the index, which refers to their names, is freed
+     */
+
+    pOption = pHead;
+    while (removed && *pOption) {
+        option = *pOption;
+        entry = merge_index_find(&index, xconfigOptionName(option));
+
+        if (entry && entry->removed && entry->item == option) {
+            *pOption = option->next;
+            option->next = garbage;
+            garbage = option;
+        } else {
+            pOption = &option->next;
+        }
+    }
+
+    merge_index_free(&index);
+
+    xconfigFreeOptionList(&garbage);
+
+} /* xconfigRemoveOptionList() */
 
 
 
@@ -190,7 +467,6 @@ static void xconfigMergeOption(XConfigOptionPtr *dstHead,
 static int xconfigMergeFlags(XConfigPtr dstConfig, XConfigPtr srcConfig)
 {
     if (srcConfig->flags) {
-        XConfigOptionPtr option;
         
         /* Flag section was not found, create a new one */
         if (!dstConfig->flags) {
@@ -199,14 +475,9 @@ static int xconfigMergeFlags(XConfigPtr dstConfig, XConfigPtr srcConfig)
             if (!dstConfig->flags) return 0;
         }
         
-        option = srcConfig->flags->options;
-        while (option) {
-            xconfigMergeOption(&(dstConfig->flags->options),
-                               &(srcConfig->flags->options),
-                               xconfigOptionName(option),
-                               &(dstConfig->flags->comment));
-            option = option->next;
-        }
+        return xconfigMergeOptionList(&(dstConfig->flags->options),
+                                      srcConfig->flags->options,
+                                      &(dstConfig->flags->comment));
     }
     
     return 1;
@@ -215,47 +486,87 @@ static int xconfigMergeFlags(XConfigPtr dstConfig, XConfigPtr srcConfig)
 
 
 
+/*
+ * xconfigMergeString() - Replace the destination string with a copy of
+ * the source string.  When layering, a source string that is not set
+ * leaves the destination string as it is.
+ */
+static void xconfigMergeString(char **dst, const char *src, int layered)
+{
+    if (layered && !src) return;
+
+    free(*dst);
+    *dst = xconfigStrdup(src);
+
+} /* xconfigMergeString() */
+
+
+
 /*
  * xconfigMergeMonitors() - Updates information in the destination monitor
- * with that of the source monitor.
+ * with that of the source monitor.  When layering, only the fields set
+ * in the source monitor are updated, and the monitor options are merged.
  *
  */
 static void xconfigMergeMonitors(XConfigMonitorPtr dstMonitor,
-                                 XConfigMonitorPtr srcMonitor)
+                                 XConfigMonitorPtr srcMonitor, int layered)
 {
     int i;
 
 
     /* Update vendor */
     
-    free(dstMonitor->vendor);
-    dstMonitor->vendor = xconfigStrdup(srcMonitor->vendor);
+    xconfigMergeString(&dstMonitor->vendor, srcMonitor->vendor, layered);
     
     /* Update modelname */
     
-    free(dstMonitor->modelname);
-    dstMonitor->modelname = xconfigStrdup(srcMonitor->modelname);
+    xconfigMergeString(&dstMonitor->modelname, srcMonitor->modelname,
+                       layered);
     
     /* Update horizontal sync */
     
-    dstMonitor->n_hsync = srcMonitor->n_hsync;
-    for (i = 0; i < srcMonitor->n_hsync; i++) {
-        dstMonitor->hsync[i].lo = srcMonitor->hsync[i].lo;
-        dstMonitor->hsync[i].hi = srcMonitor->hsync[i].hi;
+    if (!layered || srcMonitor->n_hsync) {
+        dstMonitor->n_hsync = srcMonitor->n_hsync;
+        for (i = 0; i < srcMonitor->n_hsync; i++) {
+            dstMonitor->hsync[i].lo = srcMonitor->hsync[i].lo;
+            dstMonitor->hsync[i].hi = srcMonitor->hsync[i].hi;
+        }
     }
     
     /* Update vertical sync */
     
-    dstMonitor->n_vrefresh = srcMonitor->n_vrefresh;
-    for (i = 0; i < srcMonitor->n_hsync; i++) {
-        dstMonitor->vrefresh[i].lo = srcMonitor->vrefresh[i].lo;
-        dstMonitor->vrefresh[i].hi = srcMonitor->vrefresh[i].hi;
+    if (!layered || srcMonitor->n_vrefresh) {
+        dstMonitor->n_vrefresh = srcMonitor->n_vrefresh;
+        for (i = 0; i < srcMonitor->n_vrefresh; i++) {
+            dstMonitor->vrefresh[i].lo = srcMonitor->vrefresh[i].lo;
+            dstMonitor->vrefresh[i].hi = srcMonitor->vrefresh[i].hi;
+        }
     }
     
     /* XXX Remove the destination monitor's "UseModes" references to
      *     avoid having the wrong modelines tied to the new monitor.
      */
-    xconfigFreeModesLinkList(&dstMonitor->modes_sections);
+    if (!layered || srcMonitor->n_hsync || srcMonitor->n_vrefresh) {
+        xconfigFreeModesLinkList(&dstMonitor->modes_sections);
+    }
+
+    if (layered) {
+
+        /* Update the display size and gamma; 0 means not set */
+
+        if (srcMonitor->width || srcMonitor->height) {
+            dstMonitor->width = srcMonitor->width;
+            dstMonitor->height = srcMonitor->height;
+        }
+        if (srcMonitor->gamma_red) {
+            dstMonitor->gamma_red = srcMonitor->gamma_red;
+            dstMonitor->gamma_green = srcMonitor->gamma_green;
+            dstMonitor->gamma_blue = srcMonitor->gamma_blue;
+        }
+
+        xconfigMergeOptionList(&dstMonitor->options, srcMonitor->options,
+                               &dstMonitor->comment);
+    }
 
 } /* xconfigMergeMonitors() */
 
@@ -264,14 +575,24 @@ static void xconfigMergeMonitors(XConfigMonitorPtr dstMonitor,
 /*
  * xconfigMergeAllMonitors() - This function ensures that all monitors in
  * the source config appear in the destination config by adding and/or
- * updating the "appropriate" destination monitor sections.
+ * updating the "appropriate" destination monitor sections.  The
+ * destination monitors are indexed in "dstIndex".
  *
  */
-static int xconfigMergeAllMonitors(XConfigPtr dstConfig, XConfigPtr srcConfig)
+static int xconfigMergeAllMonitors(XConfigPtr dstConfig, XConfigPtr srcConfig,
+                                   MergeIndexPtr dstIndex, int layered)
 {
     XConfigMonitorPtr dstMonitor;
     XConfigMonitorPtr srcMonitor;
+    MergeIndexEntry *entry;
+    const size_t offset = offsetof(XConfigMonitorRec, identifier);
+
+
+    /* the index persists across sources; build it for the first one */
 
+    if (!dstIndex->count) {
+        merge_index_build(dstIndex, (GenericListPtr)dstConfig->monitors, offset);
+    }
 
     /* Make sure all monitors in the src config are also in the dst config */
 
@@ -279,8 +600,8 @@ static int xconfigMergeAllMonitors(XConfigPtr dstConfig, XConfigPtr srcConfig)
          srcMonitor;
          srcMonitor = srcMonitor->next) {
 
-        dstMonitor =
-            xconfigFindMonitor(srcMonitor->identifier, dstConfig->monitors);
+        entry = merge_index_find(dstIndex, srcMonitor->identifier);
+        dstMonitor = entry ? entry->item : NULL;
 
         /* Monitor section was not found, create a new one and add it */
         if (!dstMonitor) {
@@ -290,12 +611,12 @@ static int xconfigMergeAllMonitors(XConfigPtr dstConfig, XConfigPtr srcConfig)
 
             dstMonitor->identifier = xconfigStrdup(srcMonitor->identifier);
 
-            xconfigAddListItem((GenericListPtr *)(&dstConfig->monitors),
-                               (GenericListPtr)dstMonitor);
+            merge_list_append((GenericListPtr *)(&dstConfig->monitors),
+                              dstIndex, (GenericListPtr)dstMonitor, offset);
         }
 
         /* Do the merge */
-        xconfigMergeMonitors(dstMonitor, srcMonitor);
+        xconfigMergeMonitors(dstMonitor, srcMonitor, layered);
     }
 
     return 1;
@@ -306,46 +627,93 @@ static int xconfigMergeAllMonitors(XConfigPtr dstConfig, XConfigPtr srcConfig)
 
 /*
  * xconfigMergeDevices() - Updates information in the destination device
- * with that of the source device.
+ * with that of the source device.  When layering, only the fields set in
+ * the source device are updated, and the device options are merged.
  *
  */
 static void xconfigMergeDevices(XConfigDevicePtr dstDevice,
-                                XConfigDevicePtr srcDevice)
+                                XConfigDevicePtr srcDevice, int layered)
 {
     // XXX Zero out the device section?
 
     /* Update driver */
     
-    free(dstDevice->driver);
-    dstDevice->driver = xconfigStrdup(srcDevice->driver);
+    xconfigMergeString(&dstDevice->driver, srcDevice->driver, layered);
     
     /* Update vendor */
     
-    free(dstDevice->vendor);
-    dstDevice->vendor = xconfigStrdup(srcDevice->vendor);
+    xconfigMergeString(&dstDevice->vendor, srcDevice->vendor, layered);
     
     /* Update bus ID */
     
-    free(dstDevice->busid);
-    dstDevice->busid = xconfigStrdup(srcDevice->busid);
+    if (!layered || srcDevice->busid) {
+        xconfigMergeString(&dstDevice->busid, srcDevice->busid, layered);
+        dstDevice->pciaddr = srcDevice->pciaddr;
+    }
     
     /* Update board */
     
-    free(dstDevice->board);
-    dstDevice->board = xconfigStrdup(srcDevice->board);
+    xconfigMergeString(&dstDevice->board, srcDevice->board, layered);
     
-    /* Update chip info */
+    /* Update chip info; -1 means not set */
     
-    dstDevice->chipid = srcDevice->chipid;
-    dstDevice->chiprev = srcDevice->chiprev;
+    if (!layered || srcDevice->chipid != -1) {
+        dstDevice->chipid = srcDevice->chipid;
+    }
+    if (!layered || srcDevice->chiprev != -1) {
+        dstDevice->chiprev = srcDevice->chiprev;
+    }
 
     /* Update IRQ */
 
-    dstDevice->irq = srcDevice->irq;
+    if (!layered || srcDevice->irq != -1) {
+        dstDevice->irq = srcDevice->irq;
+    }
     
     /* Update screen */
     
-    dstDevice->screen = srcDevice->screen;
+    if (!layered || srcDevice->screen != -1) {
+        dstDevice->screen = srcDevice->screen;
+    }
+
+    if (layered) {
+
+        /* Update the hardware overrides; 0 means not set */
+
+        xconfigMergeString(&dstDevice->chipset, srcDevice->chipset, TRUE);
+        xconfigMergeString(&dstDevice->card, srcDevice->card, TRUE);
+        xconfigMergeString(&dstDevice->ramdac, srcDevice->ramdac, TRUE);
+        xconfigMergeString(&dstDevice->clockchip, srcDevice->clockchip,
+                           TRUE);
+
+        if (srcDevice->dacSpeeds[0]) {
+            memcpy(dstDevice->dacSpeeds, srcDevice->dacSpeeds,
+                   sizeof(dstDevice->dacSpeeds));
+        }
+        if (srcDevice->videoram) {
+            dstDevice->videoram = srcDevice->videoram;
+        }
+        if (srcDevice->textclockfreq) {
+            dstDevice->textclockfreq = srcDevice->textclockfreq;
+        }
+        if (srcDevice->bios_base) {
+            dstDevice->bios_base = srcDevice->bios_base;
+        }
+        if (srcDevice->mem_base) {
+            dstDevice->mem_base = srcDevice->mem_base;
+        }
+        if (srcDevice->io_base) {
+            dstDevice->io_base = srcDevice->io_base;
+        }
+        if (srcDevice->clocks) {
+            dstDevice->clocks = srcDevice->clocks;
+            memcpy(dstDevice->clock, srcDevice->clock,
+                   sizeof(dstDevice->clock));
+        }
+
+        xconfigMergeOptionList(&dstDevice->options, srcDevice->options,
+                               &dstDevice->comment);
+    }
 
 } /* xconfigMergeDevices() */
 
@@ -354,23 +722,33 @@ static void xconfigMergeDevices(XConfigDevicePtr dstDevice,
 /*
  * xconfigMergeAllDevices() - This function ensures that all devices in
  * the source config appear in the destination config by adding and/or
- * updating the "appropriate" destination device sections.
+ * updating the "appropriate" destination device sections.  The
+ * destination devices are indexed in "dstIndex".
  *
  */
-static int xconfigMergeAllDevices(XConfigPtr dstConfig, XConfigPtr srcConfig)
+static int xconfigMergeAllDevices(XConfigPtr dstConfig, XConfigPtr srcConfig,
+                                  MergeIndexPtr dstIndex, int layered)
 {
     XConfigDevicePtr dstDevice;
     XConfigDevicePtr srcDevice;
+    MergeIndexEntry *entry;
+    const size_t offset = offsetof(XConfigDeviceRec, identifier);
 
 
+    /* the index persists across sources; build it for the first one */
+
+    if (!dstIndex->count) {
+        merge_index_build(dstIndex, (GenericListPtr)dstConfig->devices, offset);
+    }
+
     /* Make sure all monitors in the src config are also in the dst config */
 
     for (srcDevice = srcConfig->devices;
          srcDevice;
          srcDevice = srcDevice->next) {
 
-        dstDevice =
-            xconfigFindDevice(srcDevice->identifier, dstConfig->devices);
+        entry = merge_index_find(dstIndex, srcDevice->identifier);
+        dstDevice = entry ? entry->item : NULL;
         
         /* Device section was not found, create a new one and add it */
         if (!dstDevice) {
@@ -379,13 +757,17 @@ static int xconfigMergeAllDevices(XConfigPtr dstConfig, XConfigPtr srcConfig)
             if (!dstDevice) return 0;
 
             dstDevice->identifier = xconfigStrdup(srcDevice->identifier);
+            dstDevice->chipid = -1;
+            dstDevice->chiprev = -1;
+            dstDevice->irq = -1;
+            dstDevice->screen = -1;
 
-            xconfigAddListItem((GenericListPtr *)(&dstConfig->devices),
-                               (GenericListPtr)dstDevice);
+            merge_list_append((GenericListPtr *)(&dstConfig->devices),
+                              dstIndex, (GenericListPtr)dstDevice, offset);
         }
 
         /* Do the merge */
-        xconfigMergeDevices(dstDevice, srcDevice);
+        xconfigMergeDevices(dstDevice, srcDevice, layered);
     }
 
     return 1;
@@ -394,6 +776,59 @@ static int xconfigMergeAllDevices(XConfigPtr dstConfig, XConfigPtr srcConfig)
 
 
 
+/*
+ * xconfigMergeAllInputs() - When layering, ensure that all input
+ * devices in the source config appear in the destination config: the
+ * driver of a source input device replaces that of the matching
+ * destination input device, and their options are merged.  The
+ * destination input devices are indexed in "dstIndex".
+ *
+ */
+static int xconfigMergeAllInputs(XConfigPtr dstConfig, XConfigPtr srcConfig,
+                                 MergeIndexPtr dstIndex)
+{
+    XConfigInputPtr dstInput;
+    XConfigInputPtr srcInput;
+    MergeIndexEntry *entry;
+    const size_t offset = offsetof(XConfigInputRec, identifier);
+
+
+    /* the index persists across sources; build it for the first one */
+
+    if (!dstIndex->count) {
+        merge_index_build(dstIndex, (GenericListPtr)dstConfig->inputs, offset);
+    }
+
+    for (srcInput = srcConfig->inputs; srcInput; srcInput = srcInput->next) {
+
+        entry = merge_index_find(dstIndex, srcInput->identifier);
+        dstInput = entry ? entry->item : NULL;
+
+        /* Input section was not found, create a new one and add it */
+        if (!dstInput) {
+            dstInput = (XConfigInputPtr) calloc(1, sizeof(XConfigInputRec));
+            if (!dstInput) return 0;
+
+            dstInput->identifier = xconfigStrdup(srcInput->identifier);
+
+            merge_list_append((GenericListPtr *)(&dstConfig->inputs),
+                              dstIndex, (GenericListPtr)dstInput, offset);
+        }
+
+        xconfigMergeString(&dstInput->driver, srcInput->driver, TRUE);
+
+        if (!xconfigMergeOptionList(&dstInput->options, srcInput->options,
+                                    &dstInput->comment)) {
+            return 0;
+        }
+    }
+
+    return 1;
+
+} /* xconfigMergeAllInputs() */
+
+
+
 /*
  * xconfigMergeDriverOptions() - Update the (Screen) driver options
  * of the destination config with information from the source config.
@@ -406,48 +841,45 @@ static int xconfigMergeDriverOptions(XConfigScreenPtr dstScreen,
                                      XConfigScreenPtr srcScreen)
 {
     XConfigOptionPtr option;
+    XConfigOptionPtr *pLast;
     XConfigDisplayPtr display;
 
-    option = srcScreen->options;
-    while (option) {
-        char *name = xconfigOptionName(option);
+    /* Remove the options from all non-screen option lists */
 
-        /* Remove the option from all non-screen option lists */
-        
-        if (dstScreen->device) {
-            xconfigRemoveNamedOption(&(dstScreen->device->options), name,
-                                     &(dstScreen->device->comment));
-        }
-        if (dstScreen->monitor) {
-            xconfigRemoveNamedOption(&(dstScreen->monitor->options), name,
-                                     &(dstScreen->monitor->comment));
-        }       
-        for (display = dstScreen->displays; display; display = display->next) {
-            xconfigRemoveNamedOption(&(display->options), name,
-                                     &(display->comment));
-        }
-
-        /* Update/Add the option to the screen's option list */
-        {
-            // XXX Only add a comment if the value changed.
-            XConfigOptionPtr old =
-                xconfigFindOption(dstScreen->options, name);
-
-            if (old && xconfigOptionValuesDiffer(option, old)) {
-                xconfigRemoveNamedOption(&(dstScreen->options), name,
-                                         &(dstScreen->comment));
-            } else {
-                xconfigRemoveNamedOption(&(dstScreen->options), name,
-                                         NULL);
-            }
-        }
+    if (dstScreen->device) {
+        xconfigRemoveOptionList(&(dstScreen->device->options),
+                                srcScreen->options,
+                                &(dstScreen->device->comment), FALSE);
+    }
+    if (dstScreen->monitor) {
+        xconfigRemoveOptionList(&(dstScreen->monitor->options),
+                                srcScreen->options,
+                                &(dstScreen->monitor->comment), FALSE);
+    }
+    for (display = dstScreen->displays; display; display = display->next) {
+        xconfigRemoveOptionList(&(display->options), srcScreen->options,
+                                &(display->comment), FALSE);
+    }
 
-        /* Add the option to the screen->options list */
+    /*
+     * Remove the options from the screen's option list; only add a
+     * comment if the value changed
+     */
 
-        xconfigAddNewOption(&dstScreen->options,
-                            name, xconfigOptionValue(option));
-        
-        option = option->next;
+    xconfigRemoveOptionList(&(dstScreen->options), srcScreen->options,
+                            &(dstScreen->comment), TRUE);
+
+    /* Add the options to the end of the screen->options list */
+
+    xconfigOptionListUnshare(&dstScreen->options);
+
+    for (pLast = &dstScreen->options; *pLast; pLast = &(*pLast)->next);
+
+    for (option = srcScreen->options; option; option = option->next) {
+        *pLast = xconfigNewOption(xconfigOptionName(option),
+                                  xconfigOptionValue(option));
+        if (!*pLast) return 0;
+        pLast = &(*pLast)->next;
     }
 
     return 1;
@@ -505,11 +937,14 @@ static int xconfigMergeDisplays(XConfigScreenPtr dstScreen,
 
         lastDstMode = NULL;
         srcMode = srcDisplay->modes;
-        dstMode = NULL;
         while (srcMode) {
 
-            /* Copy the mode */
+            /*
+             * Copy the mode; xconfigAddMode() prepends to the list it is
+             * given, so give it an empty list to get a single mode
+             */
             
+            dstMode = NULL;
             xconfigAddMode(&dstMode, srcMode->mode_name);
 
             /* Add mode at the end of the list */
@@ -538,39 +973,60 @@ static int xconfigMergeDisplays(XConfigScreenPtr dstScreen,
  * xconfigMergeScreens() - Updates information in the destination screen
  * with that of the source screen.
  *
+ * When layering, only the fields set in the source screen are updated.
+ *
  * NOTE: This assumes the Monitor and Device sections have already been
- *       merged.
+ *       merged, and are indexed in "dstMonitors" and "dstDevices".
  *
  */
 static void xconfigMergeScreens(XConfigScreenPtr dstScreen,
-                                XConfigPtr dstConfig,
                                 XConfigScreenPtr srcScreen,
-                                XConfigPtr srcConfig)
+                                MergeIndexPtr dstDevices,
+                                MergeIndexPtr dstMonitors, int layered)
 {
+    MergeIndexEntry *entry;
+
     /* Use the right device */
     
-    free(dstScreen->device_name);
-    dstScreen->device_name = xconfigStrdup(srcScreen->device_name);
-    dstScreen->device =
-        xconfigFindDevice(dstScreen->device_name, dstConfig->devices);
+    xconfigMergeString(&dstScreen->device_name, srcScreen->device_name,
+                       layered);
+    entry = merge_index_find(dstDevices, dstScreen->device_name);
+    dstScreen->device = entry ? entry->item : NULL;
     
 
     /* Use the right monitor */
     
-    free(dstScreen->monitor_name);
-    dstScreen->monitor_name = xconfigStrdup(srcScreen->monitor_name);
-    dstScreen->monitor =
-        xconfigFindMonitor(dstScreen->monitor_name, dstConfig->monitors);
+    xconfigMergeString(&dstScreen->monitor_name, srcScreen->monitor_name,
+                       layered);
+    entry = merge_index_find(dstMonitors, dstScreen->monitor_name);
+    dstScreen->monitor = entry ? entry->item : NULL;
     
 
     /* Update the right default depth */
     
-    dstScreen->defaultdepth = srcScreen->defaultdepth;
+    if (!layered || srcScreen->defaultdepth) {
+        dstScreen->defaultdepth = srcScreen->defaultdepth;
+    }
+
+    /* When layering, also update the other defaults; 0 means not set */
+
+    if (layered) {
+        xconfigMergeString(&dstScreen->obsolete_driver,
+                           srcScreen->obsolete_driver, TRUE);
+        if (srcScreen->defaultbpp) {
+            dstScreen->defaultbpp = srcScreen->defaultbpp;
+        }
+        if (srcScreen->defaultfbbpp) {
+            dstScreen->defaultfbbpp = srcScreen->defaultfbbpp;
+        }
+    }
     
 
     /* Copy over the display section */
     
-    xconfigMergeDisplays(dstScreen, srcScreen);
+    if (!layered || srcScreen->displays) {
+        xconfigMergeDisplays(dstScreen, srcScreen);
+    }
    
 
     /* Update the screen's driver options */
@@ -584,14 +1040,26 @@ static void xconfigMergeScreens(XConfigScreenPtr dstScreen,
 /*
  * xconfigMergeAllScreens() - This function ensures that all screens in
  * the source config appear in the destination config by adding and/or
- * updating the "appropriate" destination screen sections.
+ * updating the "appropriate" destination screen sections.  The
+ * destination screens are indexed in "dstIndex".
  *
  */
-static int xconfigMergeAllScreens(XConfigPtr dstConfig, XConfigPtr srcConfig)
+static int xconfigMergeAllScreens(XConfigPtr dstConfig, XConfigPtr srcConfig,
+                                  MergeIndexPtr dstIndex,
+                                  MergeIndexPtr dstDevices,
+                                  MergeIndexPtr dstMonitors, int layered)
 {
     XConfigScreenPtr srcScreen;
     XConfigScreenPtr dstScreen;
+    MergeIndexEntry *entry;
+    const size_t offset = offsetof(XConfigScreenRec, identifier);
+
 
+    /* the index persists across sources; build it for the first one */
+
+    if (!dstIndex->count) {
+        merge_index_build(dstIndex, (GenericListPtr)dstConfig->screens, offset);
+    }
 
     /* Make sure all src screens are in the dst config */
 
@@ -599,8 +1067,8 @@ static int xconfigMergeAllScreens(XConfigPtr dstConfig, XConfigPtr srcConfig)
          srcScreen;
          srcScreen = srcScreen->next) {
 
-        dstScreen =
-            xconfigFindScreen(srcScreen->identifier, dstConfig->screens);
+        entry = merge_index_find(dstIndex, srcScreen->identifier);
+        dstScreen = entry ? entry->item : NULL;
 
         /* Screen section was not found, create a new one and add it */
         if (!dstScreen) {
@@ -610,12 +1078,13 @@ static int xconfigMergeAllScreens(XConfigPtr dstConfig, XConfigPtr srcConfig)
 
             dstScreen->identifier = xconfigStrdup(srcScreen->identifier);
 
-            xconfigAddListItem((GenericListPtr *)(&dstConfig->screens),
-                               (GenericListPtr)dstScreen);
+            merge_list_append((GenericListPtr *)(&dstConfig->screens),
+                              dstIndex, (GenericListPtr)dstScreen, offset);
         }
 
         /* Do the merge */
-        xconfigMergeScreens(dstScreen, dstConfig, srcScreen, srcConfig);
+        xconfigMergeScreens(dstScreen, srcScreen, dstDevices, dstMonitors,
+                            layered);
     }
 
     return 1;
@@ -624,12 +1093,113 @@ static int xconfigMergeAllScreens(XConfigPtr dstConfig, XConfigPtr srcConfig)
 
 
 
+/*
+ * merge_find_screen() - look up the named screen in the index of the
+ * destination screens.
+ */
+
+static XConfigScreenPtr merge_find_screen(MergeIndexPtr dstScreens,
+                                          const char *name)
+{
+    MergeIndexEntry *entry;
+
+    entry = merge_index_find(dstScreens, name);
+
+    return entry ? entry->item : NULL;
+
+} /* merge_find_screen() */
+
+
+
+/*
+ * xconfigMergeLayoutInputs() - Add the input device references of the
+ * source layout that are not in the destination layout, and merge the
+ * options (e.g., "CorePointer") of those that are.  The references are
+ * resolved by xconfigResolveMergedReferences().
+ *
+ */
+static int xconfigMergeLayoutInputs(XConfigLayoutPtr dstLayout,
+                                    XConfigLayoutPtr srcLayout)
+{
+    XConfigInputrefPtr srcRef, dstRef, *pLast;
+
+    for (srcRef = srcLayout->inputs; srcRef; srcRef = srcRef->next) {
+
+        for (pLast = &dstLayout->inputs; *pLast; pLast = &(*pLast)->next) {
+            if (xconfigNameCompare((*pLast)->input_name,
+                                   srcRef->input_name) == 0) {
+                break;
+            }
+        }
+
+        dstRef = *pLast;
+
+        if (!dstRef) {
+            dstRef = calloc(1, sizeof(XConfigInputrefRec));
+            if (!dstRef) return 0;
+
+            dstRef->input_name = xconfigStrdup(srcRef->input_name);
+            *pLast = dstRef;
+        }
+
+        if (!xconfigMergeOptionList(&dstRef->options, srcRef->options,
+                                    &dstLayout->comment)) {
+            return 0;
+        }
+    }
+
+    return 1;
+
+} /* xconfigMergeLayoutInputs() */
+
+
+
+/*
+ * xconfigMergeLayoutInactives() - Add the inactive devices of the
+ * source layout that are not in the destination layout.  The references
+ * are resolved by xconfigResolveMergedReferences().
+ *
+ */
+static int xconfigMergeLayoutInactives(XConfigLayoutPtr dstLayout,
+                                       XConfigLayoutPtr srcLayout)
+{
+    XConfigInactivePtr srcInactive, *pLast;
+
+    for (srcInactive = srcLayout->inactives;
+         srcInactive;
+         srcInactive = srcInactive->next) {
+
+        for (pLast = &dstLayout->inactives; *pLast; pLast = &(*pLast)->next) {
+            if (xconfigNameCompare((*pLast)->device_name,
+                                   srcInactive->device_name) == 0) {
+                break;
+            }
+        }
+
+        if (!*pLast) {
+            *pLast = calloc(1, sizeof(XConfigInactiveRec));
+            if (!*pLast) return 0;
+
+            (*pLast)->device_name = xconfigStrdup(srcInactive->device_name);
+        }
+    }
+
+    return 1;
+
+} /* xconfigMergeLayoutInactives() */
+
+
+
 /*
  * xconfigMergeLayout() - Updates information in the destination's first
- * layout with that of the source's first layout.
+ * layout with that of the source's first layout.  The destination
+ * screens are indexed in "dstScreens".  When layering, the adjacencies
+ * are only replaced if the source layout has any, and the input devices
+ * and inactive devices of the source layout are added.
  *
  */
-static int xconfigMergeLayout(XConfigPtr dstConfig, XConfigPtr srcConfig)
+static int xconfigMergeLayout(XConfigPtr dstConfig, XConfigPtr srcConfig,
+                              MergeIndexPtr dstScreens, int layered)
 {
     XConfigLayoutPtr srcLayout = srcConfig->layouts;
     XConfigLayoutPtr dstLayout = dstConfig->layouts;
@@ -638,75 +1208,93 @@ static int xconfigMergeLayout(XConfigPtr dstConfig, XConfigPtr srcConfig)
     XConfigAdjacencyPtr dstAdj;
     XConfigAdjacencyPtr lastDstAdj;
 
+    if (layered) {
+
+        /* a layer without a layout leaves the layout as it is */
+
+        if (!srcLayout) {
+            return 1;
+        }
+
+        /* Layout section was not found, create a new one */
+
+        if (!dstLayout) {
+            dstLayout =
+                (XConfigLayoutPtr) calloc(1, sizeof(XConfigLayoutRec));
+            if (!dstLayout) return 0;
+
+            dstLayout->identifier = xconfigStrdup(srcLayout->identifier);
+            dstConfig->layouts = dstLayout;
+        }
+    }
+
     if (!dstLayout || !srcLayout) {
         return 0;
     }
 
-    /* Clear the destination's adjacency list */
+    if (!layered || srcLayout->adjacencies) {
 
-    xconfigFreeAdjacencyList(&dstLayout->adjacencies);
-    
-    /* Copy adjacencies over */
-    
-    lastDstAdj = NULL;
-    srcAdj = srcLayout->adjacencies;
-    while (srcAdj) {
-        
-        /* Copy the adjacency */
-        
-        dstAdj =
-            (XConfigAdjacencyPtr) calloc(1, sizeof(XConfigAdjacencyRec));
-
-        dstAdj->scrnum = srcAdj->scrnum;
-        dstAdj->screen_name = xconfigStrdup(srcAdj->screen_name);
-        dstAdj->top_name = xconfigStrdup(srcAdj->top_name);
-        dstAdj->bottom_name = xconfigStrdup(srcAdj->bottom_name);
-        dstAdj->left_name = xconfigStrdup(srcAdj->left_name);
-        dstAdj->right_name = xconfigStrdup(srcAdj->right_name);
-        dstAdj->where = srcAdj->where;
-        dstAdj->x = srcAdj->x;
-        dstAdj->y = srcAdj->y;
-        dstAdj->refscreen = xconfigStrdup(srcAdj->refscreen);
-
-        dstAdj->screen =
-            xconfigFindScreen(dstAdj->screen_name, dstConfig->screens);
-        dstAdj->top =
-            xconfigFindScreen(dstAdj->top_name, dstConfig->screens);
-        dstAdj->bottom =
-            xconfigFindScreen(dstAdj->bottom_name, dstConfig->screens);
-        dstAdj->left =
-            xconfigFindScreen(dstAdj->left_name, dstConfig->screens);
-        dstAdj->right =
-            xconfigFindScreen(dstAdj->right_name, dstConfig->screens);
-
-        /* Add adjacency at the end of the list */
-        
-        if (!lastDstAdj) {
-            dstLayout->adjacencies = dstAdj;
-        } else {
-            lastDstAdj->next = dstAdj;
+        /* Clear the destination's adjacency list */
+
+        xconfigFreeAdjacencyList(&dstLayout->adjacencies);
+
+        /* Copy adjacencies over */
+
+        lastDstAdj = NULL;
+        srcAdj = srcLayout->adjacencies;
+        while (srcAdj) {
+
+            /* Copy the adjacency */
+
+            dstAdj = (XConfigAdjacencyPtr)
+                calloc(1, sizeof(XConfigAdjacencyRec));
+
+            dstAdj->scrnum = srcAdj->scrnum;
+            dstAdj->screen_name = xconfigStrdup(srcAdj->screen_name);
+            dstAdj->top_name = xconfigStrdup(srcAdj->top_name);
+            dstAdj->bottom_name = xconfigStrdup(srcAdj->bottom_name);
+            dstAdj->left_name = xconfigStrdup(srcAdj->left_name);
+            dstAdj->right_name = xconfigStrdup(srcAdj->right_name);
+            dstAdj->where = srcAdj->where;
+            dstAdj->x = srcAdj->x;
+            dstAdj->y = srcAdj->y;
+            dstAdj->refscreen = xconfigStrdup(srcAdj->refscreen);
+
+            dstAdj->screen =
+                merge_find_screen(dstScreens, dstAdj->screen_name);
+            dstAdj->top =
+                merge_find_screen(dstScreens, dstAdj->top_name);
+            dstAdj->bottom =
+                merge_find_screen(dstScreens, dstAdj->bottom_name);
+            dstAdj->left =
+                merge_find_screen(dstScreens, dstAdj->left_name);
+            dstAdj->right =
+                merge_find_screen(dstScreens, dstAdj->right_name);
+
+            /* Add adjacency at the end of the list */
+
+            if (!lastDstAdj) {
+                dstLayout->adjacencies = dstAdj;
+            } else {
+                lastDstAdj->next = dstAdj;
+            }
+            lastDstAdj = dstAdj;
+
+            srcAdj = srcAdj->next;
         }
-        lastDstAdj = dstAdj;
-        
-        srcAdj = srcAdj->next;
     }
 
-    /* Merge the options */
-    
-    if (srcLayout->options) {
-        XConfigOptionPtr srcOption;
-
-        srcOption = srcLayout->options;
-        while (srcOption) {
-            xconfigMergeOption(&(dstLayout->options),
-                               &(srcLayout->options),
-                               xconfigOptionName(srcOption),
-                               &(dstLayout->comment));
-            srcOption = srcOption->next;
+    if (layered) {
+        if (!xconfigMergeLayoutInputs(dstLayout, srcLayout) ||
+            !xconfigMergeLayoutInactives(dstLayout, srcLayout)) {
+            return 0;
         }
     }
 
-    return 1;
+    /* Merge the options */
+    
+    return xconfigMergeOptionList(&(dstLayout->options), srcLayout->options,
+                                  &(dstLayout->comment));
 
 } /* xconfigMergeLayout() */
 
@@ -721,7 +1309,6 @@ static int xconfigMergeLayout(XConfigPtr dstConfig, XConfigPtr srcConfig)
 static int  xconfigMergeExtensions(XConfigPtr dstConfig, XConfigPtr srcConfig)
 {
    if (srcConfig->extensions) {
-        XConfigOptionPtr option;
 
         /* Extension section was not found, create a new one */
         if (!dstConfig->extensions) {
@@ -730,14 +1317,9 @@ static int  xconfigMergeExtensions(XConfigPtr dstConfig, XConfigPtr srcConfig)
             if (!dstConfig->extensions) return 0;
         }
 
-        option = srcConfig->extensions->options;
-        while (option) {
-            xconfigMergeOption(&(dstConfig->extensions->options),
-                               &(srcConfig->extensions->options),
-                               xconfigOptionName(option),
-                               &(dstConfig->extensions->comment));
-            option = option->next;
-        }
+        return xconfigMergeOptionList(&(dstConfig->extensions->options),
+                                      srcConfig->extensions->options,
+                                      &(dstConfig->extensions->comment));
     }
 
     return 1;
@@ -745,17 +1327,29 @@ static int  xconfigMergeExtensions(XConfigPtr dstConfig, XConfigPtr srcConfig)
 } /* xconfigMergeExtensions() */
 
 /*
- * xconfigMergeConfigs() - Merges the source X configuration with the
- * destination X configuration.
- *
- * NOTE: This function is currently only used for merging X config files
- *       for display configuration reasons.  As such, the merge assumes
- *       that the dst config file is the target config file and that
- *       mostly, only new display configuration information should be
- *       copied from the source X config to the destination X config.
- *
+ * MergeStateRec - the indexes of the destination's monitors, devices,
+ * screens and (when layering) input devices; they are built when the first source is merged, and kept up
+ * to date as sections are added, so that merging several sources into
+ * one destination indexes the destination only once.
  */
-int xconfigMergeConfigs(XConfigPtr dstConfig, XConfigPtr srcConfig)
+
+typedef struct {
+    MergeIndexRec monitors;
+    MergeIndexRec devices;
+    MergeIndexRec screens;
+    MergeIndexRec inputs;
+    int layered;
+} MergeStateRec, *MergeStatePtr;
+
+
+
+/*
+ * xconfigMergeConfig() - Merges one source X configuration into the
+ * destination X configuration, using (and updating) the destination
+ * indexes in "state".
+ */
+static int xconfigMergeConfig(MergeStatePtr state, XConfigPtr dstConfig,
+                              XConfigPtr srcConfig)
 {
     /* Make sure the X config is valid */
     // make_xconfig_usable(dstConfig);
@@ -770,28 +1364,41 @@ int xconfigMergeConfigs(XConfigPtr dstConfig, XConfigPtr srcConfig)
 
     /* Merge the monitor sections */
 
-    if (!xconfigMergeAllMonitors(dstConfig, srcConfig)) {
+    if (!xconfigMergeAllMonitors(dstConfig, srcConfig, &state->monitors,
+                                 state->layered)) {
         return 0;
     }
 
 
     /* Merge the device sections */
 
-    if (!xconfigMergeAllDevices(dstConfig, srcConfig)) {
+    if (!xconfigMergeAllDevices(dstConfig, srcConfig, &state->devices,
+                                state->layered)) {
+        return 0;
+    }
+
+
+    /* Merge the input device sections */
+
+    if (state->layered &&
+        !xconfigMergeAllInputs(dstConfig, srcConfig, &state->inputs)) {
         return 0;
     }
 
 
     /* Merge the screen sections */
 
-    if (!xconfigMergeAllScreens(dstConfig, srcConfig)) {
+    if (!xconfigMergeAllScreens(dstConfig, srcConfig, &state->screens,
+                                &state->devices, &state->monitors,
+                                state->layered)) {
         return 0;
     }
 
 
     /* Merge the first layout */
     
-    if (!xconfigMergeLayout(dstConfig, srcConfig)) {
+    if (!xconfigMergeLayout(dstConfig, srcConfig, &state->screens,
+                            state->layered)) {
         return 0;
     }
 
@@ -804,4 +1411,227 @@ int xconfigMergeConfigs(XConfigPtr dstConfig, XConfigPtr srcConfig)
 
     return 1;
 
+} /* xconfigMergeConfig() */
+
+
+
+/*
+ * xconfigResolveMergedReferences() - Resolve the screen references to
+ * devices and monitors, and the layout references to screens, that
+ * could not be resolved before merging, along with the layout
+ * references to input devices and inactive devices; a later source may
+ * add the section that an earlier one (or the destination) refers to.
+ */
+static void xconfigResolveMergedReferences(MergeStatePtr state,
+                                           XConfigPtr config)
+{
+    XConfigScreenPtr screen;
+    XConfigLayoutPtr layout;
+    XConfigAdjacencyPtr adj;
+    XConfigInputrefPtr inputref;
+    XConfigInactivePtr inactive;
+    MergeIndexEntry *entry;
+
+    /* a source without input devices has not indexed the destination's */
+
+    if (!state->inputs.count) {
+        merge_index_build(&state->inputs, (GenericListPtr)config->inputs,
+                          offsetof(XConfigInputRec, identifier));
+    }
+
+    for (screen = config->screens; screen; screen = screen->next) {
+        if (!screen->device && screen->device_name) {
+            entry = merge_index_find(&state->devices, screen->device_name);
+            screen->device = entry ? entry->item : NULL;
+        }
+        if (!screen->monitor && screen->monitor_name) {
+            entry = merge_index_find(&state->monitors, screen->monitor_name);
+            screen->monitor = entry ? entry->item : NULL;
+        }
+    }
+
+    for (layout = config->layouts; layout; layout = layout->next) {
+        for (adj = layout->adjacencies; adj; adj = adj->next) {
+            if (!adj->screen && adj->screen_name) {
+                adj->screen = merge_find_screen(&state->screens,
+                                                adj->screen_name);
+            }
+            if (!adj->top && adj->top_name) {
+                adj->top = merge_find_screen(&state->screens, adj->top_name);
+            }
+            if (!adj->bottom && adj->bottom_name) {
+                adj->bottom = merge_find_screen(&state->screens,
+                                                adj->bottom_name);
+            }
+            if (!adj->left && adj->left_name) {
+                adj->left = merge_find_screen(&state->screens,
+                                              adj->left_name);
+            }
+            if (!adj->right && adj->right_name) {
+                adj->right = merge_find_screen(&state->screens,
+                                               adj->right_name);
+            }
+        }
+        for (inputref = layout->inputs; inputref; inputref = inputref->next) {
+            if (!inputref->input && inputref->input_name) {
+                entry = merge_index_find(&state->inputs,
+                                         inputref->input_name);
+                inputref->input = entry ? entry->item : NULL;
+            }
+        }
+        for (inactive = layout->inactives; inactive;
+             inactive = inactive->next) {
+            if (!inactive->device && inactive->device_name) {
+                entry = merge_index_find(&state->devices,
+                                         inactive->device_name);
+                inactive->device = entry ? entry->item : NULL;
+            }
+        }
+    }
+
+} /* xconfigResolveMergedReferences() */
+
+
+
+/*
+ * xconfigMergeStateFree() - free the destination indexes.
+ */
+static void xconfigMergeStateFree(MergeStatePtr state)
+{
+    merge_index_free(&state->monitors);
+    merge_index_free(&state->devices);
+    merge_index_free(&state->screens);
+    merge_index_free(&state->inputs);
+
+} /* xconfigMergeStateFree() */
+
+
+
+/*
+ * xconfigMergeConfigs() - Merges the source X configuration with the
+ * destination X configuration.
+ *
+ * NOTE: This function is currently only used for merging X config files
+ *       for display configuration reasons.  As such, the merge assumes
+ *       that the dst config file is the target config file and that
+ *       mostly, only new display configuration information should be
+ *       copied from the source X config to the destination X config.
+ *
+ */
+int xconfigMergeConfigs(XConfigPtr dstConfig, XConfigPtr srcConfig)
+{
+    MergeStateRec state;
+    int ret;
+
+    memset(&state, 0, sizeof(state));
+
+    ret = xconfigMergeConfig(&state, dstConfig, srcConfig);
+
+    xconfigMergeStateFree(&state);
+
+    return ret;
+
 } /* xconfigMergeConfigs() */
+
+
+
+/*
+ * merge_unlayerable_content() - return a description of the first part
+ * of the source X configuration that layering cannot merge, or NULL if
+ * all of it can be merged.
+ */
+
+static const char *merge_unlayerable_content(XConfigPtr config)
+{
+    XConfigMonitorPtr monitor;
+    XConfigScreenPtr screen;
+
+    if (config->files) return "a Files section";
+    if (config->modules) return "a Module section";
+    if (config->modes) return "a Modes section";
+    if (config->videoadaptors) return "a VideoAdaptor section";
+    if (config->inputclasses) return "an InputClass section";
+    if (config->vendors) return "a Vendor section";
+    if (config->dri) return "a DRI section";
+
+    for (monitor = config->monitors; monitor; monitor = monitor->next) {
+        if (monitor->modelines || monitor->modes_sections) {
+            return "a Monitor section with a ModeLine, Mode or UseModes entry";
+        }
+    }
+
+    for (screen = config->screens; screen; screen = screen->next) {
+        if (screen->adaptors) {
+            return "a Screen section with a VideoAdaptor entry";
+        }
+    }
+
+    if (config->layouts && config->layouts->next) {
+        return "more than one ServerLayout section";
+    }
+
+    return NULL;
+
+} /* merge_unlayerable_content() */
+
+
+
+/*
+ * xconfigMergeConfigList() - Layers the "count" source X configurations
+ * in "srcConfigs" onto the destination X configuration, in order: a
+ * later source takes precedence over an earlier one, and every source
+ * takes precedence over the destination.
+ *
+ * Unlike xconfigMergeConfigs(), a source section only updates the
+ * fields it sets: e.g., a Device section with only an Option leaves the
+ * destination device's Driver and BusID as they are.  Device and
+ * monitor options are merged option by option, a source without a
+ * layout leaves the layout as it is, and references to sections added
+ * by a later source are resolved once all sources are merged.
+ *
+ * Flags, Monitor, Device, Screen, InputDevice and Extensions sections,
+ * and the first ServerLayout, can be layered.  A source with any other
+ * content (see merge_unlayerable_content()) is reported, and nothing is
+ * merged, rather than silently dropping that content.
+ *
+ * Returns 1 if the merge was successful and 0 if not.
+ */
+int xconfigMergeConfigList(XConfigPtr dstConfig, XConfigPtr *srcConfigs,
+                           int count)
+{
+    MergeStateRec state;
+    const char *unlayerable;
+    int i, ret = 1;
+
+    for (i = 0; i < count; i++) {
+        if (!srcConfigs[i]) continue;
+
+        unlayerable = merge_unlayerable_content(srcConfigs[i]);
+        if (unlayerable) {
+            xconfigErrorMsg(ErrorMsg, "Unable to layer the X "
+                            "configuration file \"%s\": it has %s, which "
+                            "cannot be layered.\n",
+                            srcConfigs[i]->filename ?
+                            srcConfigs[i]->filename : "", unlayerable);
+            return 0;
+        }
+    }
+
+    memset(&state, 0, sizeof(state));
+    state.layered = TRUE;
+
+    for (i = 0; i < count && ret; i++) {
+        if (srcConfigs[i]) {
+            ret = xconfigMergeConfig(&state, dstConfig, srcConfigs[i]);
+        }
+    }
+
+    if (ret) {
+        xconfigResolveMergedReferences(&state, dstConfig);
+    }
+
+    xconfigMergeStateFree(&state);
+
+    return ret;
+
+} /* xconfigMergeConfigList() */
@@ -260,7 +260,7 @@ xconfigRemoveLoadDirective(XConfigLoadPtr *pHead, XConfigLoadPtr load)
      xconfigRemoveListItem((GenericListPtr *)pHead, (GenericListPtr)load);
 
     TEST_FREE(load->name);
-    TEST_FREE(load->comment);
+    FREE_COMMENT(load->comment);
     xconfigFreeOptionList(&(load->opt));
     free(load);
 }
@@ -273,7 +273,7 @@ FreeModule(XConfigLoadPtr lptr)
     while (lptr)
     {
         TEST_FREE (lptr->name);
-        TEST_FREE (lptr->comment);
+        FREE_COMMENT (lptr->comment);
         prev = lptr;
         lptr = lptr->next;
         free (prev);
@@ -289,7 +289,7 @@ xconfigFreeModules (XConfigModulePtr *ptr)
     FreeModule((*ptr)->loads);
     FreeModule((*ptr)->disables);
     
-    TEST_FREE ((*ptr)->comment);
+    FREE_COMMENT ((*ptr)->comment);
     free (*ptr);
     *ptr = NULL;
 }
@@ -134,7 +134,7 @@ xconfigParseModeLine (void)
     /* DotClock */
     if ((xconfigGetSubToken (&(ptr->comment)) != NUMBER) || !val.str)
         Error ("ModeLine dotclock expected", NULL);
-    ptr->clock = xconfigStrdup(val.str);
+    ptr->clock = xconfigInternString(val.str);
 
     /* HDisplay */
     if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
@@ -243,6 +243,8 @@ xconfigParseModeLine (void)
     }
     xconfigUnGetToken (token);
 
+    ptr->key = xconfigModelineKey (ptr);
+
     return (ptr);
 }
 
@@ -266,7 +268,8 @@ xconfigParseVerboseMode (void)
         case DOTCLOCK:
             if ((xconfigGetSubToken (&(ptr->comment)) != NUMBER) || !val.str)
                 Error (NUMBER_MSG, "DotClock");
-            ptr->clock = xconfigStrdup(val.str);
+            xconfigReleaseString (ptr->clock);
+            ptr->clock = xconfigInternString(val.str);
             had_dotclock = 1;
             break;
         case HTIMINGS:
@@ -389,6 +392,8 @@ xconfigParseVerboseMode (void)
     if (!had_vtimings)
         Error ("the vertical timings are missing", NULL);
 
+    ptr->key = xconfigModelineKey (ptr);
+
     return (ptr);
 }
 
@@ -579,6 +584,8 @@ VertDone:
     if (!has_ident)
         Error (NO_IDENT_MSG, NULL);
 
+    ptr->modelines = xconfigPoolModeLineList (ptr->modelines);
+
     return ptr;
 }
 
@@ -627,6 +634,8 @@ xconfigParseModesSection (void)
     if (!has_ident)
         Error (NO_IDENT_MSG, NULL);
 
+    ptr->modelines = xconfigPoolModeLineList (ptr->modelines);
+
     return ptr;
 }
 
@@ -636,6 +645,7 @@ void
 xconfigPrintMonitorSection (FILE * cf, XConfigMonitorPtr ptr)
 {
     int i;
+    char lo[32], mid[32], hi[32];
     XConfigModeLinePtr mlptr;
     XConfigModesLinkPtr mptr;
 
@@ -661,32 +671,39 @@ xconfigPrintMonitorSection (FILE * cf, XConfigMonitorPtr ptr)
                      ptr->height);
         for (i = 0; i < ptr->n_hsync; i++)
         {
-            fprintf (cf, "    HorizSync       %2.1f - %2.1f\n",
-                     ptr->hsync[i].lo,
-                     ptr->hsync[i].hi);
+            fprintf (cf, "    HorizSync       %s - %s\n",
+                     xconfigFormatReal (lo, sizeof(lo), ptr->hsync[i].lo, 1),
+                     xconfigFormatReal (hi, sizeof(hi), ptr->hsync[i].hi, 1));
         }
         for (i = 0; i < ptr->n_vrefresh; i++)
         {
             if (ptr->vrefresh[i].lo == ptr->vrefresh[i].hi) {
-                fprintf (cf, "    VertRefresh     %2.1f\n",
-                         ptr->vrefresh[i].lo);
+                fprintf (cf, "    VertRefresh     %s\n",
+                         xconfigFormatReal (lo, sizeof(lo),
+                                            ptr->vrefresh[i].lo, 1));
             } else {
-                fprintf (cf, "    VertRefresh     %2.1f - %2.1f\n",
-                         ptr->vrefresh[i].lo,
-                         ptr->vrefresh[i].hi);
+                fprintf (cf, "    VertRefresh     %s - %s\n",
+                         xconfigFormatReal (lo, sizeof(lo),
+                                            ptr->vrefresh[i].lo, 1),
+                         xconfigFormatReal (hi, sizeof(hi),
+                                            ptr->vrefresh[i].hi, 1));
             }
         }
         if (ptr->gamma_red) {
             if (ptr->gamma_red == ptr->gamma_green
                 && ptr->gamma_red == ptr->gamma_blue)
             {
-                fprintf (cf, "    Gamma           %.4g\n",
-                    ptr->gamma_red);
+                fprintf (cf, "    Gamma           %s\n",
+                    xconfigFormatRealShort (lo, sizeof(lo),
+                                            ptr->gamma_red, 4));
             } else {
-                fprintf (cf, "    Gamma           %.4g %.4g %.4g\n",
-                    ptr->gamma_red,
-                    ptr->gamma_green,
-                    ptr->gamma_blue);
+                fprintf (cf, "    Gamma           %s %s %s\n",
+                    xconfigFormatRealShort (lo, sizeof(lo),
+                                            ptr->gamma_red, 4),
+                    xconfigFormatRealShort (mid, sizeof(mid),
+                                            ptr->gamma_green, 4),
+                    xconfigFormatRealShort (hi, sizeof(hi),
+                                            ptr->gamma_blue, 4));
             }
         }
         for (mlptr = ptr->modelines; mlptr; mlptr = mlptr->next)
@@ -796,7 +813,7 @@ xconfigFreeMonitorList (XConfigMonitorPtr *ptr)
         TEST_FREE ((*ptr)->identifier);
         TEST_FREE ((*ptr)->vendor);
         TEST_FREE ((*ptr)->modelname);
-        TEST_FREE ((*ptr)->comment);
+        FREE_COMMENT ((*ptr)->comment);
         xconfigFreeOptionList (&((*ptr)->options));
         xconfigFreeModeLineList (&((*ptr)->modelines));
         prev = *ptr;
@@ -816,7 +833,7 @@ xconfigFreeModesList (XConfigModesPtr *ptr)
     while (*ptr)
     {
         TEST_FREE ((*ptr)->identifier);
-        TEST_FREE ((*ptr)->comment);
+        FREE_COMMENT ((*ptr)->comment);
         xconfigFreeModeLineList (&((*ptr)->modelines));
         prev = *ptr;
         *ptr = (*ptr)->next;
@@ -832,11 +849,19 @@ xconfigFreeModeLineList (XConfigModeLinePtr *ptr)
     if (ptr == NULL || *ptr == NULL)
         return;
 
+    /* a shared list is only released by its last owner */
+
+    if ((*ptr)->refcount > 0) {
+        (*ptr)->refcount--;
+        *ptr = NULL;
+        return;
+    }
+
     while (*ptr)
     {
         TEST_FREE ((*ptr)->identifier);
-        TEST_FREE ((*ptr)->comment);
-        TEST_FREE ((*ptr)->clock);
+        FREE_COMMENT ((*ptr)->comment);
+        xconfigReleaseString ((*ptr)->clock);
         prev = *ptr;
         *ptr = (*ptr)->next;
         free (prev);
@@ -919,3 +944,253 @@ xconfigValidateMonitor (XConfigPtr p, XConfigScreenPtr screen)
     }
     return (TRUE);
 }
+
+
+/*
+ * Modeline list pool: the Monitor and Modes sections of a config often
+ * repeat the same modelines (e.g., a config generated for many
+ * identical monitors), so each modeline list that is read is looked up
+ * in the pool, and a list equal to one read earlier is replaced by a
+ * reference to that list.  Modeline records are linked through their
+ * 'next' field, so it is whole lists that are shared.  The pool holds
+ * a reference to each list in it, and only lasts for the reading of
+ * one config file; see xconfigClearModeLinePool().
+ */
+
+typedef struct __modeline_pool_rec {
+    struct __modeline_pool_rec *next;
+    unsigned int hash;
+    XConfigModeLinePtr modelines;
+} ModeLinePoolRec, *ModeLinePoolPtr;
+
+#define MODELINE_POOL_MIN_BUCKETS 16
+
+static ModeLinePoolPtr *modelinePoolBuckets = NULL;
+static unsigned int modelinePoolNumBuckets = 0;
+static unsigned int modelinePoolNumEntries = 0;
+
+
+/*
+ * modeline_list_hash() - combine the keys and names of the modelines
+ * in the list
+ */
+
+static unsigned int modeline_list_hash(XConfigModeLinePtr p)
+{
+    unsigned int h = 2166136261u;
+
+    for (; p; p = p->next) {
+        h = (h ^ xconfigModelineKey(p)) * 16777619u;
+        h = (h ^ xconfigNameHash(p->identifier)) * 16777619u;
+    }
+
+    return h;
+
+} /* modeline_list_hash() */
+
+
+/*
+ * modeline_string_equal() - compare two strings, either of which may
+ * be NULL
+ */
+
+static int modeline_string_equal(const char *s1, const char *s2)
+{
+    if (s1 == s2) return TRUE;
+    if (!s1 || !s2) return FALSE;
+
+    return (strcmp(s1, s2) == 0);
+
+} /* modeline_string_equal() */
+
+
+/*
+ * modeline_list_equal() - two modeline lists are equal if they have
+ * the same modelines, with the same names and comments, in the same
+ * order
+ */
+
+static int modeline_list_equal(XConfigModeLinePtr p1, XConfigModeLinePtr p2)
+{
+    for (; p1 && p2; p1 = p1->next, p2 = p2->next) {
+        if (xconfigModelineCompare(p1, p2) ||
+            !modeline_string_equal(p1->identifier, p2->identifier) ||
+            !modeline_string_equal(p1->comment, p2->comment)) {
+            return FALSE;
+        }
+    }
+
+    return (!p1 && !p2);
+
+} /* modeline_list_equal() */
+
+
+/*
+ * modeline_pool_grow() - double the number of hash buckets, rehashing
+ * the existing entries
+ */
+
+static void modeline_pool_grow(void)
+{
+    unsigned int i, n;
+    ModeLinePoolPtr *buckets, p, next;
+
+    n = modelinePoolNumBuckets ?
+        modelinePoolNumBuckets * 2 : MODELINE_POOL_MIN_BUCKETS;
+    buckets = xconfigAlloc(n * sizeof(ModeLinePoolPtr));
+
+    for (i = 0; i < modelinePoolNumBuckets; i++) {
+        for (p = modelinePoolBuckets[i]; p; p = next) {
+            next = p->next;
+            p->next = buckets[p->hash & (n - 1)];
+            buckets[p->hash & (n - 1)] = p;
+        }
+    }
+
+    free(modelinePoolBuckets);
+    modelinePoolBuckets = buckets;
+    modelinePoolNumBuckets = n;
+
+} /* modeline_pool_grow() */
+
+
+/*
+ * xconfigPoolModeLineList() - return the pooled list equal to the given
+ * modeline list, freeing the given list if an equal list was pooled
+ * earlier, or pooling it if not.
+ *
+ * Only whole, equal lists are shared: records are not interned one by
+ * one, since they are chained through 'next'.  Two lists that differ in
+ * a single modeline (or only in its order or comment) are still kept
+ * as two full copies.
+ */
+
+XConfigModeLinePtr xconfigPoolModeLineList(XConfigModeLinePtr modelines)
+{
+    unsigned int h;
+    ModeLinePoolPtr p;
+
+    if (!modelines) return NULL;
+
+    h = modeline_list_hash(modelines);
+
+    if (modelinePoolNumBuckets) {
+        for (p = modelinePoolBuckets[h & (modelinePoolNumBuckets - 1)]; p;
+             p = p->next) {
+            if ((p->hash == h) &&
+                modeline_list_equal(p->modelines, modelines)) {
+                xconfigFreeModeLineList(&modelines);
+                p->modelines->refcount++;
+                return p->modelines;
+            }
+        }
+    }
+
+    if (modelinePoolNumEntries >= modelinePoolNumBuckets) {
+        modeline_pool_grow();
+    }
+
+    p = xconfigAlloc(sizeof(ModeLinePoolRec));
+    p->hash = h;
+    p->modelines = modelines;
+
+    /* the pool's own reference */
+
+    modelines->refcount++;
+
+    p->next = modelinePoolBuckets[h & (modelinePoolNumBuckets - 1)];
+    modelinePoolBuckets[h & (modelinePoolNumBuckets - 1)] = p;
+    modelinePoolNumEntries++;
+
+    return modelines;
+
+} /* xconfigPoolModeLineList() */
+
+
+/*
+ * xconfigClearModeLinePool() - drop the pool's references to the lists
+ * in it, and empty the pool
+ */
+
+void xconfigClearModeLinePool(void)
+{
+    unsigned int i;
+    ModeLinePoolPtr p, next;
+
+    for (i = 0; i < modelinePoolNumBuckets; i++) {
+        for (p = modelinePoolBuckets[i]; p; p = next) {
+            next = p->next;
+            xconfigFreeModeLineList(&p->modelines);
+            free(p);
+        }
+    }
+
+    free(modelinePoolBuckets);
+    modelinePoolBuckets = NULL;
+    modelinePoolNumBuckets = 0;
+    modelinePoolNumEntries = 0;
+
+} /* xconfigClearModeLinePool() */
+
+
+/*
+ * xconfigHoistModeLines() - move the modelines that a Monitor section
+ * shares with other sections to a Modes section, which the Monitor
+ * then refers to with "UseModes"; a Modes section that already has the
+ * same modelines is used if there is one.  Returns the number of
+ * Monitor sections changed.
+ */
+
+int xconfigHoistModeLines(XConfigPtr config)
+{
+    XConfigMonitorPtr monitor;
+    XConfigModesPtr modes;
+    XConfigModesLinkPtr link;
+    char name[32];
+    int n = 0, i = 0;
+
+    if (!config) return 0;
+
+    for (monitor = config->monitors; monitor; monitor = monitor->next) {
+
+        if (!monitor->modelines || (monitor->modelines->refcount == 0)) {
+            continue;
+        }
+
+        for (modes = config->modes; modes; modes = modes->next) {
+            if (modes->modelines == monitor->modelines) break;
+        }
+
+        if (!modes) {
+            do {
+                snprintf(name, sizeof(name), "Modes%d", i++);
+            } while (xconfigFindModes(name, config->modes));
+
+            modes = xconfigAlloc(sizeof(XConfigModesRec));
+            modes->identifier = xconfigStrdup(name);
+            modes->modelines = monitor->modelines;
+            modes->modelines->refcount++;
+            xconfigAddListItem((GenericListPtr *)(&config->modes),
+                               (GenericListPtr) modes);
+        }
+
+        for (link = monitor->modes_sections; link; link = link->next) {
+            if (xconfigNameCompare(link->modes_name,
+                                   modes->identifier) == 0) break;
+        }
+
+        if (!link) {
+            link = xconfigAlloc(sizeof(XConfigModesLinkRec));
+            link->modes_name = xconfigStrdup(modes->identifier);
+            link->modes = modes;
+            xconfigAddListItem((GenericListPtr *)(&monitor->modes_sections),
+                               (GenericListPtr) link);
+        }
+
+        xconfigFreeModeLineList(&monitor->modelines);
+        n++;
+    }
+
+    return n;
+
+} /* xconfigHoistModeLines() */
@@ -59,6 +59,8 @@
 
 extern LexRec val;
 
+static XConfigReadHook readHook = NULL;
+
 static XConfigSymTabRec TopLevelTab[] =
 {
     {SECTION, "section"},
@@ -96,13 +98,26 @@ static XConfigSymTabRec TopLevelTab[] =
 
 
 /*
- * xconfigReadConfigFile() - read the open XConfig file, returning the
- * parsed data as XConfigPtr.
+ * xconfigSetReadHook() - set the function to be called around each
+ * section read by xconfigReadConfigFile(); NULL removes it.
  */
 
-XConfigError xconfigReadConfigFile(XConfigPtr *configPtr)
+void xconfigSetReadHook(XConfigReadHook hook)
+{
+    readHook = hook;
+}
+
+
+
+/*
+ * parse_config_file() - read the open XConfig file, returning the
+ * parsed data as XConfigPtr; if 'validate' is set, the name references
+ * in the config are resolved and checked.
+ */
+
+static XConfigError parse_config_file(XConfigPtr *configPtr, int validate)
 {
-    int token;
+    int token, ret;
     XConfigPtr ptr = NULL;
 
     *configPtr = NULL;
@@ -125,6 +140,8 @@ XConfigError xconfigReadConfigFile(XConfigPtr *configPtr)
             }
             
             xconfigSetSection(val.str);
+
+            if (readHook) readHook(val.str, FALSE);
             
             if (xconfigNameCompare(val.str, "files") == 0)
             {
@@ -240,6 +257,8 @@ XConfigError xconfigReadConfigFile(XConfigPtr *configPtr)
                 free(val.str);
                 val.str = NULL;
             }
+
+            if (readHook) readHook(NULL, TRUE);
             break;
             
         default:
@@ -249,7 +268,15 @@ XConfigError xconfigReadConfigFile(XConfigPtr *configPtr)
         }
     }
 
-    if (xconfigValidateConfig(ptr)) {
+    if (validate) {
+        if (readHook) readHook(NULL, FALSE);
+        ret = xconfigValidateConfig(ptr);
+        if (readHook) readHook(NULL, TRUE);
+    } else {
+        ret = TRUE;
+    }
+
+    if (ret) {
         ptr->filename = strdup(xconfigGetConfigFileName());
         *configPtr = ptr;
         return XCONFIG_RETURN_SUCCESS;
@@ -262,6 +289,46 @@ XConfigError xconfigReadConfigFile(XConfigPtr *configPtr)
 #undef CLEANUP
 
 
+/*
+ * read_config_file() - parse the open XConfig file; the modeline lists
+ * of its sections are pooled while it is read, so that identical lists
+ * are shared (see xconfigPoolModeLineList()).
+ */
+
+static XConfigError read_config_file(XConfigPtr *configPtr, int validate)
+{
+    XConfigError ret = parse_config_file(configPtr, validate);
+
+    xconfigClearModeLinePool();
+
+    return ret;
+}
+
+
+/*
+ * xconfigReadConfigFile() - read the open XConfig file, returning the
+ * parsed data as XConfigPtr.
+ */
+
+XConfigError xconfigReadConfigFile(XConfigPtr *configPtr)
+{
+    return read_config_file(configPtr, TRUE);
+}
+
+
+/*
+ * xconfigReadConfigFileLayer() - read the open XConfig file as a layer
+ * to be merged with xconfigMergeConfigList().  A layer may refer to
+ * sections that are defined by the config it is merged into, so its
+ * name references are not validated.
+ */
+
+XConfigError xconfigReadConfigFileLayer(XConfigPtr *configPtr)
+{
+    return read_config_file(configPtr, FALSE);
+}
+
+
 /* 
  * This function resolves name references and reports errors if the named
  * objects cannot be found.
@@ -392,7 +459,7 @@ xconfigFreeConfig (XConfigPtr *p)
     xconfigFreeInputList (&((*p)->inputs));
     xconfigFreeVendorList (&((*p)->vendors));
     xconfigFreeDRI (&((*p)->dri));
-    TEST_FREE((*p)->comment);
+    FREE_COMMENT((*p)->comment);
 
     free (*p);
     *p = NULL;
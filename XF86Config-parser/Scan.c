@@ -93,8 +93,11 @@ static const char **builtinConfig = NULL;
 static int builtinIndex = 0;
 static int configPos = 0;            /* current readers position */
 static char *configBuf, *configRBuf; /* buffer for lines */
+static int configBufLen = 0;         /* allocated size of both buffers */
 static int pushToken = LOCK_TOKEN;
 static int eol_seen = 0;             /* private state to handle comments */
+static char *commentBuf = NULL;      /* comment last grown while parsing */
+static size_t commentLen, commentSize;
 LexRec val;
 
 int configLineNo = 0;         /* linenumber */
@@ -185,55 +188,18 @@ static unsigned int xconfigStrToUL (char *str)
  *
  *  xconfigGetToken() assumes that we will read up to the next
  *  newline; we need to grow configBuf and configRBuf as needed to
- *  support that.
+ *  support that.  The buffers grow geometrically, so a single very
+ *  long line costs linear rather than quadratic time, and they are
+ *  kept at their grown size until the config file is closed, so that
+ *  a file with many long lines doesn't reallocate for each of them.
  */
 
 static char *xconfigGetNextLine(void)
 {
-    static int configBufLen = CONFIG_BUF_LEN;
     char *tmpConfigBuf, *tmpConfigRBuf;
     int c, i, pos = 0, eolFound = 0;
     char *ret = NULL;
     
-    /*
-     * reallocate the string if it was grown last time (i.e., is no
-     * longer CONFIG_BUF_LEN); we malloc the new strings first, so
-     * that if either of the mallocs fail, we can fall back on the
-     * existing buffer allocations
-     */
-    
-    if (configBufLen != CONFIG_BUF_LEN) {
-                 
-        tmpConfigBuf = malloc(CONFIG_BUF_LEN);
-        tmpConfigRBuf = malloc(CONFIG_BUF_LEN);
-        
-        if (!tmpConfigBuf || !tmpConfigRBuf) {
-            
-            /*
-             * at least one of the mallocs failed; keep the old buffers
-             * and free any partial allocations
-             */
-            
-            free(tmpConfigBuf);
-            free(tmpConfigRBuf);
-            
-        } else {
-            
-            /*
-             * malloc succeeded; free the old buffers and use the new
-             * buffers
-             */
-            
-            configBufLen = CONFIG_BUF_LEN;
-            
-            free(configBuf);
-            free(configRBuf);
-            
-            configBuf = tmpConfigBuf;
-            configRBuf = tmpConfigRBuf;
-        }
-    }
-
     /* read in another block of chars */
     
     do {
@@ -261,8 +227,8 @@ static char *xconfigGetNextLine(void)
         
         if (!eolFound) {
             
-            tmpConfigBuf = realloc(configBuf, configBufLen + CONFIG_BUF_LEN);
-            tmpConfigRBuf = realloc(configRBuf, configBufLen + CONFIG_BUF_LEN);
+            tmpConfigBuf = realloc(configBuf, configBufLen * 2);
+            tmpConfigRBuf = realloc(configRBuf, configBufLen * 2);
             
             if (!tmpConfigBuf || !tmpConfigRBuf) {
                 
@@ -286,7 +252,7 @@ static char *xconfigGetNextLine(void)
                 configBuf = tmpConfigBuf;
                 configRBuf = tmpConfigRBuf;
                 pos = i;
-                configBufLen += CONFIG_BUF_LEN;
+                configBufLen *= 2;
             }
         }
         
@@ -421,7 +387,7 @@ again:
             configPos--;        /* GJA -- one too far */
             configRBuf[i] = '\0';
             val.num = xconfigStrToUL (configRBuf);
-            val.realnum = atof (configRBuf);
+            val.realnum = xconfigStrToReal (configRBuf);
             val.str = configRBuf;
             return (NUMBER);
         }
@@ -439,6 +405,7 @@ again:
             while ((c != '\"') && (c != '\n') && (c != '\r') && (c != '\0'));
             configRBuf[i] = '\0';
             val.str = malloc (strlen (configRBuf) + 1);
+            xconfigCountAlloc(strlen (configRBuf) + 1);
             strcpy (val.str, configRBuf);    /* private copy ! */
             return (STRING);
         }
@@ -636,7 +603,8 @@ static int pathIsSafe(const char *path)
 static char *DoSubstitution(const char *template,
                             const char *cmdline,
                             const char *projroot,
-                            int *cmdlineUsed, int *envUsed, char *XConfigFile)
+                            int *cmdlineUsed, int *envUsed,
+                            const char *XConfigFile)
 {
     char *result;
     int i, l;
@@ -826,90 +794,202 @@ static const char __user_configpath[] =
 
 
 
-const char *xconfigOpenConfigFile(const char *cmdline, const char *projroot)
+/*
+ * The search path is compiled into an ordered list of candidate file
+ * names once per (cmdline, projroot, root/user) combination: first
+ * every template substituted with XCONFIGFILE, then every template
+ * substituted with XFREE86CFGFILE, skipping candidates that were
+ * already listed (templates without %X yield the same name twice).
+ * Only the compiled list is remembered: each search still checks the
+ * candidates in order, so that a higher-priority file that appears
+ * later (e.g., xorg.conf next to XF86Config) is found by long-running
+ * processes.
+ */
+
+static struct {
+    int valid;
+    int root;
+    char *cmdline;
+    char *projroot;
+    char **paths;
+    int npaths;
+} searchCache;
+
+static int cacheKeyMatches(const char *a, const char *b)
+{
+    if (!a || !b)
+        return (a == b);
+    return (strcmp(a, b) == 0);
+}
+
+static void freeSearchCache(void)
+{
+    int i;
+
+    for (i = 0; i < searchCache.npaths; i++)
+        free(searchCache.paths[i]);
+    free(searchCache.paths);
+    free(searchCache.cmdline);
+    free(searchCache.projroot);
+    memset(&searchCache, 0, sizeof(searchCache));
+}
+
+static void addSearchCandidate(char *path)
+{
+    int i;
+
+    for (i = 0; i < searchCache.npaths; i++) {
+        if (strcmp(searchCache.paths[i], path) == 0) {
+            free(path);
+            return;
+        }
+    }
+
+    searchCache.paths = realloc(searchCache.paths,
+                                (searchCache.npaths + 1) * sizeof(char *));
+    searchCache.paths[searchCache.npaths++] = path;
+}
+
+static void compileSearchPath(const char *cmdline, const char *projroot,
+                              int root)
 {
     const char *searchpath;
-    char *pathcopy;
-    const char *template;
-    int cmdlineUsed = 0;
+    const char *configFiles[] = { XCONFIGFILE, XFREE86CFGFILE };
+    char *pathcopy, *template, *path;
+    int i, cmdlineUsed = 0;
 
-    configFile = NULL;
-    configPos = 0;        /* current readers position */
-    configLineNo = 0;    /* linenumber */
-    pushToken = LOCK_TOKEN;
+    freeSearchCache();
 
     /*
      * select the search path: XFree86 uses a slightly different path
      * depending on whether the user is root
      */
 
-    if (getuid() == 0) {
-        searchpath = __root_configpath;
-    } else {
-        searchpath = __user_configpath;
-    }
+    searchpath = root ? __root_configpath : __user_configpath;
 
-    if (!projroot) projroot = PROJECTROOT;
-    
     pathcopy = strdup(searchpath);
-    
-    template = strtok(pathcopy, ",");
-
-    /* First, search for a config file. */
-    while (template && !configFile) {
-        if ((configPath = DoSubstitution(template, cmdline, projroot,
-                                         &cmdlineUsed, NULL, XCONFIGFILE))) {
-            if ((configFile = fopen(configPath, "r")) != 0) {
-                if (cmdline && !cmdlineUsed) {
-                    fclose(configFile);
-                    configFile = NULL;
-                }
-            }
-        }
-        if (configPath && !configFile) {
-            free(configPath);
-            configPath = NULL;
-        }
-        template = strtok(NULL, ",");
-    }
 
-    /* Then search for fallback */
-    if (!configFile) {
+    for (i = 0; i < 2; i++) {
         strcpy(pathcopy, searchpath);
-        template = strtok(pathcopy, ",");
-        
-        while (template && !configFile) {
-            if ((configPath = DoSubstitution(template, cmdline, projroot,
-                                             &cmdlineUsed, NULL,
-                                             XFREE86CFGFILE))) {
-                if ((configFile = fopen(configPath, "r")) != 0) {
-                    if (cmdline && !cmdlineUsed) {
-                        fclose(configFile);
-                        configFile = NULL;
-                    }
-                }
-            }
-            if (configPath && !configFile) {
-                free(configPath);
-                configPath = NULL;
+
+        for (template = strtok(pathcopy, ","); template;
+             template = strtok(NULL, ",")) {
+            path = DoSubstitution(template, cmdline, projroot,
+                                  &cmdlineUsed, NULL, configFiles[i]);
+            if (!path)
+                continue;
+
+            /* a command-line file name must be part of the candidate */
+
+            if (cmdline && !cmdlineUsed) {
+                free(path);
+                continue;
             }
-            template = strtok(NULL, ",");
+
+            addSearchCandidate(path);
         }
     }
-    
+
     free(pathcopy);
 
-    if (!configFile) {
+    searchCache.valid = 1;
+    searchCache.root = root;
+    searchCache.cmdline = cmdline ? strdup(cmdline) : NULL;
+    searchCache.projroot = strdup(projroot);
+}
+
+/*
+ * xconfigFindConfigFile() - return the name of the config file that
+ * xconfigOpenConfigFile() would open for the given command-line file
+ * name and project root, without opening it; NULL if none is found.
+ * The returned string is owned by the parser and remains valid until
+ * the next search.
+ */
+
+const char *xconfigFindConfigFile(const char *cmdline, const char *projroot)
+{
+    int i, root = (getuid() == 0);
+
+    if (!projroot) projroot = PROJECTROOT;
+
+    if (!searchCache.valid || searchCache.root != root ||
+        !cacheKeyMatches(searchCache.cmdline, cmdline) ||
+        !cacheKeyMatches(searchCache.projroot, projroot)) {
+        compileSearchPath(cmdline, projroot, root);
+    }
+
+    for (i = 0; i < searchCache.npaths; i++) {
+        if (access(searchCache.paths[i], R_OK) == 0) {
+            return searchCache.paths[i];
+        }
+    }
+
+    return NULL;
+}
+
+const char *xconfigOpenConfigFile(const char *cmdline, const char *projroot)
+{
+    return xconfigOpenConfigFilePath(xconfigFindConfigFile(cmdline,
+                                                           projroot));
+}
+
+/*
+ * Start reading the config from fp, which was opened for path; fp is
+ * closed by xconfigCloseConfigFile().
+ */
+
+static const char *openConfigStream(const char *path, FILE *fp)
+{
+    configFile = NULL;
+    configPos = 0;        /* current readers position */
+    configLineNo = 0;    /* linenumber */
+    pushToken = LOCK_TOKEN;
+
+    if (!fp) {
         return NULL;
     }
 
+    configFile = fp;
+    configPath = strdup(path);
+
     configBuf = malloc(CONFIG_BUF_LEN);
     configRBuf = malloc(CONFIG_BUF_LEN);
+    configBufLen = CONFIG_BUF_LEN;
     configBuf[0] = '\0';
 
     return configPath;
 }
 
+/*
+ * Open the named config file for reading, without searching the config
+ * file search path (e.g., for a config file given as an overlay).
+ */
+
+const char *xconfigOpenConfigFilePath(const char *path)
+{
+    return openConfigStream(path, path ? fopen(path, "r") : NULL);
+}
+
+/*
+ * Open len bytes of buf for reading, as though they were the contents
+ * of the named config file (e.g., to fuzz the parser without creating
+ * files).  buf must remain valid until xconfigCloseConfigFile().
+ */
+
+const char *xconfigOpenConfigBuffer(const char *name, const char *buf,
+                                    size_t len)
+{
+    /* fmemopen(3) may reject an empty buffer; read "" instead */
+
+    if (len == 0) {
+        buf = "";
+        len = 1;
+    }
+
+    return openConfigStream(name, name ? fmemopen((void *) buf, len, "r") :
+                            NULL);
+}
+
 void xconfigCloseConfigFile (void)
 {
     free (configPath);
@@ -918,6 +998,8 @@ void xconfigCloseConfigFile (void)
     configRBuf = NULL;
     free (configBuf);
     configBuf = NULL;
+    configBufLen = 0;
+    commentBuf = NULL;
 
     if (configFile) {
         fclose (configFile);
@@ -950,23 +1032,46 @@ xconfigSetSection (char *section)
  */
 
 
+/*
+ * xconfigAddComment --
+ *  Append the comment line 'add' to the comment string 'cur', returning
+ *  the (possibly reallocated) comment string.
+ *
+ *  While a config file is being read, the length and allocated size of
+ *  the comment most recently appended to are remembered, and comments
+ *  grow geometrically, so that a section with many comment lines (e.g.,
+ *  hundreds of "# Removed Option" lines accumulated over many runs of
+ *  nvidia-xconfig) is built in linear rather than quadratic time.  The
+ *  remembered comment is forgotten when the config file is closed or the
+ *  comment is freed with xconfigFreeComment(), so that a new string
+ *  allocated at the same address is never mistaken for it; outside of
+ *  parsing, the comment length is always recomputed.
+ */
+
 char *
 xconfigAddComment(char *cur, char *add)
 {
     char *str;
-    int len, curlen, iscomment, hasnewline = 0, endnewline;
+    size_t len, curlen, size, needed;
+    int iscomment, hasnewline = 0, endnewline, leadnewline;
 
     if (add == NULL || add[0] == '\0')
         return (cur);
 
     if (cur) {
-        curlen = strlen(cur);
+        if (cur == commentBuf && cur[commentLen] == '\0') {
+            curlen = commentLen;
+            size = commentSize;
+        } else {
+            curlen = strlen(cur);
+            size = curlen + 1;
+        }
         if (curlen)
             hasnewline = cur[curlen - 1] == '\n';
         eol_seen = 0;
     }
     else
-        curlen = 0;
+        curlen = size = 0;
 
     str = add;
     iscomment = 0;
@@ -979,24 +1084,55 @@ xconfigAddComment(char *cur, char *add)
 
     len = strlen(add);
     endnewline = add[len - 1] == '\n';
-    len +=  1 + iscomment + (!hasnewline) + (!endnewline) + eol_seen;
-
-    if ((str = realloc(cur, len + curlen)) == NULL)
-        return (cur);
-
-    cur = str;
+    leadnewline = eol_seen || (curlen && !hasnewline);
+
+    needed = curlen + leadnewline + (!iscomment) + len + (!endnewline) + 1;
+
+    if (needed > size) {
+        if (size * 2 > needed)
+            needed = size * 2;
+        if ((str = realloc(cur, needed)) == NULL)
+            return (cur);
+        xconfigCountAlloc(needed);
+        cur = str;
+        size = needed;
+    }
 
-    if (eol_seen || (curlen && !hasnewline))
+    if (leadnewline)
         cur[curlen++] = '\n';
     if (!iscomment)
         cur[curlen++] = '#';
-    strcpy(cur + curlen, add);
+    memcpy(cur + curlen, add, len);
+    curlen += len;
     if (!endnewline)
-        strcat(cur, "\n");
+        cur[curlen++] = '\n';
+    cur[curlen] = '\0';
+
+    if (configFile) {
+        commentBuf = cur;
+        commentLen = curlen;
+        commentSize = size;
+    }
 
     return (cur);
 }
 
+/*
+ * xconfigFreeComment --
+ *  Free a comment string built by xconfigAddComment(), forgetting it if
+ *  it is the comment most recently appended to.
+ */
+
+void
+xconfigFreeComment(char *comment)
+{
+    if (comment == NULL)
+        return;
+    if (comment == commentBuf)
+        commentBuf = NULL;
+    free(comment);
+}
+
 int
 xconfigGetStringToken (XConfigSymTabRec * tab)
 {
@@ -1007,16 +1143,21 @@ static int
 StringToToken (char *str, XConfigSymTabRec * tab)
 {
     int i;
+    unsigned int key = xconfigNameHash (str);
 
     for (i = 0; tab[i].token != -1; i++)
     {
-        if (!xconfigNameCompare (tab[i].name, str))
+        if (tab[i].key == 0)
+            tab[i].key = xconfigNameHash (tab[i].name);
+        if (!xconfigNameKeyCompare (tab[i].name, tab[i].key, str, key))
             return tab[i].token;
     }
     return (ERROR_TOKEN);
 }
 
 
+#define NAME_SKIP(c) (((c) == '_') || ((c) == ' ') || ((c) == '\t'))
+
 /* 
  * Compare two names.  The characters '_', ' ', and '\t' are ignored
  * in the comparison.
@@ -1033,9 +1174,19 @@ xconfigNameCompare (const char *s1, const char *s2)
             return (1);
         }
 
-    while (*s1 == '_' || *s1 == ' ' || *s1 == '\t')
+    /*
+     * fast path: skip the common prefix of the raw strings; names are
+     * usually spelled identically, so this avoids normalizing them
+     */
+
+    while (*s1 && *s1 == *s2 && !NAME_SKIP(*s1)) {
         s1++;
-    while (*s2 == '_' || *s2 == ' ' || *s2 == '\t')
+        s2++;
+    }
+
+    while (NAME_SKIP(*s1))
+        s1++;
+    while (NAME_SKIP(*s2))
         s2++;
     c1 = (xconfigIsUpper(*s1) ? xconfigToLower(*s1) : *s1);
     c2 = (xconfigIsUpper(*s2) ? xconfigToLower(*s2) : *s2);
@@ -1045,9 +1196,9 @@ xconfigNameCompare (const char *s1, const char *s2)
             return (0);
         s1++;
         s2++;
-        while (*s1 == '_' || *s1 == ' ' || *s1 == '\t')
+        while (NAME_SKIP(*s1))
             s1++;
-        while (*s2 == '_' || *s2 == ' ' || *s2 == '\t')
+        while (NAME_SKIP(*s2))
             s2++;
         c1 = (xconfigIsUpper(*s1) ? xconfigToLower(*s1) : *s1);
         c2 = (xconfigIsUpper(*s2) ? xconfigToLower(*s2) : *s2);
@@ -1055,9 +1206,92 @@ xconfigNameCompare (const char *s1, const char *s2)
     return (c1 - c2);
 }
 
+/*
+ * Compute a hash of the normalized form of a name: the characters
+ * '_', ' ' and '\t' are ignored and case is folded, so names that
+ * xconfigNameCompare() considers equal always hash to the same key.
+ */
+unsigned int
+xconfigNameHash (const char *s)
+{
+    unsigned int h = 2166136261u;
+
+    if (!s)
+        return h;
+
+    for (; *s; s++) {
+        if (NAME_SKIP(*s))
+            continue;
+        h ^= (unsigned char) (xconfigIsUpper(*s) ? xconfigToLower(*s) : *s);
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/*
+ * Compare two names whose xconfigNameHash() keys are already known;
+ * names with different keys are rejected without looking at the
+ * strings.  Returns 0 if the names are equal.
+ */
+int
+xconfigNameKeyCompare (const char *s1, unsigned int key1,
+                       const char *s2, unsigned int key2)
+{
+    if (key1 != key2)
+        return (1);
+    if (s1 == s2)
+        return (0);
+    return xconfigNameCompare (s1, s2);
+}
+
+/*
+ * Compute the hash key of a modeline's timings (the clock string, the
+ * timing numbers, and the flags); modelines that compare equal with
+ * xconfigModelineCompare() have the same key.  The key of a parsed
+ * modeline is computed when it is parsed, and stored in the modeline.
+ */
+unsigned int
+xconfigModelineKey(XConfigModeLinePtr m)
+{
+    unsigned int h = 2166136261u;
+    const char *s;
+    int timings[11], i;
+
+    if (m->key)
+        return (m->key);
+
+    for (s = m->clock; s && *s; s++)
+    {
+        h ^= (unsigned char) *s;
+        h *= 16777619u;
+    }
+
+    timings[0] = m->hdisplay;
+    timings[1] = m->hsyncstart;
+    timings[2] = m->hsyncend;
+    timings[3] = m->htotal;
+    timings[4] = m->vdisplay;
+    timings[5] = m->vsyncstart;
+    timings[6] = m->vsyncend;
+    timings[7] = m->vtotal;
+    timings[8] = m->vscan;
+    timings[9] = m->flags;
+    timings[10] = m->hskew;
+
+    for (i = 0; i < 11; i++)
+    {
+        h ^= (unsigned int) timings[i];
+        h *= 16777619u;
+    }
+
+    /* 0 means "not computed" */
+    return (h ? h : 1);
+}
+
 /* 
  * Compare two modelines.  The modeline identifiers and comments are
- * ignored in the comparison.
+ * ignored in the comparison.  Modelines with different keys differ,
+ * so most unequal modelines are told apart without comparing fields.
  */
 int
 xconfigModelineCompare(XConfigModeLinePtr m1, XConfigModeLinePtr m2)
@@ -1068,17 +1302,21 @@ xconfigModelineCompare(XConfigModeLinePtr m1, XConfigModeLinePtr m2)
     if (!m1 || !m2)
         return (1);
 
-    if (m1->clock      != m2->clock &&
-        m1->hdisplay   != m2->hdisplay &&
-        m1->hsyncstart != m2->hsyncstart &&
-        m1->hsyncend   != m2->hsyncend &&
-        m1->htotal     != m2->htotal &&
-        m1->vdisplay   != m2->vdisplay &&
-        m1->vsyncstart != m2->vsyncstart &&
-        m1->vsyncend   != m2->vsyncend &&
-        m1->vtotal     != m2->vtotal &&
-        m1->vscan      != m2->vscan &&
-        m1->flags      != m2->flags &&
+    if (xconfigModelineKey(m1) != xconfigModelineKey(m2))
+        return (1);
+
+    if ((m1->clock != m2->clock &&
+         (!m1->clock || !m2->clock || strcmp(m1->clock, m2->clock) != 0)) ||
+        m1->hdisplay   != m2->hdisplay ||
+        m1->hsyncstart != m2->hsyncstart ||
+        m1->hsyncend   != m2->hsyncend ||
+        m1->htotal     != m2->htotal ||
+        m1->vdisplay   != m2->vdisplay ||
+        m1->vsyncstart != m2->vsyncstart ||
+        m1->vsyncend   != m2->vsyncend ||
+        m1->vtotal     != m2->vtotal ||
+        m1->vscan      != m2->vscan ||
+        m1->flags      != m2->flags ||
         m1->hskew      != m2->hskew)
         return (1);
     return (0);
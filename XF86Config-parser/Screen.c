@@ -432,7 +432,7 @@ xconfigFreeScreenList (XConfigScreenPtr *ptr)
         TEST_FREE ((*ptr)->identifier);
         TEST_FREE ((*ptr)->monitor_name);
         TEST_FREE ((*ptr)->device_name);
-        TEST_FREE ((*ptr)->comment);
+        FREE_COMMENT ((*ptr)->comment);
         xconfigFreeOptionList (&((*ptr)->options));
         xconfigFreeAdaptorLinkList (&((*ptr)->adaptors));
         xconfigFreeDisplayList (&((*ptr)->displays));
@@ -467,6 +467,14 @@ xconfigFreeDisplayList (XConfigDisplayPtr *ptr)
     if (ptr == NULL || *ptr == NULL)
         return;
 
+    /* a shared list is only released by its last owner */
+
+    if ((*ptr)->refcount > 0) {
+        (*ptr)->refcount--;
+        *ptr = NULL;
+        return;
+    }
+
     while (*ptr)
     {
         xconfigFreeModeList (&((*ptr)->modes));
@@ -669,6 +677,77 @@ xconfigAddMode(XConfigModePtr *pHead, const char *name)
 }
 
 
+/*
+ * xconfigDisplayListDup() - create a duplicate of the specified
+ * display subsection list, including the option and mode lists.
+ */
+
+XConfigDisplayPtr
+xconfigDisplayListDup(XConfigDisplayPtr display)
+{
+    XConfigDisplayPtr d, prev = NULL, head = NULL;
+    XConfigModePtr mode, *pMode;
+
+    for (; display; display = display->next) {
+        d = xconfigAlloc(sizeof(XConfigDisplayRec));
+        memcpy(d, display, sizeof(XConfigDisplayRec));
+        d->visual = xconfigStrdup(display->visual);
+        d->comment = xconfigStrdup(display->comment);
+        d->options = xconfigOptionListDup(display->options);
+        d->refcount = 0;
+        d->next = NULL;
+
+        /* preserve the order of the mode list */
+
+        d->modes = NULL;
+        pMode = &d->modes;
+        for (mode = display->modes; mode; mode = mode->next) {
+            *pMode = xconfigAlloc(sizeof(XConfigModeRec));
+            (*pMode)->mode_name = xconfigStrdup(mode->mode_name);
+            pMode = &(*pMode)->next;
+        }
+
+        if (prev) prev->next = d;
+        if (!head) head = d;
+        prev = d;
+    }
+
+    return head;
+}
+
+
+/*
+ * xconfigDisplayListRef() - share the display subsection list (and
+ * the option and mode lists it owns) with another owner.  A shared
+ * list must be unshared with xconfigDisplayListUnshare() before it,
+ * or anything hanging off of it, is modified.
+ */
+
+XConfigDisplayPtr
+xconfigDisplayListRef(XConfigDisplayPtr display)
+{
+    if (display)
+        display->refcount++;
+    return display;
+}
+
+
+/*
+ * xconfigDisplayListUnshare() - give the caller a private copy of the
+ * display subsection list, if the list is currently shared.
+ */
+
+void
+xconfigDisplayListUnshare(XConfigDisplayPtr *display)
+{
+    if (display == NULL || *display == NULL || (*display)->refcount == 0)
+        return;
+
+    (*display)->refcount--;
+    *display = xconfigDisplayListDup(*display);
+}
+
+
 void
 xconfigRemoveMode(XConfigModePtr *pHead, const char *name)
 {
@@ -0,0 +1,1044 @@
+/*
+ * nvidia-xconfig: A tool for manipulating X config files,
+ * specifically for use by the NVIDIA Linux graphics driver.
+ *
+ * Copyright (C) 2005 NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>.
+ *
+ *
+ * Snapshot.c - save a parsed and validated X config as a binary
+ * snapshot, and load it back without reading the X config text.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "xf86Parser.h"
+#include "Configint.h"
+
+
+/*
+ * A snapshot is a copy of the X config tree, as a graph of nodes: each
+ * node is the raw bytes of one record of the tree (an XConfigRec, a
+ * section, an option, a modeline, ...), with every pointer in it
+ * replaced by a reference.  A reference is 0 for NULL, (index + 1) << 1
+ * for a node, or ((offset + 1) << 1) | 1 for a string in the string
+ * table.  Since pointers to sections (e.g., XConfigScreenRec.monitor)
+ * are references like any other, the resolved references of the
+ * validated config are kept, and lists shared by several owners (see
+ * the 'refcount' fields) are stored once.  The file is laid out as
+ *
+ *     SnapshotHeaderRec
+ *     SnapshotNodeRec[num_nodes]    (node 0 is the XConfigRec)
+ *     node data                     (each node aligned to 8 bytes)
+ *     string table
+ *
+ * The records are stored in the layout of the running program, so a
+ * snapshot is only loaded by a build with the same record layout; the
+ * header records a hash of the layout to check this.  The hash covers
+ * the size of each record and the offset of each pointer in it, but
+ * not the other fields, so it also covers the NVIDIA_VERSION of the
+ * build and SNAPSHOT_VERSION, which must be bumped whenever a record
+ * changes.  The header also
+ * records the size and hash of the X config text the snapshot was made
+ * from, so that a stale snapshot is not used.
+ */
+
+#define SNAPSHOT_MAGIC   "NVXCSNAP"
+#define SNAPSHOT_VERSION 2
+
+/* the Makefile defines NVIDIA_VERSION when building this file */
+
+#ifndef NVIDIA_VERSION
+#define NVIDIA_VERSION ""
+#endif
+
+typedef struct {
+    char     magic[8];
+    uint32_t version;
+    uint32_t layout;        /* snapshot_layout_hash() */
+    uint64_t source_size;   /* size of the X config text */
+    uint64_t source_hash;   /* snapshot_hash() of the X config text */
+    uint64_t payload_hash;  /* snapshot_hash() of the rest of the file */
+    uint32_t num_nodes;
+    uint32_t pad;
+    uint64_t data_size;
+    uint64_t strings_size;
+} SnapshotHeaderRec;
+
+typedef struct {
+    uint32_t type;
+    uint32_t offset;        /* of the node's bytes in the node data */
+} SnapshotNodeRec;
+
+#define SNAPSHOT_ALIGN(n) (((n) + 7) & ~((size_t) 7))
+
+#define SNAPSHOT_REF_NODE(i)     ((uintptr_t) ((i) + 1) << 1)
+#define SNAPSHOT_REF_STRING(off) (((uintptr_t) ((off) + 1) << 1) | 1)
+
+
+/*
+ * Node types, and the pointer fields of each record; a field's kind is
+ * the node type it points to, or one of the string kinds.  Interned
+ * strings (see xconfigInternString()) are interned again when loaded.
+ */
+
+enum {
+    SNAP_CONFIG = 0,
+    SNAP_FILES,
+    SNAP_MODULE,
+    SNAP_LOAD,
+    SNAP_OPTION,
+    SNAP_FLAGS,
+    SNAP_VIDEOADAPTOR,
+    SNAP_VIDEOPORT,
+    SNAP_MODES,
+    SNAP_MODELINE,
+    SNAP_MODESLINK,
+    SNAP_MONITOR,
+    SNAP_DEVICE,
+    SNAP_MODE,
+    SNAP_DISPLAY,
+    SNAP_ADAPTORLINK,
+    SNAP_SCREEN,
+    SNAP_INPUT,
+    SNAP_INPUTCLASS,
+    SNAP_INPUTREF,
+    SNAP_ADJACENCY,
+    SNAP_INACTIVE,
+    SNAP_LAYOUT,
+    SNAP_VENDSUB,
+    SNAP_VENDOR,
+    SNAP_BUFFERS,
+    SNAP_DRI,
+    SNAP_EXTENSIONS,
+    SNAP_NUM_TYPES
+};
+
+#define SNAP_STRING   (-1)
+#define SNAP_INTERNED (-2)
+
+typedef struct {
+    size_t offset;
+    int kind;
+} SnapshotFieldRec;
+
+typedef struct {
+    size_t size;
+    const SnapshotFieldRec *fields;
+    int num_fields;
+} SnapshotTypeRec;
+
+#define FIELD(rec, field, kind) { offsetof(rec, field), kind }
+#define STRING(rec, field)      { offsetof(rec, field), SNAP_STRING }
+
+static const SnapshotFieldRec ConfigFields[] = {
+    FIELD(XConfigRec, files, SNAP_FILES),
+    FIELD(XConfigRec, modules, SNAP_MODULE),
+    FIELD(XConfigRec, flags, SNAP_FLAGS),
+    FIELD(XConfigRec, videoadaptors, SNAP_VIDEOADAPTOR),
+    FIELD(XConfigRec, modes, SNAP_MODES),
+    FIELD(XConfigRec, monitors, SNAP_MONITOR),
+    FIELD(XConfigRec, devices, SNAP_DEVICE),
+    FIELD(XConfigRec, screens, SNAP_SCREEN),
+    FIELD(XConfigRec, inputs, SNAP_INPUT),
+    FIELD(XConfigRec, inputclasses, SNAP_INPUTCLASS),
+    FIELD(XConfigRec, layouts, SNAP_LAYOUT),
+    FIELD(XConfigRec, vendors, SNAP_VENDOR),
+    FIELD(XConfigRec, dri, SNAP_DRI),
+    FIELD(XConfigRec, extensions, SNAP_EXTENSIONS),
+    STRING(XConfigRec, comment),
+    STRING(XConfigRec, filename),
+};
+
+static const SnapshotFieldRec FilesFields[] = {
+    STRING(XConfigFilesRec, logfile),
+    STRING(XConfigFilesRec, rgbpath),
+    STRING(XConfigFilesRec, modulepath),
+    STRING(XConfigFilesRec, inputdevs),
+    STRING(XConfigFilesRec, fontpath),
+    STRING(XConfigFilesRec, comment),
+};
+
+static const SnapshotFieldRec ModuleFields[] = {
+    FIELD(XConfigModuleRec, loads, SNAP_LOAD),
+    FIELD(XConfigModuleRec, disables, SNAP_LOAD),
+    STRING(XConfigModuleRec, comment),
+};
+
+static const SnapshotFieldRec LoadFields[] = {
+    FIELD(XConfigLoadRec, next, SNAP_LOAD),
+    STRING(XConfigLoadRec, name),
+    FIELD(XConfigLoadRec, opt, SNAP_OPTION),
+    STRING(XConfigLoadRec, comment),
+};
+
+static const SnapshotFieldRec OptionFields[] = {
+    FIELD(XConfigOptionRec, next, SNAP_OPTION),
+    FIELD(XConfigOptionRec, name, SNAP_INTERNED),
+    STRING(XConfigOptionRec, val),
+    STRING(XConfigOptionRec, comment),
+};
+
+static const SnapshotFieldRec FlagsFields[] = {
+    FIELD(XConfigFlagsRec, options, SNAP_OPTION),
+    STRING(XConfigFlagsRec, comment),
+};
+
+static const SnapshotFieldRec VideoAdaptorFields[] = {
+    FIELD(XConfigVideoAdaptorRec, next, SNAP_VIDEOADAPTOR),
+    STRING(XConfigVideoAdaptorRec, identifier),
+    STRING(XConfigVideoAdaptorRec, vendor),
+    STRING(XConfigVideoAdaptorRec, board),
+    STRING(XConfigVideoAdaptorRec, busid),
+    STRING(XConfigVideoAdaptorRec, driver),
+    FIELD(XConfigVideoAdaptorRec, options, SNAP_OPTION),
+    FIELD(XConfigVideoAdaptorRec, ports, SNAP_VIDEOPORT),
+    STRING(XConfigVideoAdaptorRec, fwdref),
+    STRING(XConfigVideoAdaptorRec, comment),
+};
+
+static const SnapshotFieldRec VideoPortFields[] = {
+    FIELD(XConfigVideoPortRec, next, SNAP_VIDEOPORT),
+    STRING(XConfigVideoPortRec, identifier),
+    FIELD(XConfigVideoPortRec, options, SNAP_OPTION),
+    STRING(XConfigVideoPortRec, comment),
+};
+
+static const SnapshotFieldRec ModesFields[] = {
+    FIELD(XConfigModesRec, next, SNAP_MODES),
+    STRING(XConfigModesRec, identifier),
+    FIELD(XConfigModesRec, modelines, SNAP_MODELINE),
+    STRING(XConfigModesRec, comment),
+};
+
+static const SnapshotFieldRec ModeLineFields[] = {
+    FIELD(XConfigModeLineRec, next, SNAP_MODELINE),
+    STRING(XConfigModeLineRec, identifier),
+    FIELD(XConfigModeLineRec, clock, SNAP_INTERNED),
+    STRING(XConfigModeLineRec, comment),
+};
+
+static const SnapshotFieldRec ModesLinkFields[] = {
+    FIELD(XConfigModesLinkRec, next, SNAP_MODESLINK),
+    STRING(XConfigModesLinkRec, modes_name),
+    FIELD(XConfigModesLinkRec, modes, SNAP_MODES),
+};
+
+static const SnapshotFieldRec MonitorFields[] = {
+    FIELD(XConfigMonitorRec, next, SNAP_MONITOR),
+    STRING(XConfigMonitorRec, identifier),
+    STRING(XConfigMonitorRec, vendor),
+    STRING(XConfigMonitorRec, modelname),
+    FIELD(XConfigMonitorRec, modelines, SNAP_MODELINE),
+    FIELD(XConfigMonitorRec, options, SNAP_OPTION),
+    FIELD(XConfigMonitorRec, modes_sections, SNAP_MODESLINK),
+    STRING(XConfigMonitorRec, comment),
+};
+
+static const SnapshotFieldRec DeviceFields[] = {
+    FIELD(XConfigDeviceRec, next, SNAP_DEVICE),
+    STRING(XConfigDeviceRec, identifier),
+    STRING(XConfigDeviceRec, vendor),
+    STRING(XConfigDeviceRec, board),
+    STRING(XConfigDeviceRec, chipset),
+    STRING(XConfigDeviceRec, busid),
+    STRING(XConfigDeviceRec, card),
+    STRING(XConfigDeviceRec, driver),
+    STRING(XConfigDeviceRec, ramdac),
+    STRING(XConfigDeviceRec, clockchip),
+    FIELD(XConfigDeviceRec, options, SNAP_OPTION),
+    STRING(XConfigDeviceRec, comment),
+};
+
+static const SnapshotFieldRec ModeFields[] = {
+    FIELD(XConfigModeRec, next, SNAP_MODE),
+    STRING(XConfigModeRec, mode_name),
+};
+
+static const SnapshotFieldRec DisplayFields[] = {
+    FIELD(XConfigDisplayRec, next, SNAP_DISPLAY),
+    STRING(XConfigDisplayRec, visual),
+    FIELD(XConfigDisplayRec, modes, SNAP_MODE),
+    FIELD(XConfigDisplayRec, options, SNAP_OPTION),
+    STRING(XConfigDisplayRec, comment),
+};
+
+static const SnapshotFieldRec AdaptorLinkFields[] = {
+    FIELD(XConfigAdaptorLinkRec, next, SNAP_ADAPTORLINK),
+    STRING(XConfigAdaptorLinkRec, adaptor_name),
+    FIELD(XConfigAdaptorLinkRec, adaptor, SNAP_VIDEOADAPTOR),
+};
+
+static const SnapshotFieldRec ScreenFields[] = {
+    FIELD(XConfigScreenRec, next, SNAP_SCREEN),
+    STRING(XConfigScreenRec, identifier),
+    STRING(XConfigScreenRec, obsolete_driver),
+    STRING(XConfigScreenRec, monitor_name),
+    FIELD(XConfigScreenRec, monitor, SNAP_MONITOR),
+    STRING(XConfigScreenRec, device_name),
+    FIELD(XConfigScreenRec, device, SNAP_DEVICE),
+    FIELD(XConfigScreenRec, adaptors, SNAP_ADAPTORLINK),
+    FIELD(XConfigScreenRec, displays, SNAP_DISPLAY),
+    FIELD(XConfigScreenRec, options, SNAP_OPTION),
+    STRING(XConfigScreenRec, comment),
+};
+
+static const SnapshotFieldRec InputFields[] = {
+    FIELD(XConfigInputRec, next, SNAP_INPUT),
+    STRING(XConfigInputRec, identifier),
+    STRING(XConfigInputRec, driver),
+    FIELD(XConfigInputRec, options, SNAP_OPTION),
+    STRING(XConfigInputRec, comment),
+};
+
+static const SnapshotFieldRec InputClassFields[] = {
+    FIELD(XConfigInputClassRec, next, SNAP_INPUTCLASS),
+    STRING(XConfigInputClassRec, identifier),
+    STRING(XConfigInputClassRec, driver),
+    STRING(XConfigInputClassRec, match_is_pointer),
+    STRING(XConfigInputClassRec, match_is_touchpad),
+    STRING(XConfigInputClassRec, match_is_touchscreen),
+    STRING(XConfigInputClassRec, match_is_keyboard),
+    STRING(XConfigInputClassRec, match_is_joystick),
+    STRING(XConfigInputClassRec, match_is_tablet),
+    STRING(XConfigInputClassRec, match_tag),
+    STRING(XConfigInputClassRec, match_device_path),
+    STRING(XConfigInputClassRec, match_os),
+    STRING(XConfigInputClassRec, match_usb_id),
+    STRING(XConfigInputClassRec, match_pnp_id),
+    STRING(XConfigInputClassRec, match_product),
+    STRING(XConfigInputClassRec, match_driver),
+    STRING(XConfigInputClassRec, match_vendor),
+    FIELD(XConfigInputClassRec, options, SNAP_OPTION),
+    STRING(XConfigInputClassRec, comment),
+};
+
+static const SnapshotFieldRec InputrefFields[] = {
+    FIELD(XConfigInputrefRec, next, SNAP_INPUTREF),
+    FIELD(XConfigInputrefRec, input, SNAP_INPUT),
+    STRING(XConfigInputrefRec, input_name),
+    FIELD(XConfigInputrefRec, options, SNAP_OPTION),
+};
+
+static const SnapshotFieldRec AdjacencyFields[] = {
+    FIELD(XConfigAdjacencyRec, next, SNAP_ADJACENCY),
+    FIELD(XConfigAdjacencyRec, screen, SNAP_SCREEN),
+    STRING(XConfigAdjacencyRec, screen_name),
+    FIELD(XConfigAdjacencyRec, top, SNAP_SCREEN),
+    STRING(XConfigAdjacencyRec, top_name),
+    FIELD(XConfigAdjacencyRec, bottom, SNAP_SCREEN),
+    STRING(XConfigAdjacencyRec, bottom_name),
+    FIELD(XConfigAdjacencyRec, left, SNAP_SCREEN),
+    STRING(XConfigAdjacencyRec, left_name),
+    FIELD(XConfigAdjacencyRec, right, SNAP_SCREEN),
+    STRING(XConfigAdjacencyRec, right_name),
+    STRING(XConfigAdjacencyRec, refscreen),
+};
+
+static const SnapshotFieldRec InactiveFields[] = {
+    FIELD(XConfigInactiveRec, next, SNAP_INACTIVE),
+    STRING(XConfigInactiveRec, device_name),
+    FIELD(XConfigInactiveRec, device, SNAP_DEVICE),
+};
+
+static const SnapshotFieldRec LayoutFields[] = {
+    FIELD(XConfigLayoutRec, next, SNAP_LAYOUT),
+    STRING(XConfigLayoutRec, identifier),
+    FIELD(XConfigLayoutRec, adjacencies, SNAP_ADJACENCY),
+    FIELD(XConfigLayoutRec, inactives, SNAP_INACTIVE),
+    FIELD(XConfigLayoutRec, inputs, SNAP_INPUTREF),
+    FIELD(XConfigLayoutRec, options, SNAP_OPTION),
+    STRING(XConfigLayoutRec, comment),
+};
+
+static const SnapshotFieldRec VendSubFields[] = {
+    FIELD(XConfigVendSubRec, next, SNAP_VENDSUB),
+    STRING(XConfigVendSubRec, name),
+    STRING(XConfigVendSubRec, identifier),
+    FIELD(XConfigVendSubRec, options, SNAP_OPTION),
+    STRING(XConfigVendSubRec, comment),
+};
+
+static const SnapshotFieldRec VendorFields[] = {
+    FIELD(XConfigVendorRec, next, SNAP_VENDOR),
+    STRING(XConfigVendorRec, identifier),
+    FIELD(XConfigVendorRec, options, SNAP_OPTION),
+    FIELD(XConfigVendorRec, subs, SNAP_VENDSUB),
+    STRING(XConfigVendorRec, comment),
+};
+
+static const SnapshotFieldRec BuffersFields[] = {
+    FIELD(XConfigBuffersRec, next, SNAP_BUFFERS),
+    STRING(XConfigBuffersRec, flags),
+    STRING(XConfigBuffersRec, comment),
+};
+
+static const SnapshotFieldRec DRIFields[] = {
+    STRING(XConfigDRIRec, group_name),
+    FIELD(XConfigDRIRec, buffers, SNAP_BUFFERS),
+    STRING(XConfigDRIRec, comment),
+};
+
+static const SnapshotFieldRec ExtensionsFields[] = {
+    FIELD(XConfigExtensionsRec, options, SNAP_OPTION),
+    STRING(XConfigExtensionsRec, comment),
+};
+
+#define TYPE(rec, fields) \
+    { sizeof(rec), fields, sizeof(fields) / sizeof(fields[0]) }
+
+static const SnapshotTypeRec SnapshotTypes[SNAP_NUM_TYPES] = {
+    TYPE(XConfigRec, ConfigFields),
+    TYPE(XConfigFilesRec, FilesFields),
+    TYPE(XConfigModuleRec, ModuleFields),
+    TYPE(XConfigLoadRec, LoadFields),
+    TYPE(XConfigOptionRec, OptionFields),
+    TYPE(XConfigFlagsRec, FlagsFields),
+    TYPE(XConfigVideoAdaptorRec, VideoAdaptorFields),
+    TYPE(XConfigVideoPortRec, VideoPortFields),
+    TYPE(XConfigModesRec, ModesFields),
+    TYPE(XConfigModeLineRec, ModeLineFields),
+    TYPE(XConfigModesLinkRec, ModesLinkFields),
+    TYPE(XConfigMonitorRec, MonitorFields),
+    TYPE(XConfigDeviceRec, DeviceFields),
+    TYPE(XConfigModeRec, ModeFields),
+    TYPE(XConfigDisplayRec, DisplayFields),
+    TYPE(XConfigAdaptorLinkRec, AdaptorLinkFields),
+    TYPE(XConfigScreenRec, ScreenFields),
+    TYPE(XConfigInputRec, InputFields),
+    TYPE(XConfigInputClassRec, InputClassFields),
+    TYPE(XConfigInputrefRec, InputrefFields),
+    TYPE(XConfigAdjacencyRec, AdjacencyFields),
+    TYPE(XConfigInactiveRec, InactiveFields),
+    TYPE(XConfigLayoutRec, LayoutFields),
+    TYPE(XConfigVendSubRec, VendSubFields),
+    TYPE(XConfigVendorRec, VendorFields),
+    TYPE(XConfigBuffersRec, BuffersFields),
+    TYPE(XConfigDRIRec, DRIFields),
+    TYPE(XConfigExtensionsRec, ExtensionsFields),
+};
+
+#undef FIELD
+#undef STRING
+#undef TYPE
+
+
+
+/*
+ * snapshot_hash() - 64 bit FNV-1a hash of len bytes, continuing from h
+ */
+
+#define SNAPSHOT_HASH_INIT 14695981039346656037ULL
+
+static uint64_t snapshot_hash(uint64_t h, const void *buf, size_t len)
+{
+    const unsigned char *p = buf;
+
+    while (len--) {
+        h ^= *p++;
+        h *= 1099511628211ULL;
+    }
+
+    return h;
+
+} /* snapshot_hash() */
+
+
+
+/*
+ * snapshot_layout_hash() - hash the record layout described by
+ * SnapshotTypes, with the pointer size and byte order, the build's
+ * NVIDIA_VERSION, and SNAPSHOT_VERSION
+ */
+
+static uint32_t snapshot_layout_hash(void)
+{
+    uint64_t h = SNAPSHOT_HASH_INIT;
+    const uint32_t order = 0x01020304;
+    uint64_t v;
+    int i, j;
+
+    v = sizeof(void *);
+    h = snapshot_hash(h, &v, sizeof(v));
+    h = snapshot_hash(h, &order, sizeof(order));
+    h = snapshot_hash(h, NVIDIA_VERSION, strlen(NVIDIA_VERSION));
+    v = SNAPSHOT_VERSION;
+    h = snapshot_hash(h, &v, sizeof(v));
+
+    for (i = 0; i < SNAP_NUM_TYPES; i++) {
+        v = SnapshotTypes[i].size;
+        h = snapshot_hash(h, &v, sizeof(v));
+        for (j = 0; j < SnapshotTypes[i].num_fields; j++) {
+            v = ((uint64_t) SnapshotTypes[i].fields[j].offset << 8) |
+                (uint8_t) SnapshotTypes[i].fields[j].kind;
+            h = snapshot_hash(h, &v, sizeof(v));
+        }
+    }
+
+    return (uint32_t) (h ^ (h >> 32));
+
+} /* snapshot_layout_hash() */
+
+
+
+/*
+ * snapshot_hash_file() - compute the size and hash of the named file;
+ * returns FALSE if the file cannot be read.
+ */
+
+static int snapshot_hash_file(const char *filename, uint64_t *size,
+                              uint64_t *hash)
+{
+    char buf[8192];
+    ssize_t len;
+    int fd;
+
+    fd = open(filename, O_RDONLY);
+    if (fd == -1) return FALSE;
+
+    *size = 0;
+    *hash = SNAPSHOT_HASH_INIT;
+
+    while ((len = read(fd, buf, sizeof(buf))) != 0) {
+        if (len < 0) {
+            if (errno == EINTR) continue;
+            close(fd);
+            return FALSE;
+        }
+        *hash = snapshot_hash(*hash, buf, len);
+        *size += len;
+    }
+
+    close(fd);
+
+    return TRUE;
+
+} /* snapshot_hash_file() */
+
+
+
+
+
+
+/*
+ * Writing a snapshot
+ */
+
+typedef struct {
+    const void *ptr;
+    uintptr_t ref;
+} SnapshotMapEntry;
+
+typedef struct {
+    const void *ptr;
+    int type;
+    size_t offset;
+} SnapshotPendingRec;
+
+typedef struct {
+    /* pointer -> reference, open addressed */
+    SnapshotMapEntry *map;
+    size_t map_size;
+    size_t map_count;
+
+    /* nodes, in the order they are found */
+    SnapshotPendingRec *nodes;
+    size_t num_nodes;
+    size_t max_nodes;
+
+    char *data;
+    size_t data_size;
+    size_t max_data;
+
+    char *strings;
+    size_t strings_size;
+    size_t max_strings;
+} SnapshotWriterRec, *SnapshotWriterPtr;
+
+
+
+/*
+ * snapshot_grow() - make room for 'need' bytes in the buffer pointed
+ * to by pbuf, whose size is *max
+ */
+
+static void snapshot_grow(void *pbuf, size_t *max, size_t need)
+{
+    void **buf = pbuf;
+    size_t n = *max ? *max : 256;
+    void *tmp;
+
+    if (need <= *max) return;
+
+    while (n < need) n *= 2;
+
+    tmp = realloc(*buf, n);
+    if (!tmp) {
+        fprintf(stderr, "memory allocation failure (%s)! \n",
+                strerror(errno));
+        exit(1);
+    }
+
+    *buf = tmp;
+    *max = n;
+
+} /* snapshot_grow() */
+
+
+
+/*
+ * snapshot_map_slot() - return the slot of ptr in the map, or the empty
+ * slot where it would go
+ */
+
+static size_t snapshot_map_slot(SnapshotWriterPtr w, const void *ptr)
+{
+    size_t mask = w->map_size - 1;
+    size_t i = (((uintptr_t) ptr >> 3) * 2654435761u) & mask;
+
+    while (w->map[i].ptr && (w->map[i].ptr != ptr)) {
+        i = (i + 1) & mask;
+    }
+
+    return i;
+
+} /* snapshot_map_slot() */
+
+
+
+/*
+ * snapshot_map_add() - record the reference for ptr, doubling the map
+ * when it is half full
+ */
+
+static void snapshot_map_add(SnapshotWriterPtr w, const void *ptr,
+                             uintptr_t ref)
+{
+    SnapshotMapEntry *old = w->map;
+    size_t i, old_size = w->map_size;
+
+    if (2 * (w->map_count + 1) > w->map_size) {
+        w->map_size = old_size ? old_size * 2 : 256;
+        w->map = xconfigAlloc(w->map_size * sizeof(SnapshotMapEntry));
+        for (i = 0; i < old_size; i++) {
+            if (old[i].ptr) {
+                w->map[snapshot_map_slot(w, old[i].ptr)] = old[i];
+            }
+        }
+        free(old);
+    }
+
+    i = snapshot_map_slot(w, ptr);
+    w->map[i].ptr = ptr;
+    w->map[i].ref = ref;
+    w->map_count++;
+
+} /* snapshot_map_add() */
+
+
+
+/*
+ * snapshot_ref() - return the reference for a pointer field of the
+ * given kind; a node not seen before is queued to be copied, and a
+ * string not seen before is added to the string table.
+ */
+
+static uintptr_t snapshot_ref(SnapshotWriterPtr w, const void *ptr, int kind)
+{
+    uintptr_t ref;
+    size_t i, len;
+
+    if (!ptr) return 0;
+
+    if (w->map_size) {
+        i = snapshot_map_slot(w, ptr);
+        if (w->map[i].ptr) return w->map[i].ref;
+    }
+
+    if (kind < 0) {
+        len = strlen(ptr) + 1;
+        snapshot_grow(&w->strings, &w->max_strings, w->strings_size + len);
+        memcpy(w->strings + w->strings_size, ptr, len);
+        ref = SNAPSHOT_REF_STRING(w->strings_size);
+        w->strings_size += len;
+    } else {
+        snapshot_grow(&w->nodes, &w->max_nodes,
+                      (w->num_nodes + 1) * sizeof(SnapshotPendingRec));
+        w->nodes[w->num_nodes].ptr = ptr;
+        w->nodes[w->num_nodes].type = kind;
+        ref = SNAPSHOT_REF_NODE(w->num_nodes);
+        w->num_nodes++;
+    }
+
+    snapshot_map_add(w, ptr, ref);
+
+    return ref;
+
+} /* snapshot_ref() */
+
+
+
+/*
+ * snapshot_build() - copy the config graph into the writer's node
+ * data and string table; nodes are copied in the order they are found,
+ * so that following long lists needs no recursion.
+ */
+
+static void snapshot_build(SnapshotWriterPtr w, XConfigPtr config)
+{
+    const SnapshotTypeRec *type;
+    const SnapshotFieldRec *field;
+    size_t n, offset;
+    uintptr_t ref;
+    void *ptr;
+    int i;
+
+    snapshot_ref(w, config, SNAP_CONFIG);
+
+    for (n = 0; n < w->num_nodes; n++) {
+
+        type = &SnapshotTypes[w->nodes[n].type];
+
+        offset = SNAPSHOT_ALIGN(w->data_size);
+        snapshot_grow(&w->data, &w->max_data, offset + type->size);
+        memset(w->data + w->data_size, 0, offset - w->data_size);
+        memcpy(w->data + offset, w->nodes[n].ptr, type->size);
+        w->data_size = offset + type->size;
+        w->nodes[n].offset = offset;
+
+        for (i = 0; i < type->num_fields; i++) {
+            field = &type->fields[i];
+            memcpy(&ptr, w->data + offset + field->offset, sizeof(ptr));
+            ref = snapshot_ref(w, ptr, field->kind);
+            memcpy(w->data + offset + field->offset, &ref, sizeof(ref));
+        }
+    }
+
+} /* snapshot_build() */
+
+
+
+/*
+ * xconfigWriteSnapshot() - write a snapshot of the config, which was
+ * read from the X config file 'source', to filename.  Returns TRUE on
+ * success.
+ */
+
+int xconfigWriteSnapshot(const char *filename, XConfigPtr config,
+                         const char *source)
+{
+    SnapshotWriterRec w;
+    SnapshotHeaderRec header;
+    SnapshotNodeRec *node;
+    size_t len, nodes_size, data_size, n;
+    char *buf, *p;
+    int ret;
+
+    if (!config) return FALSE;
+
+    memset(&header, 0, sizeof(header));
+
+    if (!snapshot_hash_file(source, &header.source_size,
+                            &header.source_hash)) {
+        xconfigErrorMsg(WriteErrorMsg, "Unable to read \"%s\" (%s).\n",
+                        source, strerror(errno));
+        return FALSE;
+    }
+
+    memset(&w, 0, sizeof(w));
+    snapshot_build(&w, config);
+
+    nodes_size = w.num_nodes * sizeof(SnapshotNodeRec);
+    data_size = SNAPSHOT_ALIGN(w.data_size);
+
+    if ((w.num_nodes > UINT32_MAX) || (data_size > UINT32_MAX)) {
+        xconfigErrorMsg(WriteErrorMsg, "The X configuration is too large "
+                        "for a snapshot.\n");
+        ret = FALSE;
+        goto done;
+    }
+
+    len = sizeof(header) + nodes_size + data_size + w.strings_size;
+    buf = xconfigAlloc(len);
+
+    node = (SnapshotNodeRec *) (buf + sizeof(header));
+    for (n = 0; n < w.num_nodes; n++) {
+        node[n].type = w.nodes[n].type;
+        node[n].offset = w.nodes[n].offset;
+    }
+
+    p = buf + sizeof(header) + nodes_size;
+    if (w.data_size) memcpy(p, w.data, w.data_size);
+    p += data_size;
+    if (w.strings_size) memcpy(p, w.strings, w.strings_size);
+
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.layout = snapshot_layout_hash();
+    header.num_nodes = w.num_nodes;
+    header.data_size = data_size;
+    header.strings_size = w.strings_size;
+    header.payload_hash = snapshot_hash(SNAPSHOT_HASH_INIT,
+                                        buf + sizeof(header),
+                                        len - sizeof(header));
+    memcpy(buf, &header, sizeof(header));
+
+    ret = xconfigReplaceFile(filename, buf, len);
+
+    free(buf);
+
+ done:
+    free(w.map);
+    free(w.nodes);
+    free(w.data);
+    free(w.strings);
+
+    return ret;
+
+} /* xconfigWriteSnapshot() */
+
+
+
+/*
+ * Loading a snapshot
+ */
+
+typedef struct {
+    const SnapshotNodeRec *nodes;
+    uint32_t num_nodes;
+    const char *data;
+    uint64_t data_size;
+    const char *strings;
+    uint64_t strings_size;
+} SnapshotImageRec, *SnapshotImagePtr;
+
+
+
+/*
+ * snapshot_check() - check that every node lies within the node data,
+ * and that every reference is to a node of the right type or to a
+ * string in the string table, so that the config can be built from
+ * the image without further checks.
+ */
+
+static int snapshot_check(SnapshotImagePtr image)
+{
+    const SnapshotTypeRec *type;
+    const SnapshotFieldRec *field;
+    uintptr_t ref, index;
+    uint32_t n;
+    int i;
+
+    if ((image->num_nodes == 0) || (image->nodes[0].type != SNAP_CONFIG)) {
+        return FALSE;
+    }
+
+    /* every string in the table is terminated */
+
+    if (image->strings_size &&
+        (image->strings[image->strings_size - 1] != '\0')) {
+        return FALSE;
+    }
+
+    for (n = 0; n < image->num_nodes; n++) {
+
+        if (image->nodes[n].type >= SNAP_NUM_TYPES) return FALSE;
+
+        type = &SnapshotTypes[image->nodes[n].type];
+
+        if ((image->nodes[n].offset != SNAPSHOT_ALIGN(image->nodes[n].offset)) ||
+            (image->nodes[n].offset + type->size > image->data_size)) {
+            return FALSE;
+        }
+
+        for (i = 0; i < type->num_fields; i++) {
+            field = &type->fields[i];
+            memcpy(&ref, image->data + image->nodes[n].offset + field->offset,
+                   sizeof(ref));
+
+            if (ref == 0) continue;
+
+            index = (ref >> 1) - 1;
+
+            if (ref & 1) {
+                if ((field->kind >= 0) || (index >= image->strings_size)) {
+                    return FALSE;
+                }
+            } else {
+                if ((field->kind < 0) || (index >= image->num_nodes) ||
+                    (image->nodes[index].type != field->kind)) {
+                    return FALSE;
+                }
+            }
+        }
+    }
+
+    return TRUE;
+
+} /* snapshot_check() */
+
+
+
+/*
+ * snapshot_load() - build the config from a checked image: each node is
+ * copied to its own allocation, since the config is freed (and edited)
+ * record by record, and the references in it are replaced by pointers.
+ */
+
+static XConfigPtr snapshot_load(SnapshotImagePtr image)
+{
+    const SnapshotTypeRec *type;
+    const SnapshotFieldRec *field;
+    XConfigPtr config;
+    uintptr_t ref, index;
+    void **ptrs, *ptr;
+    uint32_t n;
+    int i;
+
+    ptrs = xconfigAlloc(image->num_nodes * sizeof(void *));
+
+    for (n = 0; n < image->num_nodes; n++) {
+        type = &SnapshotTypes[image->nodes[n].type];
+        ptrs[n] = xconfigAlloc(type->size);
+        memcpy(ptrs[n], image->data + image->nodes[n].offset, type->size);
+    }
+
+    for (n = 0; n < image->num_nodes; n++) {
+        type = &SnapshotTypes[image->nodes[n].type];
+
+        for (i = 0; i < type->num_fields; i++) {
+            field = &type->fields[i];
+            memcpy(&ref, (char *) ptrs[n] + field->offset, sizeof(ref));
+
+            index = (ref >> 1) - 1;
+
+            if (ref == 0) {
+                ptr = NULL;
+            } else if (!(ref & 1)) {
+                ptr = ptrs[index];
+            } else if (field->kind == SNAP_INTERNED) {
+                ptr = xconfigInternString(image->strings + index);
+            } else {
+                ptr = xconfigStrdup(image->strings + index);
+            }
+
+            memcpy((char *) ptrs[n] + field->offset, &ptr, sizeof(ptr));
+        }
+    }
+
+    config = ptrs[0];
+    free(ptrs);
+
+    return config;
+
+} /* snapshot_load() */
+
+
+
+/*
+ * xconfigReadSnapshot() - load the config from the snapshot filename,
+ * if the snapshot was made from the current contents of the X config
+ * file 'source'.  The snapshot file is mapped, and the config is built
+ * from it without reading the X config text.  Returns TRUE on success;
+ * on failure (e.g., there is no snapshot, or it is stale), the config
+ * should be read from the X config file instead.
+ */
+
+int xconfigReadSnapshot(const char *filename, const char *source,
+                        XConfigPtr *configPtr)
+{
+    SnapshotHeaderRec header;
+    SnapshotImageRec image;
+    struct stat st;
+    uint64_t source_size, source_hash, nodes_size;
+    char *map;
+    int fd, ret = FALSE;
+
+    *configPtr = NULL;
+
+    fd = open(filename, O_RDONLY);
+    if (fd == -1) return FALSE;
+
+    if ((fstat(fd, &st) != 0) || ((size_t) st.st_size < sizeof(header))) {
+        close(fd);
+        return FALSE;
+    }
+
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (map == MAP_FAILED) return FALSE;
+
+    memcpy(&header, map, sizeof(header));
+
+    if ((memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0) ||
+        (header.version != SNAPSHOT_VERSION) ||
+        (header.layout != snapshot_layout_hash())) {
+        goto done;
+    }
+
+    /* check the sizes before the hashes, so no hash reads past the end */
+
+    nodes_size = (uint64_t) header.num_nodes * sizeof(SnapshotNodeRec);
+
+    if ((header.data_size > (uint64_t) st.st_size) ||
+        (header.strings_size > (uint64_t) st.st_size) ||
+        (sizeof(header) + nodes_size + header.data_size +
+         header.strings_size != (uint64_t) st.st_size)) {
+        goto done;
+    }
+
+    if (header.payload_hash !=
+        snapshot_hash(SNAPSHOT_HASH_INIT, map + sizeof(header),
+                      st.st_size - sizeof(header))) {
+        goto done;
+    }
+
+    if (!snapshot_hash_file(source, &source_size, &source_hash) ||
+        (source_size != header.source_size) ||
+        (source_hash != header.source_hash)) {
+        goto done;
+    }
+
+    image.nodes = (const SnapshotNodeRec *) (map + sizeof(header));
+    image.num_nodes = header.num_nodes;
+    image.data = map + sizeof(header) + nodes_size;
+    image.data_size = header.data_size;
+    image.strings = image.data + header.data_size;
+    image.strings_size = header.strings_size;
+
+    if (!snapshot_check(&image)) goto done;
+
+    *configPtr = snapshot_load(&image);
+
+    /* the config is named after the file it was read from */
+
+    free((*configPtr)->filename);
+    (*configPtr)->filename = xconfigStrdup(source);
+
+    ret = TRUE;
+
+ done:
+    munmap(map, st.st_size);
+
+    return ret;
+
+} /* xconfigReadSnapshot() */
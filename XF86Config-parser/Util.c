@@ -24,10 +24,18 @@
 #include <errno.h>
 #include <string.h>
 #include <stdio.h>
+#include <math.h>
 
 #include "xf86Parser.h"
 #include "Configint.h"
 
+/* allocations made through the wrappers below; see xconfigGetAllocStats() */
+
+static struct {
+    unsigned long long count;
+    unsigned long long bytes;
+} allocStats;
+
 void *xconfigAlloc(size_t size)
 {
     void *m = malloc(size);
@@ -37,6 +45,8 @@ void *xconfigAlloc(size_t size)
         exit(1);
     }
     memset((char *) m, 0, size);
+    allocStats.count++;
+    allocStats.bytes += size;
     return m;
     
 } /* xconfigAlloc() */
@@ -61,11 +71,42 @@ char *xconfigStrdup(const char *s)
                 strerror(errno));
         exit(1);
     }
+    allocStats.count++;
+    allocStats.bytes += strlen(m) + 1;
     return m;
     
 } /* xconfigStrdup() */
 
 
+/*
+ * xconfigCountAlloc() - count an allocation of 'size' bytes made
+ * directly with malloc(3) and friends, e.g., by PARSE_PROLOGUE
+ */
+
+void xconfigCountAlloc(size_t size)
+{
+    allocStats.count++;
+    allocStats.bytes += size;
+
+} /* xconfigCountAlloc() */
+
+
+/*
+ * xconfigGetAllocStats() - return the number of allocations made
+ * through xconfigAlloc() and xconfigStrdup() (and the helpers built on
+ * them), or counted with xconfigCountAlloc() (section records, token
+ * strings and comments), and their total size in bytes; memory freed
+ * since is not subtracted.
+ */
+
+void xconfigGetAllocStats(unsigned long long *count, unsigned long long *bytes)
+{
+    *count = allocStats.count;
+    *bytes = allocStats.bytes;
+
+} /* xconfigGetAllocStats() */
+
+
 /*
  * xconfigStrcat() - allocate a new string, copying all given strings
  * into it.  taken from glib
@@ -106,6 +147,351 @@ char *xconfigStrcat(const char *str, ...)
 
 
 
+/*
+ * Locale-independent number formatting and parsing: the X config
+ * file always uses '.' as the decimal separator, regardless of the
+ * locale in effect, so real numbers are never passed through the
+ * locale-sensitive printf("%f") or strtod() family.
+ */
+
+static const double pow10_table[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+    1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+    1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+#define POW10_TABLE_LEN (sizeof(pow10_table) / sizeof(pow10_table[0]))
+
+
+/*
+ * scale_by_pow10() - return v * 10^exp; powers of ten up to 10^22 are
+ * exact in a double, so for those the result is correctly rounded.
+ */
+
+static double scale_by_pow10(double v, int exp)
+{
+    while (exp >= (int) POW10_TABLE_LEN) {
+        v *= pow10_table[POW10_TABLE_LEN - 1];
+        exp -= POW10_TABLE_LEN - 1;
+    }
+    while (exp <= -(int) POW10_TABLE_LEN) {
+        v /= pow10_table[POW10_TABLE_LEN - 1];
+        exp += POW10_TABLE_LEN - 1;
+    }
+
+    return (exp >= 0) ? v * pow10_table[exp] : v / pow10_table[-exp];
+
+} /* scale_by_pow10() */
+
+
+/*
+ * xconfigStrToReal() - parse a number as scanned from the config file:
+ * either a hexadecimal integer ("0x...") or decimal digits with an
+ * optional fractional part.  Parsing stops at the first character
+ * that does not fit.
+ */
+
+double xconfigStrToReal(const char *s)
+{
+    unsigned long long mant = 0;
+    int exp = 0, d;
+
+    if (!s) return 0.0;
+
+    if ((s[0] == '0') && ((s[1] == 'x') || (s[1] == 'X'))) {
+        double v = 0.0;
+        for (s += 2; *s; s++) {
+            if ((*s >= '0') && (*s <= '9')) d = *s - '0';
+            else if ((*s >= 'a') && (*s <= 'f')) d = *s - 'a' + 10;
+            else if ((*s >= 'A') && (*s <= 'F')) d = *s - 'A' + 10;
+            else break;
+            v = v * 16.0 + d;
+        }
+        return v;
+    }
+
+    /*
+     * accumulate up to 18 significant digits exactly in an integer;
+     * further digits only affect the exponent
+     */
+
+    for (; (*s >= '0') && (*s <= '9'); s++) {
+        if (mant < 100000000000000000ULL) {
+            mant = mant * 10 + (*s - '0');
+        } else {
+            exp++;
+        }
+    }
+
+    if (*s == '.') {
+        for (s++; (*s >= '0') && (*s <= '9'); s++) {
+            if (mant < 100000000000000000ULL) {
+                mant = mant * 10 + (*s - '0');
+                exp--;
+            }
+        }
+    }
+
+    return scale_by_pow10((double) mant, exp);
+
+} /* xconfigStrToReal() */
+
+
+/*
+ * xconfigFormatReal() - format v into buf in fixed notation with the
+ * given number of fractional digits, like printf("%.*f") in the "C"
+ * locale.  Returns buf.
+ */
+
+char *xconfigFormatReal(char *buf, int len, double v, int digits)
+{
+    unsigned long long n, scale, ipart, fpart;
+    double scaled, frac, err;
+    int neg, i;
+
+    neg = (v < 0.0);
+    if (neg) v = -v;
+
+    /* the scaled value must fit in an unsigned long long */
+    if (digits < 0) digits = 0;
+    if (digits > 17) digits = 17;
+
+    for (scale = 1, i = 0; i < digits; i++) scale *= 10;
+
+    scaled = scale_by_pow10(v, digits);
+
+    if (!(scaled < 1e18)) {
+        /* out of the integer range (or not finite); "%.0f" has no
+         * decimal separator, so it is locale-independent */
+        snprintf(buf, len, "%s%.0f", neg ? "-" : "", v);
+        return buf;
+    }
+
+    /*
+     * round half to even, as printf does.  The product above is itself
+     * rounded, so the decision uses its exact rounding error: the
+     * fractional part of the true product is (frac + err).
+     */
+
+    err = fma(v, pow10_table[digits], -scaled);
+    n = (unsigned long long) scaled;
+    frac = (scaled - (double) n) - 0.5;
+    if ((frac + err > 0.0) || ((frac + err == 0.0) && (n & 1))) n++;
+
+    ipart = n / scale;
+    fpart = n % scale;
+
+    if (digits > 0) {
+        snprintf(buf, len, "%s%llu.%0*llu", neg ? "-" : "",
+                 ipart, digits, fpart);
+    } else {
+        snprintf(buf, len, "%s%llu", neg ? "-" : "", ipart);
+    }
+
+    return buf;
+
+} /* xconfigFormatReal() */
+
+
+/*
+ * xconfigFormatRealShort() - format v into buf with at most 'sig'
+ * significant digits and no trailing zeros, like printf("%.*g") in
+ * the "C" locale, except that fixed notation is always used: the
+ * scanner does not accept exponents.  Returns buf.
+ */
+
+char *xconfigFormatRealShort(char *buf, int len, double v, int sig)
+{
+    int exp, digits;
+    char *p;
+
+    if (v == 0.0) {
+        snprintf(buf, len, "0");
+        return buf;
+    }
+
+    exp = (int) floor(log10(fabs(v)));
+    digits = sig - 1 - exp;
+    if (digits < 0) digits = 0;
+
+    xconfigFormatReal(buf, len, v, digits);
+
+    if (strchr(buf, '.')) {
+        p = buf + strlen(buf) - 1;
+        while (*p == '0') *p-- = '\0';
+        if (*p == '.') *p = '\0';
+    }
+
+    return buf;
+
+} /* xconfigFormatRealShort() */
+
+
+
+/*
+ * String intern pool: strings that are repeated many times throughout
+ * the XConfig object graph (e.g., option names) are stored once and
+ * shared.  Each pooled string is reference counted; callers obtain a
+ * string with xconfigInternString() and give it back with
+ * xconfigReleaseString() rather than free().  Interned strings must
+ * not be modified.  The pool also records each string's normalized
+ * name key, so that name lookups need not renormalize stored names.
+ */
+
+typedef struct __intern_rec {
+    struct __intern_rec *next;
+    unsigned int hash;
+    unsigned int key;
+    int refcount;
+    char str[1];
+} InternRec, *InternPtr;
+
+#define INTERN_MIN_BUCKETS 64
+
+static InternPtr *internBuckets = NULL;
+static unsigned int internNumBuckets = 0;
+static unsigned int internNumEntries = 0;
+
+#define INTERN_REC(s) \
+    ((InternPtr) ((char *) (s) - offsetof(InternRec, str)))
+
+
+/*
+ * intern_hash() - FNV-1a hash of the string
+ */
+
+static unsigned int intern_hash(const char *s)
+{
+    unsigned int h = 2166136261u;
+
+    while (*s) {
+        h ^= (unsigned char) *s++;
+        h *= 16777619u;
+    }
+
+    return h;
+
+} /* intern_hash() */
+
+
+/*
+ * intern_grow() - double the number of hash buckets, rehashing the
+ * existing entries
+ */
+
+static void intern_grow(void)
+{
+    unsigned int i, n;
+    InternPtr *buckets, p, next;
+
+    n = internNumBuckets ? internNumBuckets * 2 : INTERN_MIN_BUCKETS;
+    buckets = xconfigAlloc(n * sizeof(InternPtr));
+
+    for (i = 0; i < internNumBuckets; i++) {
+        for (p = internBuckets[i]; p; p = next) {
+            next = p->next;
+            p->next = buckets[p->hash & (n - 1)];
+            buckets[p->hash & (n - 1)] = p;
+        }
+    }
+
+    free(internBuckets);
+    internBuckets = buckets;
+    internNumBuckets = n;
+
+} /* intern_grow() */
+
+
+/*
+ * xconfigInternString() - return the pooled copy of the given string,
+ * adding it to the pool if needed.  Equal strings returned by this
+ * function are the same pointer.
+ */
+
+char *xconfigInternString(const char *s)
+{
+    unsigned int h;
+    size_t len;
+    InternPtr p;
+
+    if (!s) return NULL;
+
+    h = intern_hash(s);
+
+    if (internNumBuckets) {
+        for (p = internBuckets[h & (internNumBuckets - 1)]; p; p = p->next) {
+            if ((p->hash == h) && (strcmp(p->str, s) == 0)) {
+                p->refcount++;
+                return p->str;
+            }
+        }
+    }
+
+    if (internNumEntries >= internNumBuckets) {
+        intern_grow();
+    }
+
+    len = strlen(s);
+    p = xconfigAlloc(offsetof(InternRec, str) + len + 1);
+    memcpy(p->str, s, len + 1);
+    p->hash = h;
+    p->key = xconfigNameHash(s);
+    p->refcount = 1;
+
+    p->next = internBuckets[h & (internNumBuckets - 1)];
+    internBuckets[h & (internNumBuckets - 1)] = p;
+    internNumEntries++;
+
+    return p->str;
+
+} /* xconfigInternString() */
+
+
+/*
+ * xconfigInternKey() - return the xconfigNameHash() key of a string
+ * returned by xconfigInternString(); the key is computed once, when
+ * the string is added to the pool.
+ */
+
+unsigned int xconfigInternKey(const char *s)
+{
+    if (!s) return xconfigNameHash(NULL);
+
+    return INTERN_REC(s)->key;
+
+} /* xconfigInternKey() */
+
+
+/*
+ * xconfigReleaseString() - drop a reference to a string returned by
+ * xconfigInternString(); the string is freed with its last reference.
+ */
+
+void xconfigReleaseString(char *s)
+{
+    InternPtr p, *pp;
+
+    if (!s) return;
+
+    p = INTERN_REC(s);
+
+    if (--p->refcount > 0) return;
+
+    for (pp = &internBuckets[p->hash & (internNumBuckets - 1)]; *pp;
+         pp = &(*pp)->next) {
+        if (*pp == p) {
+            *pp = p->next;
+            internNumEntries--;
+            break;
+        }
+    }
+
+    free(p);
+
+} /* xconfigReleaseString() */
+
+
+
 
 
 
@@ -210,7 +210,7 @@ xconfigFreeVendorList (XConfigVendorPtr *p)
 
     xconfigFreeVendorSubList (&((*p)->subs));
     TEST_FREE ((*p)->identifier);
-    TEST_FREE ((*p)->comment);
+    FREE_COMMENT ((*p)->comment);
     xconfigFreeOptionList (&((*p)->options));
     free (*p);
     *p = NULL;
@@ -228,7 +228,7 @@ xconfigFreeVendorSubList (XConfigVendSubPtr *ptr)
     {
         TEST_FREE ((*ptr)->identifier);
         TEST_FREE ((*ptr)->name);
-        TEST_FREE ((*ptr)->comment);
+        FREE_COMMENT ((*ptr)->comment);
         xconfigFreeOptionList (&((*ptr)->options));
         prev = *ptr;
         *ptr = (*ptr)->next;
@@ -248,7 +248,7 @@ xconfigFreeVideoAdaptorList (XConfigVideoAdaptorPtr *ptr)
         TEST_FREE ((*ptr)->busid);
         TEST_FREE ((*ptr)->driver);
         TEST_FREE ((*ptr)->fwdref);
-        TEST_FREE ((*ptr)->comment);
+        FREE_COMMENT ((*ptr)->comment);
         xconfigFreeVideoPortList (&((*ptr)->ports));
         xconfigFreeOptionList (&((*ptr)->options));
         prev = *ptr;
@@ -268,7 +268,7 @@ xconfigFreeVideoPortList (XConfigVideoPortPtr *ptr)
     while (*ptr)
     {
         TEST_FREE ((*ptr)->identifier);
-        TEST_FREE ((*ptr)->comment);
+        FREE_COMMENT ((*ptr)->comment);
         xconfigFreeOptionList (&((*ptr)->options));
         prev = *ptr;
         *ptr = (*ptr)->next;
@@ -59,40 +59,22 @@
 #include "xf86tokens.h"
 #include "Configint.h"
 
+#include <stdlib.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <sys/types.h>
+#include <sys/stat.h>
 #include <sys/wait.h>
 #include <signal.h>
 #include <errno.h>
-#include <locale.h>
 
 
-int xconfigWriteConfigFile (const char *filename, XConfigPtr cptr)
-{
-    FILE *cf;
-    char *locale;
-    
-    if ((cf = fopen(filename, "w")) == NULL)
-    {
-        xconfigErrorMsg(WriteErrorMsg, "Unable to open the file \"%s\" for "
-                     "writing (%s).\n", filename, strerror(errno));
-        return FALSE;
-    }
-
-    /*
-     * read the current locale and then set the standard "C" locale,
-     * so that the X configuration writer does not use locale-specific
-     * formatting.  After writing the configuration file, we restore
-     * the original locale.
-     */
-
-    locale = setlocale(LC_ALL, NULL);
-    
-    if (locale) locale = strdup(locale);
+/*
+ * print_config() - print every section of the config to the given stream
+ */
 
-    setlocale(LC_ALL, "C");
-    
-    
+static void print_config(FILE *cf, XConfigPtr cptr)
+{
     if (cptr->comment)
         fprintf (cf, "%s\n", cptr->comment);
 
@@ -132,14 +114,217 @@ int xconfigWriteConfigFile (const char *filename, XConfigPtr cptr)
 
     xconfigPrintExtensionsSection (cf, cptr->extensions);
 
-    fclose(cf);
+} /* print_config() */
+
 
-    /* restore the original locale */
 
-    if (locale) {
-        setlocale(LC_ALL, locale);
-        free(locale);
+/*
+ * xconfigWriteConfigBuffer() - render the config into a newly
+ * allocated, NUL-terminated buffer; the length of the rendered text
+ * is returned in len.  Returns NULL on failure.  The caller should
+ * free the buffer.
+ */
+
+char *xconfigWriteConfigBuffer(XConfigPtr cptr, size_t *len)
+{
+    FILE *cf;
+    char *buf = NULL;
+
+    *len = 0;
+
+    if ((cf = open_memstream(&buf, len)) == NULL)
+    {
+        xconfigErrorMsg(WriteErrorMsg, "Unable to allocate a buffer for "
+                     "the X configuration (%s).\n", strerror(errno));
+        return NULL;
+    }
+
+    /*
+     * real numbers are formatted with xconfigFormatReal(), and nothing
+     * else the printers emit depends on the locale, so there is no
+     * need to switch to the "C" locale here
+     */
+
+    print_config(cf, cptr);
+
+    if (fclose(cf) != 0) {
+        xconfigErrorMsg(WriteErrorMsg, "Unable to render the X "
+                     "configuration (%s).\n", strerror(errno));
+        free(buf);
+        return NULL;
+    }
+
+    return buf;
+}
+
+
+
+/*
+ * write_buffer() - write all of buf to fd, retrying short writes
+ */
+
+static int write_buffer(int fd, const char *buf, size_t len)
+{
+    ssize_t ret;
+
+    while (len > 0) {
+        ret = write(fd, buf, len);
+        if (ret < 0) {
+            if (errno == EINTR) continue;
+            return FALSE;
+        }
+        buf += ret;
+        len -= ret;
     }
 
     return TRUE;
 }
+
+
+
+/*
+ * write_in_place() - truncate and rewrite filename with buf
+ */
+
+static int write_in_place(const char *filename, const char *buf, size_t len)
+{
+    int fd;
+
+    fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd == -1) {
+        xconfigErrorMsg(WriteErrorMsg, "Unable to open the file \"%s\" for "
+                     "writing (%s).\n", filename, strerror(errno));
+        return FALSE;
+    }
+
+    if (!write_buffer(fd, buf, len)) {
+        xconfigErrorMsg(WriteErrorMsg, "Unable to write the file \"%s\" "
+                     "(%s).\n", filename, strerror(errno));
+        close(fd);
+        return FALSE;
+    }
+
+    if (close(fd) != 0) {
+        xconfigErrorMsg(WriteErrorMsg, "Unable to write the file \"%s\" "
+                     "(%s).\n", filename, strerror(errno));
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+
+
+/*
+ * xconfigReplaceFile() - write buf to filename.  The data is written
+ * to a temporary file in the same directory, which is then renamed
+ * over filename, so that a failed write never leaves a truncated file
+ * behind.  Files that are not regular files (e.g., /dev/stdout), and
+ * files whose directory is not writable, are rewritten in place
+ * instead.
+ */
+
+int xconfigReplaceFile(const char *filename, const char *buf, size_t len)
+{
+    char *target = NULL, *tmpname = NULL;
+    struct stat st;
+    mode_t mask;
+    int fd, exists, ret = FALSE;
+
+    /* replace the file a symlink points to, rather than the symlink */
+
+    target = realpath(filename, NULL);
+
+    if (target) {
+        exists = (stat(target, &st) == 0);
+        if (exists && !S_ISREG(st.st_mode)) {
+            ret = write_in_place(filename, buf, len);
+            goto done;
+        }
+    } else if ((errno == ENOENT) && (lstat(filename, &st) != 0)) {
+        target = xconfigStrdup(filename);
+        exists = FALSE;
+    } else {
+        ret = write_in_place(filename, buf, len);
+        goto done;
+    }
+
+    tmpname = xconfigStrcat(target, ".XXXXXX", NULL);
+
+    fd = mkstemp(tmpname);
+
+    if (fd == -1) {
+        ret = write_in_place(filename, buf, len);
+        goto done;
+    }
+
+    /*
+     * give the new file the permissions of the file it replaces, or
+     * the permissions fopen() would have used for a new file
+     */
+
+    if (exists) {
+        fchmod(fd, st.st_mode & 07777);
+        if (fchown(fd, st.st_uid, st.st_gid) != 0) {
+            /* not fatal: the file is then owned by the caller */
+        }
+    } else {
+        mask = umask(0);
+        umask(mask);
+        fchmod(fd, 0666 & ~mask);
+    }
+
+    if (!write_buffer(fd, buf, len) || (fsync(fd) != 0)) {
+        xconfigErrorMsg(WriteErrorMsg, "Unable to write the file \"%s\" "
+                     "(%s).\n", tmpname, strerror(errno));
+        close(fd);
+        unlink(tmpname);
+        goto done;
+    }
+
+    if (close(fd) != 0) {
+        xconfigErrorMsg(WriteErrorMsg, "Unable to write the file \"%s\" "
+                     "(%s).\n", tmpname, strerror(errno));
+        unlink(tmpname);
+        goto done;
+    }
+
+    if (rename(tmpname, target) != 0) {
+        xconfigErrorMsg(WriteErrorMsg, "Unable to rename \"%s\" to \"%s\" "
+                     "(%s).\n", tmpname, target, strerror(errno));
+        unlink(tmpname);
+        goto done;
+    }
+
+    ret = TRUE;
+
+ done:
+    free(tmpname);
+    free(target);
+
+    return ret;
+}
+
+
+
+/*
+ * xconfigWriteConfigFile() - write the config to filename; the config
+ * is rendered in memory, and the file is replaced with
+ * xconfigReplaceFile().
+ */
+
+int xconfigWriteConfigFile (const char *filename, XConfigPtr cptr)
+{
+    char *buf;
+    size_t len;
+    int ret;
+
+    buf = xconfigWriteConfigBuffer(cptr, &len);
+    if (!buf) return FALSE;
+
+    ret = xconfigReplaceFile(filename, buf, len);
+
+    free(buf);
+
+    return ret;
+}
@@ -73,6 +73,8 @@ XConfigModesPtr xconfigParseModesSection(void);
 void xconfigPrintMonitorSection(FILE *cf, XConfigMonitorPtr ptr);
 void xconfigPrintModesSection(FILE *cf, XConfigModesPtr ptr);
 int xconfigValidateMonitor(XConfigPtr p, XConfigScreenPtr screen);
+XConfigModeLinePtr xconfigPoolModeLineList(XConfigModeLinePtr modelines);
+void xconfigClearModeLinePool(void);
 
 /* Pointer.c */
 XConfigInputPtr xconfigParsePointerSection(void);
@@ -94,9 +96,6 @@ XConfigVideoPortPtr xconfigParseVideoPortSubSection(void);
 XConfigVideoAdaptorPtr xconfigParseVideoAdaptorSection(void);
 void xconfigPrintVideoAdaptorSection(FILE *cf, XConfigVideoAdaptorPtr ptr);
 
-/* Read.c */
-int xconfigValidateConfig(XConfigPtr p);
-
 /* Scan.c */
 int xconfigGetToken(XConfigSymTabRec *tab);
 int xconfigGetSubToken(char **comment);
@@ -108,6 +107,7 @@ int xconfigGetStringToken(XConfigSymTabRec *tab);
 char *xconfigGetConfigFileName(void);
 
 /* Write.c */
+int xconfigReplaceFile(const char *filename, const char *buf, size_t len);
 
 /* DRI.c */
 XConfigBuffersPtr xconfigParseBuffers (void);
@@ -116,7 +116,11 @@ void xconfigPrintDRISection (FILE * cf, XConfigDRIPtr ptr);
 
 /* Util.c */
 void *xconfigAlloc(size_t size);
+void xconfigCountAlloc(size_t size);
 void xconfigErrorMsg(MsgType, char *fmt, ...);
+char *xconfigInternString(const char *s);
+unsigned int xconfigInternKey(const char *s);
+void xconfigReleaseString(char *s);
 
 /* Extensions.c */
 XConfigExtensionsPtr xconfigParseExtensionsSection (void);
@@ -2,11 +2,14 @@
 
 XCONFIG_PARSER_SRC += DRI.c
 XCONFIG_PARSER_SRC += Device.c
+XCONFIG_PARSER_SRC += Diff.c
 XCONFIG_PARSER_SRC += Extensions.c
 XCONFIG_PARSER_SRC += Files.c
 XCONFIG_PARSER_SRC += Flags.c
 XCONFIG_PARSER_SRC += Generate.c
 XCONFIG_PARSER_SRC += Input.c
+XCONFIG_PARSER_SRC += InputProbe.c
+XCONFIG_PARSER_SRC += Json.c
 XCONFIG_PARSER_SRC += Keyboard.c
 XCONFIG_PARSER_SRC += Layout.c
 XCONFIG_PARSER_SRC += Merge.c
@@ -16,6 +19,7 @@ XCONFIG_PARSER_SRC += Pointer.c
 XCONFIG_PARSER_SRC += Read.c
 XCONFIG_PARSER_SRC += Scan.c
 XCONFIG_PARSER_SRC += Screen.c
+XCONFIG_PARSER_SRC += Snapshot.c
 XCONFIG_PARSER_SRC += Util.c
 XCONFIG_PARSER_SRC += Vendor.c
 XCONFIG_PARSER_SRC += Video.c
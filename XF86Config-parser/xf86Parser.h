@@ -149,6 +149,7 @@ typedef struct __xconfigoptionrec {
     char *name;
     char *val;
     char *comment;
+    int refcount; /* extra owners of the list headed by this option */
 } XConfigOptionRec, *XConfigOptionPtr;
 
 
@@ -214,6 +215,15 @@ typedef struct {
 #define XCONFIG_MODE_CUSTOM    0x0800 /* timing numbers customized by editor */
 #define XCONFIG_MODE_VSCAN     0x1000
 
+/*
+ * The clock string of a parsed modeline is interned (see
+ * xconfigInternString()), and identical modeline lists of the Monitor
+ * and Modes sections of a config that is read are shared: 'refcount'
+ * counts the extra owners of the list headed by a modeline.  'key' is
+ * the xconfigModelineKey() of a parsed modeline; code that changes the
+ * timings of a modeline must reset it to 0.
+ */
+
 typedef struct __xconfigconfmodelinerec {
     struct __xconfigconfmodelinerec *next;
     char *identifier;
@@ -230,6 +240,8 @@ typedef struct __xconfigconfmodelinerec {
     int flags;
     int hskew;
     char *comment;
+    unsigned int key;
+    int refcount; /* extra owners of the list headed by this modeline */
 } XConfigModeLineRec, *XConfigModeLinePtr;
 
 
@@ -306,6 +318,31 @@ typedef struct __xconfigconfmonitorrec {
 
 
 
+/*
+ * PCI bus addresses are packed into 64 bits, so that they can be
+ * compared as integers: bit 63 marks a valid address, followed by a
+ * 16 bit domain, a 16 bit bus, and 8 bit device and function numbers.
+ * An address of 0 means "no address".
+ */
+
+typedef unsigned long long XConfigPciAddress;
+
+#define XCONFIG_PCI_ADDRESS(domain, bus, device, func)      \
+    ((1ULL << 63) |                                         \
+     ((XConfigPciAddress) ((domain) & 0xffff) << 32) |      \
+     ((XConfigPciAddress) ((bus) & 0xffff) << 16) |         \
+     ((XConfigPciAddress) ((device) & 0xff) << 8) |         \
+     ((XConfigPciAddress) ((func) & 0xff)))
+
+#define XCONFIG_PCI_DOMAIN(addr) ((int) (((addr) >> 32) & 0xffff))
+#define XCONFIG_PCI_BUS(addr)    ((int) (((addr) >> 16) & 0xffff))
+#define XCONFIG_PCI_DEVICE(addr) ((int) (((addr) >> 8) & 0xff))
+#define XCONFIG_PCI_FUNC(addr)   ((int) ((addr) & 0xff))
+
+/* the PCI address of a device, ignoring the function number */
+#define XCONFIG_PCI_SLOT_ADDRESS(addr) ((addr) & ~0xffULL)
+
+
 /*
  * Device Section
  */
@@ -338,6 +375,7 @@ typedef struct __xconfigconfdevicerec {
     int               screen;
     XConfigOptionPtr  options;
     char             *comment;
+    XConfigPciAddress pciaddr; /* busid, packed; 0 if none or not PCI */
 } XConfigDeviceRec, *XConfigDevicePtr;
 
 
@@ -366,6 +404,7 @@ typedef struct __xconfigconfdisplayrec {
     XConfigModePtr    modes;
     XConfigOptionPtr  options;
     char             *comment;
+    int               refcount; /* extra owners of the list headed here */
 } XConfigDisplayRec, *XConfigDisplayPtr;
 
 typedef struct __xconfigconfadaptorlinkrec {
@@ -604,6 +643,7 @@ typedef struct {
 typedef struct {
     int token;            /* id of the token */
     char *name;           /* pointer to the LOWERCASED name */
+    unsigned int key;     /* xconfigNameHash(name); filled in on first use */
 } XConfigSymTabRec, *XConfigSymTabPtr;
 
 
@@ -621,6 +661,7 @@ typedef struct {
     char *keyboard;
     char *mouse;
     char *keyboard_driver;
+    char *input_root;   /* root for /proc and /sys input probing */
 
     int supports_extension_section;
     int autoloads_glx;
@@ -629,18 +670,51 @@ typedef struct {
 } GenerateOptions;
 
 
+/*
+ * input devices enumerated from the kernel, used when generating
+ * input sections
+ */
+
+typedef struct __xconfigprobedinputrec {
+    struct __xconfigprobedinputrec *next;
+    char *name;
+    char *handlers;     /* e.g. "sysrq kbd event0" */
+    char *device;       /* event node, e.g. "/dev/input/event0"; or NULL */
+    int   keyboard;
+    int   pointer;
+} XConfigProbedInputRec, *XConfigProbedInputPtr;
+
+
 /*
  * Functions for open, reading, and writing XConfig files.
  */
 const char *xconfigOpenConfigFile(const char *, const char *);
+const char *xconfigOpenConfigFilePath(const char *);
+const char *xconfigOpenConfigBuffer(const char *name, const char *buf,
+                                    size_t len);
+const char *xconfigFindConfigFile(const char *, const char *);
 XConfigError xconfigReadConfigFile(XConfigPtr *);
+XConfigError xconfigReadConfigFileLayer(XConfigPtr *);
+int xconfigValidateConfig(XConfigPtr p);
 int xconfigSanitizeConfig(XConfigPtr p, const char *screenName,
                           GenerateOptions *gop);
 void xconfigCloseConfigFile(void);
 int xconfigWriteConfigFile(const char *, XConfigPtr);
+char *xconfigWriteConfigBuffer(XConfigPtr, size_t *len);
 
 void xconfigFreeConfig(XConfigPtr *p);
 
+/*
+ * Profiling hook for xconfigReadConfigFile(): if set, it is called
+ * with end == FALSE before, and end == TRUE after, each section is
+ * parsed (section is the name of the section as written), and around
+ * the validation of the parsed config (section is NULL).
+ */
+
+typedef void (*XConfigReadHook)(const char *section, int end);
+
+void xconfigSetReadHook(XConfigReadHook hook);
+
 /*
  * Functions for searching for entries in lists
  */
@@ -700,6 +774,7 @@ void xconfigAddListItem(GenericListPtr *pHead, GenericListPtr c_new);
 void xconfigRemoveListItem(GenericListPtr *pHead, GenericListPtr item);
 int xconfigItemNotSublist(GenericListPtr list_1, GenericListPtr list_2);
 char *xconfigAddComment(char *cur, char *add);
+void xconfigFreeComment(char *comment);
 void xconfigAddNewLoadDirective(XConfigLoadPtr *pHead,
                                 char *name, int type,
                                 XConfigOptionPtr opts, int do_token);
@@ -716,6 +791,8 @@ void xconfigRemoveNamedOption(XConfigOptionPtr *head, const char *name,
                               char **comments);
 
 XConfigOptionPtr xconfigOptionListDup(XConfigOptionPtr opt);
+XConfigOptionPtr xconfigOptionListRef(XConfigOptionPtr opt);
+void             xconfigOptionListUnshare(XConfigOptionPtr *opt);
 char            *xconfigOptionName(XConfigOptionPtr opt);
 char            *xconfigOptionValue(XConfigOptionPtr opt);
 XConfigOptionPtr xconfigNewOption(const char *name, const char *value);
@@ -734,23 +811,43 @@ XConfigOptionPtr xconfigOptionListMerge(XConfigOptionPtr head,
 
 char *xconfigStrdup(const char *s);
 char *xconfigStrcat(const char *str, ...);
+void xconfigGetAllocStats(unsigned long long *count, unsigned long long *bytes);
 int xconfigNameCompare(const char *s1, const char *s2);
+unsigned int xconfigNameHash(const char *s);
+int xconfigNameKeyCompare(const char *s1, unsigned int key1,
+                          const char *s2, unsigned int key2);
 int xconfigModelineCompare(XConfigModeLinePtr m1, XConfigModeLinePtr m2);
+unsigned int xconfigModelineKey(XConfigModeLinePtr m);
 char *xconfigULongToString(unsigned long i);
+double xconfigStrToReal(const char *s);
+char *xconfigFormatReal(char *buf, int len, double v, int digits);
+char *xconfigFormatRealShort(char *buf, int len, double v, int sig);
 XConfigOptionPtr xconfigParseOption(XConfigOptionPtr head);
 void xconfigPrintOptionList(FILE *fp, XConfigOptionPtr list, int tabs);
 int xconfigParsePciBusString(const char *busID,
                              int *bus, int *device, int *func);
 void xconfigFormatPciBusString(char *str, int len,
                                int domain, int bus, int device, int func);
+int xconfigParsePciAddress(const char *busID, XConfigPciAddress *addr);
+void xconfigFormatPciAddress(char *str, int len, XConfigPciAddress addr);
+XConfigPciAddress xconfigGetDevicePciAddress(XConfigDevicePtr device);
 
 void xconfigAddDisplay(XConfigDisplayPtr *pHead, const int depth);
 
+XConfigDisplayPtr xconfigDisplayListDup(XConfigDisplayPtr display);
+XConfigDisplayPtr xconfigDisplayListRef(XConfigDisplayPtr display);
+void xconfigDisplayListUnshare(XConfigDisplayPtr *display);
+
 void xconfigAddMode(XConfigModePtr *pHead, const char *name);
 void xconfigRemoveMode(XConfigModePtr *pHead, const char *name);
 
 XConfigPtr xconfigGenerate(GenerateOptions *gop);
 
+XConfigProbedInputPtr xconfigProbeInputDevices(const char *root);
+XConfigProbedInputPtr xconfigFindProbedInput(const char *root, int pointer);
+XConfigProbedInputPtr xconfigFindProbedInputByDevice(const char *root,
+                                                     const char *device);
+
 XConfigScreenPtr xconfigGenerateAddScreen(XConfigPtr config,
                                           int bus, int domain, int slot,
                                           char *boardname, int count);
@@ -787,6 +884,18 @@ int xconfigCheckCoreInputDevices(GenerateOptions *gop,
  */
 
 int xconfigMergeConfigs(XConfigPtr dstConfig, XConfigPtr srcConfig);
+int xconfigMergeConfigList(XConfigPtr dstConfig, XConfigPtr *srcConfigs,
+                           int count);
+int xconfigHoistModeLines(XConfigPtr config);
+int xconfigDiffConfigs(FILE *fp, XConfigPtr from, XConfigPtr to,
+                       const char **uncovered);
+XConfigError xconfigApplyPatch(XConfigPtr config);
+int xconfigWriteSnapshot(const char *filename, XConfigPtr config,
+                         const char *source);
+int xconfigReadSnapshot(const char *filename, const char *source,
+                        XConfigPtr *configPtr);
+int xconfigWriteJson(FILE *fp, XConfigPtr config);
+XConfigError xconfigReadJson(const char *filename, XConfigPtr *configPtr);
 
 
 
@@ -287,7 +287,12 @@ typedef enum {
 
     /* DRI Tokens */
     GROUP,
-    BUFFERS
+    BUFFERS,
+
+    /* Patch Tokens */
+    REMOVESECTION,
+    REMOVEOPTION,
+    REMOVEDISPLAY
 } ParserTokens;
 
 #endif /* _xf86_tokens_h */
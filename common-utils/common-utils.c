@@ -43,6 +43,40 @@
 /* Memory allocation helper functions */
 /****************************************************************************/
 
+/*
+ * the number of allocations made through the helpers below, and their
+ * total size in bytes; see nv_get_alloc_stats()
+ */
+
+static struct {
+    unsigned long long count;
+    unsigned long long bytes;
+} alloc_stats;
+
+#define COUNT_ALLOC(size)                       \
+    do {                                        \
+        alloc_stats.count++;                    \
+        alloc_stats.bytes += (size);            \
+    } while (0)
+
+
+
+/*
+ * nv_get_alloc_stats() - return the number of allocations made through
+ * nvalloc(), nvrealloc(), nvstrdup() and nvstrndup() (and the helpers
+ * built on them), and their total size in bytes; memory freed since is
+ * not subtracted.
+ */
+
+void nv_get_alloc_stats(unsigned long long *count, unsigned long long *bytes)
+{
+    *count = alloc_stats.count;
+    *bytes = alloc_stats.bytes;
+
+} /* nv_get_alloc_stats() */
+
+
+
 /*
  * nvalloc() - calloc wrapper that checks for errors; if an error
  * occurs, an error is printed to stderr and exit is called -- this
@@ -58,6 +92,7 @@ void *nvalloc(size_t size)
                 PROGRAM_NAME, strerror(errno));
         exit(1);
     }
+    COUNT_ALLOC(size);
     return m;
 
 } /* nvalloc() */
@@ -127,6 +162,7 @@ void *nvrealloc(void *ptr, size_t size)
                 PROGRAM_NAME, strerror(errno));
         exit(1);
     }
+    COUNT_ALLOC(size);
     return m;
 
 } /* nvrealloc() */
@@ -152,6 +188,7 @@ char *nvstrdup(const char *s)
                 PROGRAM_NAME, strerror(errno));
         exit(1);
     }
+    COUNT_ALLOC(strlen(m) + 1);
     return m;
 
 } /* nvstrdup() */
@@ -178,6 +215,8 @@ char *nvstrndup(const char *s, size_t n)
         exit(1);
     }
 
+    COUNT_ALLOC(n + 1);
+
     strncpy (m, s, n);
     m[n] = '\0';
 
@@ -61,6 +61,7 @@ char *nvstrchrnul(char *s, int c);
 char *nvasprintf(const char *fmt, ...) NV_ATTRIBUTE_PRINTF(1, 2);
 void nv_append_sprintf(char **buf, const char *fmt, ...) NV_ATTRIBUTE_PRINTF(2, 3);
 void nvfree(void *s);
+void nv_get_alloc_stats(unsigned long long *count, unsigned long long *bytes);
 
 char *tilde_expansion(const char *str);
 char *nv_prepend_to_string_list(char *list, const char *item, const char *delim);
@@ -60,9 +60,15 @@ int nvgetopt(int argc,
 
     argv_index++;
 
-    /* if no more options, return -1 */
+    /*
+     * if no more options, return -1; the next call starts over, so
+     * that another command line can be parsed
+     */
 
-    if (argv_index >= argc) return -1;
+    if (argv_index >= argc) {
+        argv_index = 0;
+        return -1;
+    }
 
     /* get the argument in question */
 
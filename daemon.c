@@ -0,0 +1,1000 @@
+/*
+ * nvidia-xconfig: A tool for manipulating X config files,
+ * specifically for use by the NVIDIA Linux graphics driver.
+ *
+ * Copyright (C) 2004 NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>.
+ *
+ *
+ * daemon.c - the '--daemon' request server, and the '--use-daemon'
+ * client.
+ *
+ * The daemon listens on a Unix domain socket.  It detects the X server,
+ * probes the GPUs and parses the system X config file once, and keeps
+ * the results in memory.  Each request carries a command line, plus
+ * the client's environment, umask, working directory, stdin, stdout and
+ * stderr.  The daemon forks a worker for the request, which runs the
+ * command line as nvidia-xconfig would, with the client's environment
+ * (e.g., XF86CONFIG, and HOME for '~' in paths) and files, and starts
+ * with the daemon's results rather than reproducing them.  The worker's exit
+ * status is sent back to the client.
+ *
+ * Requests are handled one at a time, so that two requests never
+ * write the same X config file at once.
+ */
+
+#if defined(NV_LINUX)
+#define _GNU_SOURCE /* for struct ucred */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#include "nvidia-xconfig.h"
+#include "msg.h"
+
+
+#define DAEMON_MAGIC        0x4e565843      /* "NVXC" */
+#define DAEMON_VERSION      2
+#define DAEMON_MAX_REQUEST  (1 << 20)
+#define DAEMON_TIMEOUT      10              /* seconds to receive a request */
+
+/* the files a client passes with a request */
+
+enum {
+    DAEMON_CWD_FD = 0,
+    DAEMON_STDIN_FD,
+    DAEMON_STDOUT_FD,
+    DAEMON_STDERR_FD,
+    DAEMON_NUM_FDS
+};
+
+/*
+ * a request is the header, sent with the client's files, followed by
+ * 'size' bytes holding 'argc' NUL-terminated command line arguments
+ * (not including argv[0]), then 'envc' NUL-terminated "NAME=value"
+ * environment strings; the reply is the exit status, as an int
+ */
+
+typedef struct {
+    unsigned int magic;
+    unsigned int version;
+    unsigned int argc;
+    unsigned int envc;
+    unsigned int umask;
+    unsigned int size;
+} DaemonRequestRec;
+
+extern char **environ;
+
+/* an X config file parsed by the daemon */
+
+typedef struct _daemon_config_rec {
+    char *filename;             /* as given by realpath(3) */
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    struct timespec mtime;
+    XConfigPtr config;
+    struct _daemon_config_rec *next;
+} DaemonConfigRec, *DaemonConfigPtr;
+
+static struct {
+    int worker;                 /* this process is running a request */
+    int report_fd;              /* worker: files to be parsed by the daemon */
+    int listen_fd;
+
+    int have_xserver;
+    char *x_project_root;
+    GenerateOptions xserver;
+
+    int have_devices;
+    char *nvidia_cfg_path;
+    DevicesPtr devices;
+
+    DaemonConfigPtr configs;
+} daemon_state = { FALSE, -1, -1 };
+
+static volatile sig_atomic_t daemon_quit = FALSE;
+static volatile sig_atomic_t daemon_reload = FALSE;
+
+
+
+static int strings_equal(const char *a, const char *b)
+{
+    if (!a || !b) return (a == b);
+
+    return (strcmp(a, b) == 0);
+}
+
+
+
+/*
+ * stat_config() - stat the named file; returns FALSE if it cannot be
+ * stat'ed
+ */
+
+static int stat_config(const char *filename, DaemonConfigPtr c)
+{
+    struct stat st;
+
+    if (stat(filename, &st) != 0) return FALSE;
+
+    c->dev = st.st_dev;
+    c->ino = st.st_ino;
+    c->size = st.st_size;
+    c->mtime = st.st_mtim;
+
+    return TRUE;
+
+} /* stat_config() */
+
+
+
+/*
+ * find_config() - find the daemon's parse of the named file, which
+ * must be an absolute path without symlinks
+ */
+
+static DaemonConfigPtr find_config(const char *filename)
+{
+    DaemonConfigPtr c;
+
+    for (c = daemon_state.configs; c; c = c->next) {
+        if (strcmp(c->filename, filename) == 0) return c;
+    }
+
+    return NULL;
+
+} /* find_config() */
+
+
+
+/*
+ * parse_config() - parse the named file, and keep the config, replacing
+ * any earlier parse of the file.  The file is stat'ed before it is
+ * parsed, so that a change while it is parsed invalidates the parse.
+ */
+
+static void parse_config(const char *filename)
+{
+    DaemonConfigRec tmp;
+    DaemonConfigPtr c;
+    XConfigPtr config;
+    XConfigError error;
+
+    if (!stat_config(filename, &tmp)) return;
+
+    c = find_config(filename);
+    if (c && (c->dev == tmp.dev) && (c->ino == tmp.ino) &&
+        (c->size == tmp.size) && (c->mtime.tv_sec == tmp.mtime.tv_sec) &&
+        (c->mtime.tv_nsec == tmp.mtime.tv_nsec)) {
+        return;
+    }
+
+    if (!xconfigOpenConfigFilePath(filename)) return;
+    error = xconfigReadConfigFile(&config);
+    xconfigCloseConfigFile();
+
+    if (error != XCONFIG_RETURN_SUCCESS) return;
+
+    if (!c) {
+        c = nvalloc(sizeof(DaemonConfigRec));
+        c->filename = nvstrdup(filename);
+        c->next = daemon_state.configs;
+        daemon_state.configs = c;
+    } else {
+        xconfigFreeConfig(&c->config);
+    }
+
+    c->dev = tmp.dev;
+    c->ino = tmp.ino;
+    c->size = tmp.size;
+    c->mtime = tmp.mtime;
+    c->config = config;
+
+} /* parse_config() */
+
+
+
+/*
+ * flush_caches() - forget everything the daemon has detected, probed
+ * and parsed
+ */
+
+static void flush_caches(void)
+{
+    DaemonConfigPtr c, next;
+
+    for (c = daemon_state.configs; c; c = next) {
+        next = c->next;
+        xconfigFreeConfig(&c->config);
+        nvfree(c->filename);
+        nvfree(c);
+    }
+    daemon_state.configs = NULL;
+
+    free_devices(daemon_state.devices);
+    daemon_state.devices = NULL;
+    daemon_state.have_devices = FALSE;
+    reset_devices();
+
+    nvfree(daemon_state.x_project_root);
+    daemon_state.x_project_root = NULL;
+    daemon_state.have_xserver = FALSE;
+
+} /* flush_caches() */
+
+
+
+/*
+ * prime_caches() - detect the X server, probe the GPUs, and parse the
+ * system X config file, as requests with the daemon's own options
+ * would
+ */
+
+static void prime_caches(Options *op)
+{
+    const char *filename;
+    char *path;
+
+    daemon_state.x_project_root = nvstrdup(op->gop.x_project_root);
+    daemon_state.xserver = op->gop;
+    xconfigGetXServerInUse(&daemon_state.xserver);
+    daemon_state.have_xserver = TRUE;
+
+    /* with the EDIDs, so that the workers never need to read them */
+
+    daemon_state.nvidia_cfg_path = op->nvidia_cfg_path;
+    daemon_state.devices = find_devices(op, DEVICES_EDID);
+    daemon_state.have_devices = TRUE;
+
+    filename = xconfigFindConfigFile(op->xconfig, op->gop.x_project_root);
+    if (filename && (path = realpath(filename, NULL))) {
+        parse_config(path);
+        free(path);
+    }
+
+} /* prime_caches() */
+
+
+
+/*
+ * daemon_get_xserver_in_use() - xconfigGetXServerInUse(), answered
+ * from what the daemon detected, when running a request for the daemon
+ */
+
+void daemon_get_xserver_in_use(GenerateOptions *gop)
+{
+    if (!daemon_state.worker || !daemon_state.have_xserver ||
+        !strings_equal(gop->x_project_root, daemon_state.x_project_root)) {
+        xconfigGetXServerInUse(gop);
+        return;
+    }
+
+    gop->xserver = daemon_state.xserver.xserver;
+    gop->supports_extension_section =
+        daemon_state.xserver.supports_extension_section;
+    gop->autoloads_glx = daemon_state.xserver.autoloads_glx;
+    gop->xinerama_plus_composite_works =
+        daemon_state.xserver.xinerama_plus_composite_works;
+
+} /* daemon_get_xserver_in_use() */
+
+
+
+/*
+ * daemon_cached_devices() - when running a request for the daemon,
+ * return in pDevices a copy of the GPUs the daemon probed (NULL if it
+ * found none), and return TRUE; otherwise, return FALSE.
+ */
+
+int daemon_cached_devices(Options *op, DevicesPtr *pDevices)
+{
+    if (!daemon_state.worker || !daemon_state.have_devices ||
+        !strings_equal(op->nvidia_cfg_path, daemon_state.nvidia_cfg_path)) {
+        return FALSE;
+    }
+
+    *pDevices = copy_devices(daemon_state.devices);
+
+    return TRUE;
+
+} /* daemon_cached_devices() */
+
+
+
+/*
+ * daemon_cached_xconfig() - when running a request for the daemon,
+ * return the daemon's parse of the named X config file, if the file has
+ * not changed since; otherwise, return NULL.  The config is handed over
+ * to the caller.
+ */
+
+XConfigPtr daemon_cached_xconfig(const char *filename)
+{
+    DaemonConfigRec tmp;
+    DaemonConfigPtr c;
+    XConfigPtr config;
+    char *path;
+
+    if (!daemon_state.worker || !daemon_state.configs) return NULL;
+
+    path = realpath(filename, NULL);
+    if (!path) return NULL;
+
+    c = find_config(path);
+    free(path);
+
+    if (!c || !c->config || !stat_config(c->filename, &tmp) ||
+        (c->dev != tmp.dev) || (c->ino != tmp.ino) ||
+        (c->size != tmp.size) || (c->mtime.tv_sec != tmp.mtime.tv_sec) ||
+        (c->mtime.tv_nsec != tmp.mtime.tv_nsec)) {
+        return NULL;
+    }
+
+    config = c->config;
+    c->config = NULL;
+
+    /* name the file as the request did */
+
+    free(config->filename);
+    config->filename = xconfigStrdup(filename);
+
+    return config;
+
+} /* daemon_cached_xconfig() */
+
+
+
+/*
+ * daemon_report_xconfig() - when running a request for the daemon, ask
+ * the daemon to parse the named X config file, once the request is
+ * done, so that later requests can use the parse
+ */
+
+void daemon_report_xconfig(const char *filename)
+{
+    char *path;
+    size_t len;
+
+    if (!daemon_state.worker || (daemon_state.report_fd < 0)) return;
+
+    path = realpath(filename, NULL);
+    if (!path) return;
+
+    len = strlen(path) + 1;
+    if (write(daemon_state.report_fd, path, len) != (ssize_t) len) {
+        /* the daemon will not cache the file; not an error */
+    }
+
+    free(path);
+
+} /* daemon_report_xconfig() */
+
+
+
+/*
+ * read_reports() - read the files reported by the worker until it
+ * closes its end of the pipe, and parse them
+ */
+
+static void read_reports(int fd)
+{
+    char *buf = NULL, *p;
+    size_t len = 0, size = 0;
+    ssize_t n;
+
+    while (1) {
+        if (len == size) {
+            size = size ? size * 2 : 1024;
+            buf = nvrealloc(buf, size);
+        }
+        n = read(fd, buf + len, size - len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        len += n;
+    }
+
+    for (p = buf; p && (p < buf + len); p += strlen(p) + 1) {
+        if (!memchr(p, '\0', buf + len - p)) break;
+        parse_config(p);
+    }
+
+    nvfree(buf);
+
+} /* read_reports() */
+
+
+
+/*
+ * close_cmsg_fds() - close the files passed in an SCM_RIGHTS message
+ * that is not accepted
+ */
+
+static void close_cmsg_fds(struct cmsghdr *cmsg)
+{
+    int fd;
+    size_t i, n;
+
+    if (cmsg->cmsg_len < CMSG_LEN(0)) return;
+
+    n = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+
+    for (i = 0; i < n; i++) {
+        memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+        if (fd >= 0) close(fd);
+    }
+
+} /* close_cmsg_fds() */
+
+
+
+/*
+ * receive_request() - receive the header of a request and the client's
+ * files, then the command line and environment.  Returns the command
+ * line as an argv[] array (with argv[0] set to "nvidia-xconfig"),
+ * followed by the NULL-terminated environment, returned in 'envp'; both
+ * point into the buffer returned in 'args_buf'.  Returns NULL on error.
+ */
+
+static char **receive_request(int fd, int *argc, char ***envp,
+                              mode_t *mask, char **args_buf,
+                              int fds[DAEMON_NUM_FDS])
+{
+    DaemonRequestRec req;
+    struct msghdr msg;
+    struct iovec iov;
+    struct cmsghdr *cmsg;
+    char control[CMSG_SPACE(sizeof(int) * DAEMON_NUM_FDS)];
+    char **argv = NULL, *args = NULL, *p;
+    size_t len;
+    ssize_t n;
+    unsigned int i;
+    int bad_fds = FALSE;
+
+    for (i = 0; i < DAEMON_NUM_FDS; i++) fds[i] = -1;
+
+    memset(&msg, 0, sizeof(msg));
+    iov.iov_base = &req;
+    iov.iov_len = sizeof(req);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    do {
+        n = recvmsg(fd, &msg, MSG_WAITALL);
+    } while (n < 0 && errno == EINTR);
+
+    /*
+     * take the files first, so that they are closed on any error; the
+     * files of any other SCM_RIGHTS message (of the wrong size, or a
+     * second one) have been installed all the same, so they are closed
+     * here, and the request is rejected
+     */
+
+    for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if ((cmsg->cmsg_level != SOL_SOCKET) ||
+            (cmsg->cmsg_type != SCM_RIGHTS)) {
+            continue;
+        }
+        if ((cmsg->cmsg_len == CMSG_LEN(sizeof(int) * DAEMON_NUM_FDS)) &&
+            (fds[DAEMON_CWD_FD] < 0) && !bad_fds) {
+            memcpy(fds, CMSG_DATA(cmsg), sizeof(int) * DAEMON_NUM_FDS);
+        } else {
+            close_cmsg_fds(cmsg);
+            bad_fds = TRUE;
+        }
+    }
+
+    if ((n != sizeof(req)) || (msg.msg_flags & MSG_CTRUNC) || bad_fds ||
+        (req.magic != DAEMON_MAGIC) || (req.version != DAEMON_VERSION) ||
+        (req.size > DAEMON_MAX_REQUEST) || (req.argc > req.size) ||
+        (req.envc > req.size - req.argc) || (fds[DAEMON_CWD_FD] < 0)) {
+        nv_warning_msg("Ignoring an invalid request.");
+        return NULL;
+    }
+
+    args = nvalloc(req.size + 1);
+
+    for (len = 0; len < req.size; len += n) {
+        n = recv(fd, args + len, req.size - len, MSG_WAITALL);
+        if (n < 0 && errno == EINTR) {
+            n = 0;
+            continue;
+        }
+        if (n <= 0) {
+            nv_warning_msg("Ignoring an incomplete request.");
+            nvfree(args);
+            return NULL;
+        }
+    }
+
+    /*
+     * the arguments and environment must be exactly 'argc' + 'envc'
+     * NUL-terminated strings, each environment string with a '='; the
+     * argv[] and environment arrays are each NULL-terminated
+     */
+
+    argv = nvalloc(sizeof(char *) * (req.argc + req.envc + 3));
+    argv[0] = "nvidia-xconfig";
+
+    for (p = args, i = 0; i < req.argc + req.envc; i++) {
+        if (p >= args + req.size) break;
+        if ((i >= req.argc) && !strchr(p, '=')) break;
+        argv[(i < req.argc) ? (i + 1) : (i + 2)] = p;
+        p += strlen(p) + 1;
+    }
+
+    if ((i != req.argc + req.envc) || (p != args + req.size)) {
+        nv_warning_msg("Ignoring a malformed request.");
+        nvfree(args);
+        nvfree(argv);
+        return NULL;
+    }
+
+    *argc = req.argc + 1;
+    *envp = argv + req.argc + 2;
+    *mask = req.umask & 0777;
+    *args_buf = args;
+
+    return argv;
+
+} /* receive_request() */
+
+
+
+/*
+ * allowed_peer() - only the daemon's own user, and root, may make
+ * requests; elsewhere, the permissions of the socket are relied on
+ */
+
+static int allowed_peer(int fd)
+{
+#if defined(SO_PEERCRED)
+    struct ucred cred;
+    socklen_t len = sizeof(cred);
+
+    if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) != 0) {
+        return FALSE;
+    }
+
+    if ((cred.uid != 0) && (cred.uid != geteuid())) {
+        nv_warning_msg("Ignoring a request from user %u.",
+                       (unsigned int) cred.uid);
+        return FALSE;
+    }
+#endif
+
+    return TRUE;
+
+} /* allowed_peer() */
+
+
+
+/*
+ * run_worker() - in the forked worker: take on the client's
+ * environment, umask, working directory and files, and run the command
+ * line
+ */
+
+static void run_worker(int fd, int report_fd, int fds[DAEMON_NUM_FDS],
+                       int argc, char **argv, char **envp, mode_t mask)
+{
+    struct sigaction sa;
+    int i;
+
+    close(daemon_state.listen_fd);
+    close(fd);
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = SIG_DFL;
+    sigaction(SIGHUP, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGPIPE, &sa, NULL);
+
+    if (fchdir(fds[DAEMON_CWD_FD]) != 0) {
+        _exit(1);
+    }
+
+    environ = envp;
+    umask(mask);
+
+    for (i = DAEMON_STDIN_FD; i < DAEMON_NUM_FDS; i++) {
+        if ((fds[i] >= 0) && (dup2(fds[i], i - DAEMON_STDIN_FD) < 0)) {
+            _exit(1);
+        }
+    }
+
+    for (i = 0; i < DAEMON_NUM_FDS; i++) {
+        if (fds[i] > STDERR_FILENO) close(fds[i]);
+    }
+
+    daemon_state.worker = TRUE;
+    daemon_state.report_fd = report_fd;
+
+    nv_set_verbosity(NV_VERBOSITY_DEFAULT);
+
+    exit(nvidia_xconfig(argc, argv));
+
+} /* run_worker() */
+
+
+
+/*
+ * serve_request() - receive one request on the connection, run it in a
+ * worker, and send the worker's exit status back
+ */
+
+static void serve_request(int fd)
+{
+    struct timeval tv;
+    int fds[DAEMON_NUM_FDS];
+    int pipe_fds[2];
+    int argc, status, ret, i;
+    char **argv, **envp, *args = NULL;
+    mode_t mask;
+    pid_t pid;
+
+    if (!allowed_peer(fd)) return;
+
+    tv.tv_sec = DAEMON_TIMEOUT;
+    tv.tv_usec = 0;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    argv = receive_request(fd, &argc, &envp, &mask, &args, fds);
+    if (!argv) goto done;
+
+    if (pipe(pipe_fds) != 0) {
+        nv_error_msg("Unable to create a pipe (%s).", strerror(errno));
+        goto done;
+    }
+
+    fflush(stdout);
+    fflush(stderr);
+
+    pid = fork();
+
+    if (pid < 0) {
+        nv_error_msg("Unable to fork (%s).", strerror(errno));
+        close(pipe_fds[0]);
+        close(pipe_fds[1]);
+        goto done;
+    }
+
+    if (pid == 0) {
+        close(pipe_fds[0]);
+        run_worker(fd, pipe_fds[1], fds, argc, argv, envp, mask);
+    }
+
+    close(pipe_fds[1]);
+
+    for (i = 0; i < DAEMON_NUM_FDS; i++) {
+        if (fds[i] >= 0) close(fds[i]);
+        fds[i] = -1;
+    }
+
+    read_reports(pipe_fds[0]);
+    close(pipe_fds[0]);
+
+    while ((waitpid(pid, &status, 0) < 0) && (errno == EINTR));
+
+    if (WIFEXITED(status)) {
+        ret = WEXITSTATUS(status);
+    } else if (WIFSIGNALED(status)) {
+        ret = 128 + WTERMSIG(status);
+    } else {
+        ret = 1;
+    }
+
+    send(fd, &ret, sizeof(ret), MSG_NOSIGNAL);
+
+ done:
+
+    for (i = 0; i < DAEMON_NUM_FDS; i++) {
+        if (fds[i] >= 0) close(fds[i]);
+    }
+
+    nvfree(args);
+    nvfree(argv);
+
+} /* serve_request() */
+
+
+
+static void daemon_signal(int sig)
+{
+    if (sig == SIGHUP) {
+        daemon_reload = TRUE;
+    } else {
+        daemon_quit = TRUE;
+    }
+}
+
+
+
+/*
+ * open_socket() - create the listening socket at the given path, with
+ * permissions for its owner only.  A socket left behind by a daemon
+ * that is no longer running is replaced.
+ */
+
+static int open_socket(const char *path)
+{
+    struct sockaddr_un addr;
+    struct stat st;
+    mode_t mask;
+    int fd, ret;
+
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        nv_error_msg("The socket path '%s' is too long.", path);
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        nv_error_msg("Unable to create a socket (%s).", strerror(errno));
+        return -1;
+    }
+
+    if ((lstat(path, &st) == 0) && S_ISSOCK(st.st_mode)) {
+        if (connect(fd, (struct sockaddr *) &addr, sizeof(addr)) == 0) {
+            nv_error_msg("A daemon is already listening on '%s'.", path);
+            close(fd);
+            return -1;
+        }
+        unlink(path);
+    }
+
+    mask = umask(077);
+    ret = bind(fd, (struct sockaddr *) &addr, sizeof(addr));
+    umask(mask);
+
+    if ((ret != 0) || (listen(fd, SOMAXCONN) != 0)) {
+        nv_error_msg("Unable to listen on '%s' (%s).", path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+
+} /* open_socket() */
+
+
+
+/*
+ * run_daemon() - serve requests on the socket given with '--daemon',
+ * until SIGTERM or SIGINT; SIGHUP makes the daemon forget what it has
+ * detected, probed and parsed, e.g., after GPUs have been added.
+ * Returns the exit status.
+ */
+
+int run_daemon(Options *op)
+{
+    struct sigaction sa;
+    int fd;
+
+    if (daemon_state.worker) {
+        nv_error_msg("The '--daemon' option cannot be used in a request "
+                     "to the daemon.");
+        return 1;
+    }
+
+    daemon_state.listen_fd = open_socket(op->daemon_socket);
+    if (daemon_state.listen_fd < 0) return 1;
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = daemon_signal;
+    sigaction(SIGHUP, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGINT, &sa, NULL);
+
+    sa.sa_handler = SIG_IGN;
+    sigaction(SIGPIPE, &sa, NULL);
+
+    prime_caches(op);
+
+    nv_info_msg(NULL, "");
+    nv_info_msg(NULL, "Listening for requests on '%s'.", op->daemon_socket);
+    fflush(stdout);
+
+    while (!daemon_quit) {
+
+        if (daemon_reload) {
+            daemon_reload = FALSE;
+            flush_caches();
+            prime_caches(op);
+        }
+
+        fd = accept(daemon_state.listen_fd, NULL, NULL);
+        if (fd < 0) {
+            if ((errno == EINTR) || (errno == ECONNABORTED)) continue;
+            nv_error_msg("Unable to accept a request (%s).", strerror(errno));
+            break;
+        }
+
+        serve_request(fd);
+        close(fd);
+    }
+
+    close(daemon_state.listen_fd);
+    unlink(op->daemon_socket);
+    flush_caches();
+
+    return daemon_quit ? 0 : 1;
+
+} /* run_daemon() */
+
+
+
+/*
+ * daemon_request() - send the command line to the daemon listening on
+ * the given socket, along with our environment, umask, working
+ * directory and files, and wait for it to be run.  Returns TRUE, with
+ * the exit status of the request in 'status', if the daemon took the
+ * request; returns FALSE if there is no daemon, or if we are a worker
+ * of the daemon ourselves.
+ */
+
+int daemon_request(const char *path, int argc, char *argv[], int *status)
+{
+    DaemonRequestRec req;
+    struct sockaddr_un addr;
+    struct msghdr msg;
+    struct iovec iov;
+    struct cmsghdr *cmsg;
+    char control[CMSG_SPACE(sizeof(int) * DAEMON_NUM_FDS)];
+    int fds[DAEMON_NUM_FDS];
+    char *args, *p;
+    size_t size;
+    ssize_t n;
+    mode_t mask;
+    int fd, i, envc, ret = FALSE;
+
+    if (daemon_state.worker) return FALSE;
+
+    if (strlen(path) >= sizeof(addr.sun_path)) return FALSE;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return FALSE;
+
+    if (connect(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0) {
+        nv_warning_msg("Unable to connect to the nvidia-xconfig daemon on "
+                       "'%s' (%s); running the request directly.",
+                       path, strerror(errno));
+        close(fd);
+        return FALSE;
+    }
+
+    fds[DAEMON_CWD_FD] = open(".", O_RDONLY);
+    fds[DAEMON_STDIN_FD] = STDIN_FILENO;
+    fds[DAEMON_STDOUT_FD] = STDOUT_FILENO;
+    fds[DAEMON_STDERR_FD] = STDERR_FILENO;
+
+    if (fds[DAEMON_CWD_FD] < 0) {
+        close(fd);
+        return FALSE;
+    }
+
+    for (size = 0, i = 1; i < argc; i++) {
+        size += strlen(argv[i]) + 1;
+    }
+
+    /* only well-formed environment strings can be applied by the worker */
+
+    for (envc = 0, i = 0; environ && environ[i]; i++) {
+        if (!strchr(environ[i], '=')) continue;
+        size += strlen(environ[i]) + 1;
+        envc++;
+    }
+
+    if (size > DAEMON_MAX_REQUEST) {
+        nv_warning_msg("The request is too large for the nvidia-xconfig "
+                       "daemon; running the request directly.");
+        close(fds[DAEMON_CWD_FD]);
+        close(fd);
+        return FALSE;
+    }
+
+    args = nvalloc(size ? size : 1);
+    for (p = args, i = 1; i < argc; i++) {
+        strcpy(p, argv[i]);
+        p += strlen(argv[i]) + 1;
+    }
+    for (i = 0; environ && environ[i]; i++) {
+        if (!strchr(environ[i], '=')) continue;
+        strcpy(p, environ[i]);
+        p += strlen(environ[i]) + 1;
+    }
+
+    mask = umask(0);
+    umask(mask);
+
+    req.magic = DAEMON_MAGIC;
+    req.version = DAEMON_VERSION;
+    req.argc = argc - 1;
+    req.envc = envc;
+    req.umask = mask;
+    req.size = size;
+
+    memset(&msg, 0, sizeof(msg));
+    memset(control, 0, sizeof(control));
+    iov.iov_base = &req;
+    iov.iov_len = sizeof(req);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int) * DAEMON_NUM_FDS);
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * DAEMON_NUM_FDS);
+
+    fflush(stdout);
+    fflush(stderr);
+
+    if ((sendmsg(fd, &msg, MSG_NOSIGNAL) != sizeof(req)) ||
+        (size && (send(fd, args, size, MSG_NOSIGNAL) != (ssize_t) size))) {
+        nv_warning_msg("Unable to send the request to the nvidia-xconfig "
+                       "daemon (%s); running the request directly.",
+                       strerror(errno));
+        goto done;
+    }
+
+    /* from here on, the daemon may have run the request */
+
+    ret = TRUE;
+
+    do {
+        n = recv(fd, status, sizeof(*status), MSG_WAITALL);
+    } while (n < 0 && errno == EINTR);
+
+    if (n != sizeof(*status)) {
+        nv_error_msg("The nvidia-xconfig daemon did not complete the "
+                     "request.");
+        *status = 1;
+    }
+
+ done:
+    nvfree(args);
+    close(fds[DAEMON_CWD_FD]);
+    close(fd);
+
+    return ret;
+
+} /* daemon_request() */
@@ -40,6 +40,9 @@ SRC += options.c
 SRC += lscf.c
 SRC += query_gpu_info.c
 SRC += extract_edids.c
+SRC += stats.c
+SRC += daemon.c
+SRC += watch.c
 
 DIST_FILES := $(SRC)
 DIST_FILES += $(addprefix $(XCONFIG_PARSER_DIR)/,$(XCONFIG_PARSER_EXTRA_DIST))
@@ -47,5 +50,11 @@ DIST_FILES += nvidia-xconfig.h
 DIST_FILES += option_table.h
 DIST_FILES += nvidia-xconfig.1.m4
 DIST_FILES += gen-manpage-opts.c
+DIST_FILES += xconfig-bench.c
+DIST_FILES += xconfig-fuzz.c
+DIST_FILES += $(wildcard fuzz-corpus/seeds/* fuzz-corpus/regress/*)
+DIST_FILES += fixtures/input-root/proc/bus/input/devices
+DIST_FILES += $(wildcard fixtures/input-root-sysfs/sys/class/input/*/name)
+DIST_FILES += $(wildcard fixtures/input-root-sysfs/sys/class/input/*/*/*)
 DIST_FILES += dist-files.mk
 DIST_FILES += COPYING
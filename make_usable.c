@@ -108,6 +108,10 @@ int update_modules(XConfigPtr config)
 int update_screen(Options *op, XConfigPtr config, XConfigScreenPtr screen)
 {
     /* migrate any options from device to screen to avoid conflicts */
+    if (screen->device->options) {
+        xconfigOptionListUnshare(&screen->options);
+        xconfigOptionListUnshare(&screen->device->options);
+    }
     screen->options = xconfigOptionListMerge(screen->options,
                                              screen->device->options);
     screen->device->options = NULL;
@@ -251,6 +255,7 @@ static int update_device(Options *op, XConfigPtr config, XConfigDevicePtr device
     int screen;
     XConfigDevicePtr next;
     XConfigOptionPtr options;
+    XConfigPciAddress pciaddr;
     
     next = device->next;
     options = device->options;
@@ -260,7 +265,13 @@ static int update_device(Options *op, XConfigPtr config, XConfigDevicePtr device
     screen = device->screen;
     board = device->board;
     busid = device->busid;
+    pciaddr = device->pciaddr;
     driver = device->driver;
+
+    nvfree(device->chipset);
+    nvfree(device->card);
+    nvfree(device->ramdac);
+    nvfree(device->clockchip);
     
     memset(device, 0, sizeof(XConfigDeviceRec));
 
@@ -283,17 +294,20 @@ static int update_device(Options *op, XConfigPtr config, XConfigDevicePtr device
     if (op->busid == NV_DISABLE_STRING_OPTION) {
         device->busid = NULL;
     } else if (op->busid) {
-        device->busid = op->busid;
+        device->busid = nvstrdup(op->busid);
+        xconfigParsePciAddress(device->busid, &device->pciaddr);
     } else if (GET_BOOL_OPTION(op->boolean_options,
                                PRESERVE_BUSID_BOOL_OPTION)) {
         if (GET_BOOL_OPTION(op->boolean_option_values,
                             PRESERVE_BUSID_BOOL_OPTION)) {
             device->busid = busid;
+            device->pciaddr = pciaddr;
         } else {
             device->busid = NULL;
         }
     } else if (config->screens->next) {
         device->busid = busid;
+        device->pciaddr = pciaddr;
     }
 
     device->chipid = -1;
@@ -303,8 +317,13 @@ static int update_device(Options *op, XConfigPtr config, XConfigDevicePtr device
     if (op->preserve_driver) {
         device->driver = driver;
     } else {
-        device->driver = "nvidia";
+        device->driver = nvstrdup("nvidia");
     }
+
+    /* free what was not retained */
+
+    if (device->busid != busid) nvfree(busid);
+    if (device->driver != driver) nvfree(driver);
     
     return TRUE;
     
@@ -355,6 +374,7 @@ static void update_depth(Options *op, XConfigScreenPtr screen)
     }
     
     if (!found) {
+        xconfigDisplayListUnshare(&screen->displays);
         screen->displays->depth = screen->defaultdepth;
     }
     
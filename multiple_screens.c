@@ -26,6 +26,7 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 #include <dlfcn.h>
 
 
@@ -36,7 +37,6 @@ static int disable_separate_x_screens(Options *op, XConfigPtr config,
 
 static int set_xinerama(int xinerama_enabled, XConfigLayoutPtr layout);
 
-static XConfigDisplayPtr clone_display_list(XConfigDisplayPtr display0);
 static XConfigDevicePtr clone_device(XConfigDevicePtr device0, int idx);
 static XConfigScreenPtr clone_screen(XConfigScreenPtr screen0, int idx);
 
@@ -75,24 +75,27 @@ static int* get_screens_to_clone(Options *op,
 
     /* Detect the number of supported screens per screen candidate */
     devs_found = FALSE;
-    pDevices = find_devices(op);
+    pDevices = find_devices(op, DEVICES_GPU_INFO);
     if (pDevices) {
         for (i = 0; i < nscreens; i++) {
-            int bus, slot, scratch;
+            XConfigPciAddress addr;
 
             if (!screen_candidates[i]) {
                 continue;
             }
 
-            /* parse the bus id for this candidate screen */
-            if (!xconfigParsePciBusString(screen_candidates[i]->device->busid,
-                                          &bus, &slot, &scratch)) {
+            /* get the bus id for this candidate screen */
+            addr = xconfigGetDevicePciAddress(screen_candidates[i]->device);
+            if (!addr) {
                 continue;
             }
+            addr = XCONFIG_PCI_SLOT_ADDRESS(addr);
 
             for (j = 0; j < pDevices->nDevices; j++) {
-                if ((pDevices->devices[j].dev.bus == bus) &&
-                    (pDevices->devices[j].dev.slot == slot)) {
+                NvCfgPciDevice *dev = &pDevices->devices[j].dev;
+
+                if (XCONFIG_PCI_ADDRESS(dev->domain, dev->bus,
+                                        dev->slot, 0) == addr) {
 
                     if (pDevices->devices[j].crtcs > 0) {
                         supported_screens[i] = pDevices->devices[j].crtcs;
@@ -154,32 +157,26 @@ static void clean_screen_list(XConfigScreenPtr *screen_list,
                               int nscreens)
 {
     int i, j;
-    int *bus, *slot, scratch;
+    XConfigPciAddress *addr;
 
-    /* trim out duplicates and get the bus ids*/
+    /* get the bus ids and trim out duplicates */
 
-    bus = nvalloc(sizeof(int) * nscreens);
-    slot = nvalloc(sizeof(int) * nscreens);
+    addr = nvalloc(sizeof(XConfigPciAddress) * nscreens);
 
     for (i = 0; i < nscreens; i++) {
-        bus[i] = -1;
+        if (screen_list[i]) {
+            addr[i] = XCONFIG_PCI_SLOT_ADDRESS(
+                xconfigGetDevicePciAddress(screen_list[i]->device));
+        }
     }
     
     for (i = 0; i < nscreens; i++) {
-        if (!screen_list[i] || (bus[i] == -1 &&
-            !xconfigParsePciBusString(screen_list[i]->device->busid,
-                                      &bus[i], &slot[i], &scratch))) {
+        if (!screen_list[i] || !addr[i]) {
             continue;
         }
 
         for (j = i+1; j < nscreens; j++) {
-            if (!screen_list[j] || (bus[j] == -1 &&
-                !xconfigParsePciBusString(screen_list[j]->device->busid,
-                                          &bus[j], &slot[j], &scratch))) {
-                continue;
-            }
-
-            if ((bus[i] == bus[j]) && (slot[i] == slot[j])) {
+            if (screen_list[j] && addr[j] == addr[i]) {
                 screen_list[j] = NULL;
             }
         }
@@ -193,7 +190,6 @@ static void clean_screen_list(XConfigScreenPtr *screen_list,
     
     for (i = 0; i < nscreens; i++) {
         XConfigScreenPtr screen, prev;
-        int bus0, slot0;
 
         if (!screen_list[i]) {
             continue;
@@ -209,15 +205,11 @@ static void clean_screen_list(XConfigScreenPtr *screen_list,
             if (!screen->device) {
                 goto next_screen;
             }
-            if (!screen->device->busid) {
-                goto next_screen;
-            }
-            if (!xconfigParsePciBusString(screen->device->busid,
-                                          &bus0, &slot0, &scratch)) {
+            if (!xconfigGetDevicePciAddress(screen->device)) {
                 goto next_screen;
             }
             
-            if ((bus[i] == bus0) && (slot[i] == slot0)) {
+            if (XCONFIG_PCI_SLOT_ADDRESS(screen->device->pciaddr) == addr[i]) {
                 XConfigScreenPtr next;
 
                 if (prev) {
@@ -243,6 +235,8 @@ static void clean_screen_list(XConfigScreenPtr *screen_list,
 
         screen_list[i]->device->screen = -1;
     }
+
+    nvfree(addr);
 }
 
 /*
@@ -293,25 +287,24 @@ int apply_multi_screen_options(Options *op, XConfigPtr config,
 
 
 /*
- * find_devices() - dlopen the nvidia-cfg library and query the
- * available information about the GPUs in the system.
+ * The nvidia-cfg session: the nvidia-cfg library is loaded the first
+ * time the GPUs are needed, each of its functions is looked up the
+ * first time it is called, and the GPUs are opened and probed once,
+ * tier by tier as callers need more of them; every find_devices() in
+ * the run shares the results, until
+ * reset_devices().  The device handles stay open for the whole
+ * session, and belong to the process that opened them.
  */
 
-DevicesPtr find_devices(Options *op)
-{
-    DevicesPtr pDevices = NULL;
-    DisplayDevicePtr pDisplayDevice;
-    int i, j, n, count = 0;
-    unsigned int mask, bit;
-    DeviceRec tmpDevice;
-    NvCfgPciDevice *devs = NULL;
-    NvCfgBool is_primary_device;
-    NvCfgBool ret;
-    char *lib_path;
+static struct {
+    int loaded;
+    pid_t pid;
+    char *nvidia_cfg_path;
     void *lib_handle;
 
-    NvCfgBool (*__getDevices)(int *n, NvCfgDevice **devs);
-    NvCfgBool (*__openDevice)(int bus, int slot, NvCfgDeviceHandle *handle);
+    int level;
+    DevicesPtr devices;
+
     NvCfgBool (*__getPciDevices)(int *n, NvCfgPciDevice **devs);
     NvCfgBool (*__openPciDevice)(int domain, int bus, int slot, int function,
                                  NvCfgDeviceHandle *handle);
@@ -326,56 +319,138 @@ DevicesPtr find_devices(Options *op)
                                   NvCfgBool *is_primary_device);
     NvCfgBool (*__closeDevice)(NvCfgDeviceHandle handle);
     NvCfgBool (*__getDeviceUUID)(NvCfgDeviceHandle handle, char **uuid);
-    
-    /* dlopen() the nvidia-cfg library */
-    
+} nvcfg_session;
+
 #define __LIB_NAME "libnvidia-cfg.so.1"
 
+/*
+ * __GET_FUNC() - evaluates to TRUE if the nvidia-cfg function is
+ * available, looking it up the first time; a missing function is
+ * looked up again on each use, but then the query fails anyway.
+ */
+
+#define __GET_FUNC(proc, name)                                        \
+    (nvcfg_session.proc ||                                            \
+     (nvcfg_session.proc = nvcfg_symbol((name), TRUE)) != NULL)
+
+
+
+/*
+ * nvcfg_symbol() - look up a function in the nvidia-cfg library
+ */
+
+static void *nvcfg_symbol(const char *name, int required)
+{
+    void *proc = dlsym(nvcfg_session.lib_handle, name);
+
+    if (!proc && required) {
+        nv_warning_msg("error retrieving symbol %s from %s: %s",
+                       name, __LIB_NAME, dlerror());
+    }
+
+    return proc;
+
+} /* nvcfg_symbol() */
+
+
+
+/*
+ * nvcfg_load() - dlopen the nvidia-cfg library, unless the session
+ * already has it; a different '--nvidia-cfg-path' starts a new session.
+ * Returns TRUE if the library is loaded.
+ */
+
+static int nvcfg_load(Options *op)
+{
+    char *lib_path;
+
+    if (nvcfg_session.loaded &&
+        ((nvcfg_session.nvidia_cfg_path == op->nvidia_cfg_path) ||
+         (nvcfg_session.nvidia_cfg_path && op->nvidia_cfg_path &&
+          strcmp(nvcfg_session.nvidia_cfg_path, op->nvidia_cfg_path) == 0))) {
+        return (nvcfg_session.lib_handle != NULL);
+    }
+
+    reset_devices();
+
     if (op->nvidia_cfg_path) {
         lib_path = nvstrcat(op->nvidia_cfg_path, "/", __LIB_NAME, NULL);
     } else {
-        lib_path = strdup(__LIB_NAME);
+        lib_path = nvstrdup(__LIB_NAME);
     }
-    
-    lib_handle = dlopen(lib_path, RTLD_NOW);
-    
+
+    nvcfg_session.lib_handle = dlopen(lib_path, RTLD_LAZY);
+
     nvfree(lib_path);
-    
-    if (!lib_handle) {
+
+    nvcfg_session.loaded = TRUE;
+    nvcfg_session.pid = getpid();
+    nvcfg_session.nvidia_cfg_path = op->nvidia_cfg_path ?
+        nvstrdup(op->nvidia_cfg_path) : NULL;
+
+    if (!nvcfg_session.lib_handle) {
         nv_warning_msg("error opening %s: %s.", __LIB_NAME, dlerror());
-        return NULL;
+        return FALSE;
     }
-    
-#define __GET_FUNC(proc, name)                                        \
-    (proc) = dlsym(lib_handle, (name));                               \
-    if (!(proc)) {                                                    \
-        nv_warning_msg("error retrieving symbol %s from %s: %s",      \
-                       (name), __LIB_NAME, dlerror());                \
-        dlclose(lib_handle);                                          \
-        return NULL;                                                  \
+
+    return TRUE;
+
+} /* nvcfg_load() */
+
+
+
+/*
+ * close_device_handles() - close the devices opened by
+ * probe_pci_devices()
+ */
+
+static void close_device_handles(DevicesPtr pDevices)
+{
+    int i;
+
+    for (i = 0; i < pDevices->nDevices; i++) {
+        if (pDevices->devices[i].handle) {
+            nvcfg_session.__closeDevice(pDevices->devices[i].handle);
+            pDevices->devices[i].handle = NULL;
+        }
     }
 
-    /* required functions */
-    __GET_FUNC(__getDevices, "nvCfgGetDevices");
-    __GET_FUNC(__openDevice, "nvCfgOpenDevice");
-    __GET_FUNC(__getPciDevices, "nvCfgGetPciDevices");
-    __GET_FUNC(__openPciDevice, "nvCfgOpenPciDevice");
-    __GET_FUNC(__getNumCRTCs, "nvCfgGetNumCRTCs");
-    __GET_FUNC(__getProductName, "nvCfgGetProductName");
-    __GET_FUNC(__getDisplayDevices, "nvCfgGetDisplayDevices");
-    __GET_FUNC(__getEDID, "nvCfgGetEDID");
-    __GET_FUNC(__closeDevice, "nvCfgCloseDevice");
-    __GET_FUNC(__getDeviceUUID, "nvCfgGetDeviceUUID");
-
-    /* optional functions */
-    __isPrimaryDevice = dlsym(lib_handle, "nvCfgIsPrimaryDevice");
-    
-    if (__getPciDevices(&count, &devs) != NVCFG_TRUE) {
+} /* close_device_handles() */
+
+
+
+/*
+ * probe_pci_devices() - the first tier of probing: find and open the
+ * GPUs in the system, primary GPU first.
+ */
+
+static DevicesPtr probe_pci_devices(void)
+{
+    DevicesPtr pDevices = NULL;
+    int i, count = 0;
+    DeviceRec tmpDevice;
+    NvCfgPciDevice *devs = NULL;
+    NvCfgBool is_primary_device;
+
+    if (!__GET_FUNC(__getPciDevices, "nvCfgGetPciDevices") ||
+        !__GET_FUNC(__openPciDevice, "nvCfgOpenPciDevice") ||
+        !__GET_FUNC(__closeDevice, "nvCfgCloseDevice")) {
+        return NULL;
+    }
+
+    if (nvcfg_session.__getPciDevices(&count, &devs) != NVCFG_TRUE) {
         return NULL;
     }
 
     if (count == 0) return NULL;
 
+    /* only needed to tell the primary GPU from the others */
+
+    if (count > 1 && !nvcfg_session.__isPrimaryDevice) {
+        nvcfg_session.__isPrimaryDevice =
+            nvcfg_symbol("nvCfgIsPrimaryDevice", FALSE);
+    }
+
     pDevices = nvalloc(sizeof(DevicesRec));
     
     pDevices->devices = nvalloc(sizeof(DeviceRec) * count);
@@ -383,34 +458,86 @@ DevicesPtr find_devices(Options *op)
     pDevices->nDevices = count;
 
     for (i = 0; i < count; i++) {
-        
+
         pDevices->devices[i].dev = devs[i];
         
-        if (__openPciDevice(devs[i].domain, devs[i].bus, devs[i].slot, 0,
-                            &(pDevices->devices[i].handle)) != NVCFG_TRUE) {
-            goto fail;
+        if (nvcfg_session.__openPciDevice(devs[i].domain, devs[i].bus,
+                                          devs[i].slot, 0,
+                                          &(pDevices->devices[i].handle)) !=
+            NVCFG_TRUE) {
+            nv_warning_msg("Unable to use the nvidia-cfg library to query "
+                           "NVIDIA hardware.");
+            close_device_handles(pDevices);
+            free_devices(pDevices);
+            pDevices = NULL;
+            break;
         }
-        
-        if (__getNumCRTCs(pDevices->devices[i].handle,
-                          &pDevices->devices[i].crtcs) != NVCFG_TRUE) {
-            goto fail;
+
+        if ((i != 0) && (nvcfg_session.__isPrimaryDevice != NULL) &&
+            (nvcfg_session.__isPrimaryDevice(pDevices->devices[i].handle,
+                                             &is_primary_device) ==
+             NVCFG_TRUE) &&
+            (is_primary_device == NVCFG_TRUE)) {
+            memcpy(&tmpDevice, &pDevices->devices[0], sizeof(DeviceRec));
+            memcpy(&pDevices->devices[0], &pDevices->devices[i], sizeof(DeviceRec));
+            memcpy(&pDevices->devices[i], &tmpDevice, sizeof(DeviceRec));
         }
+    }
+    
+    free(devs);
+    
+    return pDevices;
+    
+} /* probe_pci_devices() */
+
+
 
-        if (__getProductName(pDevices->devices[i].handle,
-                             &pDevices->devices[i].name) != NVCFG_TRUE) {
-            goto fail;
+/*
+ * probe_gpu_info() - the second tier of probing: query the number of
+ * CRTCs, the product name, the UUID and the display devices of each
+ * GPU.  The EDIDs of the display devices are left to query_edid().
+ * Returns FALSE if the GPUs could not be queried.
+ */
+
+static int probe_gpu_info(DevicesPtr pDevices)
+{
+    DevicePtr pDevice;
+    int i, j, n;
+    unsigned int mask;
+
+    for (i = 0; i < pDevices->nDevices; i++) {
+
+        pDevice = &pDevices->devices[i];
+
+        stats_begin("gpu PCI:%d@%d:%d:%d", pDevice->dev.bus,
+                    pDevice->dev.domain, pDevice->dev.slot,
+                    pDevice->dev.function);
+
+        if (!__GET_FUNC(__getNumCRTCs, "nvCfgGetNumCRTCs") ||
+            nvcfg_session.__getNumCRTCs(pDevice->handle,
+                                        &pDevice->crtcs) != NVCFG_TRUE) {
+            return FALSE;
         }
 
-        if (__getDeviceUUID(pDevices->devices[i].handle,
-                            &pDevices->devices[i].uuid) != NVCFG_TRUE) {
-            goto fail;
+        if (!__GET_FUNC(__getProductName, "nvCfgGetProductName") ||
+            nvcfg_session.__getProductName(pDevice->handle,
+                                           &pDevice->name) != NVCFG_TRUE) {
+            return FALSE;
         }
-        if (__getDisplayDevices(pDevices->devices[i].handle, &mask) !=
-            NVCFG_TRUE) {
-            goto fail;
+
+        if (!__GET_FUNC(__getDeviceUUID, "nvCfgGetDeviceUUID") ||
+            nvcfg_session.__getDeviceUUID(pDevice->handle,
+                                          &pDevice->uuid) != NVCFG_TRUE) {
+            return FALSE;
+        }
+
+        if (!__GET_FUNC(__getDisplayDevices, "nvCfgGetDisplayDevices") ||
+            nvcfg_session.__getDisplayDevices(pDevice->handle,
+                                              &mask) != NVCFG_TRUE) {
+            return FALSE;
         }
         
-        pDevices->devices[i].displayDeviceMask = mask;
+        pDevice->displayDeviceMask = mask;
 
         /* count the number of display devices */
         
@@ -418,82 +545,209 @@ DevicesPtr find_devices(Options *op)
             if (mask & (1 << j)) n++;
         }
         
-        pDevices->devices[i].nDisplayDevices = n;
+        pDevice->nDisplayDevices = n;
 
         if (n) {
 
             /* allocate the info array of the right size */
             
-            pDevices->devices[i].displayDevices =
-                nvalloc(sizeof(DisplayDeviceRec) * n);
+            pDevice->displayDevices = nvalloc(sizeof(DisplayDeviceRec) * n);
             
-            /* fill in the info array */
+            /* fill in the display device masks */
             
             for (n = j = 0; j < 32; j++) {
-                bit = 1 << j;
-                if (!(bit & mask)) continue;
-                
-                pDisplayDevice = &pDevices->devices[i].displayDevices[n];
-                pDisplayDevice->mask = bit;
-
-                if (__getEDID(pDevices->devices[i].handle, bit,
-                              &pDisplayDevice->info) != NVCFG_TRUE) {
-                    pDisplayDevice->info_valid = FALSE;
-                } else {
-                    pDisplayDevice->info_valid = TRUE;
-                }
-                n++;
+                if (!(mask & (1 << j))) continue;
+                pDevice->displayDevices[n++].mask = 1 << j;
             }
         } else {
-            pDevices->devices[i].displayDevices = NULL;
+            pDevice->displayDevices = NULL;
         }
 
-        if ((i != 0) && (__isPrimaryDevice != NULL) &&
-            (__isPrimaryDevice(pDevices->devices[i].handle,
-                               &is_primary_device) == NVCFG_TRUE) &&
-            (is_primary_device == NVCFG_TRUE)) {
-            memcpy(&tmpDevice, &pDevices->devices[0], sizeof(DeviceRec));
-            memcpy(&pDevices->devices[0], &pDevices->devices[i], sizeof(DeviceRec));
-            memcpy(&pDevices->devices[i], &tmpDevice, sizeof(DeviceRec));
-        }
-        
-        ret = __closeDevice(pDevices->devices[i].handle);
-        pDevices->devices[i].handle = NULL;
+        stats_end();
+    }
 
-        if (ret != NVCFG_TRUE) {
-            goto fail;
-        }
+    return TRUE;
+
+} /* probe_gpu_info() */
+
+
+
+/*
+ * query_edid() - the third tier of probing, for one display device:
+ * read its EDID over DDC, unless that has been done already.
+ */
+
+static void query_edid(DevicePtr pDevice, DisplayDevicePtr pDisplayDevice)
+{
+    if (pDisplayDevice->info_queried) return;
+
+    stats_begin("edid 0x%08x", pDisplayDevice->mask);
+
+    if (pDevice->handle &&
+        __GET_FUNC(__getEDID, "nvCfgGetEDID") &&
+        nvcfg_session.__getEDID(pDevice->handle, pDisplayDevice->mask,
+                                &pDisplayDevice->info) == NVCFG_TRUE) {
+        pDisplayDevice->info_valid = TRUE;
+    } else {
+        pDisplayDevice->info_valid = FALSE;
     }
-    
-    goto done;
-    
- fail:
+    pDisplayDevice->info_queried = TRUE;
 
-    nv_warning_msg("Unable to use the nvidia-cfg library to query NVIDIA "
-                   "hardware.");
+    stats_end();
 
-    for (i = 0; i < pDevices->nDevices; i++) {
-        /* close the opened device */
-        if (pDevices->devices[i].handle) {
-            __closeDevice(pDevices->devices[i].handle);
+} /* query_edid() */
+
+
+
+/*
+ * probe_devices() - probe the GPUs in the system up to the given tier
+ * (DEVICES_PCI, DEVICES_GPU_INFO or DEVICES_EDID); only the tiers not
+ * already probed in this session are probed now.
+ */
+
+static void probe_devices(int level)
+{
+    DevicesPtr pDevices;
+    int i, j;
+
+    if (nvcfg_session.level < DEVICES_PCI) {
+        nvcfg_session.devices = probe_pci_devices();
+        nvcfg_session.level = DEVICES_PCI;
+    }
+
+    pDevices = nvcfg_session.devices;
+    if (!pDevices) return;
+
+    if (level >= DEVICES_GPU_INFO &&
+        nvcfg_session.level < DEVICES_GPU_INFO) {
+        nvcfg_session.level = DEVICES_GPU_INFO;
+        if (!probe_gpu_info(pDevices)) {
+            nv_warning_msg("Unable to use the nvidia-cfg library to query "
+                           "NVIDIA hardware.");
+            close_device_handles(pDevices);
+            free_devices(pDevices);
+            nvcfg_session.devices = NULL;
+            return;
         }
     }
 
-    free_devices(pDevices);
-    pDevices = NULL;
+    if (level >= DEVICES_EDID &&
+        nvcfg_session.level < DEVICES_EDID) {
+        nvcfg_session.level = DEVICES_EDID;
+        for (i = 0; i < pDevices->nDevices; i++) {
+            for (j = 0; j < pDevices->devices[i].nDisplayDevices; j++) {
+                query_edid(&pDevices->devices[i],
+                           &pDevices->devices[i].displayDevices[j]);
+            }
+        }
+    }
 
-    /* fall through */
+} /* probe_devices() */
+
+
+
+/*
+ * find_devices() - query the GPUs in the system, probing as much as
+ * the given tier; see probe_devices().  The GPUs are only probed the
+ * first time; the caller gets its own copy of the results, to free
+ * with free_devices().  The EDIDs of the display devices are read by
+ * get_edid() when first needed, unless DEVICES_EDID is requested.
+ */
+
+DevicesPtr find_devices(Options *op, int level)
+{
+    DevicesPtr pDevices;
+    int depth = stats_depth();
+
+    stats_begin("find_devices");
+    if (!daemon_cached_devices(op, &pDevices)) {
+        if (nvcfg_load(op)) {
+            probe_devices(level);
+        }
+        pDevices = copy_devices(nvcfg_session.devices);
+    }
+    stats_unwind(depth);
 
- done:
-    
-    if (devs) free(devs);
-    
     return pDevices;
-    
+
 } /* find_devices() */
 
 
 
+/*
+ * get_edid() - return the EDID information of the given display device
+ * of a GPU found by find_devices(), or NULL if there is none.  The EDID
+ * is read through the nvidia-cfg session the first time, and kept in
+ * both the session and the caller's copy.
+ */
+
+NvCfgDisplayDeviceInformation *get_edid(DevicePtr pDevice, int display)
+{
+    DisplayDevicePtr pDisplayDevice = &pDevice->displayDevices[display];
+    DevicesPtr pDevices = nvcfg_session.devices;
+    DevicePtr pSessionDevice;
+    int i, j;
+
+    if (pDisplayDevice->info_queried) {
+        return pDisplayDevice->info_valid ? &pDisplayDevice->info : NULL;
+    }
+
+    /* find the GPU and display device in the session */
+
+    for (i = 0; pDevices && i < pDevices->nDevices; i++) {
+        pSessionDevice = &pDevices->devices[i];
+        if (pSessionDevice->dev.domain != pDevice->dev.domain ||
+            pSessionDevice->dev.bus != pDevice->dev.bus ||
+            pSessionDevice->dev.slot != pDevice->dev.slot) {
+            continue;
+        }
+        for (j = 0; j < pSessionDevice->nDisplayDevices; j++) {
+            if (pSessionDevice->displayDevices[j].mask ==
+                pDisplayDevice->mask) {
+                query_edid(pSessionDevice,
+                           &pSessionDevice->displayDevices[j]);
+                *pDisplayDevice = pSessionDevice->displayDevices[j];
+                break;
+            }
+        }
+        break;
+    }
+
+    pDisplayDevice->info_queried = TRUE;
+
+    return pDisplayDevice->info_valid ? &pDisplayDevice->info : NULL;
+
+} /* get_edid() */
+
+
+
+/*
+ * reset_devices() - end the nvidia-cfg session: close the GPUs and
+ * unload the nvidia-cfg library, so that the next find_devices() probes
+ * the GPUs again.  A forked child leaves the GPUs to its parent.
+ */
+
+void reset_devices(void)
+{
+    if (nvcfg_session.devices) {
+        if (nvcfg_session.pid == getpid()) {
+            close_device_handles(nvcfg_session.devices);
+        }
+        free_devices(nvcfg_session.devices);
+    }
+
+    if (nvcfg_session.lib_handle) {
+        dlclose(nvcfg_session.lib_handle);
+    }
+
+    nvfree(nvcfg_session.nvidia_cfg_path);
+
+    memset(&nvcfg_session, 0, sizeof(nvcfg_session));
+
+} /* reset_devices() */
+
+
+
 /*
  * free_devices()
  */
@@ -520,6 +774,45 @@ void free_devices(DevicesPtr pDevices)
 
 
 
+/*
+ * copy_devices() - duplicate the query results; the product names and
+ * UUIDs, owned by the nvidia-cfg library, are shared, and the device
+ * handles stay with the nvidia-cfg session
+ */
+
+DevicesPtr copy_devices(DevicesPtr pDevices)
+{
+    DevicesPtr pCopy;
+    DevicePtr dev;
+    int i;
+
+    if (!pDevices) return NULL;
+
+    pCopy = nvalloc(sizeof(DevicesRec));
+    pCopy->nDevices = pDevices->nDevices;
+    pCopy->devices = nvalloc(sizeof(DeviceRec) * pDevices->nDevices);
+
+    memcpy(pCopy->devices, pDevices->devices,
+           sizeof(DeviceRec) * pDevices->nDevices);
+
+    for (i = 0; i < pCopy->nDevices; i++) {
+        dev = &pCopy->devices[i];
+        dev->handle = NULL;
+        if (dev->displayDevices) {
+            dev->displayDevices =
+                nvalloc(sizeof(DisplayDeviceRec) * dev->nDisplayDevices);
+            memcpy(dev->displayDevices,
+                   pDevices->devices[i].displayDevices,
+                   sizeof(DisplayDeviceRec) * dev->nDisplayDevices);
+        }
+    }
+
+    return pCopy;
+
+} /* copy_devices() */
+
+
+
 /*
  * set_xinerama() - This makes sure there is a ServerLayout
  * section and sets the "Xinerama" option
@@ -616,7 +909,7 @@ static int enable_separate_x_screens(Options *op, XConfigPtr config,
     if (!have_busids) {
         DevicesPtr pDevices;
         
-        pDevices = find_devices(op);
+        pDevices = find_devices(op, DEVICES_GPU_INFO);
         if (!pDevices) {
             nv_error_msg("Unable to determine number or location of "
                          "GPUs in system; cannot "
@@ -634,11 +927,13 @@ static int enable_separate_x_screens(Options *op, XConfigPtr config,
                 continue;
             }
             
+            screenlist[i]->device->pciaddr =
+                XCONFIG_PCI_ADDRESS(pDevices->devices[i].dev.domain,
+                                    pDevices->devices[i].dev.bus,
+                                    pDevices->devices[i].dev.slot, 0);
             screenlist[i]->device->busid = nvalloc(32);
-            xconfigFormatPciBusString(screenlist[i]->device->busid, 32,
-                                      pDevices->devices[i].dev.domain,
-                                      pDevices->devices[i].dev.bus,
-                                      pDevices->devices[i].dev.slot, 0);
+            xconfigFormatPciAddress(screenlist[i]->device->busid, 32,
+                                    screenlist[i]->device->pciaddr);
 
             screenlist[i]->device->board = nvstrdup(pDevices->devices[i].name);
         }
@@ -738,12 +1033,9 @@ static int disable_separate_x_screens(Options *op, XConfigPtr config,
      */
     
     for (i = 0; i < nscreens; i++) {
-        int bus, slot, scratch;
         if (screenlist[i] &&
             screenlist[i]->device &&
-            screenlist[i]->device->busid &&
-            xconfigParsePciBusString(screenlist[i]->device->busid,
-                                     &bus, &slot, &scratch)) {
+            xconfigGetDevicePciAddress(screenlist[i]->device)) {
             // this screen has a valid busid
         } else {
             screenlist[i] = NULL;
@@ -773,34 +1065,6 @@ static int disable_separate_x_screens(Options *op, XConfigPtr config,
 } /* disable_separate_x_screens() */
 
 
-/*
- * clone_display_list() - create a duplicate of the specified display
- * subsection.
- */
-
-static XConfigDisplayPtr clone_display_list(XConfigDisplayPtr display0)
-{
-    XConfigDisplayPtr d = NULL, prev = NULL, head = NULL;
-    
-    while (display0) {
-        d = nvalloc(sizeof(XConfigDisplayRec));
-        memcpy(d, display0, sizeof(XConfigDisplayRec));
-        if (display0->visual) d->visual = nvstrdup(display0->visual);
-        if (display0->comment) d->comment = nvstrdup(display0->comment);
-        d->options = xconfigOptionListDup(display0->options);
-        d->next = NULL;
-        if (prev) prev->next = d;
-        if (!head) head = d;
-        prev = d;
-        display0 = display0->next;
-    }
-    
-    return head;
-    
-} /* clone_display_list() */
-
-
-
 /*
  * clone_device() - duplicate the specified device section, updating
  * the screen indices as approprate for multiple X screens on one GPU
@@ -818,6 +1082,7 @@ static XConfigDevicePtr clone_device(XConfigDevicePtr device0, int idx)
     if (device0->board)   device->board   = nvstrdup(device0->board);
     if (device0->chipset) device->chipset = nvstrdup(device0->chipset);
     if (device0->busid)   device->busid   = nvstrdup(device0->busid);
+    device->pciaddr = device0->pciaddr;
     if (device0->card)    device->card    = nvstrdup(device0->card);
     if (device0->driver)  device->driver  = nvstrdup(device0->driver);
     if (device0->ramdac)  device->ramdac  = nvstrdup(device0->ramdac);
@@ -832,7 +1097,12 @@ static XConfigDevicePtr clone_device(XConfigDevicePtr device0, int idx)
     device->chiprev = -1;
     device->irq = -1;
 
-    device->options = xconfigOptionListDup(device0->options);
+    /*
+     * the option list is shared with the original device; it is
+     * unshared (copied) only if the clone's options are modified
+     */
+
+    device->options = xconfigOptionListRef(device0->options);
     
     /* insert the new device after the original device */
     
@@ -864,9 +1134,14 @@ static XConfigScreenPtr clone_screen(XConfigScreenPtr screen0, int idx)
     
     screen->defaultdepth = screen0->defaultdepth;
     
-    screen->displays = clone_display_list(screen0->displays);
+    /*
+     * share the display subsections and options with the original
+     * screen; they are copied on write by update_screen()
+     */
+
+    screen->displays = xconfigDisplayListRef(screen0->displays);
     
-    screen->options = xconfigOptionListDup(screen0->options);
+    screen->options = xconfigOptionListRef(screen0->options);
     if (screen0->comment) screen->comment = nvstrdup(screen0->comment);
 
     /* insert the new screen after the original screen */
@@ -934,7 +1209,7 @@ static int enable_all_gpus(Options *op, XConfigPtr config,
     DevicesPtr pDevices;
     int i;
 
-    pDevices = find_devices(op);
+    pDevices = find_devices(op, DEVICES_GPU_INFO);
     if (!pDevices) {
         nv_error_msg("Unable to determine number of GPUs in system; cannot "
                      "honor '--enable-all-gpus' option.");
@@ -184,6 +184,32 @@ static void parse_commandline(Options *op, int argc, char *argv[])
             
         case MOUSE_OPTION: op->gop.mouse = strval; break;
         case MOUSE_LIST_OPTION: op->mouse_list = TRUE; break;
+
+        case INPUT_ROOT_OPTION: op->gop.input_root = strval; break;
+
+        case STATS_OPTION: op->stats_file = strval; break;
+
+        case LAYER_OPTION: nv_text_rows_append(&op->layers, strval); break;
+
+        case DIFF_OPTION: op->diff_file = strval; break;
+
+        case PATCH_OPTION: op->patch_file = strval; break;
+
+        case HOIST_MODELINES_OPTION: op->hoist_modelines = TRUE; break;
+
+        case SNAPSHOT_OPTION: op->snapshot_file = strval; break;
+
+        case EXPORT_JSON_OPTION: op->export_json_file = strval; break;
+
+        case IMPORT_JSON_OPTION: op->import_json_file = strval; break;
+
+        case DAEMON_OPTION: op->daemon_socket = strval; break;
+
+        case USE_DAEMON_OPTION: op->use_daemon = strval; break;
+
+        case WATCH_OPTION: op->watch = TRUE; break;
+
+        case WATCH_UEVENTS_OPTION: op->watch_uevents = strval; break;
             
         case NVIDIA_CFG_PATH_OPTION: op->nvidia_cfg_path = strval; break;
 
@@ -762,16 +788,14 @@ static char *find_xconfig(Options *op, XConfigPtr config)
         filename = nvstrdup(config->filename);
     }
     
-    /* use xf86openConfigFile() */
+    /* use the parser's config file search */
     
     if (!filename) {
         const char *f;
-        f = xconfigOpenConfigFile(NULL, op->gop.x_project_root);
+        f = xconfigFindConfigFile(NULL, op->gop.x_project_root);
         if (f) {
-            /* dup the string since closing the config file will free
-               the string */
+            /* dup the string since the next search may replace it */
             filename = nvstrdup(f);
-            xconfigCloseConfigFile();
         }
     }
     
@@ -880,7 +904,7 @@ static int write_xconfig(Options *op, XConfigPtr config, int first_touch)
 {
     char *filename = find_xconfig(op, config);
     char *d, *tmp = NULL;
-    int ret = FALSE;
+    int ret = FALSE, written;
 
     /*
      * XXX it's strange that lack of permission to write to the target
@@ -925,9 +949,21 @@ static int write_xconfig(Options *op, XConfigPtr config, int first_touch)
         free(fakeorig);
     }
     
+    /* share the modelines that Monitor sections have in common */
+
+    if (op->hoist_modelines) {
+        stats_begin("xconfigHoistModeLines");
+        xconfigHoistModeLines(config);
+        stats_end();
+    }
+
     /* write the config file */
 
-    if (!xconfigWriteConfigFile(filename, config)) {
+    stats_begin("xconfigWriteConfigFile");
+    written = xconfigWriteConfigFile(filename, config);
+    stats_end();
+
+    if (!written) {
         nv_error_msg("Unable to write file \"%s\"; please use the "
                      "\"--output-xconfig\" commandline option to specify "
                      "an alternative output file.", filename);
@@ -1018,33 +1054,32 @@ static void update_banner(XConfigPtr config)
         "# nvidia-xconfig: ";
 
     char *s = config->comment;
-    char *line, *eol, *tmp;
+    char *src, *dst, *line, *eol;
     
-    /* remove all lines that begin with the prefix */
+    /*
+     * remove all lines that begin with the prefix; this is done in a
+     * single pass, compacting the comment in place, so that a comment
+     * with many banner lines is not rebuilt once per line
+     */
     
-    while (s && (line = find_banner_prefix(s))) {
+    if (s) {
+        src = dst = s;
         
-        eol = strchr(line, '\n'); /* find the end of the line */
-        
-        if (eol) {
-            eol++;
-            if (*eol == '\0') eol = NULL;
+        while ((line = find_banner_prefix(src))) {
+            
+            eol = strchr(line, '\n'); /* find the end of the line */
+            eol = eol ? eol + 1 : line + strlen(line);
+            
+            memmove(dst, src, line - src);
+            dst += line - src;
+            src = eol;
         }
         
-        if (line == s) { /* the line with the prefix is at the start */
-            if (eol) {   /* there is more after the prefix line */
-                tmp = strdup(eol);
-                free(s);
-                s = tmp;
-            } else {     /* the prefix line is the only line */
-                free(s);
-                s = NULL;
-            }
-        } else {         /* prefix line is in the middle or end */
-            *line = '\0';
-            tmp = nvstrcat(s, eol, NULL);
+        memmove(dst, src, strlen(src) + 1);
+        
+        if (*s == '\0') { /* the prefix lines were the only lines */
             free(s);
-            s = tmp;
+            s = NULL;
         }
     }
     
@@ -1068,10 +1103,13 @@ static XConfigPtr find_system_xconfig(Options *op)
     const char *filename;
     XConfigPtr config;
     XConfigError error;
+    int depth, ret;
 
     /* Find and open the existing X config file */
     
+    stats_begin("xconfigOpenConfigFile");
     filename = xconfigOpenConfigFile(op->xconfig, op->gop.x_project_root);
+    stats_end();
     
     if (filename) {
         nv_info_msg(NULL, "");
@@ -1081,12 +1119,50 @@ static XConfigPtr find_system_xconfig(Options *op)
         return NULL;
     }
     
-    /* Read the opened X config file */
-    
-    error = xconfigReadConfigFile(&config);
-    if (error != XCONFIG_RETURN_SUCCESS) {
-        xconfigCloseConfigFile();
-        return NULL;;
+    /* Use the daemon's parse of the X config file, if it is current */
+
+    config = daemon_cached_xconfig(filename);
+
+    /* Load the X config from its snapshot, if the snapshot is current */
+
+    if (!config && op->snapshot_file) {
+        stats_begin("xconfigReadSnapshot");
+        ret = xconfigReadSnapshot(op->snapshot_file, filename, &config);
+        stats_end();
+
+        if (ret) {
+            nv_info_msg(NULL, "Using X configuration snapshot: \"%s\".",
+                        op->snapshot_file);
+        }
+    }
+
+    /* Otherwise, read the opened X config file */
+
+    if (!config) {
+        stats_input(filename);
+        depth = stats_depth();
+        stats_begin("xconfigReadConfigFile");
+        error = xconfigReadConfigFile(&config);
+        stats_unwind(depth);
+        stats_input_end();
+
+        if (error != XCONFIG_RETURN_SUCCESS) {
+            xconfigCloseConfigFile();
+            return NULL;;
+        }
+
+        daemon_report_xconfig(filename);
+
+        if (op->snapshot_file) {
+            stats_begin("xconfigWriteSnapshot");
+            ret = xconfigWriteSnapshot(op->snapshot_file, config, filename);
+            stats_end();
+
+            if (!ret) {
+                nv_warning_msg("Unable to write the X configuration "
+                               "snapshot \"%s\".", op->snapshot_file);
+            }
+        }
     }
 
     /* Close the X config file */
@@ -1095,7 +1171,11 @@ static XConfigPtr find_system_xconfig(Options *op)
     
     /* Sanitize the X config file */
     
-    if (!xconfigSanitizeConfig(config, op->screen, &(op->gop))) {
+    stats_begin("xconfigSanitizeConfig");
+    ret = xconfigSanitizeConfig(config, op->screen, &(op->gop));
+    stats_end();
+
+    if (!ret) {
         xconfigFreeConfig(&config);
         return NULL;
     }
@@ -1106,30 +1186,304 @@ static XConfigPtr find_system_xconfig(Options *op)
 
 
 
-static int update_xconfig(Options *op, XConfigPtr config)
+/*
+ * import_xconfig() - read the X config from the JSON file given with
+ * "--import-json", in place of the system X config file; returns
+ * XConfigPtr if successful, otherwise returns NULL.
+ */
+
+static XConfigPtr import_xconfig(Options *op)
 {
-    XConfigLayoutPtr layout;
-    XConfigAdjacencyPtr adj;
-    int updated;
+    XConfigPtr config;
+    XConfigError error;
+    int ret;
 
-    /* get the layout to update */
-    
-    layout = get_layout(op, config);
-    if (!layout) {
+    stats_input(op->import_json_file);
+
+    stats_begin("xconfigReadJson");
+    error = xconfigReadJson(op->import_json_file, &config);
+    stats_end();
+    stats_input_end();
+
+    if (error != XCONFIG_RETURN_SUCCESS) {
+        return NULL;
+    }
+
+    nv_info_msg(NULL, "");
+    nv_info_msg(NULL, "Using X configuration from JSON file: \"%s\".",
+                op->import_json_file);
+
+    stats_begin("xconfigSanitizeConfig");
+    ret = xconfigSanitizeConfig(config, op->screen, &(op->gop));
+    stats_end();
+
+    if (!ret) {
+        xconfigFreeConfig(&config);
+        return NULL;
+    }
+
+    return config;
+
+} /* import_xconfig() */
+
+
+
+/*
+ * export_xconfig() - write the X config as JSON to the file given with
+ * "--export-json", or to stdout if the file is "-".  Returns TRUE if
+ * successful, otherwise returns FALSE.
+ */
+
+static int export_xconfig(Options *op, XConfigPtr config)
+{
+    FILE *fp;
+    int ret;
+
+    if (!config) {
+        nv_error_msg("Unable to read the X configuration file to export.");
         return FALSE;
     }
 
-    /* apply multi-display options */
-    
-    if (!apply_multi_screen_options(op, config, layout)) {
+    if (strcmp(op->export_json_file, "-") == 0) {
+        fp = stdout;
+    } else {
+        fp = fopen(op->export_json_file, "w");
+        if (!fp) {
+            nv_error_msg("Unable to open '%s' for writing (%s).",
+                         op->export_json_file, strerror(errno));
+            return FALSE;
+        }
+    }
+
+    stats_begin("xconfigWriteJson");
+    ret = xconfigWriteJson(fp, config);
+    stats_end();
+
+    if ((fp != stdout) && (fclose(fp) != 0)) {
+        ret = FALSE;
+    }
+
+    if (!ret) {
+        nv_error_msg("Unable to write the X configuration to '%s' (%s).",
+                     op->export_json_file, strerror(errno));
+    }
+
+    return ret;
+
+} /* export_xconfig() */
+
+
+
+/*
+ * read_layer() - read the named X config file to be layered onto the
+ * config; layers are opened as named, without searching the X config
+ * search path, and are not validated, since they usually refer to
+ * sections defined by the config they are layered onto.  Returns
+ * XConfigPtr if successful, otherwise returns NULL.
+ */
+
+static XConfigPtr read_layer(const char *filename)
+{
+    XConfigPtr config;
+    XConfigError error;
+
+    if (!xconfigOpenConfigFilePath(filename)) {
+        nv_error_msg("Unable to open X configuration file '%s' (%s).",
+                     filename, strerror(errno));
+        return NULL;
+    }
+
+    stats_input(filename);
+
+    stats_begin("xconfigReadConfigFileLayer %s", filename);
+    error = xconfigReadConfigFileLayer(&config);
+    stats_end();
+    stats_input_end();
+
+    xconfigCloseConfigFile();
+
+    if (error != XCONFIG_RETURN_SUCCESS) {
+        nv_error_msg("Unable to parse X configuration file '%s'.", filename);
+        return NULL;
+    }
+
+    return config;
+
+} /* read_layer() */
+
+
+
+/*
+ * merge_layers() - read each X config file given with "--layer", and
+ * layer them onto the config in the order given, so that later layers
+ * take precedence over earlier ones.  Returns TRUE if successful,
+ * otherwise returns FALSE.
+ */
+
+static int merge_layers(Options *op, XConfigPtr config)
+{
+    XConfigPtr *layers;
+    int i, ret = FALSE;
+
+    layers = nvalloc(op->layers.n * sizeof(XConfigPtr));
+
+    for (i = 0; i < op->layers.n; i++) {
+        nv_info_msg(NULL, "Layering X configuration file: \"%s\".",
+                    op->layers.t[i]);
+
+        stats_begin("layer %s", op->layers.t[i]);
+        layers[i] = read_layer(op->layers.t[i]);
+        stats_end();
+
+        if (!layers[i]) {
+            goto done;
+        }
+    }
+
+    stats_begin("xconfigMergeConfigList");
+    ret = xconfigMergeConfigList(config, layers, op->layers.n);
+    stats_end();
+
+    if (!ret) {
+        nv_error_msg("Unable to merge the layered X configuration files.");
+        goto done;
+    }
+
+    /* the layers may add screens that are not yet in the layout */
+
+    stats_begin("xconfigSanitizeConfig");
+    ret = xconfigSanitizeConfig(config, op->screen, &(op->gop));
+    stats_end();
+
+ done:
+
+    for (i = 0; i < op->layers.n; i++) {
+        xconfigFreeConfig(&layers[i]);
+    }
+    nvfree(layers);
+
+    return ret;
+
+} /* merge_layers() */
+
+
+
+/*
+ * diff_xconfig() - read the X config file given with "--diff", and
+ * print to stdout a patch that changes the config into it; see
+ * xconfigDiffConfigs().  Returns TRUE if successful, otherwise returns
+ * FALSE.
+ */
+
+static int diff_xconfig(Options *op, XConfigPtr config)
+{
+    XConfigPtr target;
+    XConfigError error;
+    const char *uncovered;
+    int ret;
+
+    if (!xconfigOpenConfigFilePath(op->diff_file)) {
+        nv_error_msg("Unable to open X configuration file '%s' (%s).",
+                     op->diff_file, strerror(errno));
         return FALSE;
     }
 
-    /*
-     * update the device and option for all screens, or the screen
-     * or device that was requested.
-     */
-    updated = FALSE;
+    stats_input(op->diff_file);
+
+    stats_begin("xconfigReadConfigFile %s", op->diff_file);
+    error = xconfigReadConfigFile(&target);
+    stats_end();
+    stats_input_end();
+
+    xconfigCloseConfigFile();
+
+    if (error != XCONFIG_RETURN_SUCCESS) {
+        nv_error_msg("Unable to parse X configuration file '%s'.",
+                     op->diff_file);
+        return FALSE;
+    }
+
+    /* sanitize the target as the system config was, so that only real
+     * differences end up in the patch */
+
+    stats_begin("xconfigSanitizeConfig");
+    ret = xconfigSanitizeConfig(target, op->screen, &(op->gop));
+    stats_end();
+
+    if (ret) {
+        stats_begin("xconfigDiffConfigs");
+        ret = (xconfigDiffConfigs(stdout, config, target, &uncovered) >= 0);
+        stats_end();
+
+        if (!ret && !uncovered) {
+            nv_error_msg("Unable to print a patch for '%s'.", op->diff_file);
+        } else if (!ret) {
+            nv_error_msg("Unable to print a patch for '%s': the X "
+                         "configuration files differ in a %s section in a "
+                         "way that a patch cannot express.",
+                         op->diff_file, uncovered);
+        } else if (fflush(stdout) != 0) {
+            nv_error_msg("Unable to write the patch (%s).", strerror(errno));
+            ret = FALSE;
+        }
+    }
+
+    xconfigFreeConfig(&target);
+
+    return ret;
+
+} /* diff_xconfig() */
+
+
+
+/*
+ * apply_patch() - apply the patch file given with "--patch" to the
+ * config.  Returns TRUE if successful, otherwise returns FALSE.
+ */
+
+static int apply_patch(Options *op, XConfigPtr config)
+{
+    XConfigError error;
+
+    if (!xconfigOpenConfigFilePath(op->patch_file)) {
+        nv_error_msg("Unable to open patch file '%s' (%s).",
+                     op->patch_file, strerror(errno));
+        return FALSE;
+    }
+
+    nv_info_msg(NULL, "Applying X configuration patch: \"%s\".",
+                op->patch_file);
+
+    stats_input(op->patch_file);
+
+    stats_begin("xconfigApplyPatch");
+    error = xconfigApplyPatch(config);
+    stats_end();
+    stats_input_end();
+
+    xconfigCloseConfigFile();
+
+    if (error != XCONFIG_RETURN_SUCCESS) {
+        nv_error_msg("Unable to apply patch file '%s'.", op->patch_file);
+        return FALSE;
+    }
+
+    return TRUE;
+
+} /* apply_patch() */
+
+
+
+/*
+ * update_screens() - update the device and options of all screens in
+ * the layout, or of the screen or device that was requested
+ */
+
+static int update_screens(Options *op, XConfigPtr config,
+                          XConfigLayoutPtr layout)
+{
+    XConfigAdjacencyPtr adj;
+    int updated = FALSE;
 
     for (adj = layout->adjacencies; adj; adj = adj->next) {
 
@@ -1165,6 +1519,38 @@ static int update_xconfig(Options *op, XConfigPtr config)
         return FALSE;
     }
 
+    return TRUE;
+
+} /* update_screens() */
+
+
+
+static int update_xconfig(Options *op, XConfigPtr config)
+{
+    XConfigLayoutPtr layout;
+
+    /* get the layout to update */
+    
+    layout = get_layout(op, config);
+    if (!layout) {
+        return FALSE;
+    }
+
+    /* apply multi-display options */
+    
+    if (!apply_multi_screen_options(op, config, layout)) {
+        return FALSE;
+    }
+
+    /*
+     * update the device and option for all screens, or the screen
+     * or device that was requested.
+     */
+
+    if (!update_screens(op, config, layout)) {
+        return FALSE;
+    }
+
     update_extensions(op, config);
 
     update_modules(config);
@@ -1180,7 +1566,160 @@ static int update_xconfig(Options *op, XConfigPtr config)
 
 
 /*
- * main program entry point
+ * update_hardware() - redo the steps of update_xconfig() that depend on
+ * the GPUs in the system, after GPUs have been added or removed.
+ * Returns FALSE if there is nothing to redo, or if it failed.
+ */
+
+static int update_hardware(Options *op, XConfigPtr config)
+{
+    XConfigLayoutPtr layout;
+
+    /* only the multi-screen options depend on the GPUs */
+
+    if (!op->enable_all_gpus && !op->only_one_screen &&
+        !GET_BOOL_OPTION(op->boolean_options,
+                         SEPARATE_X_SCREENS_BOOL_OPTION)) {
+        return FALSE;
+    }
+
+    layout = get_layout(op, config);
+    if (!layout) {
+        return FALSE;
+    }
+
+    if (!apply_multi_screen_options(op, config, layout) ||
+        !update_screens(op, config, layout)) {
+        return FALSE;
+    }
+
+    update_modules(config);
+
+    return TRUE;
+
+} /* update_hardware() */
+
+
+
+/*
+ * reload_xconfig() - read the X config again, as nvidia_xconfig() did,
+ * after the X config files have changed, and update it
+ */
+
+static XConfigPtr reload_xconfig(Options *op)
+{
+    XConfigPtr config = NULL;
+
+    if (op->import_json_file) {
+        config = import_xconfig(op);
+    } else if (!op->force_generate) {
+        config = find_system_xconfig(op);
+    }
+
+    if (!config) {
+        config = xconfigGenerate(&op->gop);
+    }
+
+    if (!config) {
+        return NULL;
+    }
+
+    if ((op->layers.n && !merge_layers(op, config)) ||
+        !update_xconfig(op, config)) {
+        xconfigFreeConfig(&config);
+        return NULL;
+    }
+
+    return config;
+
+} /* reload_xconfig() */
+
+
+
+/*
+ * watch_xconfig() - for '--watch': once the X config has been written,
+ * keep it up to date.  When the X config files change, the X config is
+ * read and updated again; when NVIDIA GPUs are added or removed, only
+ * the steps that depend on the GPUs are redone.  Runs until SIGTERM or
+ * SIGINT; returns TRUE if the X config was written successfully each
+ * time.
+ */
+
+static int watch_xconfig(Options *op, XConfigPtr config)
+{
+    WatchPtr w;
+    XConfigPtr new_config;
+    char *filename;
+    int what, i, ret = TRUE;
+
+    w = watch_open(op->watch_uevents);
+    if (!w) return FALSE;
+
+    filename = find_xconfig(op, config);
+
+    if (!watch_file(w, filename)) {
+        ret = FALSE;
+        goto done;
+    }
+
+    if (op->import_json_file) {
+        ret = watch_file(w, op->import_json_file);
+    } else if (config->filename) {
+        ret = watch_file(w, config->filename);
+    }
+
+    for (i = 0; ret && (i < op->layers.n); i++) {
+        ret = watch_file(w, op->layers.t[i]);
+    }
+
+    if (!ret) goto done;
+
+    nv_info_msg(NULL, "");
+    nv_info_msg(NULL, "Watching for changes to the X configuration and the "
+                "GPUs.");
+    fflush(stdout);
+
+    while ((what = watch_wait(w)) != 0) {
+
+        /* the GPUs found before may be gone */
+
+        if (what & WATCH_HARDWARE) {
+            reset_devices();
+        }
+
+        if (what & WATCH_CONFIG) {
+            new_config = reload_xconfig(op);
+            if (!new_config) {
+                nv_error_msg("Unable to update the changed X configuration.");
+                continue;
+            }
+            xconfigFreeConfig(&config);
+            config = new_config;
+        } else if (!update_hardware(op, config)) {
+            continue;
+        }
+
+        ret = write_xconfig(op, config,
+                            find_banner_prefix(config->comment) == NULL);
+        watch_file_written(w, filename);
+        fflush(stdout);
+    }
+
+ done:
+    watch_close(w);
+    nvfree(filename);
+    xconfigFreeConfig(&config);
+
+    return ret;
+
+} /* watch_xconfig() */
+
+
+
+/*
+ * nvidia_xconfig() - run the given command line; returns the exit
+ * status.  This is the main program, and is also run by the daemon's
+ * workers for each request (see daemon.c).
  *
  * The intended behavior is that, by default, nvidia-xconfig make the
  * system's X config file usable by the NVIDIA X driver.  If
@@ -1190,12 +1729,13 @@ static int update_xconfig(Options *op, XConfigPtr config)
  *
  */
 
-int main(int argc, char *argv[])
+int nvidia_xconfig(int argc, char *argv[])
 {
     Options *op;
     int ret;
     XConfigPtr config = NULL;
     int first_touch = 0;
+    int depth;
     
     /* Load defaults */
 
@@ -1208,6 +1748,19 @@ int main(int argc, char *argv[])
     /* parse the commandline */
 
     parse_commandline(op, argc, argv);
+
+    /* serve requests as a daemon, or have a daemon run this one */
+
+    if (op->daemon_socket) {
+        return run_daemon(op);
+    }
+
+    if (op->use_daemon && !op->watch &&
+        daemon_request(op->use_daemon, argc, argv, &ret)) {
+        return ret;
+    }
+
+    stats_init(op->stats_file);
     
     /*
      * first, check for any of special options that cause us to exit
@@ -1240,7 +1793,7 @@ int main(int argc, char *argv[])
 
     if (op->restore_original_backup) {
         config = find_system_xconfig(op);
-        xconfigGetXServerInUse(&op->gop);
+        daemon_get_xserver_in_use(&op->gop);
         ret = restore_backup(op, config, ORIG_SUFFIX);
         return (ret ? 0 : 1);
     }
@@ -1250,10 +1803,34 @@ int main(int argc, char *argv[])
      * if possible
      */
 
-    if (!op->force_generate) {
+    /* a patch printed with "--diff", or JSON exported to stdout, must not
+     * be mixed with messages */
+
+    if (op->diff_file ||
+        (op->export_json_file && (strcmp(op->export_json_file, "-") == 0))) {
+        nv_set_verbosity(NV_VERBOSITY_WARNING);
+    }
+
+    if (op->import_json_file) {
+        config = import_xconfig(op);
+        if (!config) {
+            nv_error_msg("Unable to import the X configuration from '%s'.",
+                         op->import_json_file);
+            return 1;
+        }
+    } else if (!op->force_generate) {
         config = find_system_xconfig(op);
     }
     
+    /*
+     * export the system config (if any) as JSON
+     */
+
+    if (op->export_json_file) {
+        ret = export_xconfig(op, config);
+        return (ret ? 0 : 1);
+    }
+
     /*
      * pass the system config (if any) to the tree printer
      */
@@ -1262,11 +1839,38 @@ int main(int argc, char *argv[])
         ret = print_tree(op, config);
         return (ret ? 0 : 1);
     }
+
+    /*
+     * "--diff" and "--patch" work on the system config as it is; no
+     * config is generated for them, and no other updates are made
+     */
+
+    if ((op->diff_file || op->patch_file) && !config) {
+        nv_error_msg("Unable to read the X configuration file to %s.",
+                     op->diff_file ? "compare" : "patch");
+        return 1;
+    }
+
+    if (op->diff_file) {
+        ret = diff_xconfig(op, config);
+        return (ret ? 0 : 1);
+    }
+
+    if (op->patch_file) {
+        if (!apply_patch(op, config)) {
+            return 1;
+        }
+        first_touch = (find_banner_prefix(config->comment) == NULL);
+        ret = write_xconfig(op, config, first_touch);
+        return (ret ? 0 : 1);
+    }
     
     /*
      * Get which X server is in use: Xorg or XFree86
      */
-    xconfigGetXServerInUse(&op->gop);
+    stats_begin("xconfigGetXServerInUse");
+    daemon_get_xserver_in_use(&op->gop);
+    stats_end();
     
     /*
      * if we failed to find the system's config file, generate a new
@@ -1274,7 +1878,9 @@ int main(int argc, char *argv[])
      */
     
     if (!config) {
+        stats_begin("xconfigGenerate");
         config = xconfigGenerate(&op->gop);
+        stats_end();
         first_touch = 1;
     }
 
@@ -1288,6 +1894,12 @@ int main(int argc, char *argv[])
         return 1;
     }
 
+    /* layer any X config files given with "--layer" onto the config */
+
+    if (op->layers.n && !merge_layers(op, config)) {
+        return 1;
+    }
+
     /* if a config file existed, check to see if it had an nvidia-xconfig
      * banner: this would suggest that we've touched this file before.
      */
@@ -1298,7 +1910,12 @@ int main(int argc, char *argv[])
 
     /* now, we have a good config; apply whatever the user requested */
     
+    depth = stats_depth();
+    stats_begin("update_xconfig");
     update_xconfig(op, config);
+    stats_unwind(depth);
+
+    stats_tree(config);
 
     /* print the config in tree format, if requested */
 
@@ -1313,6 +1930,29 @@ int main(int argc, char *argv[])
         return 1;
     }
 
+    /* keep it up to date, if requested */
+
+    if (op->watch) {
+        ret = watch_xconfig(op, config);
+        return (ret ? 0 : 1);
+    }
+
     return 0;
     
+} /* nvidia_xconfig() */
+
+
+
+/*
+ * main program entry point
+ */
+
+int main(int argc, char *argv[])
+{
+    int ret = nvidia_xconfig(argc, argv);
+
+    reset_devices();
+
+    return ret;
+
 } /* main() */
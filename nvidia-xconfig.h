@@ -99,6 +99,8 @@ typedef struct __options {
     int post_tree;
     int keyboard_list;
     int mouse_list;
+    int hoist_modelines;
+    int watch;
     int enable_all_gpus;
     int only_one_screen;
     int disable_scf;
@@ -153,6 +155,15 @@ typedef struct __options {
     char *flatpanel_properties;
     char *nvidia_3dvision_usb_path;
     char *nvidia_3dvisionpro_config_file;
+    char *stats_file;
+    char *diff_file;
+    char *patch_file;
+    char *snapshot_file;
+    char *export_json_file;
+    char *import_json_file;
+    char *daemon_socket;
+    char *use_daemon;
+    char *watch_uevents;
     double tv_over_scan;
 
     struct {
@@ -163,6 +174,7 @@ typedef struct __options {
     TextRows add_modes;
     TextRows add_modes_list;
     TextRows remove_modes;
+    TextRows layers;
 
     GenerateOptions gop;
 
@@ -173,6 +185,7 @@ typedef struct __options {
 typedef struct _display_device_rec {
     NvCfgDisplayDeviceInformation info;
     int info_valid;
+    int info_queried;
     unsigned int mask;
 } DisplayDeviceRec, *DisplayDevicePtr;
 
@@ -192,6 +205,18 @@ typedef struct {
     DevicePtr devices;
 } DevicesRec, *DevicesPtr;
 
+/* how much of the GPU information find_devices() probes */
+
+enum {
+    DEVICES_PCI = 1,       /* the GPUs' PCI addresses */
+    DEVICES_GPU_INFO,      /* also the CRTCs, names and display devices */
+    DEVICES_EDID,          /* also the EDIDs of the display devices */
+};
+
+
+/* nvidia-xconfig.c */
+
+int nvidia_xconfig(int argc, char *argv[]);
 
 /* util.c */
 
@@ -207,8 +232,11 @@ int update_server_flags(Options *op, XConfigPtr config);
 
 /* multiple_screens.c */
 
-DevicesPtr find_devices(Options *op);
+DevicesPtr find_devices(Options *op, int level);
 void free_devices(DevicesPtr devs);
+DevicesPtr copy_devices(DevicesPtr devs);
+void reset_devices(void);
+NvCfgDisplayDeviceInformation *get_edid(DevicePtr pDevice, int display);
 
 int apply_multi_screen_options(Options *op, XConfigPtr config,
                                XConfigLayoutPtr layout);
@@ -235,6 +263,39 @@ int query_gpu_info(Options *op);
 
 int extract_edids(Options *op);
 
+/* daemon.c */
+
+int run_daemon(Options *op);
+int daemon_request(const char *path, int argc, char *argv[], int *status);
+void daemon_get_xserver_in_use(GenerateOptions *gop);
+int daemon_cached_devices(Options *op, DevicesPtr *pDevices);
+XConfigPtr daemon_cached_xconfig(const char *filename);
+void daemon_report_xconfig(const char *filename);
+
+/* watch.c */
+
+#define WATCH_CONFIG    0x1     /* the X config files changed */
+#define WATCH_HARDWARE  0x2     /* NVIDIA GPUs were added or removed */
+
+typedef struct _watch_rec *WatchPtr;
+
+WatchPtr watch_open(const char *uevent_socket);
+int watch_file(WatchPtr w, const char *filename);
+void watch_file_written(WatchPtr w, const char *filename);
+int watch_wait(WatchPtr w);
+void watch_close(WatchPtr w);
+
+/* stats.c */
+
+void stats_init(const char *filename);
+void stats_begin(const char *fmt, ...) NV_ATTRIBUTE_PRINTF(1, 2);
+void stats_end(void);
+int stats_depth(void);
+void stats_unwind(int depth);
+void stats_input(const char *filename);
+void stats_input_end(void);
+void stats_tree(XConfigPtr config);
+
 
 
 #endif /* __NVIDIA_XCONFIG_H__ */
@@ -59,6 +59,19 @@ enum {
     NVIDIA_3DVISION_DISPLAY_TYPE_OPTION,
     RESTORE_ORIGINAL_BACKUP_OPTION,
     NUM_X_SCREENS_OPTION,
+    INPUT_ROOT_OPTION,
+    STATS_OPTION,
+    LAYER_OPTION,
+    DIFF_OPTION,
+    PATCH_OPTION,
+    HOIST_MODELINES_OPTION,
+    SNAPSHOT_OPTION,
+    EXPORT_JSON_OPTION,
+    IMPORT_JSON_OPTION,
+    DAEMON_OPTION,
+    USE_DAEMON_OPTION,
+    WATCH_OPTION,
+    WATCH_UEVENTS_OPTION,
 };
 
 /*
@@ -223,12 +236,34 @@ static const NVGetoptOption __options[] = {
       "used.  If this option is not specified, all the devices within "
       "the X configuration file will be used." },
 
+    { "diff", DIFF_OPTION, NVGETOPT_STRING_ARGUMENT, "FILE",
+      "Compare the X configuration file with the X configuration file "
+      "&FILE&, print to stdout a patch that changes the former into the "
+      "latter, and exit.  Sections are matched by Identifier and options "
+      "by name, and only what differs is printed; the patch can be "
+      "applied with the '--patch' option.  A patch covers the options of "
+      "all sections, and the main fields of the Monitor, Device, Screen, "
+      "InputDevice and ServerLayout sections.  If the files differ in "
+      "anything else but comments and the order of sections (e.g., "
+      "modelines, a Display subsection's Virtual size, a Device "
+      "section's VideoRam, a layout's InputDevice entries, or a Files or "
+      "Module section), no patch is printed, and an error is reported." },
+
     { "disable-glx-root-clipping",
       XCONFIG_BOOL_VAL(DISABLE_GLX_ROOT_CLIPPING_BOOL_OPTION),
       NVGETOPT_IS_BOOLEAN, NULL, "Disable or enable clipping OpenGL rendering "
       "to the root window via the \"DisableGLXRootClipping\" "
       "X configuration option." },
 
+    { "daemon", DAEMON_OPTION, NVGETOPT_STRING_ARGUMENT, "SOCKET",
+      "Run as a daemon, serving requests on the Unix domain socket "
+      "&SOCKET& until stopped.  The daemon detects the X server, probes "
+      "the GPUs, and parses the X configuration file once, and keeps the "
+      "results for the requests made with '--use-daemon'.  The other options given with "
+      "'--daemon' select what is detected, probed, and parsed.  Send the "
+      "daemon SIGHUP to have it redo this, e.g., after GPUs have been "
+      "added, and SIGTERM to stop it." },
+
     { "damage-events",
       XCONFIG_BOOL_VAL(DAMAGE_EVENTS_BOOL_OPTION),
       NVGETOPT_IS_BOOLEAN, NULL, "Use OS-level events to notify the X server "
@@ -260,6 +295,11 @@ static const NVGetoptOption __options[] = {
       "Forces the initialization of the X server with "
       "the exact timings specified in the ModeLine." },
 
+    { "export-json", EXPORT_JSON_OPTION, NVGETOPT_STRING_ARGUMENT, "FILE",
+      "Write the X configuration to &FILE& as JSON, and exit.  All sections, "
+      "options, modelines, and comments of the X configuration are "
+      "written.  If &FILE& is \"-\", the JSON is written to stdout." },
+
     { "extract-edids-from-file", 'E', NVGETOPT_STRING_ARGUMENT, "FILE",
       "Extract any raw EDID byte blocks contained in the specified X "
       "log file &LOG&; raw EDID bytes are printed by the NVIDIA X driver to "
@@ -310,12 +350,32 @@ static const NVGetoptOption __options[] = {
       "the X configuration man page for details.  The value of &WHEN& can be "
       "'Always', 'Never', or 'WhenNeeded'." },
 
+    { "hoist-modelines", HOIST_MODELINES_OPTION, 0, NULL,
+      "When writing the X configuration file, move the modelines that "
+      "Monitor sections have in common to a Modes section, and have those "
+      "Monitor sections refer to it with \"UseModes\", rather than "
+      "repeating the modelines in each Monitor section." },
+
+    { "import-json", IMPORT_JSON_OPTION, NVGETOPT_STRING_ARGUMENT, "FILE",
+      "Read the X configuration from &FILE&, a JSON file as written by "
+      "\"--export-json\", rather than from the X configuration file.  The "
+      "X configuration is then updated and written as usual." },
+
     { "include-implicit-metamodes",
       XCONFIG_BOOL_VAL(INCLUDE_IMPLICIT_METAMODES_BOOL_OPTION),
       NVGETOPT_IS_BOOLEAN, NULL,
       "Enable or disable the \"IncludeImplicitMetaModes\" X configuration "
       "option." },
 
+    { "input-root", INPUT_ROOT_OPTION, NVGETOPT_STRING_ARGUMENT, "DIR",
+      "When generating input device sections, or looking for the core "
+      "keyboard and pointer, nvidia-xconfig enumerates the input devices "
+      "listed in /proc/bus/input/devices (or, if that is not available, "
+      "/sys/class/input), and uses the \"evdev\" driver on the event "
+      "node of the first keyboard and pointer.  Read these files below &DIR& "
+      "instead of /.  This option is intended for testing, and should "
+      "normally not be needed." },
+
     { "keyboard", KEYBOARD_OPTION, NVGETOPT_STRING_ARGUMENT, NULL,
       "When generating a new X configuration file (which happens when no "
       "system X configuration file can be found, or the '--force-generate' "
@@ -336,6 +396,23 @@ static const NVGetoptOption __options[] = {
       "Print to stdout the available keyboard types recognized by the "
       "'--keyboard' option, and then exit." },
 
+    { "layer", LAYER_OPTION, NVGETOPT_STRING_ARGUMENT, "FILE",
+      "Layer the X configuration file &FILE& onto the X configuration "
+      "before applying the other options.  This option may be given more "
+      "than once; the files are merged in the order given, each taking "
+      "precedence over the ones before it, and the result is written "
+      "once.  A layer only needs the sections and fields it changes: "
+      "sections are matched by Identifier, the fields a layer's section "
+      "sets replace those of the matching section, and its options are "
+      "merged with the section's options.  A layer may contain "
+      "ServerFlags, Monitor, Device, Screen, InputDevice and Extensions "
+      "sections and one ServerLayout section, whose InputDevice and "
+      "Inactive entries are added to the layout; a layer with any other "
+      "section, or with a ModeLine, Mode or UseModes entry in a Monitor "
+      "section, or a VideoAdaptor entry in a Screen section, is reported "
+      "as an error.  The other command line options take precedence over "
+      "all layers." },
+
     { "layout", LAYOUT_OPTION, NVGETOPT_STRING_ARGUMENT, NULL,
       "The nvidia-xconfig utility operates on a Server Layout within the X "
       "configuration file.  If this option is specified, the layout named "
@@ -427,6 +504,11 @@ static const NVGetoptOption __options[] = {
       "Pixel to use as transparent when using color index overlays.  "
       "Valid values for &TRANSPARENT-INDEX& are 0-255."},
 
+    { "patch", PATCH_OPTION, NVGETOPT_STRING_ARGUMENT, "FILE",
+      "Apply the patch &FILE&, as printed by the '--diff' option, to the "
+      "X configuration file, write the result, and exit.  No other "
+      "changes are made to the X configuration." },
+
     { "post-tree", 'T', 0, NULL,
       "Like the '--tree' option, but goes through the full process of "
       "applying any user requested updates to the X configuration, before "
@@ -496,6 +578,13 @@ static const NVGetoptOption __options[] = {
       "Enable or disable SLI.  Valid values for &SLI& are 'Off', 'On', 'Auto', "
       "'AFR', 'SFR', 'AA', 'AFRofAA', 'Mosaic'." },
 
+    { "snapshot", SNAPSHOT_OPTION, NVGETOPT_STRING_ARGUMENT, "FILE",
+      "Keep a binary snapshot of the parsed X configuration file in &FILE& "
+      "for faster loading.  If &FILE& holds a snapshot of the current "
+      "contents of the X configuration file, the X configuration is loaded "
+      "from the snapshot rather than parsed; otherwise, the X configuration "
+      "file is parsed, and &FILE& is replaced with a new snapshot of it." },
+
     { "stereo", STEREO_OPTION,
       NVGETOPT_INTEGER_ARGUMENT | NVGETOPT_ALLOW_DISABLE, NULL,
       "Enable or disable the stereo mode.  Valid values for &STEREO& are: 0 "
@@ -505,6 +594,18 @@ static const NVGetoptOption __options[] = {
       "8 (3D DLP), 9 (3D DLP INV), 10 (NVIDIA 3D VISION), "
       "11 (NVIDIA 3D VISION PRO), 12 (HDMI 3D), 13 (Tridelity SL)." },
 
+    { "stats", STATS_OPTION, NVGETOPT_STRING_ARGUMENT, "FILE",
+      "Write a JSON report to &FILE& describing where nvidia-xconfig spent "
+      "its time: the wall time, the number and total size of the "
+      "allocations made, and the net growth of the heap, of each phase "
+      "(finding, reading, sanitizing, updating "
+      "and writing the X configuration file, and querying the GPUs), "
+      "the size and read throughput of each file read (the X "
+      "configuration file, layers, and the files given to --diff, --patch "
+      "and --import-json) and of all of them together, "
+      "the peak resident set size, and the number of sections, options "
+      "and modelines in the resulting X configuration." },
+
     { "thermal-configuration-check",
       XCONFIG_BOOL_VAL(THERMAL_CONFIGURATION_CHECK_BOOL_OPTION),
       NVGETOPT_IS_BOOLEAN, NULL,
@@ -575,6 +676,12 @@ static const NVGetoptOption __options[] = {
       "NVIDIA X driver will use frequency information from the EDID, when "
       "available)." },
 
+    { "use-daemon", USE_DAEMON_OPTION, NVGETOPT_STRING_ARGUMENT, "SOCKET",
+      "Have the daemon listening on the Unix domain socket &SOCKET& (see "
+      "'--daemon') run this command, with the working directory, standard "
+      "input, and output of this command.  If no daemon is listening on "
+      "&SOCKET&, the command is run directly." },
+
     { "use-display-device", USE_DISPLAY_DEVICE_OPTION,
       NVGETOPT_STRING_ARGUMENT | NVGETOPT_ALLOW_DISABLE, "DISPLAY-DEVICE",
       "Force the X driver to use the display device specified." },
@@ -591,6 +698,20 @@ static const NVGetoptOption __options[] = {
       NVGETOPT_STRING_ARGUMENT | NVGETOPT_ALLOW_DISABLE, "WIDTHxHEIGHT",
       "Specify the virtual screen resolution." },
 
+    { "watch", WATCH_OPTION, 0, NULL,
+      "After writing the X configuration file, keep running, and keep the "
+      "file up to date: when the X configuration file, or a file given "
+      "with '--layer', changes, it is read and updated again; when NVIDIA "
+      "GPUs are added or removed, the options that depend on the GPUs "
+      "(such as '--enable-all-gpus') are applied again.  Changes are "
+      "applied once they have settled.  Send SIGTERM to stop." },
+
+    { "watch-uevents", WATCH_UEVENTS_OPTION, NVGETOPT_STRING_ARGUMENT,
+      "SOCKET",
+      "With '--watch', receive the uevents that announce GPU hotplug from "
+      "datagrams sent to the Unix domain socket &SOCKET&, in the kernel's "
+      "format, rather than from the kernel; this is meant for testing." },
+
     { "x-prefix", X_PREFIX_OPTION, NVGETOPT_STRING_ARGUMENT, NULL,
       "The X installation prefix; the default is /usr/X11R6/.  Only "
       "under rare circumstances should this option be needed." },
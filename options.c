@@ -206,14 +206,31 @@ static void remove_option(XConfigScreenPtr screen, const char *name)
 
     if (!screen) return;
 
-    if (screen->device) {
+    /*
+     * option and display lists may be shared with cloned screens;
+     * only unshare them if the option is actually present
+     */
+
+    if (screen->device &&
+        xconfigFindOption(screen->device->options, name)) {
+        xconfigOptionListUnshare(&screen->device->options);
         xconfigRemoveNamedOption(&screen->device->options, name, NULL);
     }
     if (screen->monitor) {
         xconfigRemoveNamedOption(&screen->monitor->options, name, NULL);
     }
-    xconfigRemoveNamedOption(&screen->options, name, NULL);
-    
+    if (xconfigFindOption(screen->options, name)) {
+        xconfigOptionListUnshare(&screen->options);
+        xconfigRemoveNamedOption(&screen->options, name, NULL);
+    }
+
+    for (display = screen->displays; display; display = display->next) {
+        if (xconfigFindOption(display->options, name)) break;
+    }
+    if (!display) return;
+
+    xconfigDisplayListUnshare(&screen->displays);
+
     for (display = screen->displays; display; display = display->next) {
         xconfigRemoveNamedOption(&display->options, name, NULL);
     }
@@ -221,6 +238,24 @@ static void remove_option(XConfigScreenPtr screen, const char *name)
 
 
 
+/*
+ * unshare_screen_options() - make sure none of the option lists
+ * associated with this screen are shared with a cloned screen, so
+ * that they can be modified in place.
+ */
+
+static void unshare_screen_options(XConfigScreenPtr screen)
+{
+    if (screen->device) {
+        xconfigOptionListUnshare(&screen->device->options);
+    }
+    xconfigOptionListUnshare(&screen->options);
+    xconfigDisplayListUnshare(&screen->displays);
+
+} /* unshare_screen_options() */
+
+
+
 /*
  * get_screen_option() - get the option structure with the specified
  * name, searching all the option lists associated with this screen
@@ -271,6 +306,7 @@ static void set_option_value(XConfigScreenPtr screen,
 
     /* then, add the option to the screen's option list */
 
+    xconfigOptionListUnshare(&screen->options);
     xconfigAddNewOption(&screen->options, name, val);
 
 } /* set_option_value() */
@@ -369,6 +405,11 @@ static int remove_metamode_offsets(XConfigScreenPtr screen,
 
     if (!find_metamode_offset(opt->val, NULL)) return FALSE;
 
+    /* the option is modified in place, so it must not be shared */
+
+    unshare_screen_options(screen);
+    opt = get_screen_option(screen, "MetaModes");
+
     if (old_metamodes) *old_metamodes = nvstrdup(opt->val);
 
     /*
@@ -417,6 +458,15 @@ static void update_display_options(Options *op, XConfigScreenPtr screen)
     XConfigDisplayPtr display;
     int i;
     
+    if (!op->virtual.x && !op->virtual.y && !op->remove_modes.n &&
+        !op->add_modes.n && !op->add_modes_list.n) {
+        return;
+    }
+
+    /* the display list may be shared with cloned screens */
+
+    xconfigDisplayListUnshare(&screen->displays);
+
     /* update the mode list, based on what we have on the commandline */
     
     for (display = screen->displays; display; display = display->next) {
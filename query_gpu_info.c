@@ -39,12 +39,13 @@ int query_gpu_info(Options *op)
 {
     DevicesPtr pDevices;
     DisplayDevicePtr pDisplayDevice;
+    NvCfgDisplayDeviceInformation *info;
     int i, j;
     char *name, busid[BUS_ID_STRING_LENGTH];
 
     /* query the GPU information */
 
-    pDevices = find_devices(op);
+    pDevices = find_devices(op, DEVICES_GPU_INFO);
     
     if (!pDevices) {
         nv_error_msg("Unable to query GPU information");
@@ -97,46 +98,50 @@ int query_gpu_info(Options *op)
                     nv_info_msg(BIGTAB, (_fmt), (_val)); \
                 }
             
-            if (pDisplayDevice->info_valid) {
+            /* the EDID is only read now */
+
+            info = get_edid(&pDevices->devices[i], j);
+
+            if (info) {
                 
                 PRT("EDID Name             : %s", 
-                    pDisplayDevice->info.monitor_name);
+                    info->monitor_name);
                 
                 PRT("Minimum HorizSync     : %.3f kHz",
-                    pDisplayDevice->info.min_horiz_sync/1000.0);
+                    info->min_horiz_sync/1000.0);
                 
                 PRT("Maximum HorizSync     : %.3f kHz",
-                    pDisplayDevice->info.max_horiz_sync/1000.0);
+                    info->max_horiz_sync/1000.0);
                 
                 PRT("Minimum VertRefresh   : %d Hz",
-                    pDisplayDevice->info.min_vert_refresh);
+                    info->min_vert_refresh);
                 
                 PRT("Maximum VertRefresh   : %d Hz",
-                    pDisplayDevice->info.max_vert_refresh);
+                    info->max_vert_refresh);
                 
                 PRT("Maximum PixelClock    : %.3f MHz",
-                    pDisplayDevice->info.max_pixel_clock/1000.0);
+                    info->max_pixel_clock/1000.0);
                 
                 PRT("Maximum Width         : %d pixels",
-                    pDisplayDevice->info.max_xres);
+                    info->max_xres);
                 
                 PRT("Maximum Height        : %d pixels",
-                    pDisplayDevice->info.max_yres);
+                    info->max_yres);
                 
                 PRT("Preferred Width       : %d pixels",
-                    pDisplayDevice->info.preferred_xres);
+                    info->preferred_xres);
                 
                 PRT("Preferred Height      : %d pixels",
-                    pDisplayDevice->info.preferred_yres);
+                    info->preferred_yres);
                 
                 PRT("Preferred VertRefresh : %d Hz",
-                    pDisplayDevice->info.preferred_refresh);
+                    info->preferred_refresh);
                 
                 PRT("Physical Width        : %d mm",
-                    pDisplayDevice->info.physical_width);
+                    info->physical_width);
                 
                 PRT("Physical Height       : %d mm",
-                    pDisplayDevice->info.physical_height);
+                    info->physical_height);
                 
             } else {
                 nv_info_msg(BIGTAB, "No EDID information available.");
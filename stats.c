@@ -0,0 +1,637 @@
+/*
+ * nvidia-xconfig: A tool for manipulating X config files,
+ * specifically for use by the NVIDIA Linux graphics driver.
+ *
+ * Copyright (C) 2004 NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>.
+ *
+ *
+ * stats.c - per-phase wall time, allocations and heap growth,
+ * reported as JSON by the '--stats' option.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include "nvidia-xconfig.h"
+#include "msg.h"
+
+
+/*
+ * Measure the heap with mallinfo2(), which reports the bytes currently
+ * allocated; the change over a phase is its net heap growth.  It is
+ * only called while '--stats' is in effect.  __GLIBC_PREREQ() is only
+ * defined by glibc, so it must not be tested in the same #if.
+ */
+
+#if defined(__GLIBC__)
+#if __GLIBC_PREREQ(2, 33)
+#define MEASURE_HEAP 1
+#endif
+#endif
+
+#if defined(MEASURE_HEAP)
+
+#include <malloc.h>
+
+static long long heap_bytes(void)
+{
+    struct mallinfo2 mi = mallinfo2();
+
+    return (long long) (mi.uordblks + mi.hblkhd);
+}
+
+#else
+
+#define MEASURE_HEAP 0
+
+static long long heap_bytes(void)
+{
+    return 0;
+}
+
+#endif
+
+
+/*
+ * Allocations are counted by the allocation wrappers of nvidia-xconfig
+ * (nvalloc() and friends) and of the XF86Config parser (xconfigAlloc()
+ * and xconfigStrdup()); unlike the net heap growth, the counts only go
+ * up, so a phase that allocates and frees a lot still shows it.
+ * Memory allocated directly with malloc(3) is not counted.
+ */
+
+static void alloc_counts(unsigned long long *count, unsigned long long *bytes)
+{
+    unsigned long long c, b;
+
+    nv_get_alloc_stats(count, bytes);
+    xconfigGetAllocStats(&c, &b);
+
+    *count += c;
+    *bytes += b;
+}
+
+
+/*
+ * Phases form a tree: a phase begun while another is open becomes its
+ * child.  Phases with the same name under the same parent are
+ * accumulated into one node, whose count is the number of intervals.
+ */
+
+typedef struct _StatsNode {
+    char *name;
+    int count;
+    unsigned long long usecs;
+    unsigned long long allocs;
+    unsigned long long alloc_bytes;
+    long long heap_bytes;
+
+    struct _StatsNode *parent;
+    struct _StatsNode *children;
+    struct _StatsNode *last_child;
+    struct _StatsNode *next;
+
+    /* snapshot taken when the current interval began */
+    unsigned long long start_usecs;
+    unsigned long long start_allocs;
+    unsigned long long start_alloc_bytes;
+    long long start_heap_bytes;
+} StatsNode;
+
+/*
+ * Each file read (the X config file, layers, the "--diff" file, ...)
+ * is recorded with its own size, read time and number of sections, so
+ * that the throughput of each can be reported.
+ */
+
+typedef struct _StatsInput {
+    char *file;
+    long long bytes;
+    int sections;
+    unsigned long long usecs;
+    struct _StatsInput *next;
+
+    /* snapshot taken when the read began */
+    unsigned long long start_usecs;
+    int start_sections;
+} StatsInput;
+
+static struct {
+    int enabled;
+    char *filename;
+    StatsNode root;
+    StatsNode *current;
+    int depth;
+
+    StatsInput *inputs;
+    StatsInput *last_input;
+    StatsInput *open_input;
+    int sections_read;
+
+    int have_tree;
+    int sections;
+    int options;
+    int modelines;
+} stats;
+
+
+
+static unsigned long long now_usecs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (unsigned long long) ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+
+
+/*
+ * stats_begin() - begin a phase, named by the printf-style format;
+ * does nothing unless '--stats' was given.
+ */
+
+void stats_begin(const char *fmt, ...)
+{
+    StatsNode *node;
+    char name[128];
+    va_list ap;
+
+    if (!stats.enabled) return;
+
+    va_start(ap, fmt);
+    vsnprintf(name, sizeof(name), fmt, ap);
+    va_end(ap);
+
+    for (node = stats.current->children; node; node = node->next) {
+        if (xconfigNameCompare(node->name, name) == 0) break;
+    }
+
+    if (!node) {
+        node = nvalloc(sizeof(StatsNode));
+        node->name = nvstrdup(name);
+        node->parent = stats.current;
+        if (stats.current->last_child) {
+            stats.current->last_child->next = node;
+        } else {
+            stats.current->children = node;
+        }
+        stats.current->last_child = node;
+    }
+
+    stats.current = node;
+    stats.depth++;
+
+    node->count++;
+    alloc_counts(&node->start_allocs, &node->start_alloc_bytes);
+    node->start_heap_bytes = heap_bytes();
+    node->start_usecs = now_usecs();
+
+} /* stats_begin() */
+
+
+
+/*
+ * stats_end() - end the innermost open phase
+ */
+
+void stats_end(void)
+{
+    StatsNode *node = stats.current;
+    unsigned long long allocs, alloc_bytes;
+
+    if (!stats.enabled || (stats.depth == 0)) return;
+
+    node->usecs += now_usecs() - node->start_usecs;
+    alloc_counts(&allocs, &alloc_bytes);
+    node->allocs += allocs - node->start_allocs;
+    node->alloc_bytes += alloc_bytes - node->start_alloc_bytes;
+    node->heap_bytes += heap_bytes() - node->start_heap_bytes;
+
+    stats.current = node->parent;
+    stats.depth--;
+
+} /* stats_end() */
+
+
+
+/*
+ * stats_depth() and stats_unwind() - record the nesting depth, and
+ * later end every phase begun since; this lets callers close phases
+ * that were left open by an early return.
+ */
+
+int stats_depth(void)
+{
+    return stats.depth;
+}
+
+void stats_unwind(int depth)
+{
+    while (stats.enabled && (stats.depth > depth)) {
+        stats_end();
+    }
+}
+
+
+
+/*
+ * read_hook() - profile each section read by xconfigReadConfigFile(),
+ * and the validation that follows
+ */
+
+static void read_hook(const char *section, int end)
+{
+    if (end) {
+        stats_end();
+    } else {
+        if (section) stats.sections_read++;
+        stats_begin("%s", section ? section : "xconfigValidateConfig");
+    }
+}
+
+
+
+/*
+ * stats_input() - begin reading the named file, so that its size and
+ * read throughput can be reported; the read ends with
+ * stats_input_end().
+ */
+
+void stats_input(const char *filename)
+{
+    struct stat stat_buf;
+    StatsInput *input;
+
+    if (!stats.enabled || !filename) return;
+
+    stats_input_end();
+
+    input = nvalloc(sizeof(StatsInput));
+    input->file = nvstrdup(filename);
+    input->bytes = (stat(filename, &stat_buf) == 0) ?
+        (long long) stat_buf.st_size : -1;
+
+    if (stats.last_input) {
+        stats.last_input->next = input;
+    } else {
+        stats.inputs = input;
+    }
+    stats.last_input = input;
+    stats.open_input = input;
+
+    input->start_sections = stats.sections_read;
+    input->start_usecs = now_usecs();
+
+} /* stats_input() */
+
+
+
+/*
+ * stats_input_end() - end the read begun by stats_input()
+ */
+
+void stats_input_end(void)
+{
+    StatsInput *input = stats.open_input;
+
+    if (!stats.enabled || !input) return;
+
+    input->usecs = now_usecs() - input->start_usecs;
+    input->sections = stats.sections_read - input->start_sections;
+    stats.open_input = NULL;
+
+} /* stats_input_end() */
+
+
+
+/*
+ * stats_tree() - record the size of the X config tree
+ */
+
+static int count_options(XConfigOptionPtr opt)
+{
+    int n = 0;
+
+    for (; opt; opt = opt->next) n++;
+
+    return n;
+}
+
+static int count_modelines(XConfigModeLinePtr modeline)
+{
+    int n = 0;
+
+    for (; modeline; modeline = modeline->next) n++;
+
+    return n;
+}
+
+void stats_tree(XConfigPtr config)
+{
+    XConfigVideoAdaptorPtr adaptor;
+    XConfigVideoPortPtr port;
+    XConfigModesPtr modes;
+    XConfigMonitorPtr monitor;
+    XConfigDevicePtr device;
+    XConfigScreenPtr screen;
+    XConfigDisplayPtr display;
+    XConfigInputPtr input;
+    XConfigInputClassPtr class;
+    XConfigLayoutPtr layout;
+    XConfigInputrefPtr inputref;
+    XConfigVendorPtr vendor;
+    XConfigVendSubPtr sub;
+    XConfigLoadPtr load;
+    int sections = 0, options = 0, modelines = 0;
+
+    if (!stats.enabled || !config) return;
+
+    if (config->files) sections++;
+    if (config->modules) {
+        sections++;
+        for (load = config->modules->loads; load; load = load->next) {
+            options += count_options(load->opt);
+        }
+    }
+    if (config->flags) {
+        sections++;
+        options += count_options(config->flags->options);
+    }
+    if (config->dri) sections++;
+    if (config->extensions) {
+        sections++;
+        options += count_options(config->extensions->options);
+    }
+
+    for (adaptor = config->videoadaptors; adaptor; adaptor = adaptor->next) {
+        sections++;
+        options += count_options(adaptor->options);
+        for (port = adaptor->ports; port; port = port->next) {
+            options += count_options(port->options);
+        }
+    }
+
+    for (modes = config->modes; modes; modes = modes->next) {
+        sections++;
+        modelines += count_modelines(modes->modelines);
+    }
+
+    for (monitor = config->monitors; monitor; monitor = monitor->next) {
+        sections++;
+        options += count_options(monitor->options);
+        modelines += count_modelines(monitor->modelines);
+    }
+
+    for (device = config->devices; device; device = device->next) {
+        sections++;
+        options += count_options(device->options);
+    }
+
+    for (screen = config->screens; screen; screen = screen->next) {
+        sections++;
+        options += count_options(screen->options);
+        for (display = screen->displays; display; display = display->next) {
+            options += count_options(display->options);
+        }
+    }
+
+    for (input = config->inputs; input; input = input->next) {
+        sections++;
+        options += count_options(input->options);
+    }
+
+    for (class = config->inputclasses; class; class = class->next) {
+        sections++;
+        options += count_options(class->options);
+    }
+
+    for (layout = config->layouts; layout; layout = layout->next) {
+        sections++;
+        options += count_options(layout->options);
+        for (inputref = layout->inputs; inputref; inputref = inputref->next) {
+            options += count_options(inputref->options);
+        }
+    }
+
+    for (vendor = config->vendors; vendor; vendor = vendor->next) {
+        sections++;
+        options += count_options(vendor->options);
+        for (sub = vendor->subs; sub; sub = sub->next) {
+            options += count_options(sub->options);
+        }
+    }
+
+    stats.sections = sections;
+    stats.options = options;
+    stats.modelines = modelines;
+    stats.have_tree = TRUE;
+
+} /* stats_tree() */
+
+
+
+/*
+ * print_json_string() - print a JSON string literal
+ */
+
+static void print_json_string(FILE *fp, const char *s)
+{
+    fputc('"', fp);
+
+    for (; *s; s++) {
+        unsigned char c = *s;
+
+        if ((c == '"') || (c == '\\')) {
+            fprintf(fp, "\\%c", c);
+        } else if (c < 0x20) {
+            fprintf(fp, "\\u%04x", c);
+        } else {
+            fputc(c, fp);
+        }
+    }
+
+    fputc('"', fp);
+}
+
+
+
+static void print_json_nodes(FILE *fp, const StatsNode *node, int indent)
+{
+    for (; node; node = node->next) {
+        fprintf(fp, "%*s{ \"name\": ", indent, "");
+        print_json_string(fp, node->name);
+        fprintf(fp, ", \"count\": %d, \"wall_us\": %llu", node->count,
+                node->usecs);
+        fprintf(fp, ", \"allocs\": %llu, \"alloc_bytes\": %llu",
+                node->allocs, node->alloc_bytes);
+        if (MEASURE_HEAP) {
+            fprintf(fp, ", \"heap_bytes\": %lld", node->heap_bytes);
+        } else {
+            fprintf(fp, ", \"heap_bytes\": null");
+        }
+        if (node->children) {
+            fprintf(fp, ",\n%*s  \"children\": [\n", indent, "");
+            print_json_nodes(fp, node->children, indent + 4);
+            fprintf(fp, "%*s  ] }", indent, "");
+        } else {
+            fprintf(fp, " }");
+        }
+        fprintf(fp, "%s\n", node->next ? "," : "");
+    }
+}
+
+
+
+/*
+ * print_json_throughput() - print bytes and sections per second
+ */
+
+static void print_json_throughput(FILE *fp, unsigned long long bytes,
+                                  unsigned long long sections,
+                                  unsigned long long usecs)
+{
+    fprintf(fp, "{ \"bytes_per_sec\": %llu, \"sections_per_sec\": %llu }",
+            bytes * 1000000ULL / usecs, sections * 1000000ULL / usecs);
+}
+
+
+
+/*
+ * print_json_input() - report each file that was read with its read
+ * throughput, the throughput over all of them, and the peak resident
+ * set size of the process
+ */
+
+static void print_json_input(FILE *fp)
+{
+    const StatsInput *input;
+    unsigned long long bytes = 0, sections = 0, usecs = 0;
+    struct rusage usage;
+
+    stats_input_end();
+
+    fprintf(fp, "  \"inputs\": [");
+
+    for (input = stats.inputs; input; input = input->next) {
+        fprintf(fp, "%s\n    { \"file\": ", (input == stats.inputs) ? "" : ",");
+        print_json_string(fp, input->file);
+        if (input->bytes >= 0) {
+            fprintf(fp, ", \"bytes\": %lld", input->bytes);
+        } else {
+            fprintf(fp, ", \"bytes\": null");
+        }
+        fprintf(fp, ", \"sections\": %d, \"read_us\": %llu, "
+                "\"read_throughput\": ", input->sections, input->usecs);
+        if ((input->bytes >= 0) && input->usecs) {
+            print_json_throughput(fp, input->bytes, input->sections,
+                                  input->usecs);
+            bytes += input->bytes;
+            sections += input->sections;
+            usecs += input->usecs;
+        } else {
+            fprintf(fp, "null");
+        }
+        fprintf(fp, " }");
+    }
+
+    fprintf(fp, "%s],\n", stats.inputs ? "\n  " : "");
+
+    /* throughput is reported in bytes and sections per second */
+
+    fprintf(fp, "  \"read_throughput\": ");
+    if (usecs) {
+        print_json_throughput(fp, bytes, sections, usecs);
+    } else {
+        fprintf(fp, "null");
+    }
+    fprintf(fp, ",\n");
+
+    /* ru_maxrss is in kilobytes on Linux */
+
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        fprintf(fp, "  \"peak_rss_kb\": %ld,\n", (long) usage.ru_maxrss);
+    } else {
+        fprintf(fp, "  \"peak_rss_kb\": null,\n");
+    }
+}
+
+
+
+/*
+ * write_stats() - write the JSON report; registered with atexit(3), so
+ * that the report is written however nvidia-xconfig exits
+ */
+
+static void write_stats(void)
+{
+    FILE *fp;
+
+    stats_unwind(0);
+
+    fp = fopen(stats.filename, "w");
+    if (!fp) {
+        nv_error_msg("Unable to open '%s' for writing statistics.",
+                     stats.filename);
+        return;
+    }
+
+    fprintf(fp, "{\n  \"phases\": [\n");
+    print_json_nodes(fp, stats.root.children, 4);
+    fprintf(fp, "  ],\n");
+
+    print_json_input(fp);
+
+    if (stats.have_tree) {
+        fprintf(fp, "  \"tree\": { \"sections\": %d, \"options\": %d, "
+                "\"modelines\": %d }\n",
+                stats.sections, stats.options, stats.modelines);
+    } else {
+        fprintf(fp, "  \"tree\": null\n");
+    }
+
+    fprintf(fp, "}\n");
+
+    fclose(fp);
+
+} /* write_stats() */
+
+
+
+/*
+ * stats_init() - enable profiling, to be reported to the given file
+ * when nvidia-xconfig exits
+ */
+
+void stats_init(const char *filename)
+{
+    if (!filename || stats.enabled) return;
+
+    stats.filename = nvstrdup(filename);
+    stats.current = &stats.root;
+    stats.enabled = TRUE;
+
+    xconfigSetReadHook(read_hook);
+
+    atexit(write_stats);
+
+} /* stats_init() */
@@ -0,0 +1,468 @@
+/*
+ * nvidia-xconfig: A tool for manipulating X config files,
+ * specifically for use by the NVIDIA Linux graphics driver.
+ *
+ * Copyright (C) 2004 NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>.
+ *
+ *
+ * watch.c - wait for changes to the X config files, and for NVIDIA GPUs
+ * to be added or removed, for the '--watch' option.
+ *
+ * Files are watched through inotify on their directories, so that a
+ * file replaced by rename(2) is seen, as is one that is created later.
+ * GPU hotplug is seen through the kernel's uevents, received on a
+ * netlink socket; for testing, '--watch-uevents' has the uevents read
+ * from datagrams sent to a Unix domain socket instead, in the kernel's
+ * format.  Bursts of changes are reported once they have settled.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#if defined(NV_LINUX)
+#include <sys/inotify.h>
+#include <linux/netlink.h>
+#endif
+
+#include "nvidia-xconfig.h"
+#include "msg.h"
+
+
+#define WATCH_DEBOUNCE_MS   250
+#define WATCH_UEVENT_SIZE   8192
+#define NVIDIA_PCI_VENDOR   "10DE"
+
+typedef struct _watch_file_rec {
+    char *filename;
+    char *basename;             /* points into filename */
+    int wd;                     /* inotify watch of the directory */
+    int exists;
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    struct timespec mtime;
+    struct _watch_file_rec *next;
+} WatchFileRec, *WatchFilePtr;
+
+struct _watch_rec {
+    int inotify_fd;
+    int uevent_fd;
+    char *uevent_socket;        /* '--watch-uevents', unlinked on close */
+    WatchFilePtr files;
+};
+
+static volatile sig_atomic_t watch_quit = FALSE;
+
+
+
+static void watch_signal(int sig)
+{
+    watch_quit = TRUE;
+}
+
+
+
+/*
+ * stat_file() - record the state of the file; returns TRUE if it
+ * differs from what was recorded before
+ */
+
+static int stat_file(WatchFilePtr f)
+{
+    struct stat st;
+    int changed;
+
+    if (stat(f->filename, &st) != 0) {
+        changed = f->exists;
+        f->exists = FALSE;
+        return changed;
+    }
+
+    changed = !f->exists || (f->dev != st.st_dev) || (f->ino != st.st_ino) ||
+        (f->size != st.st_size) || (f->mtime.tv_sec != st.st_mtim.tv_sec) ||
+        (f->mtime.tv_nsec != st.st_mtim.tv_nsec);
+
+    f->exists = TRUE;
+    f->dev = st.st_dev;
+    f->ino = st.st_ino;
+    f->size = st.st_size;
+    f->mtime = st.st_mtim;
+
+    return changed;
+
+} /* stat_file() */
+
+
+
+#if defined(NV_LINUX)
+
+/*
+ * open_uevents() - open the kernel uevent netlink socket, or, if a
+ * socket path is given, bind a Unix domain datagram socket there to
+ * receive fake uevents from
+ */
+
+static int open_uevents(WatchPtr w, const char *path)
+{
+    struct sockaddr_nl nl;
+    struct sockaddr_un un;
+    int fd;
+
+    if (path) {
+        if (strlen(path) >= sizeof(un.sun_path)) {
+            nv_error_msg("The socket path '%s' is too long.", path);
+            return FALSE;
+        }
+
+        memset(&un, 0, sizeof(un));
+        un.sun_family = AF_UNIX;
+        strcpy(un.sun_path, path);
+
+        fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+        unlink(path);
+        if ((fd < 0) ||
+            (bind(fd, (struct sockaddr *) &un, sizeof(un)) != 0)) {
+            nv_error_msg("Unable to listen for uevents on '%s' (%s).",
+                         path, strerror(errno));
+            if (fd >= 0) close(fd);
+            return FALSE;
+        }
+
+        w->uevent_socket = nvstrdup(path);
+        w->uevent_fd = fd;
+
+        return TRUE;
+    }
+
+    memset(&nl, 0, sizeof(nl));
+    nl.nl_family = AF_NETLINK;
+    nl.nl_groups = 1;           /* kernel uevents */
+
+    fd = socket(AF_NETLINK, SOCK_DGRAM, NETLINK_KOBJECT_UEVENT);
+    if ((fd < 0) || (bind(fd, (struct sockaddr *) &nl, sizeof(nl)) != 0)) {
+        nv_warning_msg("Unable to listen for GPU hotplug events (%s); only "
+                       "the X configuration files will be watched.",
+                       strerror(errno));
+        if (fd >= 0) close(fd);
+        return TRUE;
+    }
+
+    w->uevent_fd = fd;
+
+    return TRUE;
+
+} /* open_uevents() */
+
+
+
+/*
+ * is_gpu_uevent() - check whether the uevent (NUL-separated fields,
+ * "ACTION@DEVPATH" first) is for an NVIDIA PCI device being added,
+ * removed, or bound to or unbound from a driver
+ */
+
+static int is_gpu_uevent(const char *buf, size_t len)
+{
+    const char *p, *action = NULL, *subsystem = NULL, *pci_id = NULL;
+    const char *slot = "";
+
+    for (p = buf; p < buf + len; p += strlen(p) + 1) {
+        if (!memchr(p, '\0', buf + len - p)) break;
+
+        if (strncmp(p, "ACTION=", 7) == 0) action = p + 7;
+        else if (strncmp(p, "SUBSYSTEM=", 10) == 0) subsystem = p + 10;
+        else if (strncmp(p, "PCI_ID=", 7) == 0) pci_id = p + 7;
+        else if (strncmp(p, "PCI_SLOT_NAME=", 14) == 0) slot = p + 14;
+    }
+
+    if (!action || !subsystem || !pci_id ||
+        (strcmp(subsystem, "pci") != 0) ||
+        (strncasecmp(pci_id, NVIDIA_PCI_VENDOR ":",
+                     strlen(NVIDIA_PCI_VENDOR) + 1) != 0)) {
+        return FALSE;
+    }
+
+    if ((strcmp(action, "add") != 0) && (strcmp(action, "remove") != 0) &&
+        (strcmp(action, "bind") != 0) && (strcmp(action, "unbind") != 0)) {
+        return FALSE;
+    }
+
+    nv_info_msg(NULL, "GPU %s (%s): %s.", slot, pci_id, action);
+
+    return TRUE;
+
+} /* is_gpu_uevent() */
+
+
+
+/*
+ * read_uevents() - read the pending uevents; returns WATCH_HARDWARE if
+ * any of them is for an NVIDIA GPU
+ */
+
+static int read_uevents(WatchPtr w)
+{
+    char buf[WATCH_UEVENT_SIZE];
+    ssize_t n;
+    int what = 0;
+
+    while ((n = recv(w->uevent_fd, buf, sizeof(buf) - 1, MSG_DONTWAIT)) > 0) {
+        buf[n] = '\0';
+        if (is_gpu_uevent(buf, n)) what |= WATCH_HARDWARE;
+    }
+
+    return what;
+
+} /* read_uevents() */
+
+
+
+/*
+ * read_inotify() - read the pending inotify events; returns
+ * WATCH_CONFIG if any of the watched files is no longer as it was
+ * recorded
+ */
+
+static int read_inotify(WatchPtr w)
+{
+    char buf[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    const struct inotify_event *ev;
+    WatchFilePtr f;
+    ssize_t n;
+    char *p;
+    int what = 0;
+
+    while ((n = read(w->inotify_fd, buf, sizeof(buf))) > 0) {
+        for (p = buf; p < buf + n; p += sizeof(*ev) + ev->len) {
+            ev = (const struct inotify_event *) p;
+            if (!ev->len) continue;
+
+            for (f = w->files; f; f = f->next) {
+                if ((f->wd == ev->wd) && (strcmp(f->basename, ev->name) == 0) &&
+                    stat_file(f)) {
+                    nv_info_msg(NULL, "X configuration file \"%s\" changed.",
+                                f->filename);
+                    what |= WATCH_CONFIG;
+                }
+            }
+        }
+    }
+
+    return what;
+
+} /* read_inotify() */
+
+#endif /* NV_LINUX */
+
+
+
+/*
+ * watch_open() - start listening for GPU hotplug events, on the given
+ * Unix domain socket if not NULL; files are added with watch_file()
+ */
+
+WatchPtr watch_open(const char *uevent_socket)
+{
+#if defined(NV_LINUX)
+    struct sigaction sa;
+    WatchPtr w;
+
+    w = nvalloc(sizeof(*w));
+    w->uevent_fd = -1;
+
+    w->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (w->inotify_fd < 0) {
+        nv_error_msg("Unable to watch the X configuration files (%s).",
+                     strerror(errno));
+        nvfree(w);
+        return NULL;
+    }
+
+    if (!open_uevents(w, uevent_socket)) {
+        close(w->inotify_fd);
+        nvfree(w);
+        return NULL;
+    }
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = watch_signal;
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGINT, &sa, NULL);
+
+    return w;
+#else
+    nv_error_msg("The '--watch' option is not supported on this platform.");
+    return NULL;
+#endif
+
+} /* watch_open() */
+
+
+
+/*
+ * watch_file() - watch the named file for changes; the file need not
+ * exist yet
+ */
+
+int watch_file(WatchPtr w, const char *filename)
+{
+#if defined(NV_LINUX)
+    WatchFilePtr f;
+    char *dir, *slash;
+
+    for (f = w->files; f; f = f->next) {
+        if (strcmp(f->filename, filename) == 0) return TRUE;
+    }
+
+    f = nvalloc(sizeof(*f));
+    f->filename = nvstrdup(filename);
+
+    slash = strrchr(f->filename, '/');
+    if (slash) {
+        f->basename = slash + 1;
+        dir = nvstrndup(f->filename, (slash == f->filename) ? 1 :
+                        slash - f->filename);
+    } else {
+        f->basename = f->filename;
+        dir = nvstrdup(".");
+    }
+
+    f->wd = inotify_add_watch(w->inotify_fd, dir,
+                              IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM |
+                              IN_CREATE | IN_DELETE);
+    if (f->wd < 0) {
+        nv_error_msg("Unable to watch the directory '%s' (%s).",
+                     dir, strerror(errno));
+        nvfree(dir);
+        nvfree(f->filename);
+        nvfree(f);
+        return FALSE;
+    }
+
+    nvfree(dir);
+
+    stat_file(f);
+
+    f->next = w->files;
+    w->files = f;
+#endif
+
+    return TRUE;
+
+} /* watch_file() */
+
+
+
+/*
+ * watch_file_written() - record that we wrote the named file, so that
+ * the change is not reported
+ */
+
+void watch_file_written(WatchPtr w, const char *filename)
+{
+    WatchFilePtr f;
+
+    for (f = w->files; f; f = f->next) {
+        if (strcmp(f->filename, filename) == 0) stat_file(f);
+    }
+
+} /* watch_file_written() */
+
+
+
+/*
+ * watch_wait() - wait for the watched files to change, or for NVIDIA
+ * GPUs to be added or removed; once nothing more has happened for
+ * WATCH_DEBOUNCE_MS, return what happened, as a mask of WATCH_CONFIG
+ * and WATCH_HARDWARE.  Returns 0 when SIGTERM or SIGINT is received.
+ */
+
+int watch_wait(WatchPtr w)
+{
+#if defined(NV_LINUX)
+    struct pollfd pfd[2];
+    int n, ret, what = 0, more;
+
+    while (!watch_quit) {
+
+        pfd[0].fd = w->inotify_fd;
+        pfd[0].events = POLLIN;
+        pfd[1].fd = w->uevent_fd;
+        pfd[1].events = POLLIN;
+        n = (w->uevent_fd >= 0) ? 2 : 1;
+
+        ret = poll(pfd, n, what ? WATCH_DEBOUNCE_MS : -1);
+
+        if (ret < 0) {
+            if (errno == EINTR) continue;
+            nv_error_msg("Unable to wait for changes (%s).", strerror(errno));
+            return 0;
+        }
+
+        /* the burst has settled */
+
+        if (ret == 0) return what;
+
+        more = 0;
+        if (pfd[0].revents) more |= read_inotify(w);
+        if ((n > 1) && pfd[1].revents) more |= read_uevents(w);
+
+        what |= more;
+    }
+#endif
+
+    return 0;
+
+} /* watch_wait() */
+
+
+
+/*
+ * watch_close()
+ */
+
+void watch_close(WatchPtr w)
+{
+    WatchFilePtr f, next;
+
+    if (!w) return;
+
+    for (f = w->files; f; f = next) {
+        next = f->next;
+        nvfree(f->filename);
+        nvfree(f);
+    }
+
+    if (w->inotify_fd >= 0) close(w->inotify_fd);
+    if (w->uevent_fd >= 0) close(w->uevent_fd);
+
+    if (w->uevent_socket) {
+        unlink(w->uevent_socket);
+        nvfree(w->uevent_socket);
+    }
+
+    nvfree(w);
+
+} /* watch_close() */
@@ -0,0 +1,512 @@
+/*
+ * nvidia-xconfig: A tool for manipulating X config files,
+ * specifically for use by the NVIDIA Linux graphics driver.
+ *
+ * Copyright (C) 2004 NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>.
+ *
+ *
+ * xconfig-bench.c - benchmark of the XF86Config-parser library, built
+ * and run by 'make bench'.
+ *
+ * A synthetic X config is generated from a fixed seed, so that every
+ * run reads the same text; its size is set by the knobs below.  Each
+ * iteration reads it (xconfigReadConfigFileLayer(), which is
+ * xconfigReadConfigFile() without the validation), validates it
+ * (xconfigValidateConfig()), merges a second config with the same
+ * identifiers into it (xconfigMergeConfigs()), writes it
+ * (xconfigWriteConfigFile()) and frees it (xconfigFreeConfig()).  The
+ * best and mean time of each phase, its throughput over the generated
+ * config, and the peak resident set size are printed as one JSON
+ * object, for CI to track.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include "xf86Parser.h"
+
+
+/* the knobs; set with '--name=value' */
+
+static struct {
+    const char *name;
+    int value;
+    const char *help;
+} knobs[] = {
+#define KNOB_SCREENS     0
+    { "screens",    256, "Screen sections, one per X screen in the layout" },
+#define KNOB_DEVICES     1
+    { "devices",    256, "Device sections" },
+#define KNOB_MONITORS    2
+    { "monitors",   256, "Monitor sections" },
+#define KNOB_MODELINES   3
+    { "modelines",   16, "ModeLines in each Monitor section" },
+#define KNOB_OPTIONS     4
+    { "options",      8, "Options in each section" },
+#define KNOB_COMMENTS    5
+    { "comments",    25, "percentage of lines followed by a comment" },
+#define KNOB_METAMODES   6
+    { "metamodes",    4, "modes in the MetaModes option of each Screen" },
+#define KNOB_SEED        7
+    { "seed",         1, "seed of the generator" },
+#define KNOB_ITERATIONS  8
+    { "iterations",   5, "times each phase is run" },
+    { NULL, 0, NULL }
+};
+
+#define KNOB(k) (knobs[(k)].value)
+
+enum {
+    PHASE_READ = 0,
+    PHASE_VALIDATE,
+    PHASE_MERGE,
+    PHASE_WRITE,
+    PHASE_FREE,
+    NUM_PHASES
+};
+
+static const char *phase_names[NUM_PHASES] = {
+    "xconfigReadConfigFile",
+    "xconfigValidateConfig",
+    "xconfigMergeConfigs",
+    "xconfigWriteConfigFile",
+    "xconfigFreeConfig",
+};
+
+
+
+/*
+ * xconfigPrint() - the entry point that a user of the XF86Config-parser
+ * library must provide; only errors are printed.
+ */
+
+void xconfigPrint(MsgType t, const char *msg)
+{
+    switch (t) {
+    case ParseErrorMsg:
+    case ValidationErrorMsg:
+    case InternalErrorMsg:
+    case WriteErrorMsg:
+    case ErrorMsg:
+        fprintf(stderr, "xconfig-bench: %s\n", msg);
+        break;
+    default:
+        break;
+    }
+
+} /* xconfigPrint() */
+
+
+
+/*
+ * the generator: a 32-bit xorshift sequence, so that the generated
+ * config only depends on the seed
+ */
+
+static unsigned int rng_state;
+
+static unsigned int rng(unsigned int n)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+
+    return n ? (rng_state % n) : 0;
+}
+
+typedef struct {
+    FILE *fp;
+    int sections;
+} GenRec, *GenPtr;
+
+static void line(GenPtr gen, const char *fmt, ...)
+{
+    va_list ap;
+
+    va_start(ap, fmt);
+    vfprintf(gen->fp, fmt, ap);
+    va_end(ap);
+
+    fputc('\n', gen->fp);
+
+    if (rng(100) < (unsigned int) KNOB(KNOB_COMMENTS)) {
+        fprintf(gen->fp, "    # comment %u: the quick brown fox jumps over "
+                "the lazy dog\n", rng(100000));
+    }
+}
+
+static void options(GenPtr gen, const char *prefix)
+{
+    int i;
+
+    for (i = 0; i < KNOB(KNOB_OPTIONS); i++) {
+        line(gen, "    Option         \"%s%d\" \"%u\"", prefix, i, rng(1000));
+    }
+}
+
+
+
+/*
+ * generate() - write the synthetic X config to fp; variant changes the
+ * values, but not the identifiers, so that two variants can be merged.
+ * Returns the number of sections written.
+ */
+
+static int generate(FILE *fp, unsigned int variant)
+{
+    GenRec gen = { fp, 0 };
+    int i, j, hdisp, vdisp;
+
+    rng_state = 2463534242U ^ (KNOB(KNOB_SEED) * 2654435761U) ^
+        (variant * 40503U);
+
+    fprintf(fp, "# xconfig-bench synthetic X configuration\n\n");
+
+    gen.sections++;
+    line(&gen, "Section \"ServerLayout\"");
+    line(&gen, "    Identifier     \"Layout0\"");
+    for (i = 0; i < KNOB(KNOB_SCREENS); i++) {
+        if (i == 0) {
+            line(&gen, "    Screen      0  \"Screen0\" 0 0");
+        } else {
+            line(&gen, "    Screen      %d  \"Screen%d\" RightOf \"Screen%d\"",
+                 i, i, i - 1);
+        }
+    }
+    options(&gen, "Layout");
+    line(&gen, "EndSection\n");
+
+    for (i = 0; i < KNOB(KNOB_MONITORS); i++) {
+        gen.sections++;
+        line(&gen, "Section \"Monitor\"");
+        line(&gen, "    Identifier     \"Monitor%d\"", i);
+        line(&gen, "    VendorName     \"Vendor%u\"", rng(16));
+        line(&gen, "    ModelName      \"Model%u\"", rng(1000));
+        line(&gen, "    HorizSync       %u.0 - %u.0", 28 + rng(4),
+             60 + rng(100));
+        line(&gen, "    VertRefresh     %u.0 - %u.0", 43 + rng(7),
+             60 + rng(100));
+        for (j = 0; j < KNOB(KNOB_MODELINES); j++) {
+            hdisp = 640 + 16 * rng(160);
+            vdisp = 480 + 8 * rng(200);
+            line(&gen, "    ModeLine       \"%dx%d_%d\" %u.%02u %d %d %d %d "
+                 "%d %d %d %d %s %s", hdisp, vdisp, j,
+                 25 + rng(500), rng(100),
+                 hdisp, hdisp + 48, hdisp + 80, hdisp + 160,
+                 vdisp, vdisp + 3, vdisp + 9, vdisp + 30,
+                 rng(2) ? "+HSync" : "-HSync", rng(2) ? "+VSync" : "-VSync");
+        }
+        options(&gen, "Monitor");
+        line(&gen, "EndSection\n");
+    }
+
+    for (i = 0; i < KNOB(KNOB_DEVICES); i++) {
+        gen.sections++;
+        line(&gen, "Section \"Device\"");
+        line(&gen, "    Identifier     \"Device%d\"", i);
+        line(&gen, "    Driver         \"nvidia\"");
+        line(&gen, "    VendorName     \"NVIDIA Corporation\"");
+        line(&gen, "    BoardName      \"Board %u\"", rng(1000));
+        line(&gen, "    BusID          \"PCI:%d:%d:0\"", 1 + i / 32, i % 32);
+        options(&gen, "Device");
+        line(&gen, "EndSection\n");
+    }
+
+    for (i = 0; i < KNOB(KNOB_SCREENS); i++) {
+        gen.sections++;
+        line(&gen, "Section \"Screen\"");
+        line(&gen, "    Identifier     \"Screen%d\"", i);
+        line(&gen, "    Device         \"Device%d\"",
+             KNOB(KNOB_DEVICES) ? i % KNOB(KNOB_DEVICES) : 0);
+        line(&gen, "    Monitor        \"Monitor%d\"",
+             KNOB(KNOB_MONITORS) ? i % KNOB(KNOB_MONITORS) : 0);
+        line(&gen, "    DefaultDepth    24");
+        options(&gen, "Screen");
+        if (KNOB(KNOB_METAMODES) > 0) {
+            fprintf(fp, "    Option         \"MetaModes\" \"");
+            for (j = 0; j < KNOB(KNOB_METAMODES); j++) {
+                fprintf(fp, "%sDPY-%d: %ux%u +%d+0", j ? ", " : "", j,
+                        640 + 16 * rng(160), 480 + 8 * rng(200), 1920 * j);
+            }
+            line(&gen, "\"");
+        }
+        line(&gen, "    SubSection     \"Display\"");
+        line(&gen, "        Depth       24");
+        line(&gen, "        Modes      \"1920x1080\" \"1280x1024\"");
+        line(&gen, "    EndSubSection");
+        line(&gen, "EndSection\n");
+    }
+
+    return gen.sections;
+
+} /* generate() */
+
+
+
+/*
+ * generate_file() - generate the given variant into a new temporary
+ * file; returns its name, and its size and section count in bytes and
+ * sections
+ */
+
+static char *generate_file(const char *tmpdir, unsigned int variant,
+                           long *bytes, int *sections)
+{
+    char *path = malloc(strlen(tmpdir) + 32);
+    FILE *fp;
+    int fd, n;
+
+    sprintf(path, "%s/xconfig-bench.XXXXXX", tmpdir);
+
+    if ((fd = mkstemp(path)) < 0 || !(fp = fdopen(fd, "w"))) {
+        perror("xconfig-bench: unable to create a temporary file");
+        exit(1);
+    }
+
+    n = generate(fp, variant);
+
+    if (bytes) *bytes = ftell(fp);
+    if (sections) *sections = n;
+
+    if (fclose(fp) != 0) {
+        perror("xconfig-bench: unable to write a temporary file");
+        exit(1);
+    }
+
+    return path;
+
+} /* generate_file() */
+
+
+
+static XConfigPtr read_config(const char *path)
+{
+    XConfigPtr config = NULL;
+
+    if (!xconfigOpenConfigFilePath(path)) {
+        fprintf(stderr, "xconfig-bench: unable to open %s\n", path);
+        exit(1);
+    }
+
+    if (xconfigReadConfigFileLayer(&config) != XCONFIG_RETURN_SUCCESS) {
+        fprintf(stderr, "xconfig-bench: unable to read %s\n", path);
+        exit(1);
+    }
+
+    xconfigCloseConfigFile();
+
+    return config;
+}
+
+static unsigned long long now_usecs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (unsigned long long) ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+
+
+static void usage(void)
+{
+    int i;
+
+    fprintf(stderr, "usage: xconfig-bench [--dump=FILE] [--NAME=VALUE]...\n"
+            "\n"
+            "  --dump=FILE  write the generated X config to FILE, and exit\n");
+
+    for (i = 0; knobs[i].name; i++) {
+        fprintf(stderr, "  --%s=N%*s%s (default %d)\n", knobs[i].name,
+                (int) (11 - strlen(knobs[i].name)), "", knobs[i].help,
+                knobs[i].value);
+    }
+
+    exit(2);
+}
+
+static const char *parse_args(int argc, char *argv[])
+{
+    const char *dump = NULL;
+    char *value, *end;
+    size_t len;
+    int i, k;
+
+    for (i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--", 2) || !(value = strchr(argv[i], '='))) {
+            usage();
+        }
+        len = value - argv[i] - 2;
+        value++;
+
+        if (len == 4 && strncmp(argv[i] + 2, "dump", 4) == 0) {
+            dump = value;
+            continue;
+        }
+
+        for (k = 0; knobs[k].name; k++) {
+            if (strlen(knobs[k].name) == len &&
+                strncmp(argv[i] + 2, knobs[k].name, len) == 0) break;
+        }
+
+        if (!knobs[k].name) usage();
+
+        knobs[k].value = strtol(value, &end, 10);
+        if (*end || knobs[k].value < 0) usage();
+    }
+
+    if (KNOB(KNOB_SCREENS) == 0 || KNOB(KNOB_DEVICES) == 0 ||
+        KNOB(KNOB_MONITORS) == 0 || KNOB(KNOB_ITERATIONS) == 0) {
+        fprintf(stderr, "xconfig-bench: screens, devices, monitors and "
+                "iterations must be positive\n");
+        exit(2);
+    }
+
+    return dump;
+}
+
+
+
+int main(int argc, char *argv[])
+{
+    unsigned long long best[NUM_PHASES], total[NUM_PHASES], t, usecs;
+    const char *dump, *tmpdir;
+    char *input, *merge, *output;
+    XConfigPtr config = NULL, src;
+    struct rusage usage;
+    long bytes, out_bytes = 0;
+    int i, p, sections;
+    FILE *fp;
+
+    dump = parse_args(argc, argv);
+
+    if (dump) {
+        if (!(fp = fopen(dump, "w"))) {
+            perror("xconfig-bench: unable to open the dump file");
+            return 1;
+        }
+        generate(fp, 0);
+        return (fclose(fp) == 0) ? 0 : 1;
+    }
+
+    tmpdir = getenv("TMPDIR");
+    if (!tmpdir || !*tmpdir) tmpdir = "/tmp";
+
+    input = generate_file(tmpdir, 0, &bytes, &sections);
+    merge = generate_file(tmpdir, 1, NULL, NULL);
+    output = generate_file(tmpdir, 2, NULL, NULL);
+
+    memset(total, 0, sizeof(total));
+
+    for (i = 0; i < KNOB(KNOB_ITERATIONS); i++) {
+
+        /* the config to merge is changed by the merge; read it anew */
+
+        src = read_config(merge);
+
+        for (p = 0; p < NUM_PHASES; p++) {
+
+            t = now_usecs();
+
+            switch (p) {
+            case PHASE_READ:
+                config = read_config(input);
+                break;
+            case PHASE_VALIDATE:
+                if (!xconfigValidateConfig(config)) {
+                    fprintf(stderr, "xconfig-bench: validation failed\n");
+                    return 1;
+                }
+                break;
+            case PHASE_MERGE:
+                if (!xconfigMergeConfigs(config, src)) {
+                    fprintf(stderr, "xconfig-bench: merge failed\n");
+                    return 1;
+                }
+                break;
+            case PHASE_WRITE:
+                if (!xconfigWriteConfigFile(output, config)) {
+                    fprintf(stderr, "xconfig-bench: write failed\n");
+                    return 1;
+                }
+                break;
+            case PHASE_FREE:
+                xconfigFreeConfig(&config);
+                break;
+            }
+
+            usecs = now_usecs() - t;
+
+            total[p] += usecs;
+            if (i == 0 || usecs < best[p]) best[p] = usecs;
+        }
+
+        xconfigFreeConfig(&src);
+    }
+
+    if ((fp = fopen(output, "r"))) {
+        fseek(fp, 0, SEEK_END);
+        out_bytes = ftell(fp);
+        fclose(fp);
+    }
+
+    unlink(input);
+    unlink(merge);
+    unlink(output);
+
+    /* the throughput of each phase is over the generated config */
+
+    printf("{\n  \"params\": {");
+    for (i = 0; knobs[i].name; i++) {
+        printf("%s \"%s\": %d", i ? "," : "", knobs[i].name, knobs[i].value);
+    }
+    printf(" },\n");
+    printf("  \"input\": { \"bytes\": %ld, \"sections\": %d },\n",
+           bytes, sections);
+    printf("  \"output\": { \"bytes\": %ld },\n", out_bytes);
+    printf("  \"phases\": [\n");
+    for (p = 0; p < NUM_PHASES; p++) {
+        usecs = best[p] ? best[p] : 1;
+        printf("    { \"name\": \"%s\", \"best_us\": %llu, \"mean_us\": %llu, "
+               "\"mb_per_sec\": %.2f, \"sections_per_sec\": %llu }%s\n",
+               phase_names[p], best[p], total[p] / KNOB(KNOB_ITERATIONS),
+               (double) bytes / usecs,
+               (unsigned long long) sections * 1000000ULL / usecs,
+               (p + 1 < NUM_PHASES) ? "," : "");
+    }
+    printf("  ],\n");
+
+    /* ru_maxrss is in kilobytes on Linux */
+
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        printf("  \"peak_rss_kb\": %ld\n", (long) usage.ru_maxrss);
+    } else {
+        printf("  \"peak_rss_kb\": null\n");
+    }
+    printf("}\n");
+
+    free(input);
+    free(merge);
+    free(output);
+
+    return 0;
+}
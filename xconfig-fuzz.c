@@ -0,0 +1,264 @@
+/*
+ * nvidia-xconfig: A tool for manipulating X config files,
+ * specifically for use by the NVIDIA Linux graphics driver.
+ *
+ * Copyright (C) 2004 NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>.
+ *
+ *
+ * xconfig-fuzz.c - round-trip fuzzing harness for the
+ * XF86Config-parser library.
+ *
+ * Each input is parsed from memory; if it parses, it is written with
+ * xconfigWriteConfigBuffer(), and the written text is parsed and
+ * written again.  The two written texts must be identical, i.e.,
+ * parse(write(parse(x))) must equal parse(x); otherwise the harness
+ * aborts, so that the fuzzer keeps the input.
+ *
+ * Built with -DXCONFIG_FUZZ_LIBFUZZER and -fsanitize=fuzzer, this is a
+ * libFuzzer target.  Otherwise, it has a main() that runs each file
+ * named on the command line, or stdin if there are none (as AFL runs
+ * it), and prints the parse time of each input; an input that takes
+ * longer than '--max-parse-ms' to parse fails, so that pathological
+ * inputs can be kept as regression cases.  'make fuzz' runs it over
+ * the inputs in fuzz-corpus/.  No X server or GPU is needed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "xf86Parser.h"
+
+
+/*
+ * xconfigPrint() - the entry point that a user of the XF86Config-parser
+ * library must provide; parse errors are expected, and not printed.
+ */
+
+void xconfigPrint(MsgType t, const char *msg)
+{
+    (void) t;
+    (void) msg;
+
+} /* xconfigPrint() */
+
+
+
+static unsigned long long now_usecs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (unsigned long long) ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+
+
+/*
+ * parse() - parse len bytes of buf as an X config file; returns NULL
+ * if it does not parse.  Name references are not validated, so that
+ * inputs with dangling references still reach the writer.
+ */
+
+static XConfigPtr parse(const char *buf, size_t len)
+{
+    XConfigPtr config = NULL;
+
+    if (!xconfigOpenConfigBuffer("fuzz-input", buf, len)) {
+        return NULL;
+    }
+
+    if (xconfigReadConfigFileLayer(&config) != XCONFIG_RETURN_SUCCESS) {
+        config = NULL;
+    }
+
+    xconfigCloseConfigFile();
+
+    return config;
+}
+
+
+
+/*
+ * write_config() - write the config, and free it
+ */
+
+static char *write_config(XConfigPtr config, size_t *len)
+{
+    char *buf = xconfigWriteConfigBuffer(config, len);
+
+    xconfigFreeConfig(&config);
+
+    if (!buf) {
+        fprintf(stderr, "xconfig-fuzz: unable to write a parsed config\n");
+        abort();
+    }
+
+    return buf;
+}
+
+
+
+/*
+ * round_trip() - check that parse(write(parse(x))) == parse(x); the
+ * time taken by the first parse is returned in parse_usecs.  Returns
+ * TRUE if the input parsed.
+ */
+
+static int round_trip(const uint8_t *data, size_t size,
+                      unsigned long long *parse_usecs)
+{
+    XConfigPtr config;
+    char *text1, *text2;
+    size_t len1, len2;
+    unsigned long long t;
+
+    t = now_usecs();
+    config = parse((const char *) data, size);
+    *parse_usecs = now_usecs() - t;
+
+    if (!config) return FALSE;
+
+    text1 = write_config(config, &len1);
+
+    config = parse(text1, len1);
+    if (!config) {
+        fprintf(stderr, "xconfig-fuzz: the written config does not parse:\n"
+                "%s\n", text1);
+        abort();
+    }
+
+    text2 = write_config(config, &len2);
+
+    if ((len1 != len2) || (memcmp(text1, text2, len1) != 0)) {
+        fprintf(stderr, "xconfig-fuzz: the config changed when written "
+                "and parsed again:\n--- first:\n%s\n--- second:\n%s\n",
+                text1, text2);
+        abort();
+    }
+
+    free(text1);
+    free(text2);
+
+    return TRUE;
+}
+
+
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    unsigned long long usecs;
+
+    round_trip(data, size, &usecs);
+
+    return 0;
+}
+
+
+
+#ifndef XCONFIG_FUZZ_LIBFUZZER
+
+/*
+ * read_input() - read all of fp into a new buffer
+ */
+
+static uint8_t *read_input(FILE *fp, size_t *size)
+{
+    uint8_t *buf = NULL;
+    size_t n, alloc = 0;
+
+    *size = 0;
+
+    do {
+        if (*size == alloc) {
+            alloc = alloc ? alloc * 2 : 65536;
+            if (!(buf = realloc(buf, alloc))) {
+                fprintf(stderr, "xconfig-fuzz: out of memory\n");
+                exit(1);
+            }
+        }
+        n = fread(buf + *size, 1, alloc - *size, fp);
+        *size += n;
+    } while (n > 0);
+
+    return buf;
+}
+
+
+
+/*
+ * run_input() - run the named input file ("-" is stdin); returns FALSE
+ * if it took longer than max_usecs to parse
+ */
+
+static int run_input(const char *name, unsigned long long max_usecs)
+{
+    FILE *fp = strcmp(name, "-") ? fopen(name, "rb") : stdin;
+    unsigned long long usecs;
+    uint8_t *data;
+    size_t size;
+    int parsed;
+
+    if (!fp) {
+        perror(name);
+        exit(1);
+    }
+
+    data = read_input(fp, &size);
+    if (fp != stdin) fclose(fp);
+
+    parsed = round_trip(data, size, &usecs);
+
+    printf("%-48s %10lu bytes %10llu us  %s\n", name, (unsigned long) size,
+           usecs, parsed ? "round-trip ok" : "does not parse");
+
+    free(data);
+
+    if (max_usecs && (usecs > max_usecs)) {
+        printf("%s: parsing took longer than %llu ms\n", name,
+               max_usecs / 1000);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+
+
+int main(int argc, char *argv[])
+{
+    unsigned long long max_usecs = 0;
+    int i, ret = 0, ninputs = 0;
+
+    for (i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--max-parse-ms=", 15) == 0) {
+            max_usecs = strtoull(argv[i] + 15, NULL, 10) * 1000ULL;
+            continue;
+        }
+        ninputs++;
+        if (!run_input(argv[i], max_usecs)) ret = 1;
+    }
+
+    if (ninputs == 0 && !run_input("-", max_usecs)) ret = 1;
+
+    return ret;
+}
+
+#endif /* XCONFIG_FUZZ_LIBFUZZER */